@@ -0,0 +1,198 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <omgl/job_system.hpp>
+#include <omgl/mesh_pool.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <unordered_set>
+#include <vector>
+
+namespace omgl {
+
+// Per-object data the shaders get to see. Laid out to match
+//     struct ObjectData { mat4 model; vec4 color; };
+// in a std430 SSBO (or five texels of a samplerBuffer on GL 3.3).
+struct ObjectData {
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// Collects a frame's draws and submits them in as few calls as possible.
+//
+// Every submitted draw gets a 64 bit key (program, VAO, material), the list
+// is sorted by it and each run of equal keys becomes one bucket. On GL 4.3
+// a bucket is a single glMultiDrawElementsIndirect and the per-object data
+// goes into an SSBO indexed by the instance id. On GL 3.3 there is no
+// indirect drawing and no base instance, so consecutive draws of the same
+// mesh within a bucket become one glDrawElementsInstancedBaseVertex and the
+// per-object data goes through a texture buffer.
+//
+// Either way the vertex shader finds its object through a uint attribute at
+// `object_id_location` (divisor 1), which the renderer adds to every VAO it
+// draws from:
+//
+//     layout(location = 15) in uint a_object_id;
+//     layout(std430, binding = 0) buffer Objects { ObjectData objects[]; };
+//     ... objects[a_object_id] ...
+//
+// or on 3.3:
+//
+//     uniform samplerBuffer objects;
+//     uniform int object_texel_offset;
+//     ... texelFetch(objects, object_texel_offset + int(a_object_id) * 5 + i)
+//
+// With a JobSystem the CPU side of the frame runs on its workers:
+// submitMany() culls and builds the sort keys there, flush() sorts there and
+// has them fill the buffers the GL thread mapped. The GL thread only
+// allocates, commits and draws.
+class BatchRenderer {
+   public:
+    struct Stats {
+        std::size_t objects = 0;
+        // groups with the same key, program, pool and material
+        std::size_t buckets = 0;
+        std::size_t draw_calls = 0;
+        // draws submitMany() left out
+        std::size_t culled = 0;
+    };
+
+    // One object for submitMany().
+    struct Draw {
+        ShaderProgram* program = nullptr;
+        MeshPool* pool = nullptr;
+        MeshHandle mesh;
+        // level of detail, see MeshPool::range()
+        std::uint32_t lod = 0;
+        std::uint32_t material = 0;
+        ObjectData data;
+    };
+
+    // Fills in draw `index` and returns false if it shouldn't be drawn. Runs
+    // on the job system's workers, so it can't touch GL.
+    using DrawPreparer = std::function<bool(std::size_t index, Draw& draw)>;
+
+    // Called whenever the material changes between buckets, with the
+    // bucket's program already in use.
+    using MaterialBinder =
+        std::function<void(ShaderProgram& program, std::uint32_t material)>;
+
+    BatchRenderer(
+        std::size_t max_objects,
+        gl::GLuint object_id_location = 15,
+        gl::GLuint object_binding = 0
+    );
+    ~BatchRenderer();
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    void setMaterialBinder(MaterialBinder binder);
+
+    // Spreads submitMany() and flush() over `jobs`, null goes back to doing
+    // everything on the calling thread. The job system has to outlive the
+    // renderer, or the next setJobSystem().
+    void setJobSystem(JobSystem* jobs);
+
+    // Queues a draw for this frame. The program, pool and mesh have to stay
+    // alive until flush().
+    void submit(
+        ShaderProgram& program,
+        MeshPool& pool,
+        MeshHandle mesh,
+        std::uint32_t material,
+        const ObjectData& data,
+        std::uint32_t lod = 0
+    );
+
+    // Queues `count` draws, in index order, skipping the ones `prepare`
+    // culls. Same rules as submit() for what has to stay alive, and the
+    // pools mustn't change until it returns.
+    void submitMany(std::size_t count, const DrawPreparer& prepare);
+
+    // Sorts, uploads and draws everything submitted since the last flush.
+    void flush();
+
+    // True on the multi-draw-indirect path, false on the GL 3.3 fallback.
+    bool usesIndirect() const { return indirect; }
+
+    // Stats of the last flush.
+    const Stats& stats() const { return frame_stats; }
+
+    // program in the top 20 bits, VAO in the next 20, material in the low 24.
+    // Larger ids wrap around and share keys, flush() still tells them apart.
+    static std::uint64_t makeSortKey(
+        gl::GLuint program,
+        gl::GLuint vao,
+        std::uint32_t material
+    );
+
+   private:
+    struct DrawItem {
+        std::uint64_t key;
+        ShaderProgram* program;
+        MeshPool* pool;
+        DrawRange range;
+        std::uint32_t material;
+        ObjectData data;
+    };
+
+    struct DrawElementsIndirectCommand {
+        std::uint32_t count;
+        std::uint32_t instance_count;
+        std::uint32_t first_index;
+        std::int32_t base_vertex;
+        std::uint32_t base_instance;
+    };
+
+    // adds the object id attribute to a pool's VAO the first time we see it
+    void prepareVao(MeshPool& pool);
+
+    // whether two draws can share a bucket; the key alone isn't enough
+    // since ids past its fields alias
+    static bool sameBucket(const DrawItem& a, const DrawItem& b);
+
+    // binds program/VAO/material if they differ from the previous bucket
+    void bindBucket(const DrawItem& item, const DrawItem* previous);
+
+    void flushIndirect();
+    void flushInstanced();
+
+    // body(begin, end) over [0, count), on the job system if there is one
+    template <typename Body>
+    void forChunks(std::size_t count, Body&& body);
+
+    std::size_t max_objects;
+    gl::GLuint object_id_location;
+    gl::GLuint object_binding;
+    bool indirect;
+
+    // 0, 1, 2, ... fed to the object id attribute
+    gl::GLuint object_id_buffer;
+    // by MeshPool::serial(), VAO names get reused
+    std::unordered_set<std::uint64_t> prepared_pools;
+
+    std::unique_ptr<StreamBuffer> object_stream;
+    std::unique_ptr<StreamBuffer> command_stream;
+    std::size_t object_alignment;
+
+    // texture buffer view of object_stream on the fallback path, bound to
+    // texture unit `object_binding`
+    gl::GLuint object_texture = 0;
+
+    MaterialBinder material_binder;
+    JobSystem* jobs = nullptr;
+
+    std::vector<DrawItem> items;
+    // how many each chunk of submitMany() kept
+    std::vector<std::size_t> chunk_counts;
+    std::size_t culled = 0;
+    std::vector<std::uint32_t> order;
+    Stats frame_stats;
+};
+
+}  // namespace omgl
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace omgl {
+
+// "vendor / renderer / version" of the current context. Anything derived
+// from driver output (like program binaries) should be keyed on this.
+std::string driver_identity();
+
+// Whether the current context advertises the extension, eg.
+// "GL_KHR_parallel_shader_compile". The list is read once per context, see
+// StateCache::extensions().
+bool has_extension(std::string_view name);
+
+// Whether the current context is at least version major.minor.
+bool gl_version_at_least(int major, int minor);
+
+}  // namespace omgl
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <omgl/instanced_mesh.hpp>
+#include <span>
+
+namespace omgl {
+
+// Bulk transforms and frustum culling over arrays of instances.
+//
+// Every function here has a scalar, an SSE2 and an AVX2+FMA kernel. The
+// best one the CPU supports is picked on first use, force_simd_level()
+// overrides that (for comparisons, mostly).
+
+enum class SimdLevel {
+    scalar,
+    sse2,
+    avx2,
+};
+
+const char* to_string(SimdLevel level);
+
+// What the kernels use right now.
+SimdLevel simd_level();
+// The best level this CPU can run.
+SimdLevel supported_simd_level();
+// Clamped to what the CPU supports, returns the level actually used.
+SimdLevel force_simd_level(SimdLevel level);
+
+// Six planes (left, right, bottom, top, near, far) as (normal, distance),
+// normalized and pointing inwards: a point p is inside a plane when
+// dot(normal, p) + distance >= 0.
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+
+    // Extracts the planes of a view-projection matrix with GL's -1..1 clip
+    // depth. Points come out in whatever space the matrix takes in, world
+    // space for a view-projection.
+    static Frustum fromMatrix(const glm::mat4& view_projection);
+
+    bool containsSphere(const glm::vec3& center, float radius) const;
+};
+
+// Axis-aligned boxes, one array per coordinate. All the spans have the
+// same length.
+struct AabbArrays {
+    std::span<const float> min_x;
+    std::span<const float> min_y;
+    std::span<const float> min_z;
+    std::span<const float> max_x;
+    std::span<const float> max_y;
+    std::span<const float> max_z;
+};
+
+// Culls every instance as a sphere around its position, of radius
+// `bounding_radius` times its scale, and writes the visible ones straight
+// into `out` in the GPU layout, in order and without gaps. `out` needs room
+// for instances.size() in the worst case. Returns how many were written.
+std::size_t cull_instances(
+    const Frustum& frustum,
+    const InstanceStore& instances,
+    float bounding_radius,
+    std::span<InstanceData> out
+);
+
+// Writes the indices of the boxes that are at least partly inside, in
+// order. `visible` needs room for all of them. Returns the count.
+std::size_t cull_aabbs(
+    const Frustum& frustum,
+    const AabbArrays& boxes,
+    std::span<std::uint32_t> visible
+);
+
+// out[i] = view_projection * models[i]
+void multiply_matrices(
+    const glm::mat4& view_projection,
+    std::span<const glm::mat4> models,
+    std::span<glm::mat4> out
+);
+
+}  // namespace omgl
@@ -0,0 +1,44 @@
+#pragma once
+#include <filesystem>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// Tells you which of a set of files changed on disk, through inotify.
+//
+// Watches the directories rather than the files themselves: editors tend to
+// save by writing a new file and renaming it over the old one, which a
+// watch on the old inode would never see. The kernel queues the events, so
+// there's no thread here, changes() just drains the queue without blocking.
+class FileWatcher {
+   public:
+    // Throws if inotify isn't available.
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watching the same file twice is fine.
+    void watch(const fs::path& file);
+    // Unwatching a file that isn't watched is fine too.
+    void unwatch(const fs::path& file);
+
+    const std::set<fs::path>& watched() const { return files; }
+
+    // Files that were written and closed, or replaced, since the last call,
+    // each once.
+    std::vector<fs::path> changes();
+
+   private:
+    int inotify_fd;
+    // watch descriptor -> directory
+    std::unordered_map<int, fs::path> directories;
+    std::set<fs::path> files;
+};
+
+}  // namespace omgl
@@ -0,0 +1,166 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <omgl/job_system.hpp>
+#include <optional>
+#include <vector>
+
+namespace omgl {
+
+// A render loop that overlaps the CPU side of frame N + 1 with the GL
+// submission of frame N.
+//
+// Every iteration:
+//
+//   1. poll() on the GL thread, for input and window events
+//   2. update(step) as many times as the fixed time step says, GL thread
+//   3. prepare(N + 1) on a worker, filling frame N + 1's slot
+//   4. submit(N) and present() on the GL thread, while 3 runs
+//   5. wait for prepare(N + 1)
+//
+// Each frame gets one of `frames_in_flight` slots for whatever it writes
+// and the GPU reads (mapped buffers, StreamBuffer regions, staging arrays),
+// and a fence after its submit. A slot is only handed out again once its
+// fence signaled, which also caps how far the GPU can fall behind. So the
+// CPU runs one frame ahead and the GPU at most frames_in_flight - 1 more.
+//
+// prepare() must not touch GL or the simulation state update() writes
+// to, anything else it needs it reads. submit() should only read the slot
+// prepare() filled. Without a JobSystem, or with a single frame in flight,
+// prepare() runs on the GL thread right before its own submit() and
+// nothing overlaps.
+//
+//     omgl::FrameLoop loop(
+//         {.frames_in_flight = 3},
+//         {
+//             .poll = [&] { return !glfwWindowShouldClose(window); },
+//             .update = [&](double step) { simulate(state, step); },
+//             .prepare = [&](const omgl::FrameLoop::Frame& frame) { ... },
+//             .submit = [&](const omgl::FrameLoop::Frame& frame) { ... },
+//             .present = [&] { glfwSwapBuffers(window); glfwPollEvents(); },
+//         },
+//         &jobs
+//     );
+//     loop.run();
+class FrameLoop {
+   public:
+    struct Config {
+        // simulated time per update() call
+        std::chrono::duration<double> update_step{1.0 / 60.0};
+        // after a hitch, updates past this many are dropped instead of
+        // caught up
+        std::size_t max_updates_per_frame = 5;
+        // frames the GPU may still be working on, also the slot count
+        std::size_t frames_in_flight = 2;
+    };
+
+    struct Frame {
+        std::uint64_t index;
+        // which per-frame resources this frame owns, < frames_in_flight
+        std::size_t slot;
+        // how far the frame is between the last two updates, 0..1, for
+        // interpolating the simulation state
+        double alpha;
+        // simulated seconds after the last update
+        double time;
+    };
+
+    struct Callbacks {
+        // false ends the loop
+        std::function<bool()> poll;
+        std::function<void(double step)> update;
+        std::function<void(const Frame& frame)> prepare;
+        std::function<void(const Frame& frame)> submit;
+        // swap buffers or nothing at all
+        std::function<void()> present;
+    };
+
+    struct Stats {
+        std::size_t frames = 0;
+        std::size_t updates = 0;
+        std::size_t dropped_updates = 0;
+        // times a slot was still in use by the GPU
+        std::size_t fence_waits = 0;
+        double fence_wait_ms = 0;
+        // from the poll() a frame's input came from to its present()
+        double avg_latency_ms = 0;
+        double max_latency_ms = 0;
+        // from submit() to its fence signaling, as far as the polling can
+        // tell
+        double avg_gpu_ms = 0;
+        double max_gpu_ms = 0;
+    };
+
+    FrameLoop(Config config, Callbacks callbacks, JobSystem* jobs = nullptr);
+    // Waits for the GPU to finish every frame in flight.
+    ~FrameLoop();
+
+    FrameLoop(const FrameLoop&) = delete;
+    FrameLoop& operator=(const FrameLoop&) = delete;
+
+    // One iteration. Returns false once poll() did, after submitting the
+    // frame that was already prepared.
+    bool step();
+
+    // Steps until poll() returns false or `max_frames` were presented.
+    void run(
+        std::uint64_t max_frames = std::numeric_limits<std::uint64_t>::max()
+    );
+
+    // True when prepare() runs alongside submit().
+    bool pipelined() const { return jobs != nullptr && slots.size() > 1; }
+
+    Stats stats() const;
+    void logStats() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        gl::GLsync fence = nullptr;
+        Clock::time_point submitted;
+    };
+
+    struct PreparedFrame {
+        Frame frame;
+        // when the input it's built from was polled
+        Clock::time_point polled;
+    };
+
+    // runs the fixed updates and returns the next frame
+    Frame advance(Clock::time_point now);
+    // blocks until the slot's last frame is off the GPU
+    void waitSlot(std::size_t slot);
+    // retires every fence that signaled, without blocking
+    void pollFences();
+    void retire(Slot& slot, Clock::time_point now);
+    void submitFrame(const PreparedFrame& prepared);
+
+    Config config;
+    Callbacks callbacks;
+    JobSystem* jobs;
+
+    std::vector<Slot> slots;
+    std::uint64_t next_index = 0;
+    std::uint64_t presented = 0;
+    bool running = true;
+
+    Clock::time_point last_time;
+    bool started = false;
+    double accumulator = 0;
+    double simulated = 0;
+
+    // prepared last iteration, submitted this one
+    std::optional<PreparedFrame> pending;
+
+    Stats loop_stats;
+    double total_latency_ms = 0;
+    double total_gpu_ms = 0;
+    std::size_t gpu_samples = 0;
+};
+
+}  // namespace omgl
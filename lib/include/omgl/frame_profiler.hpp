@@ -0,0 +1,171 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// Per-frame timing for CPU and GPU work.
+//
+//     omgl::FrameProfiler profiler;
+//     while (...) {
+//         profiler.beginFrame();
+//         {
+//             auto zone = profiler.cpuZone("update");
+//             ...
+//         }
+//         {
+//             auto zone = profiler.gpuZone("draw");
+//             ...
+//         }
+//         profiler.endFrame();
+//     }
+//
+// GPU zones are GL_TIME_ELAPSED queries. They're double buffered: the
+// queries issued in frame N are read in frame N + 2, and a result that still
+// isn't there is dropped instead of waited on. GL doesn't allow time elapsed
+// queries to nest, so neither do GPU zones.
+//
+// Each zone keeps a sliding window of samples for min/avg/p99. Stats can go
+// to spdlog every so often and whole frames can be recorded into a Chrome
+// trace (load it in chrome://tracing or ui.perfetto.dev).
+//
+// CPU zones can be opened from any thread, everything else belongs to the GL
+// thread.
+class FrameProfiler {
+   public:
+    struct ZoneStats {
+        std::string name;
+        bool gpu;
+        std::size_t samples;
+        double min_ms;
+        double avg_ms;
+        double p99_ms;
+    };
+
+    class CpuScope {
+       public:
+        CpuScope(FrameProfiler& profiler, std::uint32_t zone);
+        ~CpuScope();
+        CpuScope(const CpuScope&) = delete;
+        CpuScope& operator=(const CpuScope&) = delete;
+
+       private:
+        FrameProfiler& profiler;
+        std::uint32_t zone;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    class GpuScope {
+       public:
+        GpuScope(FrameProfiler& profiler, std::uint32_t zone);
+        ~GpuScope();
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+
+       private:
+        FrameProfiler& profiler;
+    };
+
+    FrameProfiler(std::size_t window_size = 240);
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    CpuScope cpuZone(std::string_view name);
+    GpuScope gpuZone(std::string_view name);
+
+    // Collects the GPU results from two frames ago and starts the "frame"
+    // zone.
+    void beginFrame();
+    // Ends the "frame" zone and logs the stats if the interval has passed.
+    void endFrame();
+
+    // How often endFrame() logs stats, zero turns logging off.
+    void setLogInterval(std::chrono::milliseconds interval);
+
+    // Records every zone into a trace until stopTrace() or until
+    // `max_events` have been recorded.
+    void startTrace(std::size_t max_events = 1'000'000);
+    void stopTrace();
+    void writeChromeTrace(const fs::path& path) const;
+
+    std::vector<ZoneStats> stats() const;
+    void logStats() const;
+
+    // GPU samples thrown away because the result wasn't ready in time
+    std::size_t droppedGpuSamples() const { return dropped_gpu_samples; }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Zone {
+        std::string name;
+        bool gpu;
+        // ring of the last window_size samples in milliseconds
+        std::vector<float> samples;
+        std::size_t next_sample = 0;
+        std::size_t sample_count = 0;
+    };
+
+    struct GpuQuery {
+        gl::GLuint query;
+        std::uint32_t zone;
+        // CPU time the zone was opened, used to place it in the trace
+        double start_us;
+    };
+
+    struct TraceEvent {
+        std::uint32_t zone;
+        std::uint32_t thread;
+        double start_us;
+        double duration_us;
+    };
+
+    std::uint32_t zoneIndex(std::string_view name, bool gpu);
+    void addSample(std::uint32_t zone, double start_us, double duration_us);
+    void endCpuZone(std::uint32_t zone, Clock::time_point start);
+    void beginGpuZone(std::uint32_t zone);
+    void endGpuZone();
+    void collectGpuQueries(std::vector<GpuQuery>& queries);
+    double microsecondsSinceStart(Clock::time_point time) const;
+
+    std::size_t window_size;
+    Clock::time_point start_time;
+
+    mutable std::mutex mutex;
+    std::vector<Zone> zones;
+    std::unordered_map<std::string, std::uint32_t> zone_lookup;
+
+    // one set of queries per frame parity
+    std::array<std::vector<GpuQuery>, 2> gpu_queries;
+    std::vector<gl::GLuint> free_queries;
+    std::uint64_t frame_number = 0;
+    bool gpu_zone_open = false;
+    std::size_t dropped_gpu_samples = 0;
+
+    std::uint32_t frame_zone;
+    Clock::time_point frame_start;
+
+    std::chrono::milliseconds log_interval{0};
+    Clock::time_point last_log;
+
+    bool tracing = false;
+    std::size_t max_trace_events = 0;
+    std::vector<TraceEvent> trace_events;
+    // small per-thread ids for the trace
+    std::unordered_map<std::size_t, std::uint32_t> trace_threads;
+};
+
+}  // namespace omgl
@@ -0,0 +1,132 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace omgl {
+
+struct CapturedFrame {
+    // counts capture() calls, starting at 0
+    std::uint64_t index;
+    std::size_t width;
+    std::size_t height;
+    // tightly packed RGBA8, bottom row first like GL
+    std::span<const std::uint8_t> pixels;
+};
+
+// Reads frames back without stalling the render loop.
+//
+// capture() only queues a glReadPixels into one of N pixel pack buffers and
+// drops a fence behind it. poll() looks at the fences without waiting, copies
+// every finished frame out of its buffer and hands it to the consumer, which
+// runs on its own thread. The render thread only ever waits when all N
+// buffers are still in flight, which shows up as a stall in the stats.
+//
+// At most N copied frames wait for the consumer. When it falls further
+// behind, poll() leaves finished frames in their buffers and capture()
+// blocks until the consumer catches up, so no frame is ever dropped and
+// memory stays bounded however long the capture runs.
+//
+// The consumer must not hold on to the pixel span after it returns.
+class FrameReader {
+   public:
+    using Consumer = std::function<void(const CapturedFrame&)>;
+
+    struct Stats {
+        std::size_t captured = 0;
+        std::size_t delivered = 0;
+        // times capture() had to wait for the oldest buffer
+        std::size_t stalls = 0;
+        // times it then also had to wait for the consumer
+        std::size_t consumer_stalls = 0;
+        // from capture() until the pixels were copied out of the buffer
+        double avg_readback_ms = 0;
+        double max_readback_ms = 0;
+    };
+
+    FrameReader(
+        std::size_t width,
+        std::size_t height,
+        std::size_t buffer_count,
+        Consumer consumer
+    );
+    // Finishes every pending readback before returning.
+    ~FrameReader();
+
+    FrameReader(const FrameReader&) = delete;
+    FrameReader& operator=(const FrameReader&) = delete;
+
+    // Queues a readback of the bound read framebuffer.
+    void capture();
+
+    // Hands finished readbacks to the consumer, never blocks. Call it once a
+    // frame.
+    void poll();
+
+    // Waits until everything captured so far went through the consumer.
+    void flush();
+
+    // readbacks the GPU is still working on
+    std::size_t inFlight() const { return in_flight; }
+    // frames copied out but not yet through the consumer
+    std::size_t queued() const;
+
+    Stats stats() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        gl::GLuint pbo;
+        gl::GLsync fence = nullptr;
+        std::uint64_t frame_index = 0;
+        Clock::time_point issued;
+    };
+
+    struct PendingFrame {
+        std::uint64_t index;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    // copies the oldest slot out and queues it for the consumer, waiting
+    // for room in the queue
+    void retireOldest();
+    bool queueFull() const;
+    void consumerLoop(std::stop_token stop);
+
+    std::size_t width;
+    std::size_t height;
+    std::size_t frame_bytes;
+
+    std::vector<Slot> slots;
+    // oldest in-flight slot
+    std::size_t tail = 0;
+    std::size_t in_flight = 0;
+    std::uint64_t next_frame_index = 0;
+
+    Consumer consumer;
+
+    // everything below is shared with the consumer thread
+    mutable std::mutex mutex;
+    std::condition_variable_any frame_ready;
+    std::condition_variable frame_done;
+    std::deque<PendingFrame> pending;
+    // pixel buffers that went through the consumer and can be reused
+    std::vector<std::vector<std::uint8_t>> spare_buffers;
+    bool consuming = false;
+    Stats frame_stats;
+    double total_readback_ms = 0;
+
+    // last so it's joined before anything above goes away
+    std::jthread consumer_thread;
+};
+
+}  // namespace omgl
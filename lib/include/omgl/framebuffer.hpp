@@ -0,0 +1,41 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace omgl {
+
+// Offscreen render target: RGBA8 color plus a depth/stencil renderbuffer.
+class Framebuffer {
+   public:
+    Framebuffer(std::size_t width, std::size_t height);
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // Binds it for drawing and reading and sets the viewport to cover it.
+    void bind();
+
+    // Reads the color attachment into `out` as tightly packed RGBA8, bottom
+    // row first like GL. Blocks until rendering is done, see FrameReader for
+    // the non-blocking version.
+    void readPixels(std::span<std::uint8_t> out);
+    std::vector<std::uint8_t> readPixels();
+
+    std::size_t width() const { return fb_width; }
+    std::size_t height() const { return fb_height; }
+    std::size_t byteSize() const { return fb_width * fb_height * 4; }
+
+    gl::GLuint id;
+
+   private:
+    gl::GLuint color_rbo;
+    gl::GLuint depth_rbo;
+    std::size_t fb_width;
+    std::size_t fb_height;
+};
+
+}  // namespace omgl
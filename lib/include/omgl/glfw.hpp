@@ -4,6 +4,11 @@
 #include <string>
 
 namespace omgl {
-GLFWwindow*
-make_window(std::string window_name, std::size_t width, std::size_t height);
+GLFWwindow* make_window(
+    std::string window_name,
+    std::size_t width,
+    std::size_t height,
+    int gl_major = 3,
+    int gl_minor = 3
+);
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <omgl/framebuffer.hpp>
+
+namespace omgl {
+
+// An OpenGL context without a window, for machines that have no display.
+//
+// Goes through EGL: mesa's surfaceless platform if it's there, otherwise the
+// default display with a tiny pbuffer just to make the context current. The
+// context is made current and glbinding is initialized, same as make_window.
+// Everything is drawn into target(), an offscreen framebuffer of the
+// requested size that is bound on creation.
+//
+// Under llvmpipe this runs on machines without any GPU at all:
+//   LIBGL_ALWAYS_SOFTWARE=1 EGL_PLATFORM=surfaceless ./headless_render
+class HeadlessContext {
+   public:
+    HeadlessContext(
+        std::size_t width,
+        std::size_t height,
+        int gl_major = 3,
+        int gl_minor = 3
+    );
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    void makeCurrent();
+
+    Framebuffer& target() { return *framebuffer; }
+
+   private:
+    // EGLDisplay/EGLContext/EGLSurface, kept opaque so egl.h doesn't leak
+    // into every file that includes this
+    void* display;
+    void* context;
+    void* surface;
+
+    std::unique_ptr<Framebuffer> framebuffer;
+};
+
+}  // namespace omgl
@@ -0,0 +1,176 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <omgl/vertex_format.hpp>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace omgl {
+
+struct Frustum;
+
+// What the instance buffer holds for each instance, 20 bytes.
+struct InstanceData {
+    // xyz offset, w uniform scale
+    glm::vec4 transform;
+    // RGBA8, read as a normalized vec4
+    std::uint32_t color;
+};
+
+std::uint32_t pack_rgba8(const glm::vec4& color);
+
+// CPU side of the instances, one array per field so updates only touch the
+// fields they change and run 4 (or more) instances per instruction.
+//
+//     omgl::InstanceStore instances;
+//     instances.add({x, y, 0}, 0.01f, omgl::pack_rgba8(color));
+//     ...
+//     auto xs = instances.x();
+//     for (std::size_t i = 0; i < xs.size(); i++) xs[i] += speed * dt;
+class InstanceStore {
+   public:
+    std::size_t add(
+        const glm::vec3& position,
+        float scale,
+        std::uint32_t color
+    );
+
+    void reserve(std::size_t count);
+    // New instances are at the origin, scale 1, white.
+    void resize(std::size_t count);
+    void clear();
+    std::size_t size() const { return xs.size(); }
+
+    std::span<float> x() { return xs; }
+    std::span<float> y() { return ys; }
+    std::span<float> z() { return zs; }
+    std::span<float> scale() { return scales; }
+    std::span<std::uint32_t> colors() { return color_values; }
+
+    std::span<const float> x() const { return xs; }
+    std::span<const float> y() const { return ys; }
+    std::span<const float> z() const { return zs; }
+    std::span<const float> scale() const { return scales; }
+    std::span<const std::uint32_t> colors() const { return color_values; }
+
+    // Interleaves the arrays into the GPU layout, transposing four instances
+    // at a time with SSE. `out` needs room for size() instances.
+    void pack(std::span<InstanceData> out) const;
+
+   private:
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+    std::vector<float> scales;
+    std::vector<std::uint32_t> color_values;
+};
+
+// One mesh drawn many times with a single glDrawElementsInstanced.
+//
+// The mesh has its own VAO, vertex and index buffers. The instances go
+// through a StreamBuffer, one region per frame with an allocation per draw,
+// and reach the vertex shader as two attributes with a divisor of 1:
+//
+//     layout(location = 2) in vec4 a_transform;  // xyz offset, w scale
+//     layout(location = 3) in vec4 a_color;
+//     ...
+//     gl_Position = vec4(a_pos * a_transform.w + a_transform.xyz, 1.);
+//
+// The draws of a frame go between beginFrame() and endFrame():
+//
+//     mesh.beginFrame();
+//     mesh.draw(trees);
+//     mesh.drawVisible(rocks, frustum, 1.0f);
+//     mesh.endFrame();
+class InstancedMesh {
+   public:
+    struct Stats {
+        std::size_t instances = 0;
+        // packing the store into the instance buffer, or culling it for
+        // drawVisible
+        double pack_ms = 0;
+    };
+
+    // `vertices` holds tightly packed vertices of vertex_stride bytes.
+    // `max_instances` is how many instances all the draws of a frame upload
+    // together, counting the whole store for drawVisible().
+    InstancedMesh(
+        std::span<const VertexAttribute> attributes,
+        std::size_t vertex_stride,
+        std::span<const std::byte> vertices,
+        std::span<const std::uint32_t> indices,
+        std::size_t max_instances,
+        gl::GLuint transform_location = 2,
+        gl::GLuint color_location = 3
+    );
+
+    template <typename Vertex>
+    InstancedMesh(
+        std::span<const VertexAttribute> attributes,
+        std::span<const Vertex> vertices,
+        std::span<const std::uint32_t> indices,
+        std::size_t max_instances,
+        gl::GLuint transform_location = 2,
+        gl::GLuint color_location = 3
+    )
+        : InstancedMesh(
+              attributes,
+              sizeof(Vertex),
+              std::as_bytes(vertices),
+              indices,
+              max_instances,
+              transform_location,
+              color_location
+          ) {}
+
+    ~InstancedMesh();
+
+    InstancedMesh(const InstancedMesh&) = delete;
+    InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+    // Moves the instance buffer to the next frame's region, waiting for the
+    // GPU if it's still reading it.
+    void beginFrame();
+    // Fences the frame's region.
+    void endFrame();
+
+    // Uploads every instance in the store and draws them, with whatever
+    // program is in use. Throws outside beginFrame()/endFrame(), or if the
+    // frame would upload more than max_instances.
+    void draw(const InstanceStore& instances);
+
+    // Like draw(), but only uploads and draws the instances whose bounding
+    // sphere (bounding_radius times their scale) touches the frustum. The
+    // culling writes straight into the instance buffer, see cull_instances().
+    void drawVisible(
+        const InstanceStore& instances,
+        const Frustum& frustum,
+        float bounding_radius
+    );
+
+    std::size_t maxInstances() const { return max_instances; }
+    // Stats of the last draw.
+    const Stats& stats() const { return draw_stats; }
+
+   private:
+    // the upload fills the region it's given and returns how many it wrote
+    template <typename Upload>
+    void drawFrom(std::size_t count, Upload&& upload);
+
+    gl::GLuint vao_id;
+    gl::GLuint vertex_buffer_id;
+    gl::GLuint index_buffer_id;
+    gl::GLsizei index_count;
+
+    std::size_t max_instances;
+    std::vector<VertexAttribute> instance_attributes;
+    StreamBuffer instance_stream;
+
+    Stats draw_stats;
+};
+
+}  // namespace omgl
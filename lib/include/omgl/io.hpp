@@ -1,27 +1,65 @@
 #pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
 #include <filesystem>
+#include <span>
 #include <string>
-#include <fstream>
-#include <format>
+#include <string_view>
 
 namespace fs = std::filesystem;
 
 namespace omgl {
 
-std::string read_file_text(
-    fs::path path
-) {
-    std::ifstream file(path);
+// Read-only view of a whole file, mapped into memory instead of read.
+//
+// Nothing gets copied until somebody touches the bytes, and then the kernel
+// pages them in straight from the page cache. The view lives as long as the
+// MappedFile, so hand out the span/string_view only to code that's done
+// with it by then. Empty files are fine and give an empty view.
+class MappedFile {
+   public:
+    // Throws if the file can't be opened or mapped.
+    explicit MappedFile(const fs::path& path);
+    ~MappedFile();
 
-    if (!file) {
-        throw std::runtime_error(std::format("Couldn't open {}", path.string())
-        );
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> bytes() const { return {data, length}; }
+    // Not null terminated, pass the length along.
+    std::string_view text() const {
+        return {reinterpret_cast<const char*>(data), length};
     }
+    std::size_t size() const { return length; }
+
+    // Tells the kernel the file is going to be read front to back, so it
+    // reads ahead aggressively.
+    void adviseSequential() const;
+
+   private:
+    void unmap();
+
+    const std::byte* data = nullptr;
+    std::size_t length = 0;
+};
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+// The whole file as a string, a single copy out of the mapping. Prefer
+// MappedFile when a view is enough.
+std::string read_file_text(const fs::path& path);
 
-    return buffer.str();
-}
+// Fills `buffer` with the contents of the file, (re)allocating its storage
+// with `usage`. The file is mapped and handed to GL in chunks of
+// `chunk_size`, so no copy of it ever lands on the heap and the driver
+// never has to stage all of it at once. Leaves `buffer` bound to `target`.
+// Returns the size in bytes.
+std::size_t upload_file_to_buffer(
+    gl::GLenum target,
+    gl::GLuint buffer,
+    const fs::path& path,
+    gl::GLenum usage = gl::GL_STATIC_DRAW,
+    std::size_t chunk_size = 4 * 1024 * 1024
+);
 
-}
\ No newline at end of file
+}  // namespace omgl
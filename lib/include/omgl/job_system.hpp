@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace omgl {
+
+// Counts jobs that haven't finished yet. Jobs started with a counter add one
+// to it and take it away again when they're done, so a counter of zero means
+// everything it tracked has run. Other jobs can be held back until it gets
+// there (JobSystem::runAfter), and JobSystem::wait() blocks on it.
+//
+// A counter can be reused once it got back to zero, but it has to outlive
+// every job that uses it.
+class JobCounter {
+   public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+   private:
+    friend class JobSystem;
+
+    std::atomic<std::size_t> pending = 0;
+
+    // held back by this counter
+    std::mutex mutex;
+    std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+    // the first exception a tracked job threw, rethrown by wait()
+    std::exception_ptr error;
+};
+
+// One less than the hardware has, which leaves a core to the thread that
+// submits.
+std::size_t default_worker_count();
+
+// A work-stealing thread pool for the CPU side of a frame.
+//
+// Every worker has its own deque. It pushes and pops its own jobs at the
+// back, so a job's children run while their data is still in cache, and
+// steals from the front of the others' deques when it runs dry. Threads that
+// aren't workers, the GL thread in particular, queue into a deque of their
+// own that the workers steal from.
+//
+// Jobs must not touch GL, the context belongs to the thread that made it.
+// The pattern is that the GL thread maps (or allocates from a StreamBuffer)
+// up front, the jobs fill the mapped memory and the GL thread waits for them
+// before it commits and draws:
+//
+//     auto allocation = stream.allocate(count * sizeof(ObjectData));
+//     auto objects = static_cast<ObjectData*>(allocation.data);
+//     jobs.parallelFor(count, 1024, [&](std::size_t begin, std::size_t end) {
+//         for (auto i = begin; i < end; i++) objects[i] = ...;
+//     });
+//     stream.commit();
+//
+// wait() doesn't sleep while there's work, it runs queued jobs itself, so
+// the GL thread helps out instead of idling.
+class JobSystem {
+   public:
+    using Job = std::function<void()>;
+
+    // With no workers every job runs on the thread that waits for it.
+    explicit JobSystem(std::size_t worker_count = default_worker_count());
+    // Waits for every queued job, then stops the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queues a job. If `done` isn't null it counts the job until it ran.
+    void run(Job job, JobCounter* done = nullptr);
+
+    // Queues `job` once `dependency` gets to zero, right away if it's there
+    // already.
+    void runAfter(
+        JobCounter& dependency,
+        Job job,
+        JobCounter* done = nullptr
+    );
+
+    // Runs queued jobs until `counter` is zero. Rethrows the first exception
+    // a job tracked by the counter threw.
+    void wait(JobCounter& counter);
+
+    // Calls body(begin, end) on chunks of at most `grain` indices out of
+    // [0, count), spread over the workers and the calling thread. Returns
+    // once every chunk ran.
+    template <typename Body>
+    void parallelFor(std::size_t count, std::size_t grain, Body&& body);
+
+    // std::sort with the chunks sorted on the workers and merged pairwise.
+    template <typename Iterator, typename Compare>
+    void parallelSort(Iterator first, Iterator last, Compare compare);
+
+    // Not counting the threads that only submit and wait.
+    std::size_t workerCount() const { return workers.size(); }
+
+    // The calling thread's worker index, or workerCount() on any other
+    // thread.
+    std::size_t currentWorker() const;
+
+   private:
+    struct Task {
+        Job job;
+        JobCounter* counter;
+    };
+
+    // A mutex is plenty here: jobs are coarse, and the owner and the
+    // thieves work at opposite ends so they rarely fight over it.
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool runOne(std::size_t self);
+    bool pop(std::size_t self, Task& task);
+    void execute(Task& task);
+    void finish(JobCounter& counter);
+    void workerLoop(std::size_t index, std::stop_token stop);
+
+    // one per worker, plus the last one for everyone else
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<std::size_t> queued = 0;
+
+    std::mutex sleep_mutex;
+    std::condition_variable_any wake;
+
+    // last so they're joined before anything above goes away
+    std::vector<std::jthread> workers;
+};
+
+template <typename Body>
+void JobSystem::parallelFor(
+    std::size_t count,
+    std::size_t grain,
+    Body&& body
+) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    if (count <= grain || workers.empty()) {
+        body(std::size_t{0}, count);
+        return;
+    }
+
+    JobCounter done;
+    // the first chunk stays on this thread
+    for (std::size_t begin = grain; begin < count; begin += grain) {
+        const std::size_t end = std::min(begin + grain, count);
+        run([&body, begin, end] { body(begin, end); }, &done);
+    }
+    std::exception_ptr error;
+    try {
+        body(std::size_t{0}, grain);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // the chunks reference body, so they have to finish either way
+    wait(done);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename Iterator, typename Compare>
+void JobSystem::parallelSort(
+    Iterator first,
+    Iterator last,
+    Compare compare
+) {
+    const std::size_t count = std::distance(first, last);
+    const std::size_t chunks = std::min(workers.size() + 1, count / 4096);
+    if (chunks < 2) {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    // chunk boundaries, chunks + 1 of them
+    std::vector<std::size_t> bounds(chunks + 1);
+    for (std::size_t i = 0; i <= chunks; i++) {
+        bounds[i] = count * i / chunks;
+    }
+
+    parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            std::sort(first + bounds[i], first + bounds[i + 1], compare);
+        }
+    });
+
+    // every round merges neighbouring pairs and halves the run count
+    for (std::size_t width = 1; width < chunks; width *= 2) {
+        const std::size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+        parallelFor(pairs, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t pair = begin; pair < end; pair++) {
+                const std::size_t low = pair * 2 * width;
+                const std::size_t middle = std::min(low + width, chunks);
+                const std::size_t high = std::min(low + 2 * width, chunks);
+                if (middle < high) {
+                    std::inplace_merge(
+                        first + bounds[low],
+                        first + bounds[middle],
+                        first + bounds[high],
+                        compare
+                    );
+                }
+            }
+        });
+    }
+}
+
+}  // namespace omgl
@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <omgl/io.hpp>
+#include <omgl/mesh_import.hpp>
+#include <omgl/mesh_pool.hpp>
+#include <omgl/vertex_format.hpp>
+#include <span>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// .ommesh, meshes in the layout MeshPool stores them in.
+//
+// A header, the vertex attributes, then the interleaved vertices and the
+// 32 bit indices, each 16 byte aligned. Loading one is mapping the file;
+// MeshPool::add() copies the vertices and indices from the page cache into
+// its buffers without anything in between. Everything is little endian.
+//
+// Files are written by write_mesh_file(), usually through meshconv, which
+// also puts the vertices and indices in a cache friendly order.
+
+struct MeshFileHeader {
+    std::array<char, 4> magic;
+    std::uint32_t version;
+    std::uint32_t vertex_stride;
+    std::uint32_t attribute_count;
+    std::uint64_t vertex_count;
+    std::uint64_t index_count;
+    // from the start of the file
+    std::uint64_t vertex_offset;
+    std::uint64_t index_offset;
+    // of the positions, in model space
+    std::array<float, 3> bounds_min;
+    std::array<float, 3> bounds_max;
+};
+static_assert(sizeof(MeshFileHeader) == 72);
+
+// A VertexAttribute, attribute_count of them right after the header.
+struct MeshFileAttribute {
+    std::uint32_t location;
+    std::uint32_t components;
+    // GL enum
+    std::uint32_t type;
+    std::uint32_t offset;
+    std::uint32_t divisor;
+    std::uint8_t normalized;
+    std::uint8_t integer;
+    std::uint16_t reserved;
+};
+static_assert(sizeof(MeshFileAttribute) == 24);
+
+constexpr std::array<char, 4> mesh_file_magic = {'O', 'M', 'M', 'S'};
+constexpr std::uint32_t mesh_file_version = 1;
+
+// A mapped .ommesh file. The constructor checks the header, that the
+// attributes fit in a vertex and that the data is where the header says.
+// The indices aren't checked against the vertex count, that would mean
+// reading every one of them.
+class MeshFile {
+   public:
+    // Throws if the file can't be mapped or isn't a valid .ommesh.
+    explicit MeshFile(const fs::path& path);
+
+    const MeshFileHeader& header() const { return file_header; }
+    std::span<const VertexAttribute> attributes() const {
+        return vertex_attributes;
+    }
+    std::size_t stride() const { return file_header.vertex_stride; }
+
+    // Straight out of the mapping, valid as long as the MeshFile.
+    std::span<const std::byte> vertices() const;
+    std::span<const std::uint32_t> indices() const;
+
+    // Adds the mesh to a pool with the same stride and attributes, throws
+    // otherwise.
+    MeshHandle addTo(MeshPool& pool) const;
+
+   private:
+    MappedFile file;
+    MeshFileHeader file_header;
+    std::vector<VertexAttribute> vertex_attributes;
+};
+
+// Writes the mesh to `path`. Throws on write errors.
+void write_mesh_file(const fs::path& path, const MeshData& mesh);
+
+}  // namespace omgl
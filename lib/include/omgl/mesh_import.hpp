@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <omgl/vertex_format.hpp>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// A mesh on the CPU, interleaved the way MeshPool takes it.
+struct MeshData {
+    std::vector<VertexAttribute> attributes;
+    std::size_t stride = 0;
+    std::vector<std::byte> vertices;
+    std::vector<std::uint32_t> indices;
+    // of the positions, in model space
+    glm::vec3 bounds_min{0.0f};
+    glm::vec3 bounds_max{0.0f};
+
+    std::size_t vertexCount() const {
+        return stride == 0 ? 0 : vertices.size() / stride;
+    }
+};
+
+// What load_obj() produces: position at location 0, normal at 1 and
+// texture coordinates at 2.
+struct ObjVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+template <>
+struct VertexLayout<ObjVertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &ObjVertex::position),
+        vertex_field(1, &ObjVertex::normal),
+        vertex_field(2, &ObjVertex::uv),
+    };
+};
+
+// Loads the triangles of a Wavefront OBJ file, polygons are split into
+// fans. Faces without normals get smooth ones averaged from the faces
+// around each position, missing texture coordinates are zero. Materials,
+// groups and everything else are ignored.
+//
+// Every face corner becomes a vertex of its own and the indices just count
+// up, remove_duplicate_vertices() turns that into a proper indexed mesh.
+// Throws on files that can't be read or parsed.
+MeshData load_obj(const fs::path& path);
+
+// An ObjVertex in half the space: half float position and texture
+// coordinates, and the normal as signed normalized 10:10:10:2. Same
+// locations, so shaders don't notice the difference. Halves keep about
+// three significant digits, plenty for most models, not for huge ones.
+struct QuantizedVertex {
+    // x, y, z and padding
+    std::array<std::uint16_t, 4> position;
+    std::uint32_t normal;
+    std::array<std::uint16_t, 2> uv;
+};
+static_assert(sizeof(QuantizedVertex) == 16);
+
+template <>
+struct VertexLayout<QuantizedVertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &QuantizedVertex::position, vertex_formats::half3),
+        vertex_field(
+            1, &QuantizedVertex::normal, vertex_formats::snorm_10_10_10_2
+        ),
+        vertex_field(2, &QuantizedVertex::uv, vertex_formats::half2),
+    };
+};
+
+// Converts a mesh of ObjVertex to QuantizedVertex, the indices and bounds
+// stay the same. Throws if the mesh has another vertex format.
+MeshData quantize_mesh(const MeshData& mesh);
+
+}  // namespace omgl
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <omgl/mesh_import.hpp>
+#include <omgl/mesh_pool.hpp>
+#include <span>
+#include <vector>
+
+namespace omgl {
+
+// The positions of a mesh's vertices, from the attribute at location 0,
+// which has to be 3 or 4 floats or halves. Throws otherwise.
+std::vector<glm::vec3> mesh_positions(const MeshData& mesh);
+
+// Simplifies a triangle mesh down to about `target_index_count` indices by
+// collapsing edges, cheapest first, with the cost measured by quadric error
+// metrics (Garland and Heckbert): every vertex sums up the squared
+// distances to the planes of its triangles, and a collapse costs the
+// distance its surviving vertex is from the planes of both.
+//
+// Vertices only ever collapse into a neighbour, none are moved or added,
+// so the result indexes the same vertex buffer as the input. Borders only
+// collapse along themselves, and vertices that share their position with
+// another vertex (UV seams, hard edges) stay where they are so the seams
+// don't tear. Collapses that would flip a triangle are skipped. Stops early
+// when nothing can be collapsed any more.
+//
+// `error` gets the largest collapse cost as a distance in model units.
+std::vector<std::uint32_t> simplify_mesh(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    std::size_t target_index_count,
+    float* error = nullptr
+);
+
+struct LodConfig {
+    // counting the full detail one
+    std::size_t max_levels = 6;
+    // how many of the previous level's triangles each level aims for
+    float reduction = 0.5f;
+    // no level gets below this
+    std::size_t min_triangles = 64;
+};
+
+// The levels of detail of one mesh, ready for MeshPool::add().
+struct LodChain {
+    // every level's indices one after the other, full detail first
+    std::vector<std::uint32_t> indices;
+    std::vector<MeshLod> levels;
+};
+
+// Simplifies the mesh once, keeping the triangles it's down to whenever it
+// reaches the size of the next level, so every level's error is measured
+// against the full detail mesh. Every level is optimized for the vertex
+// cache; the first level is the mesh itself. Stops early when a level
+// wouldn't be much smaller than the last.
+LodChain build_lod_chain(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    const LodConfig& config = {}
+);
+
+// Turns model space errors into pixels for select_lod().
+struct LodSelector {
+    // pixels per unit at a distance of 1, see perspective_lod_scale()
+    float projection_scale;
+    // the most a level may be off by on screen
+    float pixel_threshold = 1.0f;
+};
+
+// The projection_scale of a perspective projection with a vertical field
+// of view of `fov_y` radians onto a viewport `viewport_height` pixels high.
+float perspective_lod_scale(float fov_y, float viewport_height);
+
+// The coarsest level whose error, for an object scaled by `scale` and
+// `distance` away from the camera, stays under the threshold on screen.
+// Zero when nothing does, or there are no levels.
+std::size_t select_lod(
+    std::span<const MeshLod> levels,
+    float scale,
+    float distance,
+    const LodSelector& selector
+);
+
+}  // namespace omgl
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <omgl/mesh_import.hpp>
+#include <span>
+
+namespace omgl {
+
+// How well an index order uses the GPU's post-transform vertex cache,
+// simulated as a FIFO of `cache_size` vertices.
+struct VertexCacheStats {
+    std::size_t misses;
+    // average cache miss ratio, vertex shader runs per triangle: 3 when
+    // nothing is shared, 0.5 is the limit for a big regular grid
+    double acmr;
+    // average transform to vertex ratio, vertex shader runs per vertex:
+    // 1 is perfect
+    double atvr;
+};
+
+VertexCacheStats analyze_vertex_cache(
+    std::span<const std::uint32_t> indices,
+    std::size_t vertex_count,
+    std::size_t cache_size = 16
+);
+
+// Merges vertices that are identical byte for byte and points the indices
+// at the survivors. The first occurrence of each stays, in the same order.
+void remove_duplicate_vertices(MeshData& mesh);
+
+// Reorders the triangles so that vertices get reused while they're still
+// in the vertex cache, with Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation": every vertex is scored by how recently it was used and
+// how many of its triangles are left, and the triangle with the best sum
+// goes next. Doesn't depend much on the actual cache size, which varies a
+// lot between GPUs. Leaves the vertices alone.
+void optimize_vertex_cache(
+    std::span<std::uint32_t> indices,
+    std::size_t vertex_count
+);
+
+// Reorders the vertices in the order the indices first use them, so the
+// vertex fetches walk through memory instead of jumping around. Drops
+// vertices no index refers to. Do this after optimize_vertex_cache().
+void optimize_vertex_fetch(MeshData& mesh);
+
+}  // namespace omgl
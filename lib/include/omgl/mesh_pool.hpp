@@ -0,0 +1,172 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <omgl/range_allocator.hpp>
+#include <omgl/vertex_format.hpp>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace omgl {
+
+struct MeshHandle {
+    std::uint32_t index;
+    // bumped whenever the slot is reused, so stale handles are caught
+    std::uint32_t generation;
+};
+
+// What glDrawElementsBaseVertex needs to draw one mesh out of a pool.
+struct DrawRange {
+    gl::GLint base_vertex;
+    std::uint32_t first_index;
+    std::uint32_t index_count;
+};
+
+// One level of detail of a mesh: a range of the mesh's own indices, drawn
+// over the same vertices as every other level.
+struct MeshLod {
+    // relative to the mesh's first index
+    std::uint32_t first_index;
+    std::uint32_t index_count;
+    // how far the surface moved from the full detail one, in model units
+    float error;
+};
+
+// Shared vertex and index storage for many meshes with the same vertex
+// format.
+//
+// Instead of a VAO, VBO and EBO per mesh, every mesh gets a range of one big
+// vertex buffer and one big index buffer behind a single VAO. Indices are
+// relative to the mesh's first vertex, the base vertex takes care of the
+// rest, so drawing a mesh is just a DrawRange and switching between meshes
+// needs no binds at all.
+//
+// A mesh can bring levels of detail, index buffers of its own all sharing
+// its vertices (see build_lod_chain()), so switching levels only changes the
+// index range that gets drawn.
+//
+// The buffers grow when they run out of space. Removing meshes leaves holes,
+// compact() packs everything back together.
+class MeshPool {
+   public:
+    struct Stats {
+        std::size_t meshes;
+        // in vertices
+        FragmentationStats vertices;
+        // in indices
+        FragmentationStats indices;
+    };
+
+    MeshPool(
+        std::span<const VertexAttribute> attributes,
+        std::size_t vertex_stride,
+        std::size_t initial_vertices = 64 * 1024,
+        std::size_t initial_indices = 256 * 1024
+    );
+    ~MeshPool();
+
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    // `vertices` holds tightly packed vertices of vertex_stride bytes.
+    MeshHandle add(
+        std::span<const std::byte> vertices,
+        std::span<const std::uint32_t> indices
+    );
+
+    template <typename Vertex>
+    MeshHandle add(
+        std::span<const Vertex> vertices,
+        std::span<const std::uint32_t> indices
+    ) {
+        if (sizeof(Vertex) != vertex_stride) {
+            throw std::runtime_error("Vertex type doesn't match the pool stride");
+        }
+        return add(std::as_bytes(vertices), indices);
+    }
+
+    // With levels of detail, ranges of `indices`, most detailed first.
+    // Throws if one of them isn't within the indices or isn't whole
+    // triangles.
+    MeshHandle add(
+        std::span<const std::byte> vertices,
+        std::span<const std::uint32_t> indices,
+        std::span<const MeshLod> lods
+    );
+
+    void remove(MeshHandle handle);
+
+    // Levels past the last one give the last one, meshes without levels
+    // of detail have a single one with all their indices.
+    DrawRange range(MeshHandle handle, std::size_t lod = 0) const;
+
+    // Empty for meshes added without levels of detail.
+    std::span<const MeshLod> lods(MeshHandle handle) const;
+
+    // Binds the shared VAO, for drawing the meshes some other way.
+    void bind();
+
+    // Draws one mesh. Binds the pool's VAO first, which the StateCache
+    // skips when it's already bound, so growing the pool in between is
+    // fine.
+    void draw(MeshHandle handle, std::size_t lod = 0) const;
+
+    // Moves every mesh to the front of the buffers so all free space is one
+    // block again. Handles stay valid, ranges change.
+    void compact();
+
+    Stats stats() const;
+
+    gl::GLuint vao() const { return vao_id; }
+    // Unique to this pool for the life of the process, unlike the VAO name,
+    // which GL hands out again once the pool is gone.
+    std::uint64_t serial() const { return pool_serial; }
+    gl::GLuint vertexBuffer() const { return vertex_buffer_id; }
+    gl::GLuint indexBuffer() const { return index_buffer_id; }
+    std::size_t vertexStride() const { return vertex_stride; }
+    std::span<const VertexAttribute> vertexAttributes() const {
+        return attributes;
+    }
+
+   private:
+    struct Entry {
+        std::size_t first_vertex;
+        std::size_t vertex_count;
+        std::size_t first_index;
+        std::size_t index_count;
+        std::vector<MeshLod> lods;
+        std::uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    const Entry& entry(MeshHandle handle) const;
+
+    // makes sure there is a free block this big, growing if it has to
+    std::size_t allocateVertices(std::size_t count);
+    std::size_t allocateIndices(std::size_t count);
+
+    // copies the live contents into a bigger buffer
+    void growVertexBuffer(std::size_t new_capacity);
+    void growIndexBuffer(std::size_t new_capacity);
+
+    // points the VAO at the current buffers
+    void setupVao();
+
+    std::vector<VertexAttribute> attributes;
+    std::size_t vertex_stride;
+
+    gl::GLuint vao_id;
+    gl::GLuint vertex_buffer_id;
+    gl::GLuint index_buffer_id;
+
+    RangeAllocator vertex_allocator;
+    RangeAllocator index_allocator;
+
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> free_entries;
+    std::size_t mesh_count = 0;
+    std::uint64_t pool_serial;
+};
+
+}  // namespace omgl
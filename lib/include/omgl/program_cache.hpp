@@ -0,0 +1,74 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// On-disk cache of linked program binaries (glGetProgramBinary /
+// glProgramBinary). Entries are keyed on the shader sources and the driver
+// identity, so a driver update or a shader edit just misses and
+// recompiles. Entries keep all of those next to the binary and
+// are only loaded when they match exactly, not just by hash.
+class ProgramCache {
+   public:
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        // binaries that were found but the driver refused to load
+        std::size_t rejected = 0;
+    };
+
+    // Needs a current context, the driver identity is read once here.
+    ProgramCache(fs::path directory);
+
+    // Returns a linked program, loaded from disk if possible and compiled
+    // (then written back) otherwise. Throws like make_shader_program if the
+    // sources don't compile.
+    gl::GLuint getOrBuild(
+        std::string_view vertex_source,
+        std::string_view fragment_source
+    );
+
+    // Removes every cached binary.
+    void clear();
+
+    // False if the driver exposes no binary formats, everything is compiled
+    // from source then.
+    bool enabled() const { return binaries_supported; }
+
+    const Stats& stats() const { return cache_stats; }
+
+   private:
+    std::uint64_t makeKey(
+        std::string_view vertex_source,
+        std::string_view fragment_source
+    ) const;
+
+    fs::path entryPath(std::uint64_t key) const;
+
+    // returns 0 if there is no usable entry for exactly these sources
+    gl::GLuint tryLoad(
+        std::uint64_t key,
+        std::string_view vertex_source,
+        std::string_view fragment_source
+    );
+    void store(
+        std::uint64_t key,
+        std::string_view vertex_source,
+        std::string_view fragment_source,
+        gl::GLuint program_id
+    );
+
+    fs::path directory;
+    std::string driver;
+    bool binaries_supported;
+    Stats cache_stats;
+};
+
+}  // namespace omgl
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <optional>
+
+namespace omgl {
+
+struct FragmentationStats {
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    std::size_t free_blocks = 0;
+    std::size_t largest_free_block = 0;
+    // 0 when all free space is one block, towards 1 the more it's scattered
+    double fragmentation = 0;
+};
+
+// Hands out [offset, offset + size) ranges of some abstract space, like the
+// vertices of a shared buffer. Best fit, and neighbouring free blocks are
+// merged when something is freed. Doesn't touch GL at all.
+class RangeAllocator {
+   public:
+    RangeAllocator(std::size_t capacity = 0);
+
+    // nullopt if there is no free block big enough
+    std::optional<std::size_t> allocate(std::size_t size);
+    void free(std::size_t offset, std::size_t size);
+
+    // Adds space at the end.
+    void grow(std::size_t new_capacity);
+
+    // Forgets everything and marks [0, used) as allocated, for after the
+    // owner has packed its live ranges to the front.
+    void reset(std::size_t used);
+
+    std::size_t capacity() const { return total; }
+    FragmentationStats stats() const;
+
+   private:
+    void insertFree(std::size_t offset, std::size_t size);
+    void eraseFree(std::map<std::size_t, std::size_t>::iterator block);
+
+    std::size_t total;
+    std::size_t used = 0;
+    // offset -> size, for merging with neighbours
+    std::map<std::size_t, std::size_t> free_by_offset;
+    // size -> offset, for best fit
+    std::multimap<std::size_t, std::size_t> free_by_size;
+};
+
+}  // namespace omgl
@@ -0,0 +1,109 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <filesystem>
+#include <omgl/io.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// Non-blocking: whether the driver is done linking the program (and so
+// compiling its stages). Always true without parallel compile support, the
+// status queries will block instead.
+bool program_link_done(gl::GLuint program_id);
+
+// Builds a set of programs without waiting on each compile in turn.
+//
+// Everything is queued up first, submit() then issues every compile and link
+// back to back without a single status query in between, so a driver with
+// GL_KHR_parallel_shader_compile can spread the work over its compiler
+// threads. ready() polls GL_COMPLETION_STATUS_KHR without blocking, finish()
+// checks the results and throws on the first error.
+//
+//     omgl::ShaderBatch batch;
+//     auto vert = batch.addVertexShader(vertex_path);
+//     auto frag = batch.addFragmentShader(fragment_path);
+//     auto program = batch.addProgram(vert, frag);
+//     batch.submit();
+//     batch.finish();
+//     gl::GLuint id = batch.program(program);
+class ShaderBatch {
+   public:
+    struct StageHandle {
+        std::size_t index;
+    };
+    struct ProgramHandle {
+        std::size_t index;
+    };
+
+    ShaderBatch() = default;
+    ShaderBatch(const ShaderBatch&) = delete;
+    ShaderBatch& operator=(const ShaderBatch&) = delete;
+    // Deletes the shader stages and any program that wasn't finished.
+    ~ShaderBatch();
+
+    // A stage can be shared by any number of programs, it's compiled once.
+    StageHandle addVertexShader(std::string source);
+    StageHandle addVertexShader(fs::path path);
+    StageHandle addFragmentShader(std::string source);
+    StageHandle addFragmentShader(fs::path path);
+
+    // Throws unless `vertex` and `fragment` are stages of this batch of
+    // those types.
+    ProgramHandle addProgram(StageHandle vertex, StageHandle fragment);
+
+    // Kicks off every compile and link.
+    void submit();
+
+    // True once the driver says every compile and link is done. Without
+    // parallel compile support there is nothing to poll and this is always
+    // true, the wait happens in finish() instead.
+    bool ready() const;
+
+    // Blocks until everything is done, throws if anything failed to compile
+    // or link. The stage objects are deleted, the programs now belong to the
+    // caller.
+    void finish();
+
+    gl::GLuint program(ProgramHandle handle) const;
+
+    // Whether the driver compiles in the background for us.
+    static bool parallelCompileSupported();
+
+   private:
+    struct Stage {
+        gl::GLenum type;
+        // either the source itself or the file it's mapped from
+        std::string source;
+        std::optional<MappedFile> file;
+        // file name or "<source>", for error messages
+        std::string label;
+        gl::GLuint id = 0;
+    };
+
+    struct Program {
+        std::size_t vertex;
+        std::size_t fragment;
+        gl::GLuint id = 0;
+    };
+
+    StageHandle addStage(
+        gl::GLenum type,
+        std::string source,
+        std::optional<MappedFile> file,
+        std::string label
+    );
+    // throws if the handle isn't a stage of `type` in this batch
+    void checkStage(StageHandle handle, gl::GLenum type) const;
+
+    std::vector<Stage> stages;
+    std::vector<Program> programs;
+    bool submitted = false;
+    bool finished = false;
+};
+
+}  // namespace omgl
@@ -0,0 +1,94 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// name -> value, injected as `#define name value` right after #version.
+// Sorted, so equal sets always print (and hash) the same.
+using ShaderDefines = std::map<std::string, std::string>;
+
+// A shader after preprocessing, ready for glShaderSource.
+struct PreprocessedShader {
+    std::string source;
+    // Every file that ended up in the source. The position in here is the
+    // source string number in the #line directives (and so in the driver's
+    // error messages), the root file is 0.
+    std::vector<fs::path> files;
+
+    // Rewrites the "0:12(5): error" style locations in a driver log into
+    // "file.glsl:12(5): error". Understands the Mesa, NVIDIA and AMD formats,
+    // other lines pass through untouched.
+    std::string remapLog(std::string_view log) const;
+};
+
+// The bits of preprocessing GLSL doesn't do itself.
+//
+//  - `#include "file"` is looked up next to the including file, then in the
+//    include directories. `#include <file>` only in the include directories.
+//    Includes are expanded even inside #if blocks that end up disabled.
+//  - `#pragma once` in a file stops it from being included again. Classic
+//    #ifndef guards work too, the GLSL compiler handles those.
+//  - A define set is injected right after #version. Defines that neither
+//    the shader nor the value of another injected define mentions are left
+//    out, so variants that only differ in those come out identical and can
+//    share a compiled stage.
+//  - #line directives keep the driver's line numbers pointing at the real
+//    file and line, see PreprocessedShader::remapLog.
+//
+// Files are read once and kept, so preprocessing many variants of the same
+// shader only touches the disk the first time.
+class ShaderPreprocessor {
+   public:
+    explicit ShaderPreprocessor(std::vector<fs::path> include_dirs = {});
+
+    // Throws on missing files and include cycles.
+    PreprocessedShader process(
+        const fs::path& path,
+        const ShaderDefines& defines = {}
+    );
+
+    // Forgets the cached file contents, for when files changed on disk.
+    void clear();
+
+   private:
+    struct Context {
+        PreprocessedShader result;
+        // version dependent, see lineDirective
+        int line_offset = 0;
+        std::vector<fs::path> include_stack;
+        std::vector<fs::path> included_once;
+    };
+
+    const std::string& load(const fs::path& path);
+    fs::path resolve(
+        std::string_view name,
+        bool quoted,
+        const fs::path& including_file
+    ) const;
+
+    void processFile(
+        Context& context,
+        const fs::path& path,
+        std::size_t first_line
+    );
+
+    std::size_t fileIndex(Context& context, const fs::path& path) const;
+
+    static void lineDirective(
+        Context& context,
+        std::size_t next_line,
+        std::size_t file_index
+    );
+
+    std::vector<fs::path> include_dirs;
+    std::unordered_map<std::string, std::string> file_cache;
+};
+
+}  // namespace omgl
@@ -0,0 +1,104 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <omgl/file_watcher.hpp>
+#include <omgl/shader_preprocessor.hpp>
+#include <omgl/shaders.hpp>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// Rebuilds programs when their shader files change.
+//
+// Sources go through the ShaderPreprocessor, so a change to any included
+// file counts too. A rebuild is kicked off as soon as update() sees the
+// change and with parallel shader compile it finishes in the background
+// over the next frames. Only once it has linked is it swapped into the
+// ShaderProgram, at the update() call, so a frame never sees half a
+// program. If it doesn't compile or link the error is logged (with real
+// file names) and the old program stays.
+//
+//     omgl::ShaderReloader reloader;
+//     reloader.watch(program, "shader.vert", "shader.frag");
+//     while (...) {
+//         reloader.update();
+//         ... draw ...
+//     }
+class ShaderReloader {
+   public:
+    struct Stats {
+        std::size_t reloads = 0;
+        std::size_t failures = 0;
+        // from the file change to the swap, of the last reload
+        double last_reload_ms = 0;
+    };
+
+    explicit ShaderReloader(std::vector<fs::path> include_dirs = {});
+    ~ShaderReloader();
+
+    ShaderReloader(const ShaderReloader&) = delete;
+    ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+    // The program has to outlive the reloader (or at least its last
+    // update()). The defines are the ones the program was built with.
+    void watch(
+        ShaderProgram& program,
+        const fs::path& vertex_path,
+        const fs::path& fragment_path,
+        ShaderDefines defines = {}
+    );
+
+    // Call once per frame, between frames. Starts rebuilds for changed
+    // files and swaps in the ones that are done. Returns how many programs
+    // were swapped.
+    std::size_t update();
+
+    const Stats& stats() const { return reload_stats; }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        ShaderProgram* program;
+        fs::path vertex_path;
+        fs::path fragment_path;
+        ShaderDefines defines;
+        // every file the last successful preprocessing read, even if the
+        // compile that followed failed
+        std::vector<fs::path> dependencies;
+
+        // a rebuild in flight, all 0 when there's none
+        gl::GLuint vertex_id = 0;
+        gl::GLuint fragment_id = 0;
+        gl::GLuint program_id = 0;
+        // for mapping error messages back to files
+        PreprocessedShader vertex_source;
+        PreprocessedShader fragment_source;
+        Clock::time_point started;
+    };
+
+    // preprocesses and kicks off the compiles and the link, no waiting
+    void startRebuild(Entry& entry);
+    // true once the rebuild is over, one way or the other
+    bool finishRebuild(Entry& entry);
+    void discardRebuild(Entry& entry);
+
+    // watches exactly the files the entries depend on right now, so
+    // includes that were dropped stop counting
+    void updateWatches();
+
+    // whether the entry depends on the file, includes and all
+    static bool dependsOn(const Entry& entry, const fs::path& file);
+
+    FileWatcher watcher;
+    ShaderPreprocessor preprocessor;
+    std::vector<std::unique_ptr<Entry>> entries;
+    Stats reload_stats;
+};
+
+}  // namespace omgl
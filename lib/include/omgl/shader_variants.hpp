@@ -0,0 +1,99 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <omgl/shader_preprocessor.hpp>
+#include <omgl/shaders.hpp>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// Builds shader permutations on demand, each one exactly once.
+//
+// A variant is a shader file plus a define set. Nothing is compiled until a
+// program asks for it, so a library with thousands of possible variants only
+// pays for the ones that are actually drawn with. Stages are keyed on their
+// preprocessed source, so two requests that come out identical (the same
+// vertex shader under different fragment defines, say) share one stage, and
+// programs are keyed on their pair of stages.
+//
+//     omgl::ShaderVariantCache variants({shaders_dir / "include"});
+//     auto& lit = variants.program("mesh.vert", "mesh.frag", {{"LIT", "1"}});
+//
+// Compile errors name the real file and line, includes and all.
+class ShaderVariantCache {
+   public:
+    struct Stats {
+        // files preprocessed with a new define set
+        std::size_t preprocessed = 0;
+        std::size_t stages_compiled = 0;
+        // requests served by a stage compiled for another request
+        std::size_t stages_shared = 0;
+        std::size_t programs_linked = 0;
+    };
+
+    explicit ShaderVariantCache(std::vector<fs::path> include_dirs = {});
+    // Deletes the stages and the programs, the cache owns both. References
+    // from program() mustn't outlive it.
+    ~ShaderVariantCache();
+
+    ShaderVariantCache(const ShaderVariantCache&) = delete;
+    ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+    // The compiled stage for this variant. Throws with a remapped log if it
+    // doesn't compile.
+    gl::GLuint stage(
+        gl::GLenum type,
+        const fs::path& path,
+        const ShaderDefines& defines = {}
+    );
+
+    // Both stages get the same defines. The reference stays valid for the
+    // lifetime of the cache.
+    ShaderProgram& program(
+        const fs::path& vertex_path,
+        const fs::path& fragment_path,
+        const ShaderDefines& defines = {}
+    );
+
+    const Stats& stats() const { return cache_stats; }
+
+   private:
+    struct Stage {
+        gl::GLuint id;
+        // only the file list, for remapping errors, the source is the key
+        PreprocessedShader shader;
+        bool checked = false;
+    };
+
+    // compiles (if needed) without waiting for the result
+    Stage& startStage(
+        gl::GLenum type,
+        const fs::path& path,
+        const ShaderDefines& defines
+    );
+    void checkStage(Stage& stage);
+
+    ShaderPreprocessor preprocessor;
+
+    // (type, path, defines) -> key into `stages`, so repeated requests
+    // skip the preprocessor
+    std::map<std::tuple<gl::GLenum, std::string, ShaderDefines>, std::string>
+        requests;
+    // type + preprocessed source -> stage
+    std::unordered_map<std::string, Stage> stages;
+    std::map<std::pair<gl::GLuint, gl::GLuint>, std::unique_ptr<ShaderProgram>>
+        programs;
+
+    Stats cache_stats;
+};
+
+}  // namespace omgl
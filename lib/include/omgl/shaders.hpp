@@ -1,28 +1,84 @@
 #pragma once
 #include <glbinding/gl/gl.h>
 #include <glbinding/glbinding.h>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 
 namespace fs = std::filesystem;
 namespace omgl {
 
+class ProgramCache;
+
 void ensure_shader_compiled(gl::GLuint shader_id);
 
+// The whole info log, however long it is.
+std::string shader_info_log(gl::GLuint shader_id);
+std::string program_info_log(gl::GLuint program_id);
+
 void ensure_shader_program_linked(gl::GLuint program_id);
 
-gl::GLuint compile_vertex_shader(std::string source);
+// Create/source/compile without asking for the result, so the driver can keep
+// working in the background. Call ensure_shader_compiled once it's needed.
+// The source doesn't need to be null terminated.
+gl::GLuint start_shader_compile(gl::GLenum type, std::string_view source);
+
+// Same for linking, check with ensure_shader_program_linked.
+gl::GLuint
+start_program_link(gl::GLuint vertex_shader_id, gl::GLuint fragment_shader_id);
+
+gl::GLuint compile_vertex_shader(std::string_view source);
+// only here so a std::string doesn't have to pick between the two above and
+// below
+gl::GLuint compile_vertex_shader(const std::string& source);
 gl::GLuint compile_vertex_shader(fs::path path);
 
 gl::GLuint
 make_shader_program(fs::path vertex_shader_path, fs::path fragment_shader_path);
 
-gl::GLuint compile_fragment_shader(std::string source);
+gl::GLuint compile_fragment_shader(std::string_view source);
+gl::GLuint compile_fragment_shader(const std::string& source);
 gl::GLuint compile_fragment_shader(fs::path path);
 
 gl::GLuint
 make_shader_program(gl::GLuint vertex_shader_id, gl::GLuint fragment_shader_id);
 
+// Number of bytes a single element of a uniform of this GL type takes up on
+// the client side (bools are uploaded as ints).
+std::size_t uniform_type_size(gl::GLenum type);
+
+// Index into a program's uniform table. Look it up once with
+// ShaderProgram::uniformHandle and keep it around, setting a uniform through
+// a handle doesn't touch strings or the driver.
+struct UniformHandle {
+    static constexpr std::uint32_t invalid_index =
+        std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t index = invalid_index;
+
+    bool valid() const { return index != invalid_index; }
+};
+
+// One entry per active uniform, filled in when the program is linked.
+struct UniformSlot {
+    gl::GLint location;
+    gl::GLenum type;
+    // array length, 1 for plain uniforms
+    gl::GLint size;
+    // where the last uploaded value lives in the shadow buffer
+    std::uint32_t shadow_offset;
+    std::uint32_t shadow_bytes;
+    // how much of the shadow holds uploaded values, arrays can be set
+    // partially
+    std::uint32_t uploaded_bytes;
+};
+
 class ShaderProgram {
    public:
     gl::GLuint id;
@@ -30,17 +86,95 @@ class ShaderProgram {
 
     ShaderProgram(fs::path vertex_shader_path, fs::path fragment_shader_path);
     ShaderProgram(gl::GLuint vertex_shader_id, gl::GLuint fragment_shader_id);
+    // Loads the linked program from the cache when it can.
+    ShaderProgram(
+        fs::path vertex_shader_path,
+        fs::path fragment_shader_path,
+        ProgramCache& cache
+    );
+
+    // Returns an invalid handle if the uniform isn't active in the program,
+    // setting an invalid handle is a no-op just like location -1 in GL.
+    UniformHandle uniformHandle(std::string_view name) const;
+
+    // Uploads are skipped when the value is the same as the last one set
+    // through this program. T is any of the GLSL types: float, int,
+    // unsigned, bool and the glm vectors and matrices (bool uniforms take
+    // any of them, int uniforms take bool, samplers take int). Throws if T
+    // doesn't fit the uniform.
+    template <typename T>
+    void setUniform(UniformHandle handle, const T& value) const;
+
+    // The first values.size() elements of an array uniform, in one call.
+    // Throws if there are more values than the array has elements.
+    template <typename T>
+    void setUniform(UniformHandle handle, std::span<const T> values) const;
 
     // 🔥 Template for GLM vectors and more
     template <typename T>
-    void setUniform(const std::string& name, const T value) const;
+    void setUniform(
+        const std::string& name,
+        const T& value
+    ) const {
+        setUniform<T>(uniformHandle(name), value);
+    }
 
-   private:
-    gl::GLint getUniformLocation(
-        const std::string& name
+    template <typename T>
+    void setUniform(
+        const std::string& name,
+        std::span<const T> values
+    ) const {
+        setUniform<T>(uniformHandle(name), values);
+    }
+
+    // Swaps in a freshly linked program and deletes the old one. Handles
+    // stay valid: uniforms are matched up by name, ones that are gone act
+    // like location -1. Every value has to be set again, the shadow copies
+    // are forgotten.
+    void replace(gl::GLuint program_id);
+
+    const std::vector<UniformSlot>& uniforms() const { return uniform_slots; }
+    const std::string& uniformName(
+        UniformHandle handle
     ) const {
-        return gl::glGetUniformLocation(id, name.c_str());
+        return uniform_names[handle.index];
     }
+
+    // How many setUniform calls were dropped by the redundant-value filter.
+    std::size_t elidedUniformUploads() const { return elided_uploads; }
+
+   private:
+    void reflectUniforms();
+    // points every uniform block at its binding from the
+    // UniformBlockRegistry, throws if a block's size disagrees with the C++
+    // side
+    void bindUniformBlocks();
+
+    // Resolves the handle and checks the values fit the uniform, throws if
+    // they don't. nullptr means the call is a no-op.
+    UniformSlot* checkedSlot(
+        UniformHandle handle,
+        gl::GLenum value_type,
+        std::size_t count
+    ) const;
+
+    // Records the value in the shadow buffer, returns false if it matches the
+    // last upload and the GL call can be skipped.
+    bool updateShadow(
+        UniformSlot& slot,
+        const void* data,
+        std::size_t bytes
+    ) const;
+
+    // cold: only used when resolving handles
+    std::vector<std::string> uniform_names;
+    // uniform indices sorted by name, for binary search
+    std::vector<std::uint32_t> uniform_lookup;
+
+    // hot: touched on every setUniform
+    mutable std::vector<UniformSlot> uniform_slots;
+    mutable std::vector<std::byte> uniform_shadow;
+    mutable std::size_t elided_uploads = 0;
 };
 
-}  // namespace omgl
\ No newline at end of file
+}  // namespace omgl
@@ -0,0 +1,265 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <omgl/job_system.hpp>
+#include <omgl/vertex_format.hpp>
+#include <span>
+#include <vector>
+
+namespace omgl {
+
+// The most floats a soft shader can pass from vertex to fragment.
+constexpr std::size_t soft_max_varyings = 16;
+// Attribute locations a soft shader can read, 0 to 15.
+constexpr std::size_t soft_max_attributes = 16;
+
+// What the vertex stage gets: every attribute of the vertex by location,
+// widened to a vec4 the way GL does it, (0, 0, 0, 1) where nothing is bound.
+struct SoftVertexInput {
+    std::array<glm::vec4, soft_max_attributes> attributes;
+};
+
+// What the vertex stage hands on: the clip space position and the
+// varyings, interpolated perspective-correctly for the fragment stage.
+struct SoftVertex {
+    glm::vec4 position;
+    std::array<float, soft_max_varyings> varyings;
+};
+
+using SoftVaryings = std::array<float, soft_max_varyings>;
+
+// A "shader" for SoftRasterizer::draw() is any type with
+//
+//     static constexpr std::size_t varying_count = ...;
+//     void vertex(const SoftVertexInput& in, SoftVertex& out) const;
+//     glm::vec4 fragment(const SoftVaryings& varyings) const;
+//
+// Both are called from several threads at once, so they should only read
+// their members. Only the first varying_count varyings get interpolated.
+template <typename Shader>
+concept SoftShader = requires(
+    const Shader& shader,
+    const SoftVertexInput& in,
+    SoftVertex& out,
+    const SoftVaryings& varyings
+) {
+    { Shader::varying_count } -> std::convertible_to<std::size_t>;
+    shader.vertex(in, out);
+    { shader.fragment(varyings) } -> std::convertible_to<glm::vec4>;
+};
+
+// A mesh in the same form the GL path takes it: interleaved vertices
+// described by VertexAttributes, and optional indices. Without indices the
+// vertices are drawn in order, like glDrawArrays.
+struct SoftMesh {
+    std::span<const VertexAttribute> attributes;
+    std::size_t stride;
+    std::span<const std::byte> vertices;
+    std::span<const std::uint32_t> indices;
+};
+
+// Draws triangles on the CPU, for machines without a GPU and as a
+// reference: the output only depends on the input, not on the thread
+// count or the machine's SIMD width.
+//
+// Vertices snap to 1/16 of a pixel and coverage is decided with integer
+// edge functions and GL's top-left rule, so triangles sharing an edge
+// neither overlap nor leave gaps. The screen is split into 64x64 tiles;
+// triangles are binned into the tiles they touch and every tile is
+// rasterized, depth tested (GL_LESS) and shaded on its own, four pixels
+// at a time with SSE2. Triangles are clipped against the near and far
+// planes and a guard band, and drawn regardless of winding.
+//
+// Pixels are RGBA8 with the bottom row first, the same as glReadPixels,
+// so the results can be compared byte for byte.
+//
+//     omgl::SoftRasterizer raster(800, 600, &jobs);
+//     raster.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+//     raster.draw(mesh, SolidColor{.color = orange});
+//     write_ppm(raster.pixels(), ...);
+class SoftRasterizer {
+   public:
+    struct Stats {
+        std::size_t triangles = 0;
+        // entirely outside a clip plane or with no area
+        std::size_t culled = 0;
+        // crossing a clip plane, split into smaller ones
+        std::size_t clipped = 0;
+        // fragments that passed the depth test and got shaded
+        std::size_t fragments = 0;
+    };
+
+    static constexpr int tile_size = 64;
+    static constexpr int subpixel_bits = 4;
+
+    // At most 4096x4096, the fixed point math runs out of bits beyond.
+    SoftRasterizer(
+        std::size_t width,
+        std::size_t height,
+        JobSystem* jobs = nullptr
+    );
+
+    void clear(const glm::vec4& color, float depth = 1.0f);
+
+    template <SoftShader Shader>
+    void draw(const SoftMesh& mesh, const Shader& shader);
+
+    std::size_t width() const { return target_width; }
+    std::size_t height() const { return target_height; }
+
+    // RGBA8, bottom row first
+    std::span<const std::uint8_t> pixels() const;
+    std::span<const float> depth() const { return depth_buffer; }
+
+    // Counts of everything drawn since the last clear().
+    const Stats& stats() const { return draw_stats; }
+
+   private:
+    // A triangle after clipping, in window space.
+    struct Triangle {
+        // fixed point window coordinates
+        std::array<std::int32_t, 3> x;
+        std::array<std::int32_t, 3> y;
+        // twice the area, in fixed point
+        std::int64_t area;
+        // window depth, 0..1
+        std::array<float, 3> z;
+        std::array<float, 3> inverse_w;
+        // the varyings divided by w
+        std::array<SoftVaryings, 3> varyings;
+        // pixel bounds, inclusive
+        int min_x, min_y, max_x, max_y;
+    };
+
+    // One pixel of one triangle that passed the depth test.
+    struct Fragment {
+        std::uint32_t pixel;
+        // chunk_triangles[chunk][triangle]
+        std::uint32_t chunk;
+        std::uint32_t triangle;
+        // screen space barycentrics
+        float b1;
+        float b2;
+    };
+
+    void fetchVertex(
+        const SoftMesh& mesh,
+        std::size_t index,
+        SoftVertexInput& in
+    ) const;
+
+    // clips, sets up and bins the triangles of `shaded`
+    void assemble(
+        std::span<const std::uint32_t> indices,
+        std::size_t varying_count
+    );
+    void setupTriangle(
+        const SoftVertex& a,
+        const SoftVertex& b,
+        const SoftVertex& c,
+        std::size_t varying_count,
+        std::vector<Triangle>& out
+    );
+
+    // coverage and depth test of every triangle binned into `tile`, in
+    // order
+    void rasterizeTile(std::size_t tile, std::vector<Fragment>& fragments);
+
+    void interpolate(
+        const Fragment& fragment,
+        std::size_t varying_count,
+        SoftVaryings& out
+    ) const;
+    void writeColor(std::uint32_t pixel, const glm::vec4& color);
+
+    // runs body(begin, end) over [0, count), on the jobs if there are any
+    template <typename Body>
+    void forEach(std::size_t count, std::size_t grain, Body&& body);
+
+    std::size_t target_width;
+    std::size_t target_height;
+    JobSystem* jobs;
+
+    std::vector<std::uint32_t> color_buffer;
+    std::vector<float> depth_buffer;
+
+    int tiles_x;
+    int tiles_y;
+
+    // the current draw
+    std::vector<SoftVertex> shaded;
+    // one list per assembly chunk, so chunks don't share anything and the
+    // tiles see the triangles in submission order
+    std::vector<std::vector<Triangle>> chunk_triangles;
+    // [chunk][tile] indices into chunk_triangles[chunk]
+    std::vector<std::vector<std::vector<std::uint32_t>>> bins;
+    // one per worker and one for everyone else
+    std::vector<std::vector<Fragment>> fragment_buffers;
+
+    Stats draw_stats;
+};
+
+template <typename Body>
+void SoftRasterizer::forEach(
+    std::size_t count,
+    std::size_t grain,
+    Body&& body
+) {
+    if (jobs != nullptr) {
+        jobs->parallelFor(count, grain, body);
+    } else {
+        body(std::size_t{0}, count);
+    }
+}
+
+template <SoftShader Shader>
+void SoftRasterizer::draw(
+    const SoftMesh& mesh,
+    const Shader& shader
+) {
+    static_assert(
+        Shader::varying_count <= soft_max_varyings, "Too many varyings"
+    );
+
+    const std::size_t vertex_count =
+        mesh.stride > 0 ? mesh.vertices.size() / mesh.stride : 0;
+    shaded.resize(vertex_count);
+
+    forEach(vertex_count, 1024, [&](std::size_t begin, std::size_t end) {
+        SoftVertexInput in;
+        for (std::size_t i = begin; i < end; i++) {
+            fetchVertex(mesh, i, in);
+            shaded[i] = SoftVertex{};
+            shader.vertex(in, shaded[i]);
+        }
+    });
+
+    assemble(mesh.indices, Shader::varying_count);
+
+    const std::size_t tile_count = static_cast<std::size_t>(tiles_x) * tiles_y;
+    std::vector<std::size_t> shaded_counts(tile_count);
+
+    forEach(tile_count, 1, [&](std::size_t begin, std::size_t end) {
+        auto& fragments = fragment_buffers[jobs ? jobs->currentWorker() : 0];
+        SoftVaryings varyings;
+        for (std::size_t tile = begin; tile < end; tile++) {
+            fragments.clear();
+            rasterizeTile(tile, fragments);
+            // in submission order, so the last fragment to pass the depth
+            // test ends up on screen, like on GL
+            for (const auto& fragment : fragments) {
+                interpolate(fragment, Shader::varying_count, varyings);
+                writeColor(fragment.pixel, shader.fragment(varyings));
+            }
+            shaded_counts[tile] = fragments.size();
+        }
+    });
+
+    for (auto count : shaded_counts) {
+        draw_stats.fragments += count;
+    }
+}
+
+}  // namespace omgl
@@ -0,0 +1,143 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace omgl {
+
+// Shadow copy of the GL binding state, so redundant binds never reach the
+// driver.
+//
+// Only works if every bind goes through it. Code that talks to GL directly
+// (or a new context) has to call invalidate() afterwards, after which the
+// first call for each piece of state is issued again.
+//
+// Everything starts out unknown rather than assuming GL's defaults.
+//
+//     auto& state = omgl::StateCache::current();
+//     state.useProgram(program);
+//     state.bindVertexArray(vao);
+//     ...
+//     state.endFrame();
+//     spdlog::info("{} elided", state.frameStats().elided);
+class StateCache {
+   public:
+    struct Stats {
+        // calls that made it to GL
+        std::size_t issued = 0;
+        // calls dropped because the state was already set
+        std::size_t elided = 0;
+    };
+
+    // The cache of the calling thread, which is the thread the context is
+    // current on.
+    static StateCache& current();
+
+    void useProgram(gl::GLuint program);
+    void bindVertexArray(gl::GLuint vao);
+
+    // The element array binding belongs to the VAO, so it's forgotten
+    // whenever the VAO changes.
+    void bindBuffer(gl::GLenum target, gl::GLuint buffer);
+
+    // Always issued, but glBindBufferRange also changes the generic binding
+    // of `target`, so that has to be tracked.
+    void bindBufferRange(
+        gl::GLenum target,
+        gl::GLuint index,
+        gl::GLuint buffer,
+        gl::GLintptr offset,
+        gl::GLsizeiptr size
+    );
+
+    void activeTexture(gl::GLuint unit);
+    // Also makes `unit` the active one.
+    void bindTexture(gl::GLuint unit, gl::GLenum target, gl::GLuint texture);
+
+    // glEnable/glDisable
+    void setEnabled(gl::GLenum capability, bool enabled);
+    void blendFunc(gl::GLenum source, gl::GLenum destination);
+    void depthFunc(gl::GLenum function);
+    void depthMask(bool write);
+    void viewport(
+        gl::GLint x,
+        gl::GLint y,
+        gl::GLsizei width,
+        gl::GLsizei height
+    );
+    // glPixelStorei(GL_UNPACK_ALIGNMENT)
+    void unpackAlignment(gl::GLint alignment);
+
+    // Call before deleting an object. GL unbinds deleted objects, and their
+    // names get reused, so the cache mustn't think they're still bound.
+    void forgetBuffer(gl::GLuint buffer);
+    void forgetVertexArray(gl::GLuint vao);
+    void forgetTexture(gl::GLuint texture);
+    // Returns whether it was the current program.
+    bool forgetProgram(gl::GLuint program);
+
+    // Forgets everything.
+    void invalidate();
+
+    // The context's extensions, sorted. Read on the first call after the
+    // cache was made or invalidated, which every new context does anyway.
+    const std::vector<std::string>& extensions();
+
+    // Closes the frame's counters.
+    void endFrame();
+
+    // Counters of the last finished frame.
+    const Stats& frameStats() const { return last_frame; }
+    // Counters since the cache was created.
+    Stats totalStats() const;
+
+   private:
+    static constexpr gl::GLuint unknown = ~0u;
+
+    struct BufferBinding {
+        gl::GLenum target;
+        gl::GLuint buffer;
+    };
+
+    struct TextureBinding {
+        gl::GLuint unit;
+        gl::GLenum target;
+        gl::GLuint texture;
+    };
+
+    struct Capability {
+        gl::GLenum capability;
+        bool enabled;
+    };
+
+    // counts the call and returns true if it has to be issued
+    bool change(bool differs);
+
+    gl::GLuint program = unknown;
+    gl::GLuint vertex_array = unknown;
+    gl::GLuint active_unit = unknown;
+
+    // a handful of targets and units at most, so a linear search beats
+    // anything fancier
+    std::vector<BufferBinding> buffers;
+    std::vector<TextureBinding> textures;
+    std::vector<Capability> capabilities;
+
+    std::optional<std::pair<gl::GLenum, gl::GLenum>> blend;
+    std::optional<gl::GLenum> depth_function;
+    std::optional<bool> depth_write;
+    std::optional<std::array<gl::GLint, 4>> viewport_rect;
+    std::optional<gl::GLint> unpack_alignment;
+
+    std::optional<std::vector<std::string>> extension_names;
+
+    Stats frame;
+    Stats last_frame;
+    Stats previous_frames;
+};
+
+}  // namespace omgl
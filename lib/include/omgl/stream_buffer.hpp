@@ -0,0 +1,109 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <vector>
+
+namespace omgl {
+
+// One big buffer for data that changes every frame.
+//
+// The buffer is split into `region_count` regions, one per frame in flight.
+// Each frame bump-allocates from its region and the region is fenced at the
+// end of the frame, so it's only written again once the GPU is done reading
+// it. With ARB_buffer_storage the whole buffer is persistently mapped once
+// and never unmapped. Without it, the buffer is orphaned with
+// glBufferData(nullptr) whenever the ring wraps and each region is mapped
+// unsynchronized for the frame. The buffer is only ever bound to
+// GL_COPY_WRITE_BUFFER here; binding it to `target` for drawing is up to
+// the caller.
+//
+//     stream.beginFrame();
+//     auto allocation = stream.allocate(bytes);
+//     std::memcpy(allocation.data, vertices, bytes);
+//     stream.commit();
+//     // draw using allocation.offset into stream.id
+//     stream.endFrame();
+class StreamBuffer {
+   public:
+    struct Allocation {
+        // offset into the GL buffer, for attribute pointers, draw offsets and
+        // the like
+        std::size_t offset;
+        // where to write it, null for an empty allocation at the end of a
+        // full region in the fallback path
+        void* data;
+    };
+
+    struct Stats {
+        std::size_t frames = 0;
+        // times beginFrame() had to wait for the GPU to free a region
+        std::size_t waits = 0;
+        double wait_ms = 0;
+    };
+
+    // `region_size` is rounded up to a multiple of `region_alignment`, so
+    // every region starts on it. Pass the largest alignment allocate() will
+    // be asked for (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and friends) to keep
+    // the rounding from eating into the region.
+    StreamBuffer(
+        gl::GLenum target,
+        std::size_t region_size,
+        std::size_t region_count = 3,
+        std::size_t region_alignment = 256
+    );
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Moves to the next region, waiting for the GPU if it's still using it.
+    void beginFrame();
+
+    // The offset into the buffer is a multiple of `alignment`. Throws if
+    // the frame's region is full.
+    Allocation allocate(std::size_t bytes, std::size_t alignment = 16);
+
+    // Makes everything written so far visible to GL. Has to happen before
+    // drawing from the allocations. The frame can keep allocating after it,
+    // for the next draw.
+    void commit();
+
+    // Fences the region so it isn't reused too early.
+    void endFrame();
+
+    gl::GLuint id() const { return buffer_id; }
+    gl::GLenum target() const { return buffer_target; }
+    bool persistent() const { return persistent_mapping; }
+
+    std::size_t regionSize() const { return region_size; }
+    std::size_t regionCount() const { return region_count; }
+    // bytes allocated in the current frame
+    std::size_t used() const { return region_used; }
+
+    const Stats& stats() const { return stream_stats; }
+
+   private:
+    // maps the region from region_used on, for the fallback path
+    void mapRest();
+
+    gl::GLuint buffer_id;
+    gl::GLenum buffer_target;
+    std::size_t region_size;
+    std::size_t region_count;
+
+    bool persistent_mapping;
+    // the persistent mapping, or the current region's mapping in the
+    // fallback path
+    std::byte* mapped = nullptr;
+    // where in the region the fallback mapping starts
+    std::size_t mapped_from = 0;
+
+    std::vector<gl::GLsync> region_fences;
+    std::size_t region = 0;
+    std::size_t region_used = 0;
+    bool in_frame = false;
+
+    Stats stream_stats;
+};
+
+}  // namespace omgl
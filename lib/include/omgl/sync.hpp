@@ -0,0 +1,20 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+
+namespace omgl {
+
+// Small helpers around GL fence sync objects.
+
+// Fence that signals once every command issued so far has finished.
+gl::GLsync insert_fence();
+
+// Non-blocking check. A null fence counts as signaled.
+bool fence_signaled(gl::GLsync fence);
+
+// Blocks until the fence signals. A null fence returns right away.
+void wait_fence(gl::GLsync fence);
+
+// Deletes the fence and nulls it.
+void delete_fence(gl::GLsync& fence);
+
+}  // namespace omgl
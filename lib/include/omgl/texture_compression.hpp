@@ -0,0 +1,14 @@
+#pragma once
+#include <omgl/texture_manager.hpp>
+
+namespace omgl {
+
+// Block compresses every level of an RGBA8 image to BC1 (S3TC DXT1,
+// GL_COMPRESSED_RGB_S3TC_DXT1_EXT), 8 bytes per 4x4 block and alpha
+// dropped. The endpoints are the bounding box of each block's colors, pulled
+// in a little and flipped along the axes the colors run against, which is
+// quick and close to what slower encoders get on smooth content. Meant for
+// offline conversion, see texconv.
+TextureImage compress_bc1(const TextureImage& image);
+
+}  // namespace omgl
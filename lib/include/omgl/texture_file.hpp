@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <omgl/io.hpp>
+#include <omgl/texture_manager.hpp>
+#include <span>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// .omtx, textures already in the layout GL uploads them in.
+//
+// A header, an index with one entry per level and layer, then the data of
+// each, 16 byte aligned and in exactly the form glTexSubImage2D or
+// glCompressedTexSubImage2D takes it. The data goes smallest level first,
+// the order TextureManager streams it in. Loading one is mapping the file
+// and reading the index; the pixels go from the page cache into the upload
+// buffer without anything in between. Everything is little endian.
+//
+// Files are written by write_texture_file(), usually through texconv.
+
+struct TextureFileHeader {
+    std::array<char, 4> magic;
+    std::uint32_t version;
+    // GL enums, format and type are 0 for compressed formats
+    std::uint32_t internal_format;
+    std::uint32_t format;
+    std::uint32_t type;
+    // see TextureImage
+    std::uint32_t block_size;
+    std::uint32_t bytes_per_block;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t level_count;
+    std::uint32_t layer_count;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(TextureFileHeader) == 48);
+
+// Entry `level * layer_count + layer` of the index, right after the header.
+struct TextureFileLevel {
+    // from the start of the file
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t level;
+    std::uint32_t layer;
+};
+static_assert(sizeof(TextureFileLevel) == 32);
+
+constexpr std::array<char, 4> texture_file_magic = {'O', 'M', 'T', 'X'};
+constexpr std::uint32_t texture_file_version = 1;
+
+// A mapped .omtx file. The constructor checks the header and that every
+// level is where the index says and as big as its size says.
+class TextureFile {
+   public:
+    // Throws if the file can't be mapped or isn't a valid .omtx.
+    explicit TextureFile(const fs::path& path);
+
+    const TextureFileHeader& header() const { return file_header; }
+
+    // Straight out of the mapping, valid as long as the TextureFile.
+    std::span<const std::byte> data(
+        std::size_t level,
+        std::size_t layer = 0
+    ) const;
+
+   private:
+    MappedFile file;
+    TextureFileHeader file_header;
+    std::vector<TextureFileLevel> index;
+};
+
+// One layer of the file as a TextureImage whose levels point into the
+// mapping, which the image keeps alive. Decodes nothing, so it's a fine
+// TextureDecoder.
+TextureImage read_texture_file(const fs::path& path, std::size_t layer = 0);
+
+// Writes the layers, which must all have the same format, size and level
+// count, to `path`. Throws on mismatches or write errors.
+void write_texture_file(
+    const fs::path& path,
+    std::span<const TextureImage> layers
+);
+
+}  // namespace omgl
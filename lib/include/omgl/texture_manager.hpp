@@ -0,0 +1,249 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <omgl/job_system.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace omgl {
+
+// A decoded texture, every mip level of it, in the form glTexSubImage2D
+// or glCompressedTexSubImage2D takes it.
+struct TextureImage {
+    struct Level {
+        std::size_t width;
+        std::size_t height;
+        // tightly packed rows of blocks, bottom row first like GL wants them
+        std::vector<std::byte> pixels;
+        // used instead of `pixels` when it isn't empty, for levels that
+        // point into memory `source` keeps alive
+        std::span<const std::byte> mapped;
+
+        std::span<const std::byte> data() const {
+            return mapped.empty() ? std::span<const std::byte>(pixels) : mapped;
+        }
+    };
+
+    // for glTexStorage2D
+    gl::GLenum internal_format = gl::GL_RGBA8;
+    // for glTexSubImage2D, unused when compressed
+    gl::GLenum format = gl::GL_RGBA;
+    gl::GLenum type = gl::GL_UNSIGNED_BYTE;
+    // pixels are stored in blocks of block_size x block_size, 1 for plain
+    // pixels and 4 for the BCn formats, which are compressed
+    std::size_t block_size = 1;
+    std::size_t bytes_per_block = 4;
+
+    // level 0, the full size one, first
+    std::vector<Level> levels;
+    // whatever the levels' `mapped` views point into
+    std::shared_ptr<const void> source;
+
+    bool compressed() const { return block_size > 1; }
+    // bytes in one row of blocks of a level `width` pixels wide
+    std::size_t rowBytes(std::size_t width) const {
+        return (width + block_size - 1) / block_size * bytes_per_block;
+    }
+};
+
+// Appends levels 1 and up to an RGBA8 image that only has level 0, each
+// a 2x2 box filter of the one before, down to 1x1.
+void generate_mipmaps(TextureImage& image);
+
+// Binary PPM (P6, 8 bits per channel) as RGBA8 with a full mip chain.
+// Throws on anything else.
+TextureImage decode_ppm(const fs::path& path);
+
+// Turns a file into a TextureImage. Runs on a worker thread, so it mustn't
+// touch GL. Throws when it can't.
+using TextureDecoder = std::function<TextureImage(const fs::path& path)>;
+
+struct TextureHandle {
+    std::uint32_t index;
+    // bumped whenever the slot is reused, so stale handles are caught
+    std::uint32_t generation;
+};
+
+// Loads textures in the background so a scene can start drawing before its
+// textures are in.
+//
+// load() returns a handle right away and queues the file for decoding on
+// the JobSystem. update(), once a frame on the GL thread, picks up what got
+// decoded and uploads it through a ring of pixel unpack buffers, at most
+// `upload_budget` bytes a frame so a big texture never stalls a frame; a
+// level that doesn't fit is spread over several frames, a band of rows at a
+// time. The smallest mip levels go first and GL_TEXTURE_BASE_LEVEL follows
+// the finest level that's complete, so a blurry version of the texture is
+// there after a frame or two and sharpens as the rest arrives.
+//
+// Until then id() hands out a 1x1 grey placeholder, so drawing never has to
+// check.
+//
+//     omgl::TextureManager textures(jobs);
+//     auto albedo = textures.load("bricks.ppm");
+//     while (...) {
+//         textures.update();
+//         state.bindTexture(0, gl::GL_TEXTURE_2D, textures.id(albedo));
+//         ...
+//     }
+class TextureManager {
+   public:
+    struct Config {
+        // bytes glTexSubImage2D'd per update()
+        std::size_t upload_budget = 8 * 1024 * 1024;
+        // staging regions, one per frame the GPU may still be reading from
+        std::size_t staging_regions = 3;
+    };
+
+    enum class Status {
+        // being decoded, or waiting for its first level to be uploaded
+        decoding,
+        // some levels are on the GPU, id() is usable
+        partial,
+        // every level is on the GPU
+        resident,
+        // couldn't be decoded, id() stays the placeholder
+        failed,
+    };
+
+    struct Stats {
+        std::size_t loaded = 0;
+        std::size_t decoding = 0;
+        // decoded and waiting for upload, or partway through it
+        std::size_t uploading = 0;
+        std::size_t resident = 0;
+        std::size_t failed = 0;
+        // by the last update()
+        std::size_t uploaded_bytes = 0;
+        std::size_t total_uploaded_bytes = 0;
+        // bytes decoded but not uploaded yet
+        std::size_t queued_bytes = 0;
+    };
+
+    // Knows .ppm and .omtx out of the box, anything else needs
+    // addDecoder().
+    TextureManager(JobSystem& jobs, Config config);
+    explicit TextureManager(JobSystem& jobs)
+        : TextureManager(jobs, Config{}) {}
+    // Waits for the decodes still running, then deletes every texture.
+    ~TextureManager();
+
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    // Decodes files ending in `extension` (".ppm", lower case) with
+    // `decoder` from now on.
+    void addDecoder(const std::string& extension, TextureDecoder decoder);
+
+    // Throws if there's no decoder for the file's extension, decoding
+    // errors only show up as Status::failed.
+    TextureHandle load(const fs::path& path);
+    // Deletes the texture, or drops it once it's decoded.
+    void release(TextureHandle handle);
+
+    // Picks up decoded images and spends the frame's upload budget. GL
+    // thread only. Without worker threads this is also where the decoding
+    // happens, all of it at once.
+    void update();
+
+    // The texture, or the placeholder while there's nothing to sample yet.
+    gl::GLuint id(TextureHandle handle) const;
+    Status status(TextureHandle handle) const;
+    // The finest level that can be sampled, or the level count while
+    // nothing is uploaded.
+    std::size_t residentLevel(TextureHandle handle) const;
+
+    Stats stats() const;
+    void logStats() const;
+
+   private:
+    struct Entry {
+        fs::path path;
+        std::uint32_t generation = 0;
+        bool used = false;
+        Status status = Status::decoding;
+        gl::GLuint texture = 0;
+
+        // decoded and not fully uploaded yet, dropped when done
+        std::unique_ptr<TextureImage> image;
+        std::size_t level_count = 0;
+        // the level being uploaded, the smaller ones past it are done
+        std::size_t next_level = 0;
+        // rows of blocks of next_level uploaded so far
+        std::size_t next_row = 0;
+    };
+
+    // one glTexSubImage2D out of the staging buffer
+    struct Upload {
+        gl::GLuint texture;
+        gl::GLenum internal_format;
+        gl::GLenum format;
+        gl::GLenum type;
+        bool compressed;
+        std::size_t level;
+        std::size_t width;
+        // in pixels
+        std::size_t first_row;
+        std::size_t rows;
+        std::size_t offset;
+        std::size_t bytes;
+        // the level is complete after this one
+        bool completes_level;
+    };
+
+    struct Decoded {
+        std::uint32_t index;
+        std::uint32_t generation;
+        // null when decoding failed
+        std::unique_ptr<TextureImage> image;
+    };
+
+    const Entry& entry(TextureHandle handle) const;
+    Entry& entry(TextureHandle handle);
+
+    // creates the texture and its storage for every level
+    void createTexture(Entry& entry);
+    // copies what fits into `budget` of the entry's next level into the
+    // staging buffer, returns the bytes used
+    std::size_t stageLevel(
+        Entry& entry,
+        std::size_t budget,
+        std::vector<Upload>& uploads
+    );
+
+    JobSystem& jobs;
+    Config config;
+
+    std::map<std::string, TextureDecoder> decoders;
+
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> free_entries;
+    // decoded, waiting for upload, oldest first
+    std::vector<std::uint32_t> upload_queue;
+
+    std::unique_ptr<StreamBuffer> staging;
+    gl::GLuint placeholder = 0;
+    bool texture_storage;
+    // BC1 textures fail without it
+    bool s3tc_support;
+
+    // filled by the decode jobs, emptied by update()
+    std::mutex decoded_mutex;
+    std::vector<Decoded> decoded;
+    JobCounter decodes;
+
+    std::size_t last_uploaded_bytes = 0;
+    std::size_t total_uploaded_bytes = 0;
+};
+
+}  // namespace omgl
@@ -0,0 +1,396 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace omgl {
+
+class StreamBuffer;
+
+// Typed uniform buffer objects with the std140 layout worked out at compile
+// time.
+//
+// A C++ struct is described once by specializing UniformBlockLayout with the
+// GLSL block name and its fields, in declaration order:
+//
+//     struct FrameUniforms {
+//         glm::mat4 view_projection;
+//         glm::vec3 light_direction;
+//         float time;
+//     };
+//
+//     template <>
+//     struct omgl::UniformBlockLayout<FrameUniforms> {
+//         static constexpr std::string_view name = "Frame";
+//         static constexpr auto fields = std::tuple{
+//             uniform_field(&FrameUniforms::view_projection),
+//             uniform_field(&FrameUniforms::light_direction),
+//             uniform_field(&FrameUniforms::time),
+//         };
+//     };
+//
+// which matches `layout(std140) uniform Frame { mat4 view_projection;
+// vec3 light_direction; float time; };` in GLSL. The C++ struct can be laid
+// out however it likes, the fields are packed into std140 on upload.
+//
+//     omgl::UniformBlock<FrameUniforms> frame;
+//     frame.set(values);  // one glBufferSubData, every program sees it
+//
+// Blocks are matched up with programs by name, see UniformBlockRegistry.
+
+template <typename T>
+struct UniformBlockLayout;
+
+template <typename Struct, typename Member>
+struct UniformField {
+    using type = Member;
+    Member Struct::* member;
+};
+
+template <typename Struct, typename Member>
+constexpr UniformField<Struct, Member> uniform_field(
+    Member Struct::* member
+) {
+    return {member};
+}
+
+constexpr std::size_t std140_align_up(
+    std::size_t value,
+    std::size_t alignment
+) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// How one member type is laid out in std140: its base alignment, how many
+// bytes it takes and how to write it there.
+template <typename T>
+struct Std140;
+
+template <typename T>
+concept Std140Type = requires(const T& value, std::byte* out) {
+    { Std140<T>::alignment } -> std::convertible_to<std::size_t>;
+    { Std140<T>::size } -> std::convertible_to<std::size_t>;
+    Std140<T>::write(value, out);
+};
+
+// scalars and vectors are copied as they are
+template <typename T, std::size_t Alignment>
+struct Std140Plain {
+    static constexpr std::size_t alignment = Alignment;
+    static constexpr std::size_t size = sizeof(T);
+
+    static void write(
+        const T& value,
+        std::byte* out
+    ) {
+        std::memcpy(out, &value, sizeof(T));
+    }
+};
+
+template <>
+struct Std140<float> : Std140Plain<float, 4> {};
+template <>
+struct Std140<std::int32_t> : Std140Plain<std::int32_t, 4> {};
+template <>
+struct Std140<std::uint32_t> : Std140Plain<std::uint32_t, 4> {};
+
+// a vec3 is aligned like a vec4 but only takes 12 bytes, so a scalar can
+// follow it in the same 16
+template <>
+struct Std140<glm::vec2> : Std140Plain<glm::vec2, 8> {};
+template <>
+struct Std140<glm::vec3> : Std140Plain<glm::vec3, 16> {};
+template <>
+struct Std140<glm::vec4> : Std140Plain<glm::vec4, 16> {};
+template <>
+struct Std140<glm::ivec2> : Std140Plain<glm::ivec2, 8> {};
+template <>
+struct Std140<glm::ivec3> : Std140Plain<glm::ivec3, 16> {};
+template <>
+struct Std140<glm::ivec4> : Std140Plain<glm::ivec4, 16> {};
+template <>
+struct Std140<glm::uvec2> : Std140Plain<glm::uvec2, 8> {};
+template <>
+struct Std140<glm::uvec3> : Std140Plain<glm::uvec3, 16> {};
+template <>
+struct Std140<glm::uvec4> : Std140Plain<glm::uvec4, 16> {};
+
+// GLSL bools are 4 bytes
+template <>
+struct Std140<bool> {
+    static constexpr std::size_t alignment = 4;
+    static constexpr std::size_t size = 4;
+
+    static void write(
+        const bool& value,
+        std::byte* out
+    ) {
+        const std::uint32_t word = value ? 1 : 0;
+        std::memcpy(out, &word, sizeof(word));
+    }
+};
+
+// Matrices are arrays of column vectors, and every array element starts on
+// a 16 byte boundary. A mat3 is three vec4s with the w left alone.
+template <typename Matrix, int Columns, typename Column>
+struct Std140Matrix {
+    static constexpr std::size_t alignment = 16;
+    static constexpr std::size_t size = Columns * 16;
+
+    static void write(
+        const Matrix& value,
+        std::byte* out
+    ) {
+        for (int column = 0; column < Columns; column++) {
+            std::memcpy(out + column * 16, &value[column], sizeof(Column));
+        }
+    }
+};
+
+template <>
+struct Std140<glm::mat2> : Std140Matrix<glm::mat2, 2, glm::vec2> {};
+template <>
+struct Std140<glm::mat3> : Std140Matrix<glm::mat3, 3, glm::vec3> {};
+template <>
+struct Std140<glm::mat4> : Std140Matrix<glm::mat4, 4, glm::vec4> {};
+
+// Arrays round their element stride up to 16 too, so a float[4] is 64
+// bytes.
+template <Std140Type T, std::size_t N>
+struct Std140<std::array<T, N>> {
+    static constexpr std::size_t stride =
+        std140_align_up(Std140<T>::size, 16);
+    static constexpr std::size_t alignment =
+        std140_align_up(Std140<T>::alignment, 16);
+    static constexpr std::size_t size = stride * N;
+
+    static void write(
+        const std::array<T, N>& value,
+        std::byte* out
+    ) {
+        for (std::size_t i = 0; i < N; i++) {
+            Std140<T>::write(value[i], out + i * stride);
+        }
+    }
+};
+
+template <typename T>
+concept DescribedUniformBlock = requires {
+    UniformBlockLayout<T>::fields;
+};
+
+// Described structs, either the block itself or a struct member of one.
+// Their alignment is the largest of their members rounded up to 16, and so
+// is their size.
+template <typename Fields>
+struct Std140Fields;
+
+template <typename Struct, typename... Members>
+struct Std140Fields<std::tuple<UniformField<Struct, Members>...>> {
+    static_assert(sizeof...(Members) > 0, "GLSL doesn't allow empty blocks");
+
+    static constexpr std::size_t count = sizeof...(Members);
+
+    // offset of every field, in declaration order
+    static constexpr std::array<std::size_t, count> offsets = [] {
+        std::array<std::size_t, count> result{};
+        std::size_t at = 0;
+        std::size_t i = 0;
+        ((at = std140_align_up(at, Std140<Members>::alignment),
+          result[i++] = at,
+          at += Std140<Members>::size),
+         ...);
+        return result;
+    }();
+
+    static constexpr std::size_t alignment =
+        std::max({std::size_t(16), Std140<Members>::alignment...});
+
+    static constexpr std::size_t size = [] {
+        std::size_t at = 0;
+        ((at = std140_align_up(at, Std140<Members>::alignment) +
+               Std140<Members>::size),
+         ...);
+        return std140_align_up(at, alignment);
+    }();
+
+    static void write(
+        const std::tuple<UniformField<Struct, Members>...>& fields,
+        const Struct& value,
+        std::byte* out
+    ) {
+        std::size_t i = 0;
+        std::apply(
+            [&](const auto&... field) {
+                (Std140<Members>::write(
+                     value.*(field.member), out + offsets[i++]
+                 ),
+                 ...);
+            },
+            fields
+        );
+    }
+};
+
+template <typename T>
+using Std140FieldsOf =
+    Std140Fields<std::remove_cv_t<decltype(UniformBlockLayout<T>::fields)>>;
+
+template <DescribedUniformBlock T>
+struct Std140<T> : Std140FieldsOf<T> {
+    static void write(
+        const T& value,
+        std::byte* out
+    ) {
+        Std140FieldsOf<T>::write(UniformBlockLayout<T>::fields, value, out);
+    }
+};
+
+// For static_asserts against the GLSL side:
+//
+//     static_assert(omgl::std140_offset<FrameUniforms, 2> == 76);
+template <DescribedUniformBlock T>
+constexpr std::size_t std140_size = Std140<T>::size;
+
+template <DescribedUniformBlock T, std::size_t Field>
+constexpr std::size_t std140_offset = Std140<T>::offsets[Field];
+
+// Hands out a uniform buffer binding point per block name, so every program
+// that declares a block reads it from the same place and a buffer only has
+// to be bound once for all of them. Programs pick up their bindings when
+// they are linked, in whatever order they and the buffers come.
+class UniformBlockRegistry {
+   public:
+    // The registry of the calling thread, which is the thread the context is
+    // current on.
+    static UniformBlockRegistry& current();
+
+    // The binding point for the block, assigned on first use. Throws when
+    // the context runs out of them.
+    gl::GLuint binding(std::string_view block_name);
+
+    // Records the std140 size the C++ side has for the block. Throws if a
+    // program already linked with a different one.
+    void declareSize(std::string_view block_name, std::size_t size);
+
+    // Records the size a linked program has for the block. Throws if the
+    // C++ side declared a different one, whichever came first.
+    void checkLinkedSize(
+        std::string_view block_name,
+        std::size_t size,
+        gl::GLuint program
+    );
+
+    // 0 if nothing was declared.
+    std::size_t declaredSize(std::string_view block_name) const;
+
+   private:
+    struct Block {
+        std::string name;
+        gl::GLuint binding;
+        std::size_t size;
+        // from the first program linked with the block, 0 before that
+        std::size_t linked_size = 0;
+        gl::GLuint linked_program = 0;
+    };
+
+    Block& block(std::string_view block_name);
+
+    // a handful of blocks, so a linear search is plenty
+    std::vector<Block> blocks;
+};
+
+// The untyped half of UniformBlock: one GL buffer per block, bound to the
+// block's binding point.
+class UniformBuffer {
+   public:
+    struct Stats {
+        std::size_t uploads = 0;
+        // set() calls with the same bytes as the last upload
+        std::size_t elided = 0;
+    };
+
+    // Throws if a program already linked has the block at another size.
+    UniformBuffer(std::string_view block_name, std::size_t size);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // One glBufferSubData of the whole block, skipped when the bytes are
+    // the same as last time.
+    void upload(std::span<const std::byte> data);
+
+    // Sub-allocates from the stream instead, for blocks that change more
+    // than once a frame. The stream has to be a GL_UNIFORM_BUFFER one and
+    // committed before drawing. Returns where to write the block, the
+    // range is already bound.
+    std::byte* allocate(StreamBuffer& stream);
+
+    // Binds the block's own buffer again, only needed if something else
+    // was bound to the binding point.
+    void bind();
+
+    gl::GLuint id() const { return buffer_id; }
+    gl::GLuint binding() const { return binding_point; }
+    std::size_t size() const { return block_size; }
+    const Stats& stats() const { return upload_stats; }
+
+   private:
+    gl::GLuint buffer_id;
+    gl::GLuint binding_point;
+    std::size_t block_size;
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of the context it was made in
+    std::size_t offset_alignment;
+
+    // the last upload, to drop repeated ones
+    std::vector<std::byte> uploaded;
+    bool has_upload = false;
+    // whether a stream range is bound instead of our own buffer
+    bool stream_bound = false;
+
+    Stats upload_stats;
+};
+
+template <DescribedUniformBlock T>
+class UniformBlock {
+   public:
+    static constexpr std::size_t size = Std140<T>::size;
+
+    UniformBlock() : buffer(UniformBlockLayout<T>::name, size) {}
+
+    void set(
+        const T& value
+    ) {
+        Std140<T>::write(value, staging.data());
+        buffer.upload(staging);
+    }
+
+    // see UniformBuffer::allocate
+    void set(
+        const T& value,
+        StreamBuffer& stream
+    ) {
+        Std140<T>::write(value, buffer.allocate(stream));
+    }
+
+    UniformBuffer& gpu() { return buffer; }
+
+   private:
+    UniformBuffer buffer;
+    // padding stays zeroed so identical values compare equal
+    std::array<std::byte, size> staging{};
+};
+
+}  // namespace omgl
@@ -0,0 +1,388 @@
+#pragma once
+#include <glbinding/gl/gl.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+namespace omgl {
+
+// Everything glVertexAttribPointer needs to know about one attribute.
+struct VertexAttribute {
+    gl::GLuint location;
+    gl::GLint components;
+    gl::GLenum type;
+    // fixed point types mapped to [0, 1] / [-1, 1]
+    bool normalized = false;
+    // fed to an int/uint input through glVertexAttribIPointer
+    bool integer = false;
+    std::size_t offset = 0;
+    // 0 per vertex, 1 per instance
+    gl::GLuint divisor = 0;
+
+    bool operator==(const VertexAttribute&) const = default;
+};
+
+// Points the attributes at the buffer bound to GL_ARRAY_BUFFER, for the
+// bound VAO. `base_offset` is added to every attribute offset.
+void apply_vertex_attributes(
+    std::span<const VertexAttribute> attributes,
+    std::size_t stride,
+    std::size_t base_offset = 0
+);
+
+// Checks the attributes against the active vertex shader inputs of a
+// linked program: every input needs an attribute at its location, and int
+// and uint inputs need integer attributes while float ones need the
+// others. Either mistake leaves GL reading garbage without a word. Throws
+// on the first one found.
+void check_vertex_inputs(
+    gl::GLuint program_id,
+    std::span<const VertexAttribute> attributes
+);
+
+// Vertex layouts worked out at compile time from the C++ vertex struct.
+//
+// A struct is described once by specializing VertexLayout with an attribute
+// location for every member, in declaration order:
+//
+//     struct Vertex {
+//         glm::vec3 position;
+//         std::uint32_t normal;
+//         std::array<std::uint16_t, 2> uv;
+//     };
+//
+//     template <>
+//     struct omgl::VertexLayout<Vertex> {
+//         static constexpr auto fields = std::tuple{
+//             vertex_field(0, &Vertex::position),
+//             vertex_field(
+//                 1, &Vertex::normal, vertex_formats::snorm_10_10_10_2
+//             ),
+//             vertex_field(2, &Vertex::uv, vertex_formats::half2),
+//         };
+//         // optional, 1 for per instance data
+//         static constexpr gl::GLuint divisor = 0;
+//     };
+//
+// Floats, ints and the glm vectors of them know their format, anything
+// else is a packed format from vertex_formats. The offsets follow from the
+// member types, and it's a compile error if a member is missing, out of
+// order, or smaller than its format, or if two share a location.
+//
+//     omgl::apply_vertex_layout<Vertex>();
+//     omgl::check_vertex_inputs(
+//         program.id, omgl::vertex_attributes_of<Vertex>
+//     );
+
+template <typename T>
+struct VertexLayout;
+
+// How the bytes of one attribute are read.
+struct VertexFormat {
+    gl::GLint components;
+    gl::GLenum type;
+    bool normalized = false;
+    bool integer = false;
+    // bytes the attribute reads
+    std::size_t size = 0;
+};
+
+// Smaller encodings, for less vertex bandwidth.
+namespace vertex_formats {
+
+// for positions and texture coordinates, about three significant digits
+constexpr VertexFormat half2{
+    .components = 2, .type = gl::GL_HALF_FLOAT, .size = 4
+};
+constexpr VertexFormat half3{
+    .components = 3, .type = gl::GL_HALF_FLOAT, .size = 6
+};
+constexpr VertexFormat half4{
+    .components = 4, .type = gl::GL_HALF_FLOAT, .size = 8
+};
+
+// 10 bits each for xyz and 2 for w in one uint, x in the lowest bits; for
+// normals and tangents
+constexpr VertexFormat snorm_10_10_10_2{
+    .components = 4,
+    .type = gl::GL_INT_2_10_10_10_REV,
+    .normalized = true,
+    .size = 4,
+};
+constexpr VertexFormat unorm_10_10_10_2{
+    .components = 4,
+    .type = gl::GL_UNSIGNED_INT_2_10_10_10_REV,
+    .normalized = true,
+    .size = 4,
+};
+
+// colors, and normals where 8 bits will do
+constexpr VertexFormat unorm8x4{
+    .components = 4,
+    .type = gl::GL_UNSIGNED_BYTE,
+    .normalized = true,
+    .size = 4,
+};
+constexpr VertexFormat snorm8x4{
+    .components = 4, .type = gl::GL_BYTE, .normalized = true, .size = 4
+};
+
+// texture coordinates in [0, 1] or [-1, 1]
+constexpr VertexFormat unorm16x2{
+    .components = 2,
+    .type = gl::GL_UNSIGNED_SHORT,
+    .normalized = true,
+    .size = 4,
+};
+constexpr VertexFormat snorm16x2{
+    .components = 2, .type = gl::GL_SHORT, .normalized = true, .size = 4
+};
+constexpr VertexFormat snorm16x4{
+    .components = 4, .type = gl::GL_SHORT, .normalized = true, .size = 8
+};
+
+}  // namespace vertex_formats
+
+// The format a member type gets when vertex_field() isn't given one.
+template <typename T>
+struct DefaultVertexFormat;
+
+template <typename T, gl::GLint Components, gl::GLenum Type, bool Integer>
+struct DefaultVertexFormatOf {
+    static constexpr VertexFormat format{
+        .components = Components,
+        .type = Type,
+        .integer = Integer,
+        .size = sizeof(T),
+    };
+};
+
+template <>
+struct DefaultVertexFormat<float>
+    : DefaultVertexFormatOf<float, 1, gl::GL_FLOAT, false> {};
+template <>
+struct DefaultVertexFormat<glm::vec2>
+    : DefaultVertexFormatOf<glm::vec2, 2, gl::GL_FLOAT, false> {};
+template <>
+struct DefaultVertexFormat<glm::vec3>
+    : DefaultVertexFormatOf<glm::vec3, 3, gl::GL_FLOAT, false> {};
+template <>
+struct DefaultVertexFormat<glm::vec4>
+    : DefaultVertexFormatOf<glm::vec4, 4, gl::GL_FLOAT, false> {};
+template <>
+struct DefaultVertexFormat<std::int32_t>
+    : DefaultVertexFormatOf<std::int32_t, 1, gl::GL_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::ivec2>
+    : DefaultVertexFormatOf<glm::ivec2, 2, gl::GL_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::ivec3>
+    : DefaultVertexFormatOf<glm::ivec3, 3, gl::GL_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::ivec4>
+    : DefaultVertexFormatOf<glm::ivec4, 4, gl::GL_INT, true> {};
+template <>
+struct DefaultVertexFormat<std::uint32_t>
+    : DefaultVertexFormatOf<std::uint32_t, 1, gl::GL_UNSIGNED_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::uvec2>
+    : DefaultVertexFormatOf<glm::uvec2, 2, gl::GL_UNSIGNED_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::uvec3>
+    : DefaultVertexFormatOf<glm::uvec3, 3, gl::GL_UNSIGNED_INT, true> {};
+template <>
+struct DefaultVertexFormat<glm::uvec4>
+    : DefaultVertexFormatOf<glm::uvec4, 4, gl::GL_UNSIGNED_INT, true> {};
+
+template <typename Struct, typename Member>
+struct VertexField {
+    using type = Member;
+    gl::GLuint location;
+    Member Struct::* member;
+    VertexFormat format;
+};
+
+template <typename Struct, typename Member>
+constexpr VertexField<Struct, Member> vertex_field(
+    gl::GLuint location,
+    Member Struct::* member
+) {
+    return {location, member, DefaultVertexFormat<Member>::format};
+}
+
+template <typename Struct, typename Member>
+constexpr VertexField<Struct, Member> vertex_field(
+    gl::GLuint location,
+    Member Struct::* member,
+    VertexFormat format
+) {
+    // fields are constexpr, so this is a compile error
+    if (format.size > sizeof(Member)) {
+        throw std::logic_error("The vertex format reads past the member");
+    }
+    return {location, member, format};
+}
+
+template <typename T>
+concept DescribedVertex = requires { VertexLayout<T>::fields; };
+
+template <typename Fields>
+struct VertexFields;
+
+template <typename Struct, typename... Members>
+struct VertexFields<std::tuple<VertexField<Struct, Members>...>> {
+    static_assert(sizeof...(Members) > 0, "A vertex needs an attribute");
+
+    using Tuple = std::tuple<VertexField<Struct, Members>...>;
+
+    static constexpr std::size_t count = sizeof...(Members);
+
+    static constexpr std::size_t alignUp(
+        std::size_t value,
+        std::size_t alignment
+    ) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // members go in declaration order, each at the next multiple of its
+    // alignment
+    static constexpr std::array<std::size_t, count> offsets = [] {
+        std::array<std::size_t, count> result{};
+        std::size_t at = 0;
+        std::size_t i = 0;
+        ((at = alignUp(at, alignof(Members)),
+          result[i++] = at,
+          at += sizeof(Members)),
+         ...);
+        return result;
+    }();
+
+    // what the struct takes with exactly these members
+    static constexpr std::size_t size = [] {
+        std::size_t at = 0;
+        std::size_t alignment = 1;
+        ((at = alignUp(at, alignof(Members)) + sizeof(Members),
+          alignment = std::max(alignment, alignof(Members))),
+         ...);
+        return alignUp(at, alignment);
+    }();
+
+    // compares the members' addresses in a value of the struct
+    static constexpr bool inDeclarationOrder(
+        const Tuple& fields
+    ) {
+        Struct probe{};
+        std::array<const void*, count> addresses{};
+        std::size_t i = 0;
+        std::apply(
+            [&](const auto&... field) {
+                ((addresses[i++] = &(probe.*(field.member))), ...);
+            },
+            fields
+        );
+        for (std::size_t j = 1; j < count; j++) {
+            if (!(addresses[j - 1] < addresses[j])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool uniqueLocations(
+        const Tuple& fields
+    ) {
+        std::array<gl::GLuint, count> locations{};
+        std::size_t i = 0;
+        std::apply(
+            [&](const auto&... field) {
+                ((locations[i++] = field.location), ...);
+            },
+            fields
+        );
+        std::sort(locations.begin(), locations.end());
+        return std::adjacent_find(locations.begin(), locations.end()) ==
+               locations.end();
+    }
+
+    static constexpr std::array<VertexAttribute, count> attributes(
+        const Tuple& fields,
+        gl::GLuint divisor
+    ) {
+        std::array<VertexAttribute, count> result{};
+        std::size_t i = 0;
+        std::apply(
+            [&](const auto&... field) {
+                ((result[i] =
+                      VertexAttribute{
+                          .location = field.location,
+                          .components = field.format.components,
+                          .type = field.format.type,
+                          .normalized = field.format.normalized,
+                          .integer = field.format.integer,
+                          .offset = offsets[i],
+                          .divisor = divisor,
+                      },
+                  i++),
+                 ...);
+            },
+            fields
+        );
+        return result;
+    }
+};
+
+template <DescribedVertex T>
+constexpr gl::GLuint vertex_divisor = [] {
+    if constexpr (requires { VertexLayout<T>::divisor; }) {
+        return gl::GLuint{VertexLayout<T>::divisor};
+    } else {
+        return gl::GLuint{0};
+    }
+}();
+
+template <DescribedVertex T>
+struct VertexAttributesOf {
+    using Fields =
+        VertexFields<std::remove_cv_t<decltype(VertexLayout<T>::fields)>>;
+
+    static_assert(
+        std::is_standard_layout_v<T>,
+        "Vertices have to be standard layout to have predictable offsets"
+    );
+    static_assert(
+        Fields::inDeclarationOrder(VertexLayout<T>::fields),
+        "VertexLayout has to list the members in declaration order"
+    );
+    static_assert(
+        Fields::size == sizeof(T),
+        "VertexLayout has to list every member of the vertex"
+    );
+    static_assert(
+        Fields::uniqueLocations(VertexLayout<T>::fields),
+        "Two members of the vertex share an attribute location"
+    );
+
+    static constexpr auto value =
+        Fields::attributes(VertexLayout<T>::fields, vertex_divisor<T>);
+};
+
+// The VertexAttributes of a described vertex, for MeshPool, InstancedMesh
+// and the rest.
+template <DescribedVertex T>
+constexpr auto vertex_attributes_of = VertexAttributesOf<T>::value;
+
+// apply_vertex_attributes() for a described vertex.
+template <DescribedVertex T>
+void apply_vertex_layout(
+    std::size_t base_offset = 0
+) {
+    apply_vertex_attributes(vertex_attributes_of<T>, sizeof(T), base_offset);
+}
+
+}  // namespace omgl
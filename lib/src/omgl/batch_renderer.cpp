@@ -0,0 +1,499 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <format>
+#include <numeric>
+#include <omgl/batch_renderer.hpp>
+#include <omgl/context_info.hpp>
+#include <omgl/state_cache.hpp>
+#include <stdexcept>
+#include <tuple>
+
+namespace omgl {
+
+// ObjectData has to split evenly into RGBA32F texels on the texture buffer
+// path
+static_assert(sizeof(ObjectData) % 16 == 0);
+
+BatchRenderer::BatchRenderer(
+    std::size_t max_objects,
+    gl::GLuint object_id_location,
+    gl::GLuint object_binding
+)
+    : max_objects(max_objects),
+      object_id_location(object_id_location),
+      object_binding(object_binding) {
+    // MDI and SSBOs are both 4.3, base instance in indirect commands is 4.2
+    indirect = gl_version_at_least(4, 3);
+
+    auto& state = StateCache::current();
+
+    std::vector<std::uint32_t> ids(max_objects);
+    std::iota(ids.begin(), ids.end(), 0);
+
+    gl::glGenBuffers(1, &object_id_buffer);
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, object_id_buffer);
+    gl::glBufferData(
+        gl::GL_ARRAY_BUFFER,
+        ids.size() * sizeof(std::uint32_t),
+        ids.data(),
+        gl::GL_STATIC_DRAW
+    );
+
+    if (indirect) {
+        gl::GLint alignment = 0;
+        gl::glGetIntegerv(
+            gl::GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment
+        );
+        object_alignment = std::max<std::size_t>(alignment, 16);
+
+        // regions a multiple of the alignment, so every frame's range
+        // starts on it
+        object_stream = std::make_unique<StreamBuffer>(
+            gl::GL_SHADER_STORAGE_BUFFER,
+            max_objects * sizeof(ObjectData),
+            3,
+            object_alignment
+        );
+        command_stream = std::make_unique<StreamBuffer>(
+            gl::GL_DRAW_INDIRECT_BUFFER,
+            max_objects * sizeof(DrawElementsIndirectCommand) + 16
+        );
+    } else {
+        // offsets only need to land on a texel
+        object_alignment = 16;
+        object_stream = std::make_unique<StreamBuffer>(
+            gl::GL_TEXTURE_BUFFER,
+            max_objects * sizeof(ObjectData),
+            3,
+            object_alignment
+        );
+
+        // the texture covers the whole ring, and fetches past the limit
+        // quietly return zero
+        gl::GLint max_texels = 0;
+        gl::glGetIntegerv(gl::GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+        const std::size_t texels =
+            object_stream->regionSize() * object_stream->regionCount() / 16;
+        if (texels > static_cast<std::size_t>(max_texels)) {
+            throw std::runtime_error(std::format(
+                "BatchRenderer: {} objects need {} texels of texture buffer, "
+                "GL_MAX_TEXTURE_BUFFER_SIZE is {}",
+                max_objects,
+                texels,
+                max_texels
+            ));
+        }
+
+        gl::glGenTextures(1, &object_texture);
+        state.bindTexture(
+            object_binding, gl::GL_TEXTURE_BUFFER, object_texture
+        );
+        // the whole ring, the shader gets told where this frame starts
+        gl::glTexBuffer(
+            gl::GL_TEXTURE_BUFFER, gl::GL_RGBA32F, object_stream->id()
+        );
+    }
+
+    spdlog::info(
+        "BatchRenderer: up to {} objects, {}",
+        max_objects,
+        indirect ? "multi-draw-indirect" : "instanced fallback"
+    );
+}
+
+BatchRenderer::~BatchRenderer() {
+    auto& state = StateCache::current();
+    state.forgetBuffer(object_id_buffer);
+    gl::glDeleteBuffers(1, &object_id_buffer);
+    if (object_texture != 0) {
+        state.forgetTexture(object_texture);
+        gl::glDeleteTextures(1, &object_texture);
+    }
+}
+
+std::uint64_t BatchRenderer::makeSortKey(
+    gl::GLuint program,
+    gl::GLuint vao,
+    std::uint32_t material
+) {
+    // program switches are the most expensive, so they go in the top bits
+    return (static_cast<std::uint64_t>(program & 0xfffff) << 44) |
+           (static_cast<std::uint64_t>(vao & 0xfffff) << 24) |
+           static_cast<std::uint64_t>(material & 0xffffff);
+}
+
+void BatchRenderer::setMaterialBinder(
+    MaterialBinder binder
+) {
+    material_binder = std::move(binder);
+}
+
+void BatchRenderer::setJobSystem(
+    JobSystem* jobs
+) {
+    this->jobs = jobs;
+}
+
+template <typename Body>
+void BatchRenderer::forChunks(
+    std::size_t count,
+    Body&& body
+) {
+    // big enough that a chunk outweighs queueing it
+    const std::size_t grain = 4096;
+    if (jobs != nullptr) {
+        jobs->parallelFor(count, grain, body);
+    } else {
+        body(std::size_t{0}, count);
+    }
+}
+
+void BatchRenderer::submit(
+    ShaderProgram& program,
+    MeshPool& pool,
+    MeshHandle mesh,
+    std::uint32_t material,
+    const ObjectData& data,
+    std::uint32_t lod
+) {
+    if (items.size() == max_objects) {
+        throw std::runtime_error(std::format(
+            "BatchRenderer is full ({} objects per frame)", max_objects
+        ));
+    }
+
+    items.push_back(DrawItem{
+        .key = makeSortKey(program.id, pool.vao(), material),
+        .program = &program,
+        .pool = &pool,
+        .range = pool.range(mesh, lod),
+        .material = material,
+        .data = data,
+    });
+}
+
+void BatchRenderer::submitMany(
+    std::size_t count,
+    const DrawPreparer& prepare
+) {
+    const std::size_t first = items.size();
+    // checked before anything is queued, culling may not save it
+    if (first + count > max_objects) {
+        throw std::runtime_error(std::format(
+            "BatchRenderer is full ({} objects per frame)", max_objects
+        ));
+    }
+    const std::size_t chunk_size = 4096;
+    const std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    // every chunk compacts into the front of its own slice, then the slices
+    // are packed together
+    items.resize(first + count);
+    chunk_counts.assign(chunk_count, 0);
+
+    auto prepare_chunk = [&](std::size_t chunk) {
+        const std::size_t begin = chunk * chunk_size;
+        const std::size_t end = std::min(begin + chunk_size, count);
+        DrawItem* out = items.data() + first + begin;
+
+        std::size_t kept = 0;
+        for (std::size_t i = begin; i < end; i++) {
+            Draw draw;
+            if (!prepare(i, draw)) {
+                continue;
+            }
+            out[kept++] = DrawItem{
+                .key = makeSortKey(
+                    draw.program->id, draw.pool->vao(), draw.material
+                ),
+                .program = draw.program,
+                .pool = draw.pool,
+                .range = draw.pool->range(draw.mesh, draw.lod),
+                .material = draw.material,
+                .data = draw.data,
+            };
+        }
+        chunk_counts[chunk] = kept;
+    };
+    if (jobs != nullptr) {
+        jobs->parallelFor(
+            chunk_count,
+            1,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t chunk = begin; chunk < end; chunk++) {
+                    prepare_chunk(chunk);
+                }
+            }
+        );
+    } else {
+        for (std::size_t chunk = 0; chunk < chunk_count; chunk++) {
+            prepare_chunk(chunk);
+        }
+    }
+
+    std::size_t end = first;
+    for (std::size_t chunk = 0; chunk < chunk_count; chunk++) {
+        const auto slice = items.begin() + first + chunk * chunk_size;
+        if (items.begin() + end != slice) {
+            std::move(slice, slice + chunk_counts[chunk], items.begin() + end);
+        }
+        end += chunk_counts[chunk];
+    }
+    items.resize(end);
+    culled += count - (end - first);
+}
+
+void BatchRenderer::prepareVao(
+    MeshPool& pool
+) {
+    if (!prepared_pools.insert(pool.serial()).second) {
+        return;
+    }
+
+    auto& state = StateCache::current();
+    state.bindVertexArray(pool.vao());
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, object_id_buffer);
+    gl::glVertexAttribIPointer(
+        object_id_location, 1, gl::GL_UNSIGNED_INT, sizeof(std::uint32_t), 0
+    );
+    gl::glEnableVertexAttribArray(object_id_location);
+    // one id per instance, and base instance shifts where it starts
+    gl::glVertexAttribDivisor(object_id_location, 1);
+}
+
+bool BatchRenderer::sameBucket(
+    const DrawItem& a,
+    const DrawItem& b
+) {
+    return a.key == b.key && a.program == b.program && a.pool == b.pool &&
+           a.material == b.material;
+}
+
+void BatchRenderer::bindBucket(
+    const DrawItem& item,
+    const DrawItem* previous
+) {
+    const bool new_program =
+        previous == nullptr || previous->program != item.program;
+
+    if (new_program) {
+        item.program->use();
+    }
+    if (previous == nullptr || previous->pool != item.pool) {
+        prepareVao(*item.pool);
+        item.pool->bind();
+    }
+    if (new_program || previous->material != item.material) {
+        if (material_binder) {
+            material_binder(*item.program, item.material);
+        }
+    }
+}
+
+void BatchRenderer::flush() {
+    frame_stats = Stats{.objects = items.size(), .culled = culled};
+    culled = 0;
+
+    if (items.empty()) {
+        return;
+    }
+
+    order.resize(items.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    // within a key, keep draws of the same mesh together for the instanced
+    // path, and fall back to submission order so the result is stable
+    auto compare = [this](auto a, auto b) {
+        const auto& item_a = items[a];
+        const auto& item_b = items[b];
+        return std::tie(
+                   item_a.key,
+                   item_a.range.first_index,
+                   item_a.range.base_vertex,
+                   a
+               ) <
+               std::tie(
+                   item_b.key,
+                   item_b.range.first_index,
+                   item_b.range.base_vertex,
+                   b
+               );
+    };
+    if (jobs != nullptr) {
+        jobs->parallelSort(order.begin(), order.end(), compare);
+    } else {
+        std::sort(order.begin(), order.end(), compare);
+    }
+
+    if (indirect) {
+        flushIndirect();
+    } else {
+        flushInstanced();
+    }
+
+    items.clear();
+}
+
+void BatchRenderer::flushIndirect() {
+    object_stream->beginFrame();
+    command_stream->beginFrame();
+
+    auto objects = object_stream->allocate(
+        items.size() * sizeof(ObjectData), object_alignment
+    );
+    auto commands = command_stream->allocate(
+        items.size() * sizeof(DrawElementsIndirectCommand), 4
+    );
+
+    auto object_data = static_cast<ObjectData*>(objects.data);
+    auto command_data =
+        static_cast<DrawElementsIndirectCommand*>(commands.data);
+
+    // straight into the mapped buffers, from the workers if there are any
+    forChunks(order.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const auto& item = items[order[i]];
+            object_data[i] = item.data;
+            command_data[i] = DrawElementsIndirectCommand{
+                .count = item.range.index_count,
+                .instance_count = 1,
+                .first_index = item.range.first_index,
+                .base_vertex = item.range.base_vertex,
+                // the object id attribute starts here, so it's also the
+                // index into the SSBO
+                .base_instance = static_cast<std::uint32_t>(i),
+            };
+        }
+    });
+
+    object_stream->commit();
+    command_stream->commit();
+
+    auto& state = StateCache::current();
+    state.bindBufferRange(
+        gl::GL_SHADER_STORAGE_BUFFER,
+        object_binding,
+        object_stream->id(),
+        objects.offset,
+        items.size() * sizeof(ObjectData)
+    );
+    state.bindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, command_stream->id());
+
+    std::size_t bucket_start = 0;
+    const DrawItem* previous = nullptr;
+
+    while (bucket_start < order.size()) {
+        const auto& first = items[order[bucket_start]];
+
+        std::size_t bucket_end = bucket_start + 1;
+        while (bucket_end < order.size() &&
+               sameBucket(items[order[bucket_end]], first)) {
+            bucket_end++;
+        }
+
+        bindBucket(first, previous);
+        frame_stats.buckets++;
+
+        gl::glMultiDrawElementsIndirect(
+            gl::GL_TRIANGLES,
+            gl::GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(
+                commands.offset +
+                bucket_start * sizeof(DrawElementsIndirectCommand)
+            ),
+            bucket_end - bucket_start,
+            0
+        );
+        frame_stats.draw_calls++;
+
+        previous = &first;
+        bucket_start = bucket_end;
+    }
+
+    object_stream->endFrame();
+    command_stream->endFrame();
+}
+
+void BatchRenderer::flushInstanced() {
+    object_stream->beginFrame();
+
+    auto objects = object_stream->allocate(
+        items.size() * sizeof(ObjectData), object_alignment
+    );
+    auto object_data = static_cast<ObjectData*>(objects.data);
+    forChunks(order.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            object_data[i] = items[order[i]].data;
+        }
+    });
+    object_stream->commit();
+
+    auto& state = StateCache::current();
+    state.bindTexture(object_binding, gl::GL_TEXTURE_BUFFER, object_texture);
+
+    const int texel_offset = static_cast<int>(objects.offset / 16);
+
+    std::size_t run_start = 0;
+    const DrawItem* previous = nullptr;
+
+    while (run_start < order.size()) {
+        const auto& first = items[order[run_start]];
+
+        // a run is the same key and the same mesh, which is one instanced
+        // draw
+        std::size_t run_end = run_start + 1;
+        while (run_end < order.size()) {
+            const auto& next = items[order[run_end]];
+            if (!sameBucket(next, first) ||
+                next.range.first_index != first.range.first_index ||
+                next.range.base_vertex != first.range.base_vertex) {
+                break;
+            }
+            run_end++;
+        }
+
+        const bool new_program =
+            previous == nullptr || previous->program != first.program;
+        // runs of other meshes in the same bucket follow each other
+        if (previous == nullptr || !sameBucket(first, *previous)) {
+            frame_stats.buckets++;
+        }
+        bindBucket(first, previous);
+
+        if (new_program) {
+            first.program->setUniform(
+                "objects", static_cast<int>(object_binding)
+            );
+            first.program->setUniform("object_texel_offset", texel_offset);
+        }
+
+        // no base instance before 4.2, so move the id attribute instead
+        state.bindBuffer(gl::GL_ARRAY_BUFFER, object_id_buffer);
+        gl::glVertexAttribIPointer(
+            object_id_location,
+            1,
+            gl::GL_UNSIGNED_INT,
+            sizeof(std::uint32_t),
+            reinterpret_cast<const void*>(run_start * sizeof(std::uint32_t))
+        );
+
+        gl::glDrawElementsInstancedBaseVertex(
+            gl::GL_TRIANGLES,
+            first.range.index_count,
+            gl::GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(
+                first.range.first_index * sizeof(std::uint32_t)
+            ),
+            run_end - run_start,
+            first.range.base_vertex
+        );
+        frame_stats.draw_calls++;
+
+        previous = &first;
+        run_start = run_end;
+    }
+
+    object_stream->endFrame();
+}
+
+}  // namespace omgl
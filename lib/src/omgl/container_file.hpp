@@ -0,0 +1,94 @@
+#pragma once
+// Shared between the .ommesh and .omtx readers and writers, not part of the
+// public headers.
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace omgl {
+
+namespace fs = std::filesystem;
+
+// Both containers keep every section on 16 bytes.
+inline std::size_t align_16(
+    std::size_t offset
+) {
+    return (offset + 15) / 16 * 16;
+}
+
+// The error for a file that doesn't parse, as in
+//
+//     const InvalidFile fail{path, "mesh"};
+//     throw fail("wrong magic");
+struct InvalidFile {
+    const fs::path& path;
+    std::string_view kind;
+
+    std::runtime_error operator()(
+        std::string_view reason
+    ) const {
+        return std::runtime_error(std::format(
+            "{} isn't a valid {} file: {}", path.string(), kind, reason
+        ));
+    }
+};
+
+// Writes a container front to back, zero padding up to the offsets the
+// header promised.
+class ContainerWriter {
+   public:
+    explicit ContainerWriter(
+        const fs::path& path
+    )
+        : path(path), file(path, std::ios::binary) {
+        if (!file) {
+            throw std::runtime_error(
+                std::format("Couldn't open {} for writing", path.string())
+            );
+        }
+    }
+
+    void write(
+        const void* bytes,
+        std::size_t size
+    ) {
+        file.write(
+            static_cast<const char*>(bytes), static_cast<std::streamsize>(size)
+        );
+    }
+
+    void padTo(
+        std::size_t target
+    ) {
+        const std::array<char, 16> padding{};
+        while (position() < target) {
+            write(
+                padding.data(),
+                std::min(target - position(), padding.size())
+            );
+        }
+    }
+
+    std::size_t position() { return static_cast<std::size_t>(file.tellp()); }
+
+    // Throws if any of the writes failed.
+    void finish() {
+        file.flush();
+        if (!file) {
+            throw std::runtime_error(
+                std::format("Couldn't write {}", path.string())
+            );
+        }
+    }
+
+   private:
+    const fs::path& path;
+    std::ofstream file;
+};
+
+}  // namespace omgl
@@ -0,0 +1,49 @@
+#include <glbinding/gl/gl.h>
+#include <algorithm>
+#include <format>
+#include <omgl/context_info.hpp>
+#include <omgl/state_cache.hpp>
+#include <vector>
+
+namespace omgl {
+
+static std::string get_gl_string(
+    gl::GLenum name
+) {
+    auto value = gl::glGetString(name);
+    if (value == nullptr) {
+        return "";
+    }
+    return std::string(reinterpret_cast<const char*>(value));
+}
+
+std::string driver_identity() {
+    return std::format(
+        "{} / {} / {}",
+        get_gl_string(gl::GL_VENDOR),
+        get_gl_string(gl::GL_RENDERER),
+        get_gl_string(gl::GL_VERSION)
+    );
+}
+
+bool has_extension(
+    std::string_view name
+) {
+    // cached per context, contexts invalidate the cache when made current
+    const auto& extensions = StateCache::current().extensions();
+    return std::binary_search(extensions.begin(), extensions.end(), name);
+}
+
+bool gl_version_at_least(
+    int major,
+    int minor
+) {
+    gl::GLint context_major = 0, context_minor = 0;
+    gl::glGetIntegerv(gl::GL_MAJOR_VERSION, &context_major);
+    gl::glGetIntegerv(gl::GL_MINOR_VERSION, &context_minor);
+
+    return context_major > major ||
+           (context_major == major && context_minor >= minor);
+}
+
+}  // namespace omgl
@@ -0,0 +1,429 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <format>
+#include <omgl/culling.hpp>
+#include <stdexcept>
+#include "culling_kernels.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace omgl {
+
+namespace kernels {
+
+std::size_t cull_spheres_scalar(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    std::size_t first,
+    InstanceData* out
+) {
+    std::size_t written = 0;
+    for (std::size_t i = first; i < batch.count; i++) {
+        const glm::vec3 center(batch.x[i], batch.y[i], batch.z[i]);
+        if (frustum.containsSphere(center, batch.radius * batch.scale[i])) {
+            write_instance(batch, i, out[written++]);
+        }
+    }
+    return written;
+}
+
+std::size_t cull_boxes_scalar(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::size_t first,
+    std::uint32_t* visible
+) {
+    std::size_t written = 0;
+    for (std::size_t i = first; i < batch.count; i++) {
+        bool inside = true;
+        for (const auto& plane : frustum.planes) {
+            // the corner furthest along the normal
+            float distance = plane.w;
+            for (int axis = 0; axis < 3; axis++) {
+                const float* corner =
+                    plane[axis] >= 0.0f ? batch.max[axis] : batch.min[axis];
+                distance += plane[axis] * corner[i];
+            }
+            if (distance < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) {
+            visible[written++] = static_cast<std::uint32_t>(i);
+        }
+    }
+    return written;
+}
+
+void multiply_matrices_scalar(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t first,
+    std::size_t count,
+    glm::mat4* out
+) {
+    for (std::size_t i = first; i < count; i++) {
+        out[i] = view_projection * models[i];
+    }
+}
+
+#if defined(__SSE2__)
+
+std::size_t cull_spheres_sse2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+) {
+    const __m128 radius = _mm_set1_ps(batch.radius);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    std::size_t written = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= batch.count; i += 4) {
+        const __m128 x = _mm_loadu_ps(batch.x + i);
+        const __m128 y = _mm_loadu_ps(batch.y + i);
+        const __m128 z = _mm_loadu_ps(batch.z + i);
+        // -radius * scale
+        const __m128 limit = _mm_xor_ps(
+            _mm_mul_ps(radius, _mm_loadu_ps(batch.scale + i)), sign
+        );
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m128 distance = _mm_set1_ps(plane.w);
+            distance =
+                _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.x), x));
+            distance =
+                _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), y));
+            distance =
+                _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, limit));
+        }
+
+        // compact: one write per visible lane, in order
+        for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1) {
+            write_instance(batch, i + __builtin_ctz(mask), out[written++]);
+        }
+    }
+    return written + cull_spheres_scalar(frustum, batch, i, out + written);
+}
+
+std::size_t cull_boxes_sse2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+) {
+    std::size_t written = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= batch.count; i += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            // which corner is furthest along the normal is the same for
+            // every box, so it's picked per plane instead of per lane
+            __m128 distance = _mm_set1_ps(plane.w);
+            for (int axis = 0; axis < 3; axis++) {
+                const float* corner =
+                    plane[axis] >= 0.0f ? batch.max[axis] : batch.min[axis];
+                distance = _mm_add_ps(
+                    distance,
+                    _mm_mul_ps(
+                        _mm_set1_ps(plane[axis]), _mm_loadu_ps(corner + i)
+                    )
+                );
+            }
+            inside =
+                _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+
+        for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1) {
+            visible[written++] =
+                static_cast<std::uint32_t>(i + __builtin_ctz(mask));
+        }
+    }
+    return written + cull_boxes_scalar(frustum, batch, i, visible + written);
+}
+
+void multiply_matrices_sse2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+) {
+    const float* vp = reinterpret_cast<const float*>(&view_projection);
+    const __m128 c0 = _mm_loadu_ps(vp);
+    const __m128 c1 = _mm_loadu_ps(vp + 4);
+    const __m128 c2 = _mm_loadu_ps(vp + 8);
+    const __m128 c3 = _mm_loadu_ps(vp + 12);
+
+    for (std::size_t i = 0; i < count; i++) {
+        const float* model = reinterpret_cast<const float*>(&models[i]);
+        float* result = reinterpret_cast<float*>(&out[i]);
+
+        // each column of the product mixes the columns of view_projection
+        // by the model's column
+        for (int column = 0; column < 4; column++) {
+            const float* m = model + column * 4;
+            __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(m[0]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(m[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(m[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(m[3])));
+            _mm_storeu_ps(result + column * 4, sum);
+        }
+    }
+}
+
+#else
+
+// not x86, everything goes through the scalar code
+
+std::size_t cull_spheres_sse2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+) {
+    return cull_spheres_scalar(frustum, batch, 0, out);
+}
+
+std::size_t cull_boxes_sse2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+) {
+    return cull_boxes_scalar(frustum, batch, 0, visible);
+}
+
+void multiply_matrices_sse2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+) {
+    multiply_matrices_scalar(view_projection, models, 0, count, out);
+}
+
+#endif
+
+}  // namespace kernels
+
+const char* to_string(
+    SimdLevel level
+) {
+    switch (level) {
+        case SimdLevel::scalar:
+            return "scalar";
+        case SimdLevel::sse2:
+            return "sse2";
+        case SimdLevel::avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+SimdLevel supported_simd_level() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const SimdLevel supported = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return SimdLevel::avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return SimdLevel::sse2;
+        }
+        return SimdLevel::scalar;
+    }();
+    return supported;
+#else
+    return SimdLevel::scalar;
+#endif
+}
+
+// The kernels in use, picked on first use.
+struct KernelTable {
+    SimdLevel level;
+    std::size_t (*cull_spheres)(
+        const Frustum&,
+        const kernels::SphereBatch&,
+        InstanceData*
+    );
+    std::size_t (*cull_boxes)(
+        const Frustum&,
+        const kernels::BoxBatch&,
+        std::uint32_t*
+    );
+    void (*multiply_matrices)(
+        const glm::mat4&,
+        const glm::mat4*,
+        std::size_t,
+        glm::mat4*
+    );
+};
+
+static KernelTable make_kernel_table(
+    SimdLevel level
+) {
+    switch (level) {
+        case SimdLevel::avx2:
+            return {
+                level,
+                kernels::cull_spheres_avx2,
+                kernels::cull_boxes_avx2,
+                kernels::multiply_matrices_avx2,
+            };
+        case SimdLevel::sse2:
+            return {
+                level,
+                kernels::cull_spheres_sse2,
+                kernels::cull_boxes_sse2,
+                kernels::multiply_matrices_sse2,
+            };
+        case SimdLevel::scalar:
+            break;
+    }
+    return {
+        SimdLevel::scalar,
+        [](const Frustum& frustum,
+           const kernels::SphereBatch& batch,
+           InstanceData* out) {
+            return kernels::cull_spheres_scalar(frustum, batch, 0, out);
+        },
+        [](const Frustum& frustum,
+           const kernels::BoxBatch& batch,
+           std::uint32_t* visible) {
+            return kernels::cull_boxes_scalar(frustum, batch, 0, visible);
+        },
+        [](const glm::mat4& view_projection,
+           const glm::mat4* models,
+           std::size_t count,
+           glm::mat4* out) {
+            kernels::multiply_matrices_scalar(
+                view_projection, models, 0, count, out
+            );
+        },
+    };
+}
+
+static KernelTable& kernel_table() {
+    static KernelTable table = [] {
+        auto table = make_kernel_table(supported_simd_level());
+        spdlog::debug("Culling kernels: {}", to_string(table.level));
+        return table;
+    }();
+    return table;
+}
+
+SimdLevel simd_level() {
+    return kernel_table().level;
+}
+
+SimdLevel force_simd_level(
+    SimdLevel level
+) {
+    level = std::min(level, supported_simd_level());
+    kernel_table() = make_kernel_table(level);
+    return level;
+}
+
+Frustum Frustum::fromMatrix(
+    const glm::mat4& m
+) {
+    // Gribb & Hartmann: each plane is the last row plus or minus another
+    auto row = [&](int index) {
+        return glm::vec4(m[0][index], m[1][index], m[2][index], m[3][index]);
+    };
+    const glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+
+    Frustum frustum{{w + x, w - x, w + y, w - y, w + z, w - z}};
+    for (auto& plane : frustum.planes) {
+        const float length =
+            glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        plane = plane / length;
+    }
+    return frustum;
+}
+
+bool Frustum::containsSphere(
+    const glm::vec3& center,
+    float radius
+) const {
+    for (const auto& plane : planes) {
+        const float distance = plane.x * center.x + plane.y * center.y +
+                               plane.z * center.z + plane.w;
+        if (distance < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t cull_instances(
+    const Frustum& frustum,
+    const InstanceStore& instances,
+    float bounding_radius,
+    std::span<InstanceData> out
+) {
+    if (out.size() < instances.size()) {
+        throw std::runtime_error(std::format(
+            "Culling {} instances into room for {}",
+            instances.size(),
+            out.size()
+        ));
+    }
+
+    const kernels::SphereBatch batch{
+        .x = instances.x().data(),
+        .y = instances.y().data(),
+        .z = instances.z().data(),
+        .scale = instances.scale().data(),
+        .color = instances.colors().data(),
+        .count = instances.size(),
+        .radius = bounding_radius,
+    };
+    return kernel_table().cull_spheres(frustum, batch, out.data());
+}
+
+std::size_t cull_aabbs(
+    const Frustum& frustum,
+    const AabbArrays& boxes,
+    std::span<std::uint32_t> visible
+) {
+    const std::size_t count = boxes.min_x.size();
+    if (boxes.min_y.size() != count || boxes.min_z.size() != count ||
+        boxes.max_x.size() != count || boxes.max_y.size() != count ||
+        boxes.max_z.size() != count) {
+        throw std::runtime_error("AABB arrays differ in length");
+    }
+    if (visible.size() < count) {
+        throw std::runtime_error(std::format(
+            "Culling {} boxes into room for {}", count, visible.size()
+        ));
+    }
+
+    const kernels::BoxBatch batch{
+        .min = {boxes.min_x.data(), boxes.min_y.data(), boxes.min_z.data()},
+        .max = {boxes.max_x.data(), boxes.max_y.data(), boxes.max_z.data()},
+        .count = count,
+    };
+    return kernel_table().cull_boxes(frustum, batch, visible.data());
+}
+
+void multiply_matrices(
+    const glm::mat4& view_projection,
+    std::span<const glm::mat4> models,
+    std::span<glm::mat4> out
+) {
+    if (out.size() < models.size()) {
+        throw std::runtime_error(std::format(
+            "Multiplying {} matrices into room for {}",
+            models.size(),
+            out.size()
+        ));
+    }
+    kernel_table().multiply_matrices(
+        view_projection, models.data(), models.size(), out.data()
+    );
+}
+
+}  // namespace omgl
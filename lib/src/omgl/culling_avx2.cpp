@@ -0,0 +1,154 @@
+// Only ever called once culling.cpp has checked the CPU has AVX2 and FMA.
+// The file is built for the baseline like the rest, and only the kernels
+// themselves target AVX2, so no AVX code can end up in the inline functions
+// (glm's, write_instance) the linker shares with the other files.
+#include "culling_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace omgl::kernels {
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2,fma")))
+std::size_t cull_spheres_avx2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+) {
+    const __m256 radius = _mm256_set1_ps(batch.radius);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    std::size_t written = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= batch.count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(batch.x + i);
+        const __m256 y = _mm256_loadu_ps(batch.y + i);
+        const __m256 z = _mm256_loadu_ps(batch.z + i);
+        // -radius * scale
+        const __m256 limit = _mm256_xor_ps(
+            _mm256_mul_ps(radius, _mm256_loadu_ps(batch.scale + i)), sign
+        );
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m256 distance = _mm256_set1_ps(plane.w);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), x, distance);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.y), y, distance);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.z), z, distance);
+            inside = _mm256_and_ps(
+                inside, _mm256_cmp_ps(distance, limit, _CMP_GE_OQ)
+            );
+        }
+
+        for (int mask = _mm256_movemask_ps(inside); mask != 0;
+             mask &= mask - 1) {
+            write_instance(batch, i + __builtin_ctz(mask), out[written++]);
+        }
+    }
+    return written + cull_spheres_scalar(frustum, batch, i, out + written);
+}
+
+__attribute__((target("avx2,fma")))
+std::size_t cull_boxes_avx2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+) {
+    std::size_t written = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= batch.count; i += 8) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            __m256 distance = _mm256_set1_ps(plane.w);
+            for (int axis = 0; axis < 3; axis++) {
+                const float* corner =
+                    plane[axis] >= 0.0f ? batch.max[axis] : batch.min[axis];
+                distance = _mm256_fmadd_ps(
+                    _mm256_set1_ps(plane[axis]),
+                    _mm256_loadu_ps(corner + i),
+                    distance
+                );
+            }
+            inside = _mm256_and_ps(
+                inside,
+                _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ)
+            );
+        }
+
+        for (int mask = _mm256_movemask_ps(inside); mask != 0;
+             mask &= mask - 1) {
+            visible[written++] =
+                static_cast<std::uint32_t>(i + __builtin_ctz(mask));
+        }
+    }
+    return written + cull_boxes_scalar(frustum, batch, i, visible + written);
+}
+
+__attribute__((target("avx2,fma")))
+void multiply_matrices_avx2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+) {
+    // every column of view_projection in both halves
+    const float* vp = reinterpret_cast<const float*>(&view_projection);
+    const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(vp));
+    const __m256 c1 =
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(vp + 4));
+    const __m256 c2 =
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(vp + 8));
+    const __m256 c3 =
+        _mm256_broadcast_ps(reinterpret_cast<const __m128*>(vp + 12));
+
+    for (std::size_t i = 0; i < count; i++) {
+        const float* model = reinterpret_cast<const float*>(&models[i]);
+        float* result = reinterpret_cast<float*>(&out[i]);
+
+        // two model columns at a time, one per half
+        for (int column = 0; column < 4; column += 2) {
+            const __m256 m = _mm256_loadu_ps(model + column * 4);
+            __m256 sum = _mm256_mul_ps(c0, _mm256_permute_ps(m, 0x00));
+            sum = _mm256_fmadd_ps(c1, _mm256_permute_ps(m, 0x55), sum);
+            sum = _mm256_fmadd_ps(c2, _mm256_permute_ps(m, 0xaa), sum);
+            sum = _mm256_fmadd_ps(c3, _mm256_permute_ps(m, 0xff), sum);
+            _mm256_storeu_ps(result + column * 4, sum);
+        }
+    }
+}
+
+#else
+
+// not x86, the dispatcher never picks these but they have to exist
+
+std::size_t cull_spheres_avx2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+) {
+    return cull_spheres_sse2(frustum, batch, out);
+}
+
+std::size_t cull_boxes_avx2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+) {
+    return cull_boxes_sse2(frustum, batch, visible);
+}
+
+void multiply_matrices_avx2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+) {
+    multiply_matrices_sse2(view_projection, models, count, out);
+}
+
+#endif
+
+}  // namespace omgl::kernels
@@ -0,0 +1,93 @@
+#pragma once
+// Shared between culling.cpp and the kernels built with other instruction
+// sets, not part of the public headers.
+#include <cstddef>
+#include <cstdint>
+#include <omgl/culling.hpp>
+
+namespace omgl::kernels {
+
+struct SphereBatch {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* scale;
+    const std::uint32_t* color;
+    std::size_t count;
+    // multiplied by the scale for each sphere's radius
+    float radius;
+};
+
+struct BoxBatch {
+    const float* min[3];
+    const float* max[3];
+    std::size_t count;
+};
+
+// Each kernel does as many elements as fit its vector width and hands the
+// rest to the scalar version, starting at `first`.
+std::size_t cull_spheres_scalar(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    std::size_t first,
+    InstanceData* out
+);
+std::size_t cull_spheres_sse2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+);
+std::size_t cull_spheres_avx2(
+    const Frustum& frustum,
+    const SphereBatch& batch,
+    InstanceData* out
+);
+
+std::size_t cull_boxes_scalar(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::size_t first,
+    std::uint32_t* visible
+);
+std::size_t cull_boxes_sse2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+);
+std::size_t cull_boxes_avx2(
+    const Frustum& frustum,
+    const BoxBatch& batch,
+    std::uint32_t* visible
+);
+
+void multiply_matrices_scalar(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t first,
+    std::size_t count,
+    glm::mat4* out
+);
+void multiply_matrices_sse2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+);
+void multiply_matrices_avx2(
+    const glm::mat4& view_projection,
+    const glm::mat4* models,
+    std::size_t count,
+    glm::mat4* out
+);
+
+inline void write_instance(
+    const SphereBatch& batch,
+    std::size_t i,
+    InstanceData& out
+) {
+    out.transform =
+        glm::vec4(batch.x[i], batch.y[i], batch.z[i], batch.scale[i]);
+    out.color = batch.color[i];
+}
+
+}  // namespace omgl::kernels
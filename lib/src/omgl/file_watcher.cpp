@@ -0,0 +1,114 @@
+#include <spdlog/spdlog.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <omgl/file_watcher.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+// written in place and closed, or renamed over the old one; IN_CREATE would
+// fire while a new file is still empty
+const auto watched_events = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+FileWatcher::FileWatcher() {
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        throw std::runtime_error(
+            std::format("inotify_init1 failed: {}", std::strerror(errno))
+        );
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    // closing the descriptor drops every watch with it
+    ::close(inotify_fd);
+}
+
+void FileWatcher::watch(
+    const fs::path& file
+) {
+    const auto path = fs::weakly_canonical(file);
+    if (!files.insert(path).second) {
+        return;
+    }
+
+    const auto directory = path.parent_path();
+    const int descriptor =
+        ::inotify_add_watch(inotify_fd, directory.c_str(), watched_events);
+    if (descriptor < 0) {
+        throw std::runtime_error(std::format(
+            "Couldn't watch {}: {}", directory.string(), std::strerror(errno)
+        ));
+    }
+    // the same directory gives back the same descriptor
+    directories[descriptor] = directory;
+
+    spdlog::debug("Watching {}", path.string());
+}
+
+void FileWatcher::unwatch(
+    const fs::path& file
+) {
+    const auto path = fs::weakly_canonical(file);
+    if (files.erase(path) == 0) {
+        return;
+    }
+
+    // the directory watch goes once no other file needs it
+    const auto directory = path.parent_path();
+    for (const auto& other : files) {
+        if (other.parent_path() == directory) {
+            return;
+        }
+    }
+    for (auto it = directories.begin(); it != directories.end(); ++it) {
+        if (it->second == directory) {
+            ::inotify_rm_watch(inotify_fd, it->first);
+            directories.erase(it);
+            break;
+        }
+    }
+
+    spdlog::debug("Stopped watching {}", path.string());
+}
+
+std::vector<fs::path> FileWatcher::changes() {
+    std::set<fs::path> changed;
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        const auto length = ::read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // EAGAIN, the queue is empty
+            break;
+        }
+
+        for (char* at = buffer; at < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(at);
+            at += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // events were dropped, assume the worst
+                changed.insert(files.begin(), files.end());
+                continue;
+            }
+
+            auto directory = directories.find(event->wd);
+            if (directory == directories.end() || event->len == 0) {
+                continue;
+            }
+
+            auto path = directory->second / event->name;
+            if (files.contains(path)) {
+                changed.insert(std::move(path));
+            }
+        }
+    }
+
+    return {changed.begin(), changed.end()};
+}
+
+}  // namespace omgl
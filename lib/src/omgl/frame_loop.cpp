@@ -0,0 +1,239 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <omgl/frame_loop.hpp>
+#include <omgl/sync.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+FrameLoop::FrameLoop(
+    Config config,
+    Callbacks callbacks,
+    JobSystem* jobs
+)
+    : config(config), callbacks(std::move(callbacks)), jobs(jobs) {
+    if (config.frames_in_flight == 0) {
+        throw std::runtime_error(
+            "FrameLoop needs at least one frame in flight"
+        );
+    }
+    if (config.update_step.count() <= 0) {
+        throw std::runtime_error("FrameLoop needs a positive update step");
+    }
+    if (!this->callbacks.poll || !this->callbacks.prepare ||
+        !this->callbacks.submit) {
+        throw std::runtime_error("FrameLoop needs poll, prepare and submit");
+    }
+    slots.resize(config.frames_in_flight);
+
+    spdlog::debug(
+        "FrameLoop: {} frames in flight, {:.2f} ms updates, {}",
+        config.frames_in_flight,
+        config.update_step.count() * 1000.0,
+        pipelined() ? "pipelined" : "not pipelined"
+    );
+}
+
+FrameLoop::~FrameLoop() {
+    for (auto& slot : slots) {
+        wait_fence(slot.fence);
+        delete_fence(slot.fence);
+    }
+}
+
+bool FrameLoop::step() {
+    if (!running) {
+        return false;
+    }
+
+    const auto now = Clock::now();
+    pollFences();
+
+    if (!callbacks.poll()) {
+        running = false;
+        // it's ready, might as well show it
+        if (pending) {
+            submitFrame(*pending);
+            pending.reset();
+        }
+        return false;
+    }
+
+    const Frame frame = advance(now);
+    waitSlot(frame.slot);
+    const PreparedFrame prepared{.frame = frame, .polled = now};
+
+    if (!pipelined()) {
+        callbacks.prepare(frame);
+        submitFrame(prepared);
+        return true;
+    }
+
+    JobCounter done;
+    jobs->run([this, &frame] { callbacks.prepare(frame); }, &done);
+
+    std::exception_ptr error;
+    try {
+        if (pending) {
+            submitFrame(*pending);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // the job holds on to `frame`, so it has to be done either way
+    jobs->wait(done);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    pending = prepared;
+    return true;
+}
+
+void FrameLoop::run(
+    std::uint64_t max_frames
+) {
+    while (presented < max_frames && step()) {
+    }
+}
+
+FrameLoop::Frame FrameLoop::advance(
+    Clock::time_point now
+) {
+    if (!started) {
+        last_time = now;
+        started = true;
+    }
+    accumulator += std::chrono::duration<double>(now - last_time).count();
+    last_time = now;
+
+    const double update_step = config.update_step.count();
+    std::size_t updates = 0;
+    while (accumulator >= update_step) {
+        if (updates == config.max_updates_per_frame) {
+            // too far behind to catch up, let the simulation slow down
+            // instead
+            const double behind = std::floor(accumulator / update_step);
+            loop_stats.dropped_updates += static_cast<std::size_t>(behind);
+            accumulator -= behind * update_step;
+            break;
+        }
+        if (callbacks.update) {
+            callbacks.update(update_step);
+        }
+        accumulator -= update_step;
+        simulated += update_step;
+        updates++;
+    }
+    loop_stats.updates += updates;
+
+    const std::uint64_t index = next_index++;
+    return Frame{
+        .index = index,
+        .slot = static_cast<std::size_t>(index % slots.size()),
+        .alpha = std::clamp(accumulator / update_step, 0.0, 1.0),
+        .time = simulated,
+    };
+}
+
+void FrameLoop::waitSlot(
+    std::size_t slot_index
+) {
+    auto& slot = slots[slot_index];
+    if (slot.fence == nullptr) {
+        return;
+    }
+
+    if (!fence_signaled(slot.fence)) {
+        // the GPU is frames_in_flight frames behind, this is the cap
+        const auto wait_start = Clock::now();
+        wait_fence(slot.fence);
+        loop_stats.fence_waits++;
+        loop_stats.fence_wait_ms +=
+            std::chrono::duration<double, std::milli>(
+                Clock::now() - wait_start
+            )
+                .count();
+    }
+    retire(slot, Clock::now());
+}
+
+void FrameLoop::pollFences() {
+    const auto now = Clock::now();
+    for (auto& slot : slots) {
+        if (slot.fence != nullptr && fence_signaled(slot.fence)) {
+            retire(slot, now);
+        }
+    }
+}
+
+void FrameLoop::retire(
+    Slot& slot,
+    Clock::time_point now
+) {
+    const double gpu_ms =
+        std::chrono::duration<double, std::milli>(now - slot.submitted)
+            .count();
+    total_gpu_ms += gpu_ms;
+    gpu_samples++;
+    loop_stats.max_gpu_ms = std::max(loop_stats.max_gpu_ms, gpu_ms);
+
+    delete_fence(slot.fence);
+}
+
+void FrameLoop::submitFrame(
+    const PreparedFrame& prepared
+) {
+    auto& slot = slots[prepared.frame.slot];
+
+    callbacks.submit(prepared.frame);
+    slot.fence = insert_fence();
+    slot.submitted = Clock::now();
+
+    if (callbacks.present) {
+        callbacks.present();
+    }
+
+    const double latency_ms = std::chrono::duration<double, std::milli>(
+                                  Clock::now() - prepared.polled
+    )
+                                  .count();
+    total_latency_ms += latency_ms;
+    loop_stats.max_latency_ms =
+        std::max(loop_stats.max_latency_ms, latency_ms);
+    loop_stats.frames++;
+    presented++;
+}
+
+FrameLoop::Stats FrameLoop::stats() const {
+    Stats stats = loop_stats;
+    stats.avg_latency_ms =
+        stats.frames > 0 ? total_latency_ms / stats.frames : 0;
+    stats.avg_gpu_ms = gpu_samples > 0 ? total_gpu_ms / gpu_samples : 0;
+    return stats;
+}
+
+void FrameLoop::logStats() const {
+    const auto stats = this->stats();
+    spdlog::info(
+        "FrameLoop: {} frames, {} updates ({} dropped), latency avg {:.2f} "
+        "ms max {:.2f} ms",
+        stats.frames,
+        stats.updates,
+        stats.dropped_updates,
+        stats.avg_latency_ms,
+        stats.max_latency_ms
+    );
+    spdlog::info(
+        "FrameLoop: GPU avg {:.2f} ms max {:.2f} ms, {} fence waits "
+        "({:.2f} ms)",
+        stats.avg_gpu_ms,
+        stats.max_gpu_ms,
+        stats.fence_waits,
+        stats.fence_wait_ms
+    );
+}
+
+}  // namespace omgl
@@ -0,0 +1,364 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <omgl/frame_profiler.hpp>
+#include <stdexcept>
+#include <thread>
+
+namespace omgl {
+
+// trace "thread" the GPU zones are shown on
+const std::uint32_t gpu_trace_thread = 0;
+
+FrameProfiler::CpuScope::CpuScope(
+    FrameProfiler& profiler,
+    std::uint32_t zone
+)
+    : profiler(profiler),
+      zone(zone),
+      start(Clock::now()) {}
+
+FrameProfiler::CpuScope::~CpuScope() {
+    profiler.endCpuZone(zone, start);
+}
+
+FrameProfiler::GpuScope::GpuScope(
+    FrameProfiler& profiler,
+    std::uint32_t zone
+)
+    : profiler(profiler) {
+    profiler.beginGpuZone(zone);
+}
+
+FrameProfiler::GpuScope::~GpuScope() {
+    profiler.endGpuZone();
+}
+
+FrameProfiler::FrameProfiler(
+    std::size_t window_size
+)
+    : window_size(window_size),
+      start_time(Clock::now()),
+      last_log(Clock::now()) {
+    frame_zone = zoneIndex("frame", false);
+}
+
+FrameProfiler::~FrameProfiler() {
+    for (auto& queries : gpu_queries) {
+        for (const auto& query : queries) {
+            gl::glDeleteQueries(1, &query.query);
+        }
+    }
+    if (!free_queries.empty()) {
+        gl::glDeleteQueries(free_queries.size(), free_queries.data());
+    }
+}
+
+std::uint32_t FrameProfiler::zoneIndex(
+    std::string_view name,
+    bool gpu
+) {
+    std::lock_guard lock(mutex);
+
+    // gpu and cpu zones with the same name are kept apart
+    std::string key = std::format("{}{}", gpu ? "gpu:" : "cpu:", name);
+
+    auto it = zone_lookup.find(key);
+    if (it != zone_lookup.end()) {
+        return it->second;
+    }
+
+    zones.push_back(Zone{
+        .name = std::string(name),
+        .gpu = gpu,
+        .samples = std::vector<float>(window_size),
+    });
+    const auto index = static_cast<std::uint32_t>(zones.size() - 1);
+    zone_lookup.emplace(std::move(key), index);
+    return index;
+}
+
+double FrameProfiler::microsecondsSinceStart(
+    Clock::time_point time
+) const {
+    return std::chrono::duration<double, std::micro>(time - start_time)
+        .count();
+}
+
+FrameProfiler::CpuScope FrameProfiler::cpuZone(
+    std::string_view name
+) {
+    return CpuScope(*this, zoneIndex(name, false));
+}
+
+FrameProfiler::GpuScope FrameProfiler::gpuZone(
+    std::string_view name
+) {
+    return GpuScope(*this, zoneIndex(name, true));
+}
+
+void FrameProfiler::addSample(
+    std::uint32_t zone_index,
+    double start_us,
+    double duration_us
+) {
+    // mutex is held by the caller
+    auto& zone = zones[zone_index];
+    zone.samples[zone.next_sample] = static_cast<float>(duration_us / 1000.0);
+    zone.next_sample = (zone.next_sample + 1) % zone.samples.size();
+    zone.sample_count = std::min(zone.sample_count + 1, zone.samples.size());
+
+    if (!tracing) {
+        return;
+    }
+
+    std::uint32_t thread = gpu_trace_thread;
+    if (!zone.gpu) {
+        auto id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        auto [it, inserted] = trace_threads.emplace(
+            id, static_cast<std::uint32_t>(trace_threads.size() + 1)
+        );
+        thread = it->second;
+    }
+
+    trace_events.push_back(TraceEvent{
+        .zone = zone_index,
+        .thread = thread,
+        .start_us = start_us,
+        .duration_us = duration_us,
+    });
+
+    if (trace_events.size() >= max_trace_events) {
+        tracing = false;
+        spdlog::warn("Trace buffer full after {} events", trace_events.size());
+    }
+}
+
+void FrameProfiler::endCpuZone(
+    std::uint32_t zone,
+    Clock::time_point start
+) {
+    const auto end = Clock::now();
+    const double duration_us =
+        std::chrono::duration<double, std::micro>(end - start).count();
+
+    std::lock_guard lock(mutex);
+    addSample(zone, microsecondsSinceStart(start), duration_us);
+}
+
+void FrameProfiler::beginGpuZone(
+    std::uint32_t zone
+) {
+    if (gpu_zone_open) {
+        throw std::runtime_error(
+            "GPU zones can't nest, GL_TIME_ELAPSED queries don't allow it"
+        );
+    }
+    gpu_zone_open = true;
+
+    gl::GLuint query;
+    if (free_queries.empty()) {
+        gl::glGenQueries(1, &query);
+    } else {
+        query = free_queries.back();
+        free_queries.pop_back();
+    }
+
+    gpu_queries[frame_number % 2].push_back(GpuQuery{
+        .query = query,
+        .zone = zone,
+        .start_us = microsecondsSinceStart(Clock::now()),
+    });
+    gl::glBeginQuery(gl::GL_TIME_ELAPSED, query);
+}
+
+void FrameProfiler::endGpuZone() {
+    gl::glEndQuery(gl::GL_TIME_ELAPSED);
+    gpu_zone_open = false;
+}
+
+void FrameProfiler::collectGpuQueries(
+    std::vector<GpuQuery>& queries
+) {
+    std::lock_guard lock(mutex);
+
+    for (const auto& query : queries) {
+        int available = 0;
+        gl::glGetQueryObjectiv(
+            query.query, gl::GL_QUERY_RESULT_AVAILABLE, &available
+        );
+
+        if (available) {
+            gl::GLuint64 elapsed_ns = 0;
+            gl::glGetQueryObjectui64v(
+                query.query, gl::GL_QUERY_RESULT, &elapsed_ns
+            );
+            addSample(query.zone, query.start_us, elapsed_ns / 1000.0);
+        } else {
+            // waiting would stall the pipeline, which is the one thing a
+            // profiler shouldn't do
+            dropped_gpu_samples++;
+        }
+
+        free_queries.push_back(query.query);
+    }
+
+    queries.clear();
+}
+
+void FrameProfiler::beginFrame() {
+    frame_number++;
+    // this parity was last written two frames ago
+    collectGpuQueries(gpu_queries[frame_number % 2]);
+
+    frame_start = Clock::now();
+}
+
+void FrameProfiler::endFrame() {
+    endCpuZone(frame_zone, frame_start);
+
+    if (log_interval.count() > 0 &&
+        Clock::now() - last_log >= log_interval) {
+        logStats();
+        last_log = Clock::now();
+    }
+}
+
+void FrameProfiler::setLogInterval(
+    std::chrono::milliseconds interval
+) {
+    log_interval = interval;
+    last_log = Clock::now();
+}
+
+void FrameProfiler::startTrace(
+    std::size_t max_events
+) {
+    std::lock_guard lock(mutex);
+    trace_events.clear();
+    trace_events.reserve(std::min<std::size_t>(max_events, 65536));
+    max_trace_events = max_events;
+    tracing = true;
+}
+
+void FrameProfiler::stopTrace() {
+    std::lock_guard lock(mutex);
+    tracing = false;
+}
+
+// zone names are ours but may still contain quotes or backslashes
+static std::string json_escape(
+    std::string_view text
+) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void FrameProfiler::writeChromeTrace(
+    const fs::path& path
+) const {
+    std::lock_guard lock(mutex);
+
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error(
+            std::format("Couldn't open {} for writing", path.string())
+        );
+    }
+
+    file << "{\"traceEvents\":[\n";
+    file << std::format(
+        "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},"
+        "\"args\":{{\"name\":\"GPU\"}}}}",
+        gpu_trace_thread
+    );
+    for (const auto& [id, thread] : trace_threads) {
+        file << std::format(
+            ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},"
+            "\"args\":{{\"name\":\"CPU {}\"}}}}",
+            thread,
+            thread
+        );
+    }
+
+    for (const auto& event : trace_events) {
+        const auto& zone = zones[event.zone];
+        file << std::format(
+            ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,"
+            "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+            json_escape(zone.name),
+            zone.gpu ? "gpu" : "cpu",
+            event.thread,
+            event.start_us,
+            event.duration_us
+        );
+    }
+    file << "\n]}\n";
+
+    spdlog::info(
+        "Wrote {} trace events to {}", trace_events.size(), path.string()
+    );
+}
+
+std::vector<FrameProfiler::ZoneStats> FrameProfiler::stats() const {
+    std::lock_guard lock(mutex);
+
+    std::vector<ZoneStats> result;
+    std::vector<float> window;
+
+    for (const auto& zone : zones) {
+        if (zone.sample_count == 0) {
+            continue;
+        }
+
+        window.assign(
+            zone.samples.begin(), zone.samples.begin() + zone.sample_count
+        );
+
+        double sum = 0;
+        float min = window[0];
+        for (float sample : window) {
+            sum += sample;
+            min = std::min(min, sample);
+        }
+
+        const std::size_t p99_index = (window.size() - 1) * 99 / 100;
+        std::nth_element(
+            window.begin(), window.begin() + p99_index, window.end()
+        );
+
+        result.push_back(ZoneStats{
+            .name = zone.name,
+            .gpu = zone.gpu,
+            .samples = zone.sample_count,
+            .min_ms = min,
+            .avg_ms = sum / window.size(),
+            .p99_ms = window[p99_index],
+        });
+    }
+
+    return result;
+}
+
+void FrameProfiler::logStats() const {
+    for (const auto& zone : stats()) {
+        spdlog::info(
+            "{} {:<24} min {:8.3f} ms  avg {:8.3f} ms  p99 {:8.3f} ms",
+            zone.gpu ? "gpu" : "cpu",
+            zone.name,
+            zone.min_ms,
+            zone.avg_ms,
+            zone.p99_ms
+        );
+    }
+}
+
+}  // namespace omgl
@@ -0,0 +1,219 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <omgl/frame_reader.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/sync.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+FrameReader::FrameReader(
+    std::size_t width,
+    std::size_t height,
+    std::size_t buffer_count,
+    Consumer consumer
+)
+    : width(width),
+      height(height),
+      frame_bytes(width * height * 4),
+      consumer(std::move(consumer)) {
+    if (buffer_count == 0) {
+        throw std::runtime_error("FrameReader needs at least one buffer");
+    }
+
+    auto& state = StateCache::current();
+
+    slots.resize(buffer_count);
+    for (auto& slot : slots) {
+        gl::glGenBuffers(1, &slot.pbo);
+        state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, slot.pbo);
+        // GL writes, we read
+        gl::glBufferData(
+            gl::GL_PIXEL_PACK_BUFFER, frame_bytes, nullptr, gl::GL_STREAM_READ
+        );
+    }
+    // a bound pack buffer would turn every other glReadPixels into a copy
+    // to it, so it's always unbound again
+    state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+
+    consumer_thread = std::jthread([this](std::stop_token stop) {
+        consumerLoop(stop);
+    });
+
+    spdlog::info(
+        "FrameReader: {} buffers of {}x{}", buffer_count, width, height
+    );
+}
+
+FrameReader::~FrameReader() {
+    flush();
+
+    for (auto& slot : slots) {
+        delete_fence(slot.fence);
+        StateCache::current().forgetBuffer(slot.pbo);
+        gl::glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+void FrameReader::capture() {
+    if (in_flight == slots.size()) {
+        // every buffer is still busy, this is the one place we block
+        {
+            std::lock_guard lock(mutex);
+            frame_stats.stalls++;
+        }
+        wait_fence(slots[tail].fence);
+        retireOldest();
+    }
+
+    auto& slot = slots[(tail + in_flight) % slots.size()];
+
+    auto& state = StateCache::current();
+    state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, slot.pbo);
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound the pointer is an offset into it, so this
+    // returns as soon as the copy is queued
+    gl::glReadPixels(
+        0, 0, width, height, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, nullptr
+    );
+    state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = insert_fence();
+    slot.frame_index = next_frame_index++;
+    slot.issued = Clock::now();
+    in_flight++;
+
+    std::lock_guard lock(mutex);
+    frame_stats.captured++;
+}
+
+void FrameReader::poll() {
+    // a full queue leaves the frames in their buffers until capture() needs
+    // them, that's where the waiting happens
+    while (in_flight > 0 && !queueFull() &&
+           fence_signaled(slots[tail].fence)) {
+        retireOldest();
+    }
+}
+
+bool FrameReader::queueFull() const {
+    std::lock_guard lock(mutex);
+    return pending.size() >= slots.size();
+}
+
+void FrameReader::retireOldest() {
+    auto& slot = slots[tail];
+    delete_fence(slot.fence);
+
+    std::vector<std::uint8_t> pixels;
+    {
+        std::lock_guard lock(mutex);
+        if (!spare_buffers.empty()) {
+            pixels = std::move(spare_buffers.back());
+            spare_buffers.pop_back();
+        }
+    }
+    pixels.resize(frame_bytes);
+
+    auto& state = StateCache::current();
+    state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, slot.pbo);
+    auto mapped = gl::glMapBufferRange(
+        gl::GL_PIXEL_PACK_BUFFER, 0, frame_bytes, gl::GL_MAP_READ_BIT
+    );
+    if (mapped == nullptr) {
+        state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+        throw std::runtime_error("Couldn't map the pixel pack buffer");
+    }
+    std::memcpy(pixels.data(), mapped, frame_bytes);
+    gl::glUnmapBuffer(gl::GL_PIXEL_PACK_BUFFER);
+    state.bindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+
+    const double readback_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - slot.issued)
+            .count();
+
+    {
+        // only this thread adds frames, so once there is room it stays
+        std::unique_lock lock(mutex);
+        if (pending.size() >= slots.size()) {
+            frame_stats.consumer_stalls++;
+            frame_done.wait(lock, [this] {
+                return pending.size() < slots.size();
+            });
+        }
+        pending.push_back(PendingFrame{
+            .index = slot.frame_index,
+            .pixels = std::move(pixels),
+        });
+        total_readback_ms += readback_ms;
+        frame_stats.max_readback_ms =
+            std::max(frame_stats.max_readback_ms, readback_ms);
+    }
+    frame_ready.notify_one();
+
+    tail = (tail + 1) % slots.size();
+    in_flight--;
+}
+
+void FrameReader::flush() {
+    while (in_flight > 0) {
+        wait_fence(slots[tail].fence);
+        retireOldest();
+    }
+
+    std::unique_lock lock(mutex);
+    frame_done.wait(lock, [this] {
+        return pending.empty() && !consuming;
+    });
+}
+
+void FrameReader::consumerLoop(
+    std::stop_token stop
+) {
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        frame_ready.wait(lock, stop, [this] {
+            return !pending.empty();
+        });
+        if (pending.empty()) {
+            // woken up by the stop request
+            return;
+        }
+
+        PendingFrame frame = std::move(pending.front());
+        pending.pop_front();
+        consuming = true;
+
+        lock.unlock();
+        consumer(CapturedFrame{
+            .index = frame.index,
+            .width = width,
+            .height = height,
+            .pixels = frame.pixels,
+        });
+        lock.lock();
+
+        consuming = false;
+        frame_stats.delivered++;
+        spare_buffers.push_back(std::move(frame.pixels));
+        frame_done.notify_all();
+    }
+}
+
+std::size_t FrameReader::queued() const {
+    std::lock_guard lock(mutex);
+    return pending.size();
+}
+
+FrameReader::Stats FrameReader::stats() const {
+    std::lock_guard lock(mutex);
+
+    Stats stats = frame_stats;
+    const std::size_t retired = frame_stats.captured - in_flight;
+    stats.avg_readback_ms = retired > 0 ? total_readback_ms / retired : 0;
+    return stats;
+}
+
+}  // namespace omgl
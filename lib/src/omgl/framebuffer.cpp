@@ -0,0 +1,95 @@
+#include <spdlog/spdlog.h>
+#include <format>
+#include <omgl/framebuffer.hpp>
+#include <omgl/state_cache.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+Framebuffer::Framebuffer(
+    std::size_t width,
+    std::size_t height
+)
+    : fb_width(width),
+      fb_height(height) {
+    gl::glGenFramebuffers(1, &this->id);
+    gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, this->id);
+
+    gl::glGenRenderbuffers(1, &this->color_rbo);
+    gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, this->color_rbo);
+    gl::glRenderbufferStorage(gl::GL_RENDERBUFFER, gl::GL_RGBA8, width, height);
+    gl::glFramebufferRenderbuffer(
+        gl::GL_FRAMEBUFFER,
+        gl::GL_COLOR_ATTACHMENT0,
+        gl::GL_RENDERBUFFER,
+        this->color_rbo
+    );
+
+    gl::glGenRenderbuffers(1, &this->depth_rbo);
+    gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, this->depth_rbo);
+    gl::glRenderbufferStorage(
+        gl::GL_RENDERBUFFER, gl::GL_DEPTH24_STENCIL8, width, height
+    );
+    gl::glFramebufferRenderbuffer(
+        gl::GL_FRAMEBUFFER,
+        gl::GL_DEPTH_STENCIL_ATTACHMENT,
+        gl::GL_RENDERBUFFER,
+        this->depth_rbo
+    );
+
+    auto status = gl::glCheckFramebufferStatus(gl::GL_FRAMEBUFFER);
+    if (status != gl::GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error(std::format(
+            "Framebuffer incomplete: status={}", static_cast<unsigned>(status)
+        ));
+    }
+
+    gl::glBindRenderbuffer(gl::GL_RENDERBUFFER, 0);
+
+    spdlog::info("Framebuffer created: id={} {}x{}", this->id, width, height);
+}
+
+Framebuffer::~Framebuffer() {
+    gl::glDeleteRenderbuffers(1, &this->color_rbo);
+    gl::glDeleteRenderbuffers(1, &this->depth_rbo);
+    gl::glDeleteFramebuffers(1, &this->id);
+}
+
+void Framebuffer::bind() {
+    gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, this->id);
+    StateCache::current().viewport(0, 0, fb_width, fb_height);
+}
+
+void Framebuffer::readPixels(
+    std::span<std::uint8_t> out
+) {
+    if (out.size() < byteSize()) {
+        throw std::runtime_error(std::format(
+            "Pixel buffer too small: {} < {}", out.size(), byteSize()
+        ));
+    }
+
+    gl::glBindFramebuffer(gl::GL_READ_FRAMEBUFFER, this->id);
+    // rows of RGBA8 are always 4-byte aligned, but don't rely on whatever
+    // someone left in the pack state
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound out.data() would be taken as an offset
+    StateCache::current().bindBuffer(gl::GL_PIXEL_PACK_BUFFER, 0);
+    gl::glReadPixels(
+        0,
+        0,
+        fb_width,
+        fb_height,
+        gl::GL_RGBA,
+        gl::GL_UNSIGNED_BYTE,
+        out.data()
+    );
+}
+
+std::vector<std::uint8_t> Framebuffer::readPixels() {
+    std::vector<std::uint8_t> pixels(byteSize());
+    readPixels(pixels);
+    return pixels;
+}
+
+}  // namespace omgl
@@ -2,6 +2,7 @@
 #include <glbinding/glbinding.h>
 #include <spdlog/spdlog.h>
 #include <omgl/glfw.hpp>
+#include <omgl/state_cache.hpp>
 #include <stdexcept>
 
 namespace omgl {
@@ -9,11 +10,13 @@ namespace omgl {
 GLFWwindow* make_window(
     std::string window_name,
     std::size_t width,
-    std::size_t height
+    std::size_t height,
+    int gl_major,
+    int gl_minor
 ) {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, gl_major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, gl_minor);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     GLFWwindow* window =
@@ -26,10 +29,11 @@ GLFWwindow* make_window(
     spdlog::info("GLFW window created");
 
     glfwMakeContextCurrent(window);
+    StateCache::current().invalidate();
 
     glbinding::initialize(glfwGetProcAddress);
 
-    gl::glViewport(0, 0, width, height);
+    StateCache::current().viewport(0, 0, width, height);
 
     return window;
 }
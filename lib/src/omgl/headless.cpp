@@ -0,0 +1,188 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glbinding/gl/gl.h>
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+#include <format>
+#include <omgl/headless.hpp>
+#include <omgl/state_cache.hpp>
+#include <stdexcept>
+#include <string_view>
+
+namespace omgl {
+
+static bool has_egl_extension(
+    EGLDisplay display,
+    std::string_view name
+) {
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == nullptr) {
+        return false;
+    }
+
+    // space separated list, make sure we don't match a prefix of another one
+    std::string_view list(extensions);
+    std::size_t pos = 0;
+    while ((pos = list.find(name, pos)) != std::string_view::npos) {
+        const std::size_t end = pos + name.size();
+        const bool starts = pos == 0 || list[pos - 1] == ' ';
+        const bool ends = end == list.size() || list[end] == ' ';
+        if (starts && ends) {
+            return true;
+        }
+        pos = end;
+    }
+    return false;
+}
+
+static EGLDisplay get_display() {
+    // client extensions are queried on EGL_NO_DISPLAY
+    if (has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        auto get_platform_display =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT")
+            );
+
+        if (get_platform_display != nullptr) {
+            EGLDisplay display = get_platform_display(
+                EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr
+            );
+            if (display != EGL_NO_DISPLAY) {
+                spdlog::debug("Using the EGL surfaceless platform");
+                return display;
+            }
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+HeadlessContext::HeadlessContext(
+    std::size_t width,
+    std::size_t height,
+    int gl_major,
+    int gl_minor
+) {
+    EGLDisplay egl_display = get_display();
+    if (egl_display == EGL_NO_DISPLAY) {
+        throw std::runtime_error("Failed to get an EGL display");
+    }
+
+    EGLint egl_major, egl_minor;
+    if (!eglInitialize(egl_display, &egl_major, &egl_minor)) {
+        throw std::runtime_error(
+            std::format("eglInitialize failed: {:#x}", eglGetError())
+        );
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(egl_display);
+        throw std::runtime_error("EGL display doesn't support desktop OpenGL");
+    }
+
+    const bool surfaceless =
+        has_egl_extension(egl_display, "EGL_KHR_surfaceless_context");
+
+    // we render into our own framebuffer, the config only matters for the
+    // pbuffer fallback
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE,
+        surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE,
+        EGL_OPENGL_BIT,
+        EGL_NONE,
+    };
+
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(
+            egl_display, config_attributes, &config, 1, &config_count
+        ) ||
+        config_count == 0) {
+        eglTerminate(egl_display);
+        throw std::runtime_error("No suitable EGL config");
+    }
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        gl_major,
+        EGL_CONTEXT_MINOR_VERSION,
+        gl_minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+
+    EGLContext egl_context = eglCreateContext(
+        egl_display, config, EGL_NO_CONTEXT, context_attributes
+    );
+    if (egl_context == EGL_NO_CONTEXT) {
+        eglTerminate(egl_display);
+        throw std::runtime_error(std::format(
+            "Failed to create a {}.{} core context: {:#x}",
+            gl_major,
+            gl_minor,
+            eglGetError()
+        ));
+    }
+
+    EGLSurface egl_surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbuffer_attributes[] = {
+            EGL_WIDTH,
+            1,
+            EGL_HEIGHT,
+            1,
+            EGL_NONE,
+        };
+        egl_surface =
+            eglCreatePbufferSurface(egl_display, config, pbuffer_attributes);
+        if (egl_surface == EGL_NO_SURFACE) {
+            eglDestroyContext(egl_display, egl_context);
+            eglTerminate(egl_display);
+            throw std::runtime_error("Failed to create an EGL pbuffer");
+        }
+    }
+
+    this->display = egl_display;
+    this->context = egl_context;
+    this->surface = egl_surface;
+
+    makeCurrent();
+
+    glbinding::initialize(eglGetProcAddress);
+
+    spdlog::info(
+        "Headless EGL {}.{} context created ({})",
+        egl_major,
+        egl_minor,
+        surfaceless ? "surfaceless" : "pbuffer"
+    );
+
+    this->framebuffer = std::make_unique<Framebuffer>(width, height);
+    this->framebuffer->bind();
+}
+
+HeadlessContext::~HeadlessContext() {
+    // the framebuffer needs the context to still be around
+    framebuffer.reset();
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+    }
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+
+void HeadlessContext::makeCurrent() {
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        throw std::runtime_error(
+            std::format("eglMakeCurrent failed: {:#x}", eglGetError())
+        );
+    }
+    // whatever the cache knew was about some other context
+    StateCache::current().invalidate();
+}
+
+}  // namespace omgl
@@ -0,0 +1,269 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <omgl/culling.hpp>
+#include <omgl/instanced_mesh.hpp>
+#include <omgl/state_cache.hpp>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace omgl {
+
+static_assert(sizeof(InstanceData) == 20, "InstanceData has to stay packed");
+
+std::uint32_t pack_rgba8(
+    const glm::vec4& color
+) {
+    auto channel = [](float value) {
+        return static_cast<std::uint32_t>(
+            std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f)
+        );
+    };
+    // little endian, so r ends up in the first byte
+    return channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 |
+           channel(color.w) << 24;
+}
+
+std::size_t InstanceStore::add(
+    const glm::vec3& position,
+    float scale,
+    std::uint32_t color
+) {
+    xs.push_back(position.x);
+    ys.push_back(position.y);
+    zs.push_back(position.z);
+    scales.push_back(scale);
+    color_values.push_back(color);
+    return xs.size() - 1;
+}
+
+void InstanceStore::reserve(
+    std::size_t count
+) {
+    xs.reserve(count);
+    ys.reserve(count);
+    zs.reserve(count);
+    scales.reserve(count);
+    color_values.reserve(count);
+}
+
+void InstanceStore::resize(
+    std::size_t count
+) {
+    xs.resize(count, 0.0f);
+    ys.resize(count, 0.0f);
+    zs.resize(count, 0.0f);
+    scales.resize(count, 1.0f);
+    color_values.resize(count, 0xffffffff);
+}
+
+void InstanceStore::clear() {
+    resize(0);
+}
+
+void InstanceStore::pack(
+    std::span<InstanceData> out
+) const {
+    const std::size_t count = size();
+    if (out.size() < count) {
+        throw std::runtime_error(std::format(
+            "Packing {} instances into room for {}", count, out.size()
+        ));
+    }
+
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // four instances' x, y, z and scale in, four transforms out
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(xs.data() + i);
+        __m128 y = _mm_loadu_ps(ys.data() + i);
+        __m128 z = _mm_loadu_ps(zs.data() + i);
+        __m128 s = _mm_loadu_ps(scales.data() + i);
+        _MM_TRANSPOSE4_PS(x, y, z, s);
+
+        // 20 byte stride, so nothing is aligned
+        _mm_storeu_ps(reinterpret_cast<float*>(&out[i].transform), x);
+        _mm_storeu_ps(reinterpret_cast<float*>(&out[i + 1].transform), y);
+        _mm_storeu_ps(reinterpret_cast<float*>(&out[i + 2].transform), z);
+        _mm_storeu_ps(reinterpret_cast<float*>(&out[i + 3].transform), s);
+
+        out[i].color = color_values[i];
+        out[i + 1].color = color_values[i + 1];
+        out[i + 2].color = color_values[i + 2];
+        out[i + 3].color = color_values[i + 3];
+    }
+#endif
+    for (; i < count; i++) {
+        out[i].transform = glm::vec4(xs[i], ys[i], zs[i], scales[i]);
+        out[i].color = color_values[i];
+    }
+}
+
+InstancedMesh::InstancedMesh(
+    std::span<const VertexAttribute> attributes,
+    std::size_t vertex_stride,
+    std::span<const std::byte> vertices,
+    std::span<const std::uint32_t> indices,
+    std::size_t max_instances,
+    gl::GLuint transform_location,
+    gl::GLuint color_location
+)
+    : index_count(static_cast<gl::GLsizei>(indices.size())),
+      max_instances(max_instances),
+      // room for every instance in each frame in flight
+      instance_stream(
+          gl::GL_ARRAY_BUFFER,
+          std::max<std::size_t>(max_instances, 1) * sizeof(InstanceData)
+      ) {
+    instance_attributes = {
+        VertexAttribute{
+            .location = transform_location,
+            .components = 4,
+            .type = gl::GL_FLOAT,
+            .offset = offsetof(InstanceData, transform),
+            .divisor = 1,
+        },
+        VertexAttribute{
+            .location = color_location,
+            .components = 4,
+            .type = gl::GL_UNSIGNED_BYTE,
+            .normalized = true,
+            .offset = offsetof(InstanceData, color),
+            .divisor = 1,
+        },
+    };
+
+    auto& state = StateCache::current();
+
+    gl::glGenVertexArrays(1, &vao_id);
+    state.bindVertexArray(vao_id);
+
+    gl::glGenBuffers(1, &vertex_buffer_id);
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, vertex_buffer_id);
+    gl::glBufferData(
+        gl::GL_ARRAY_BUFFER,
+        vertices.size(),
+        vertices.data(),
+        gl::GL_STATIC_DRAW
+    );
+    apply_vertex_attributes(attributes, vertex_stride);
+
+    gl::glGenBuffers(1, &index_buffer_id);
+    state.bindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, index_buffer_id);
+    gl::glBufferData(
+        gl::GL_ELEMENT_ARRAY_BUFFER,
+        indices.size_bytes(),
+        indices.data(),
+        gl::GL_STATIC_DRAW
+    );
+
+    spdlog::debug(
+        "InstancedMesh: vao={} {} indices, up to {} instances",
+        vao_id,
+        index_count,
+        max_instances
+    );
+}
+
+InstancedMesh::~InstancedMesh() {
+    auto& state = StateCache::current();
+    state.forgetVertexArray(vao_id);
+    state.forgetBuffer(vertex_buffer_id);
+    state.forgetBuffer(index_buffer_id);
+
+    gl::glDeleteVertexArrays(1, &vao_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    gl::glDeleteBuffers(1, &index_buffer_id);
+}
+
+void InstancedMesh::beginFrame() {
+    instance_stream.beginFrame();
+}
+
+void InstancedMesh::endFrame() {
+    instance_stream.endFrame();
+}
+
+void InstancedMesh::draw(
+    const InstanceStore& instances
+) {
+    drawFrom(instances.size(), [&](std::span<InstanceData> region) {
+        instances.pack(region);
+        return region.size();
+    });
+}
+
+void InstancedMesh::drawVisible(
+    const InstanceStore& instances,
+    const Frustum& frustum,
+    float bounding_radius
+) {
+    drawFrom(instances.size(), [&](std::span<InstanceData> region) {
+        return cull_instances(frustum, instances, bounding_radius, region);
+    });
+}
+
+template <typename Upload>
+void InstancedMesh::drawFrom(
+    std::size_t count,
+    Upload&& upload
+) {
+    // drawVisible() reserves the whole store, not just what survives
+    const std::size_t reserved =
+        instance_stream.used() / sizeof(InstanceData);
+    if (reserved + count > max_instances) {
+        throw std::runtime_error(std::format(
+            "{} + {} instances this frame, the mesh was made for {}",
+            reserved,
+            count,
+            max_instances
+        ));
+    }
+
+    draw_stats.instances = 0;
+    if (count == 0) {
+        return;
+    }
+
+    auto& state = StateCache::current();
+    state.bindVertexArray(vao_id);
+
+    // room for all of them, culling only knows how many fit afterwards. No
+    // padding between the draws, so max_instances fit in the region
+    const auto allocation = instance_stream.allocate(
+        count * sizeof(InstanceData), alignof(InstanceData)
+    );
+
+    const auto pack_start = std::chrono::steady_clock::now();
+    const std::size_t written =
+        upload(std::span(static_cast<InstanceData*>(allocation.data), count));
+    draw_stats.pack_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - pack_start
+    )
+                             .count();
+    draw_stats.instances = written;
+    instance_stream.commit();
+
+    if (written > 0) {
+        // the instances moved to this draw's allocation
+        state.bindBuffer(gl::GL_ARRAY_BUFFER, instance_stream.id());
+        apply_vertex_attributes(
+            instance_attributes, sizeof(InstanceData), allocation.offset
+        );
+
+        gl::glDrawElementsInstanced(
+            gl::GL_TRIANGLES,
+            index_count,
+            gl::GL_UNSIGNED_INT,
+            nullptr,
+            static_cast<gl::GLsizei>(written)
+        );
+    }
+}
+
+}  // namespace omgl
@@ -0,0 +1,125 @@
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <omgl/io.hpp>
+#include <omgl/state_cache.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace omgl {
+
+MappedFile::MappedFile(
+    const fs::path& path
+) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::format(
+            "Couldn't open {}: {}", path.string(), std::strerror(errno)
+        ));
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error(std::format(
+            "Couldn't stat {}: {}", path.string(), std::strerror(error)
+        ));
+    }
+    length = static_cast<std::size_t>(info.st_size);
+
+    // mmap refuses zero lengths, an empty view needs no mapping anyway
+    if (length > 0) {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            const int error = errno;
+            ::close(fd);
+            throw std::runtime_error(std::format(
+                "Couldn't map {}: {}", path.string(), std::strerror(error)
+            ));
+        }
+        data = static_cast<const std::byte*>(mapped);
+    }
+
+    // the mapping keeps the file alive on its own
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(
+    MappedFile&& other
+) noexcept
+    : data(std::exchange(other.data, nullptr)),
+      length(std::exchange(other.length, 0)) {}
+
+MappedFile& MappedFile::operator=(
+    MappedFile&& other
+) noexcept {
+    if (this != &other) {
+        unmap();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+void MappedFile::unmap() {
+    if (data != nullptr) {
+        ::munmap(const_cast<std::byte*>(data), length);
+        data = nullptr;
+        length = 0;
+    }
+}
+
+void MappedFile::adviseSequential() const {
+    if (data != nullptr) {
+        ::madvise(const_cast<std::byte*>(data), length, MADV_SEQUENTIAL);
+    }
+}
+
+std::string read_file_text(
+    const fs::path& path
+) {
+    MappedFile file(path);
+    return std::string(file.text());
+}
+
+std::size_t upload_file_to_buffer(
+    gl::GLenum target,
+    gl::GLuint buffer,
+    const fs::path& path,
+    gl::GLenum usage,
+    std::size_t chunk_size
+) {
+    MappedFile file(path);
+    file.adviseSequential();
+
+    const auto bytes = file.bytes();
+
+    StateCache::current().bindBuffer(target, buffer);
+    gl::glBufferData(target, bytes.size(), nullptr, usage);
+
+    for (std::size_t offset = 0; offset < bytes.size(); offset += chunk_size) {
+        const std::size_t count = std::min(chunk_size, bytes.size() - offset);
+        gl::glBufferSubData(target, offset, count, bytes.data() + offset);
+    }
+
+    spdlog::debug(
+        "Uploaded {} ({} bytes) to buffer {}",
+        path.string(),
+        bytes.size(),
+        buffer
+    );
+    return bytes.size();
+}
+
+}  // namespace omgl
@@ -0,0 +1,233 @@
+#include <spdlog/spdlog.h>
+#include <omgl/job_system.hpp>
+
+namespace omgl {
+
+// which pool the calling thread works for, if any
+struct WorkerIdentity {
+    const JobSystem* system = nullptr;
+    std::size_t index = 0;
+};
+
+static thread_local WorkerIdentity worker_identity;
+
+std::size_t default_worker_count() {
+    const std::size_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+JobSystem::JobSystem(
+    std::size_t worker_count
+) {
+    for (std::size_t i = 0; i <= worker_count; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    workers.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; i++) {
+        workers.emplace_back([this, i](std::stop_token stop) {
+            workerLoop(i, stop);
+        });
+    }
+
+    spdlog::info("JobSystem: {} workers", worker_count);
+}
+
+JobSystem::~JobSystem() {
+    const std::size_t self = currentWorker();
+    while (queued.load() > 0) {
+        if (!runOne(self)) {
+            // a worker has the last ones
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.request_stop();
+    }
+    workers.clear();
+}
+
+std::size_t JobSystem::currentWorker() const {
+    return worker_identity.system == this ? worker_identity.index
+                                          : workers.size();
+}
+
+void JobSystem::run(
+    Job job,
+    JobCounter* done
+) {
+    if (done != nullptr) {
+        done->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    push(Task{.job = std::move(job), .counter = done});
+}
+
+void JobSystem::runAfter(
+    JobCounter& dependency,
+    Job job,
+    JobCounter* done
+) {
+    if (done != nullptr) {
+        done->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard lock(dependency.mutex);
+        if (!dependency.done()) {
+            dependency.continuations.emplace_back(std::move(job), done);
+            return;
+        }
+    }
+    push(Task{.job = std::move(job), .counter = done});
+}
+
+void JobSystem::wait(
+    JobCounter& counter
+) {
+    const std::size_t self = currentWorker();
+    while (!counter.done()) {
+        if (runOne(self)) {
+            continue;
+        }
+        // whatever we're waiting for is running on a worker
+        std::unique_lock lock(sleep_mutex);
+        wake.wait(lock, [&] {
+            return queued.load() > 0 || counter.done();
+        });
+    }
+
+    // the last job may still be inside finish(), and the counter often
+    // lives on the caller's stack
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(counter.mutex);
+        std::swap(error, counter.error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::push(
+    Task task
+) {
+    auto& queue = *queues[currentWorker()];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    // taking the lock orders this against a worker about to sleep
+    { std::lock_guard lock(sleep_mutex); }
+    wake.notify_one();
+}
+
+bool JobSystem::pop(
+    std::size_t self,
+    Task& task
+) {
+    {
+        auto& own = *queues[self];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // steal the oldest job from the next queue that has one
+    for (std::size_t i = 1; i < queues.size(); i++) {
+        auto& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::runOne(
+    std::size_t self
+) {
+    Task task;
+    if (!pop(self, task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(
+    Task& task
+) {
+    try {
+        task.job();
+    } catch (...) {
+        if (task.counter == nullptr) {
+            try {
+                throw;
+            } catch (const std::exception& error) {
+                spdlog::error("Job failed: {}", error.what());
+            } catch (...) {
+                spdlog::error("Job failed");
+            }
+        } else {
+            std::lock_guard lock(task.counter->mutex);
+            if (!task.counter->error) {
+                task.counter->error = std::current_exception();
+            }
+        }
+    }
+
+    // the job's captures go before anyone waiting on it wakes up
+    task.job = nullptr;
+    if (task.counter != nullptr) {
+        finish(*task.counter);
+    }
+}
+
+void JobSystem::finish(
+    JobCounter& counter
+) {
+    std::vector<std::pair<Job, JobCounter*>> ready;
+    {
+        std::lock_guard lock(counter.mutex);
+        if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        std::swap(ready, counter.continuations);
+    }
+    // the counter may be gone from here on
+
+    for (auto& [job, done] : ready) {
+        push(Task{.job = std::move(job), .counter = done});
+    }
+
+    { std::lock_guard lock(sleep_mutex); }
+    wake.notify_all();
+}
+
+void JobSystem::workerLoop(
+    std::size_t index,
+    std::stop_token stop
+) {
+    worker_identity = WorkerIdentity{.system = this, .index = index};
+
+    while (!stop.stop_requested()) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex);
+        wake.wait(lock, stop, [this] {
+            return queued.load() > 0;
+        });
+    }
+}
+
+}  // namespace omgl
@@ -0,0 +1,204 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <omgl/mesh_file.hpp>
+#include <stdexcept>
+#include "container_file.hpp"
+
+namespace omgl {
+
+MeshFile::MeshFile(
+    const fs::path& path
+)
+    : file(path) {
+    const auto bytes = file.bytes();
+    const InvalidFile fail{path, "mesh"};
+
+    if (bytes.size() < sizeof(MeshFileHeader)) {
+        throw fail("too short for the header");
+    }
+    std::memcpy(&file_header, bytes.data(), sizeof(MeshFileHeader));
+    if (file_header.magic != mesh_file_magic) {
+        throw fail("wrong magic");
+    }
+    if (file_header.version != mesh_file_version) {
+        throw fail(std::format("version {}", file_header.version));
+    }
+    if (file_header.vertex_stride == 0) {
+        throw fail("no vertex stride");
+    }
+
+    const std::size_t count = file_header.attribute_count;
+    if ((bytes.size() - sizeof(MeshFileHeader)) / sizeof(MeshFileAttribute) <
+        count) {
+        throw fail("too short for the attributes");
+    }
+    std::vector<MeshFileAttribute> stored(count);
+    std::memcpy(
+        stored.data(),
+        bytes.data() + sizeof(MeshFileHeader),
+        count * sizeof(MeshFileAttribute)
+    );
+    for (const auto& attribute : stored) {
+        if (attribute.offset >= file_header.vertex_stride) {
+            throw fail(std::format(
+                "attribute {} starts past the end of a vertex",
+                attribute.location
+            ));
+        }
+        auto& out = vertex_attributes.emplace_back();
+        out.location = attribute.location;
+        out.components = static_cast<gl::GLint>(attribute.components);
+        out.type = static_cast<gl::GLenum>(attribute.type);
+        out.normalized = attribute.normalized != 0;
+        out.integer = attribute.integer != 0;
+        out.offset = attribute.offset;
+        out.divisor = attribute.divisor;
+    }
+
+    auto check_range = [&](std::uint64_t offset,
+                           std::uint64_t count,
+                           std::size_t size,
+                           std::string_view what) {
+        if (offset % 16 != 0) {
+            throw fail(std::format("the {} aren't aligned", what));
+        }
+        if (offset > bytes.size() || (bytes.size() - offset) / size < count) {
+            throw fail(std::format("the {} go past the end", what));
+        }
+    };
+    check_range(
+        file_header.vertex_offset,
+        file_header.vertex_count,
+        file_header.vertex_stride,
+        "vertices"
+    );
+    check_range(
+        file_header.index_offset,
+        file_header.index_count,
+        sizeof(std::uint32_t),
+        "indices"
+    );
+
+    file.adviseSequential();
+}
+
+std::span<const std::byte> MeshFile::vertices() const {
+    return file.bytes().subspan(
+        file_header.vertex_offset,
+        file_header.vertex_count * file_header.vertex_stride
+    );
+}
+
+std::span<const std::uint32_t> MeshFile::indices() const {
+    // the mapping is page aligned and the offset a multiple of 16
+    return {
+        reinterpret_cast<const std::uint32_t*>(
+            file.bytes().data() + file_header.index_offset
+        ),
+        file_header.index_count
+    };
+}
+
+MeshHandle MeshFile::addTo(
+    MeshPool& pool
+) const {
+    if (pool.vertexStride() != stride()) {
+        throw std::runtime_error(std::format(
+            "A mesh with {} byte vertices doesn't fit a pool of {} byte ones",
+            stride(),
+            pool.vertexStride()
+        ));
+    }
+    // the same bytes read as other attributes would draw garbage
+    const auto pool_attributes = pool.vertexAttributes();
+    if (pool_attributes.size() != vertex_attributes.size()) {
+        throw std::runtime_error(std::format(
+            "A mesh with {} attributes doesn't fit a pool with {}",
+            vertex_attributes.size(),
+            pool_attributes.size()
+        ));
+    }
+    for (const auto& attribute : vertex_attributes) {
+        const auto match = std::find(
+            pool_attributes.begin(), pool_attributes.end(), attribute
+        );
+        if (match == pool_attributes.end()) {
+            throw std::runtime_error(std::format(
+                "Attribute {} of the mesh isn't laid out like the pool's",
+                attribute.location
+            ));
+        }
+    }
+    return pool.add(vertices(), indices());
+}
+
+void write_mesh_file(
+    const fs::path& path,
+    const MeshData& mesh
+) {
+    if (mesh.stride == 0 || mesh.vertices.size() % mesh.stride != 0) {
+        throw std::runtime_error(std::format(
+            "{} bytes of vertices don't make whole vertices of {} bytes",
+            mesh.vertices.size(),
+            mesh.stride
+        ));
+    }
+
+    const std::size_t vertex_offset = align_16(
+        sizeof(MeshFileHeader) +
+        mesh.attributes.size() * sizeof(MeshFileAttribute)
+    );
+    const std::size_t index_offset =
+        align_16(vertex_offset + mesh.vertices.size());
+    const MeshFileHeader header{
+        .magic = mesh_file_magic,
+        .version = mesh_file_version,
+        .vertex_stride = static_cast<std::uint32_t>(mesh.stride),
+        .attribute_count = static_cast<std::uint32_t>(mesh.attributes.size()),
+        .vertex_count = mesh.vertexCount(),
+        .index_count = mesh.indices.size(),
+        .vertex_offset = vertex_offset,
+        .index_offset = index_offset,
+        .bounds_min = {mesh.bounds_min.x, mesh.bounds_min.y, mesh.bounds_min.z},
+        .bounds_max = {mesh.bounds_max.x, mesh.bounds_max.y, mesh.bounds_max.z},
+    };
+
+    std::vector<MeshFileAttribute> attributes;
+    for (const auto& attribute : mesh.attributes) {
+        auto& out = attributes.emplace_back();
+        out.location = attribute.location;
+        out.components = static_cast<std::uint32_t>(attribute.components);
+        out.type = static_cast<std::uint32_t>(attribute.type);
+        out.offset = static_cast<std::uint32_t>(attribute.offset);
+        out.divisor = attribute.divisor;
+        out.normalized = attribute.normalized;
+        out.integer = attribute.integer;
+        out.reserved = 0;
+    }
+
+    ContainerWriter file(path);
+
+    file.write(&header, sizeof(header));
+    file.write(
+        attributes.data(), attributes.size() * sizeof(MeshFileAttribute)
+    );
+    file.padTo(vertex_offset);
+    file.write(mesh.vertices.data(), mesh.vertices.size());
+    file.padTo(index_offset);
+    file.write(
+        mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t)
+    );
+
+    file.finish();
+    spdlog::debug(
+        "Wrote {}: {} vertices of {} bytes, {} indices",
+        path.string(),
+        header.vertex_count,
+        header.vertex_stride,
+        header.index_count
+    );
+}
+
+}  // namespace omgl
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+#include <omgl/io.hpp>
+#include <omgl/mesh_import.hpp>
+#include <stdexcept>
+#include <string_view>
+
+namespace omgl {
+
+// splits off the next whitespace separated token, empty at the end
+static std::string_view next_token(
+    std::string_view& rest
+) {
+    const auto start = rest.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+        rest = {};
+        return {};
+    }
+    rest.remove_prefix(start);
+    const auto end = std::min(rest.find_first_of(" \t\r"), rest.size());
+    const auto token = rest.substr(0, end);
+    rest.remove_prefix(end);
+    return token;
+}
+
+// One corner of a face, indices into the position/uv/normal lists or -1.
+struct Corner {
+    std::int64_t position;
+    std::int64_t uv;
+    std::int64_t normal;
+};
+
+class ObjParser {
+   public:
+    ObjParser(
+        const fs::path& path,
+        std::string_view text
+    )
+        : path(path), text(text) {}
+
+    void parse() {
+        while (!text.empty()) {
+            line_number++;
+            const auto end = std::min(text.find('\n'), text.size());
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(std::min(end + 1, text.size()));
+
+            const auto keyword = next_token(line);
+            if (keyword == "v") {
+                positions.push_back(readVec3(line));
+            } else if (keyword == "vn") {
+                normals.push_back(readVec3(line));
+            } else if (keyword == "vt") {
+                // a third coordinate is allowed and ignored
+                const float u = readFloat(next_token(line));
+                const auto v = next_token(line);
+                uvs.emplace_back(u, v.empty() ? 0.0f : readFloat(v));
+            } else if (keyword == "f") {
+                readFace(line);
+            }
+        }
+    }
+
+    std::runtime_error fail(
+        std::string_view reason
+    ) const {
+        return std::runtime_error(std::format(
+            "{}:{}: {}", path.string(), line_number, reason
+        ));
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    // three per triangle
+    std::vector<Corner> corners;
+
+   private:
+    float readFloat(
+        std::string_view token
+    ) const {
+        float value = 0.0f;
+        const auto [end, error] =
+            std::from_chars(token.data(), token.data() + token.size(), value);
+        if (token.empty() || error != std::errc() ||
+            end != token.data() + token.size()) {
+            throw fail(std::format("Expected a number, got \"{}\"", token));
+        }
+        return value;
+    }
+
+    glm::vec3 readVec3(
+        std::string_view& line
+    ) const {
+        const float x = readFloat(next_token(line));
+        const float y = readFloat(next_token(line));
+        const float z = readFloat(next_token(line));
+        return {x, y, z};
+    }
+
+    // 1-based, negative counts back from the last one read so far,
+    // empty means there is none
+    std::int64_t readIndex(
+        std::string_view token,
+        std::size_t count
+    ) const {
+        if (token.empty()) {
+            return -1;
+        }
+        std::int64_t index = 0;
+        const auto [end, error] =
+            std::from_chars(token.data(), token.data() + token.size(), index);
+        if (error != std::errc() || end != token.data() + token.size()) {
+            throw fail(std::format("Expected an index, got \"{}\"", token));
+        }
+        const std::int64_t resolved =
+            index < 0 ? static_cast<std::int64_t>(count) + index : index - 1;
+        if (index == 0 || resolved < 0 ||
+            resolved >= static_cast<std::int64_t>(count)) {
+            throw fail(std::format("Index {} out of range", index));
+        }
+        return resolved;
+    }
+
+    // v, v/vt, v//vn or v/vt/vn
+    Corner readCorner(
+        std::string_view token
+    ) const {
+        const auto first_slash = std::min(token.find('/'), token.size());
+        const auto position = token.substr(0, first_slash);
+        auto rest = token.substr(std::min(first_slash + 1, token.size()));
+        const auto second_slash = std::min(rest.find('/'), rest.size());
+        const auto uv = rest.substr(0, second_slash);
+        const auto normal =
+            rest.substr(std::min(second_slash + 1, rest.size()));
+
+        if (position.empty()) {
+            throw fail(
+                std::format("Face corner \"{}\" has no position", token)
+            );
+        }
+        return {
+            readIndex(position, positions.size()),
+            readIndex(uv, uvs.size()),
+            readIndex(normal, normals.size()),
+        };
+    }
+
+    void readFace(
+        std::string_view line
+    ) {
+        face.clear();
+        for (auto token = next_token(line); !token.empty();
+             token = next_token(line)) {
+            face.push_back(readCorner(token));
+        }
+        if (face.size() < 3) {
+            throw fail("A face needs at least three corners");
+        }
+        for (std::size_t i = 1; i + 1 < face.size(); i++) {
+            corners.push_back(face[0]);
+            corners.push_back(face[i]);
+            corners.push_back(face[i + 1]);
+        }
+    }
+
+    const fs::path& path;
+    std::string_view text;
+    std::size_t line_number = 0;
+    std::vector<Corner> face;
+};
+
+MeshData load_obj(
+    const fs::path& path
+) {
+    const MappedFile file(path);
+    file.adviseSequential();
+    ObjParser parser(path, file.text());
+    parser.parse();
+    if (parser.corners.empty()) {
+        throw std::runtime_error(
+            std::format("{} has no faces", path.string())
+        );
+    }
+
+    // area weighted face normals summed up per position, for the corners
+    // that don't come with one
+    std::vector<glm::vec3> smooth_normals;
+    const bool needs_normals =
+        std::any_of(parser.corners.begin(), parser.corners.end(), [](auto c) {
+            return c.normal < 0;
+        });
+    if (needs_normals) {
+        smooth_normals.assign(parser.positions.size(), glm::vec3(0.0f));
+        for (std::size_t i = 0; i < parser.corners.size(); i += 3) {
+            const auto a = parser.corners[i].position;
+            const auto b = parser.corners[i + 1].position;
+            const auto c = parser.corners[i + 2].position;
+            const glm::vec3 normal = glm::cross(
+                parser.positions[b] - parser.positions[a],
+                parser.positions[c] - parser.positions[a]
+            );
+            smooth_normals[a] += normal;
+            smooth_normals[b] += normal;
+            smooth_normals[c] += normal;
+        }
+        for (auto& normal : smooth_normals) {
+            const float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0, 0, 1);
+        }
+    }
+
+    MeshData mesh;
+    const auto& attributes = vertex_attributes_of<ObjVertex>;
+    mesh.attributes.assign(attributes.begin(), attributes.end());
+    mesh.stride = sizeof(ObjVertex);
+    mesh.vertices.resize(parser.corners.size() * sizeof(ObjVertex));
+    mesh.indices.resize(parser.corners.size());
+    mesh.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    mesh.bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (std::size_t i = 0; i < parser.corners.size(); i++) {
+        const auto& corner = parser.corners[i];
+        ObjVertex vertex;
+        vertex.position = parser.positions[corner.position];
+        vertex.normal = corner.normal < 0
+                            ? smooth_normals[corner.position]
+                            : parser.normals[corner.normal];
+        vertex.uv = corner.uv < 0 ? glm::vec2(0.0f) : parser.uvs[corner.uv];
+        std::memcpy(
+            &mesh.vertices[i * sizeof(ObjVertex)], &vertex, sizeof(vertex)
+        );
+        mesh.indices[i] = static_cast<std::uint32_t>(i);
+
+        mesh.bounds_min = glm::min(mesh.bounds_min, vertex.position);
+        mesh.bounds_max = glm::max(mesh.bounds_max, vertex.position);
+    }
+    return mesh;
+}
+
+MeshData quantize_mesh(
+    const MeshData& mesh
+) {
+    if (mesh.stride != sizeof(ObjVertex)) {
+        throw std::runtime_error(std::format(
+            "quantize_mesh needs ObjVertex vertices, got a stride of {}",
+            mesh.stride
+        ));
+    }
+    // other 32 byte layouts would be read as ObjVertex all the same
+    if (!std::ranges::equal(mesh.attributes, vertex_attributes_of<ObjVertex>)) {
+        throw std::runtime_error(
+            "quantize_mesh needs ObjVertex vertices, the attributes differ"
+        );
+    }
+
+    MeshData quantized;
+    const auto& attributes = vertex_attributes_of<QuantizedVertex>;
+    quantized.attributes.assign(attributes.begin(), attributes.end());
+    quantized.stride = sizeof(QuantizedVertex);
+    quantized.vertices.resize(mesh.vertexCount() * sizeof(QuantizedVertex));
+    quantized.indices = mesh.indices;
+    quantized.bounds_min = mesh.bounds_min;
+    quantized.bounds_max = mesh.bounds_max;
+
+    for (std::size_t i = 0; i < mesh.vertexCount(); i++) {
+        ObjVertex in;
+        std::memcpy(&in, &mesh.vertices[i * sizeof(ObjVertex)], sizeof(in));
+
+        QuantizedVertex out;
+        out.position = {
+            glm::packHalf1x16(in.position.x),
+            glm::packHalf1x16(in.position.y),
+            glm::packHalf1x16(in.position.z),
+            0,
+        };
+        out.normal = glm::packSnorm3x10_1x2(glm::vec4(in.normal, 0.0f));
+        out.uv = {glm::packHalf1x16(in.uv.x), glm::packHalf1x16(in.uv.y)};
+        std::memcpy(
+            &quantized.vertices[i * sizeof(QuantizedVertex)], &out, sizeof(out)
+        );
+    }
+    return quantized;
+}
+
+}  // namespace omgl
@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <glm/gtc/packing.hpp>
+#include <omgl/mesh_lod.hpp>
+#include <omgl/mesh_optimizer.hpp>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace omgl {
+
+std::vector<glm::vec3> mesh_positions(
+    const MeshData& mesh
+) {
+    const auto attribute = std::find_if(
+        mesh.attributes.begin(),
+        mesh.attributes.end(),
+        [](const VertexAttribute& attribute) {
+            return attribute.location == 0;
+        }
+    );
+    if (attribute == mesh.attributes.end() || attribute->components < 3 ||
+        (attribute->type != gl::GL_FLOAT &&
+         attribute->type != gl::GL_HALF_FLOAT)) {
+        throw std::runtime_error(
+            "Mesh positions have to be 3 or 4 floats or halves at location 0"
+        );
+    }
+
+    std::vector<glm::vec3> positions(mesh.vertexCount());
+    for (std::size_t i = 0; i < positions.size(); i++) {
+        const auto* at = &mesh.vertices[i * mesh.stride + attribute->offset];
+        if (attribute->type == gl::GL_FLOAT) {
+            std::memcpy(&positions[i], at, sizeof(glm::vec3));
+        } else {
+            std::uint16_t halves[3];
+            std::memcpy(halves, at, sizeof(halves));
+            positions[i] = glm::vec3(
+                glm::unpackHalf1x16(halves[0]),
+                glm::unpackHalf1x16(halves[1]),
+                glm::unpackHalf1x16(halves[2])
+            );
+        }
+    }
+    return positions;
+}
+
+// A symmetric 4x4 matrix that gives the summed, weighted squared distance
+// of a point to a set of planes, plus the summed weights.
+struct Quadric {
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+};
+
+// plane n.p + d = 0 with n normalized
+static Quadric plane_quadric(
+    const glm::vec3& n,
+    float d,
+    double weight
+) {
+    const double a = n.x, b = n.y, c = n.z;
+    return {
+        a * a * weight,
+        a * b * weight,
+        a * c * weight,
+        a * d * weight,
+        b * b * weight,
+        b * c * weight,
+        b * d * weight,
+        c * c * weight,
+        c * d * weight,
+        double(d) * d * weight,
+        weight,
+    };
+}
+
+static void add_quadric(
+    Quadric& to,
+    const Quadric& q
+) {
+    to.a2 += q.a2;
+    to.ab += q.ab;
+    to.ac += q.ac;
+    to.ad += q.ad;
+    to.b2 += q.b2;
+    to.bc += q.bc;
+    to.bd += q.bd;
+    to.c2 += q.c2;
+    to.cd += q.cd;
+    to.d2 += q.d2;
+    to.weight += q.weight;
+}
+
+// mean squared distance of `p` to the planes of both quadrics
+static double collapse_cost(
+    const Quadric& q1,
+    const Quadric& q2,
+    const glm::vec3& p
+) {
+    Quadric q = q1;
+    add_quadric(q, q2);
+    if (q.weight <= 0.0) {
+        return 0.0;
+    }
+    const double x = p.x, y = p.y, z = p.z;
+    const double sum = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z +
+                       2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z) +
+                       2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+    return std::max(sum / q.weight, 0.0);
+}
+
+// border planes count this much more than triangle planes, so the outline
+// holds up longer than the surface
+constexpr float border_weight = 10.0f;
+
+// a collapse may turn a triangle by at most about 75 degrees
+constexpr float min_normal_cosine = 0.25f;
+
+enum class VertexKind : std::uint8_t { interior, border, locked };
+
+static std::uint64_t edge_key(
+    std::uint32_t from,
+    std::uint32_t to
+) {
+    return std::uint64_t{from} << 32 | to;
+}
+
+// Collapses edges until the index count gets down to each of the targets,
+// which go from many to few, and snapshots the indices at each. Returns the
+// snapshots that could be reached with the largest error up to then.
+static std::vector<std::pair<std::vector<std::uint32_t>, float>> simplify(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    std::span<const std::size_t> targets
+) {
+    const std::size_t vertex_count = positions.size();
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error(std::format(
+            "{} indices aren't a whole number of triangles", indices.size()
+        ));
+    }
+    for (const auto index : indices) {
+        if (index >= vertex_count) {
+            throw std::runtime_error(std::format(
+                "Index {} out of range for {} vertices", index, vertex_count
+            ));
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertex_count, VertexKind::interior);
+
+    // vertices at the same position as another one are seams, as long as
+    // both are actually used
+    {
+        std::vector<bool> used(vertex_count, false);
+        for (const auto index : indices) {
+            used[index] = true;
+        }
+        std::unordered_map<std::string_view, std::uint32_t> first_at;
+        first_at.reserve(vertex_count);
+        for (std::uint32_t v = 0; v < vertex_count; v++) {
+            if (!used[v]) {
+                continue;
+            }
+            const std::string_view key(
+                reinterpret_cast<const char*>(&positions[v]), sizeof(glm::vec3)
+            );
+            const auto [found, inserted] = first_at.try_emplace(key, v);
+            if (!inserted) {
+                kinds[v] = VertexKind::locked;
+                kinds[found->second] = VertexKind::locked;
+            }
+        }
+    }
+
+    // an edge without a twin going the other way is a border, one used
+    // more than once in the same direction isn't manifold
+    std::unordered_map<std::uint64_t, std::uint32_t> edges;
+    edges.reserve(indices.size());
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        for (std::size_t k = 0; k < 3; k++) {
+            edges[edge_key(indices[i + k], indices[i + (k + 1) % 3])]++;
+        }
+    }
+    std::vector<std::uint8_t> border_edges(vertex_count, 0);
+    for (const auto& [key, count] : edges) {
+        const auto from = static_cast<std::uint32_t>(key >> 32);
+        const auto to = static_cast<std::uint32_t>(key);
+        if (count > 1) {
+            kinds[from] = VertexKind::locked;
+            kinds[to] = VertexKind::locked;
+        } else if (!edges.contains(edge_key(to, from))) {
+            border_edges[from]++;
+            border_edges[to]++;
+        }
+    }
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        if (kinds[v] == VertexKind::locked || border_edges[v] == 0) {
+            continue;
+        }
+        // anything but a simple run of border needs to stay put
+        kinds[v] =
+            border_edges[v] == 2 ? VertexKind::border : VertexKind::locked;
+    }
+
+    // the planes of the triangles around every vertex, weighted by area,
+    // and planes standing on the border edges to keep them in place
+    std::vector<Quadric> quadrics(vertex_count, Quadric{});
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& p0 = positions[indices[i]];
+        const glm::vec3& p1 = positions[indices[i + 1]];
+        const glm::vec3& p2 = positions[indices[i + 2]];
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        const glm::vec3 n = normal / length;
+        const auto quadric =
+            plane_quadric(n, -glm::dot(n, p0), 0.5 * length);
+        for (std::size_t k = 0; k < 3; k++) {
+            add_quadric(quadrics[indices[i + k]], quadric);
+        }
+
+        for (std::size_t k = 0; k < 3; k++) {
+            const auto from = indices[i + k];
+            const auto to = indices[i + (k + 1) % 3];
+            if (edges.contains(edge_key(to, from))) {
+                continue;
+            }
+            const glm::vec3 edge = positions[to] - positions[from];
+            const glm::vec3 side = glm::cross(edge, n);
+            const float side_length = glm::length(side);
+            if (side_length == 0.0f) {
+                continue;
+            }
+            const glm::vec3 m = side / side_length;
+            const auto border = plane_quadric(
+                m,
+                -glm::dot(m, positions[from]),
+                glm::dot(edge, edge) * border_weight
+            );
+            add_quadric(quadrics[from], border);
+            add_quadric(quadrics[to], border);
+        }
+    }
+
+    std::vector<std::pair<std::vector<std::uint32_t>, float>> snapshots;
+    std::vector<std::uint32_t> current(indices.begin(), indices.end());
+    double max_cost = 0.0;
+
+    // the triangles around each vertex, rebuilt every pass
+    std::vector<std::uint32_t> first_triangle(vertex_count + 1);
+    std::vector<std::uint32_t> vertex_triangles;
+    std::vector<bool> touched(vertex_count);
+    std::vector<bool> dead;
+    std::vector<std::uint32_t> neighbours;
+
+    struct Collapse {
+        std::uint32_t from;
+        std::uint32_t to;
+        double cost;
+    };
+    std::vector<Collapse> collapses;
+
+    for (const std::size_t target : targets) {
+        const std::size_t target_triangles = target / 3;
+        // Every pass collapses the cheapest edges that don't share a
+        // neighbourhood, so the checks of one collapse can't be undone by
+        // another. Then everything is rebuilt for the next.
+        while (current.size() / 3 > target_triangles) {
+            const std::size_t triangle_count = current.size() / 3;
+
+            std::fill(first_triangle.begin(), first_triangle.end(), 0);
+            for (const auto index : current) {
+                first_triangle[index + 1]++;
+            }
+            for (std::size_t v = 0; v < vertex_count; v++) {
+                first_triangle[v + 1] += first_triangle[v];
+            }
+            vertex_triangles.resize(current.size());
+            {
+                std::vector<std::uint32_t> fill(
+                    first_triangle.begin(), first_triangle.end() - 1
+                );
+                for (std::size_t i = 0; i < current.size(); i++) {
+                    vertex_triangles[fill[current[i]]++] =
+                        static_cast<std::uint32_t>(i / 3);
+                }
+            }
+            auto triangles_of = [&](std::uint32_t v) {
+                return std::span<const std::uint32_t>(
+                    vertex_triangles.data() + first_triangle[v],
+                    first_triangle[v + 1] - first_triangle[v]
+                );
+            };
+
+            std::unordered_map<std::uint64_t, std::uint32_t> pass_edges;
+            pass_edges.reserve(current.size());
+            for (std::size_t i = 0; i < current.size(); i += 3) {
+                for (std::size_t k = 0; k < 3; k++) {
+                    pass_edges[edge_key(
+                        current[i + k], current[i + (k + 1) % 3]
+                    )]++;
+                }
+            }
+            auto is_border = [&](std::uint32_t a, std::uint32_t b) {
+                return !pass_edges.contains(edge_key(a, b)) ||
+                       !pass_edges.contains(edge_key(b, a));
+            };
+
+            // the cheapest way out for every vertex that can move
+            collapses.clear();
+            for (std::uint32_t p = 0; p < vertex_count; p++) {
+                if (kinds[p] == VertexKind::locked) {
+                    continue;
+                }
+                Collapse best{p, p, 0.0};
+                for (const auto t : triangles_of(p)) {
+                    for (std::size_t k = 0; k < 3; k++) {
+                        const auto q = current[t * 3 + k];
+                        if (q == p || (kinds[p] == VertexKind::border &&
+                                       !is_border(p, q))) {
+                            continue;
+                        }
+                        const double cost = collapse_cost(
+                            quadrics[p], quadrics[q], positions[q]
+                        );
+                        if (best.to == p || cost < best.cost) {
+                            best = {p, q, cost};
+                        }
+                    }
+                }
+                if (best.to != p) {
+                    collapses.push_back(best);
+                }
+            }
+            std::sort(
+                collapses.begin(),
+                collapses.end(),
+                [](const Collapse& a, const Collapse& b) {
+                    return a.cost < b.cost;
+                }
+            );
+
+            std::fill(touched.begin(), touched.end(), false);
+            dead.assign(triangle_count, false);
+            std::size_t removed = 0;
+            for (const auto& collapse : collapses) {
+                if (triangle_count - removed <= target_triangles) {
+                    break;
+                }
+                const auto p = collapse.from;
+                const auto q = collapse.to;
+                const auto around = triangles_of(p);
+
+                bool blocked = touched[q];
+                for (const auto t : around) {
+                    for (std::size_t k = 0; k < 3; k++) {
+                        blocked = blocked || touched[current[t * 3 + k]];
+                    }
+                }
+                if (blocked) {
+                    continue;
+                }
+
+                // Link condition: p and q may only share the neighbours
+                // across the triangles on their edge, or the collapse
+                // would fold the surface onto itself.
+                neighbours.clear();
+                std::size_t shared_triangles = 0;
+                for (const auto t : around) {
+                    bool has_q = false;
+                    for (std::size_t k = 0; k < 3; k++) {
+                        const auto v = current[t * 3 + k];
+                        has_q = has_q || v == q;
+                        if (v != p && v != q) {
+                            neighbours.push_back(v);
+                        }
+                    }
+                    shared_triangles += has_q ? 1 : 0;
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+                neighbours.erase(
+                    std::unique(neighbours.begin(), neighbours.end()),
+                    neighbours.end()
+                );
+                const std::size_t p_neighbours = neighbours.size();
+                for (const auto t : triangles_of(q)) {
+                    for (std::size_t k = 0; k < 3; k++) {
+                        const auto v = current[t * 3 + k];
+                        if (v != p && v != q) {
+                            neighbours.push_back(v);
+                        }
+                    }
+                }
+                std::sort(neighbours.begin() + p_neighbours, neighbours.end());
+                neighbours.erase(
+                    std::unique(
+                        neighbours.begin() + p_neighbours, neighbours.end()
+                    ),
+                    neighbours.end()
+                );
+                std::inplace_merge(
+                    neighbours.begin(),
+                    neighbours.begin() + p_neighbours,
+                    neighbours.end()
+                );
+                const auto shared_neighbours = static_cast<std::size_t>(
+                    neighbours.end() -
+                    std::unique(neighbours.begin(), neighbours.end())
+                );
+                if (shared_neighbours > shared_triangles) {
+                    continue;
+                }
+
+                // the triangles that stay mustn't flip or collapse
+                bool flips = false;
+                for (const auto t : around) {
+                    std::array<glm::vec3, 3> before;
+                    std::array<glm::vec3, 3> after;
+                    bool has_q = false;
+                    for (std::size_t k = 0; k < 3; k++) {
+                        const auto v = current[t * 3 + k];
+                        has_q = has_q || v == q;
+                        before[k] = positions[v];
+                        after[k] = positions[v == p ? q : v];
+                    }
+                    if (has_q) {
+                        continue;
+                    }
+                    const glm::vec3 normal_before = glm::cross(
+                        before[1] - before[0], before[2] - before[0]
+                    );
+                    const glm::vec3 normal_after = glm::cross(
+                        after[1] - after[0], after[2] - after[0]
+                    );
+                    if (glm::dot(normal_before, normal_after) <=
+                        min_normal_cosine * glm::length(normal_before) *
+                            glm::length(normal_after)) {
+                        flips = true;
+                        break;
+                    }
+                }
+                if (flips) {
+                    continue;
+                }
+
+                touched[q] = true;
+                for (const auto t : around) {
+                    bool has_q = false;
+                    for (std::size_t k = 0; k < 3; k++) {
+                        touched[current[t * 3 + k]] = true;
+                        has_q = has_q || current[t * 3 + k] == q;
+                    }
+                    if (has_q) {
+                        dead[t] = true;
+                        removed++;
+                        continue;
+                    }
+                    for (std::size_t k = 0; k < 3; k++) {
+                        if (current[t * 3 + k] == p) {
+                            current[t * 3 + k] = q;
+                        }
+                    }
+                }
+                add_quadric(quadrics[q], quadrics[p]);
+                max_cost = std::max(max_cost, collapse.cost);
+            }
+
+            if (removed == 0) {
+                break;
+            }
+            std::size_t kept = 0;
+            for (std::size_t t = 0; t < triangle_count; t++) {
+                if (!dead[t]) {
+                    std::copy_n(&current[t * 3], 3, &current[kept * 3]);
+                    kept++;
+                }
+            }
+            current.resize(kept * 3);
+        }
+
+        if (current.size() / 3 > target_triangles && !snapshots.empty() &&
+            current.size() == snapshots.back().first.size()) {
+            // stuck, the rest of the targets won't be reached either
+            break;
+        }
+        snapshots.emplace_back(current, float(std::sqrt(max_cost)));
+    }
+    return snapshots;
+}
+
+std::vector<std::uint32_t> simplify_mesh(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    std::size_t target_index_count,
+    float* error
+) {
+    const std::array<std::size_t, 1> targets = {target_index_count};
+    auto snapshots = simplify(indices, positions, targets);
+    if (error != nullptr) {
+        *error = snapshots.front().second;
+    }
+    return std::move(snapshots.front().first);
+}
+
+LodChain build_lod_chain(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    const LodConfig& config
+) {
+    std::vector<std::size_t> targets;
+    std::size_t triangles = indices.size() / 3;
+    while (targets.size() + 1 < config.max_levels) {
+        triangles = static_cast<std::size_t>(triangles * config.reduction);
+        if (triangles < config.min_triangles) {
+            break;
+        }
+        targets.push_back(triangles * 3);
+    }
+    const auto snapshots = simplify(indices, positions, targets);
+
+    LodChain chain;
+    auto add_level = [&chain](
+                         std::span<const std::uint32_t> level, float error
+                     ) {
+        chain.levels.push_back(MeshLod{
+            .first_index = static_cast<std::uint32_t>(chain.indices.size()),
+            .index_count = static_cast<std::uint32_t>(level.size()),
+            .error = error,
+        });
+        chain.indices.insert(chain.indices.end(), level.begin(), level.end());
+    };
+    add_level(indices, 0.0f);
+
+    for (auto [level, error] : snapshots) {
+        // a level has to be worth its memory
+        const std::size_t previous = chain.levels.back().index_count;
+        if (level.size() > previous - previous / 8) {
+            break;
+        }
+        optimize_vertex_cache(level, positions.size());
+        add_level(level, error);
+    }
+    return chain;
+}
+
+float perspective_lod_scale(
+    float fov_y,
+    float viewport_height
+) {
+    return viewport_height / (2.0f * std::tan(fov_y / 2.0f));
+}
+
+std::size_t select_lod(
+    std::span<const MeshLod> levels,
+    float scale,
+    float distance,
+    const LodSelector& selector
+) {
+    if (levels.empty() || distance <= 0.0f) {
+        return 0;
+    }
+    const float pixels_per_unit = selector.projection_scale * scale / distance;
+    for (std::size_t level = levels.size(); level-- > 1;) {
+        if (levels[level].error * pixels_per_unit <= selector.pixel_threshold) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+}  // namespace omgl
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <omgl/mesh_optimizer.hpp>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace omgl {
+
+static void check_indices(
+    std::span<const std::uint32_t> indices,
+    std::size_t vertex_count
+) {
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error(std::format(
+            "{} indices aren't a whole number of triangles", indices.size()
+        ));
+    }
+    for (const auto index : indices) {
+        if (index >= vertex_count) {
+            throw std::runtime_error(std::format(
+                "Index {} out of range for {} vertices", index, vertex_count
+            ));
+        }
+    }
+}
+
+VertexCacheStats analyze_vertex_cache(
+    std::span<const std::uint32_t> indices,
+    std::size_t vertex_count,
+    std::size_t cache_size
+) {
+    check_indices(indices, vertex_count);
+
+    // A vertex stays in the FIFO until cache_size more vertices went in
+    // after it, so remembering when each one went in is the whole
+    // simulation. The clock starts past cache_size so nothing starts out
+    // cached.
+    std::vector<std::size_t> inserted_at(vertex_count, 0);
+    std::size_t clock = cache_size + 1;
+    std::size_t misses = 0;
+    std::size_t used_vertices = 0;
+    std::vector<bool> used(vertex_count, false);
+    for (const auto index : indices) {
+        if (clock - inserted_at[index] > cache_size) {
+            inserted_at[index] = clock++;
+            misses++;
+        }
+        if (!used[index]) {
+            used[index] = true;
+            used_vertices++;
+        }
+    }
+
+    const std::size_t triangles = indices.size() / 3;
+    return {
+        .misses = misses,
+        .acmr = triangles == 0 ? 0.0 : double(misses) / triangles,
+        .atvr = used_vertices == 0 ? 0.0 : double(misses) / used_vertices,
+    };
+}
+
+void remove_duplicate_vertices(
+    MeshData& mesh
+) {
+    const std::size_t vertex_count = mesh.vertexCount();
+    check_indices(mesh.indices, vertex_count);
+
+    // keyed on the bytes of the vertex in the old buffer, which stays
+    // untouched until the end
+    std::unordered_map<std::string_view, std::uint32_t> unique;
+    unique.reserve(vertex_count);
+    std::vector<std::uint32_t> remap(vertex_count);
+    std::vector<std::byte> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (std::size_t i = 0; i < vertex_count; i++) {
+        const auto* vertex = &mesh.vertices[i * mesh.stride];
+        const std::string_view key(
+            reinterpret_cast<const char*>(vertex), mesh.stride
+        );
+        const auto next = static_cast<std::uint32_t>(unique.size());
+        const auto [found, inserted] = unique.try_emplace(key, next);
+        remap[i] = found->second;
+        if (inserted) {
+            vertices.insert(vertices.end(), vertex, vertex + mesh.stride);
+        }
+    }
+
+    for (auto& index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+// Forsyth's scoring, with his constants
+constexpr std::size_t forsyth_cache_size = 32;
+constexpr float forsyth_last_triangle_score = 0.75f;
+constexpr float forsyth_cache_decay_power = 1.5f;
+constexpr float forsyth_valence_boost_scale = 2.0f;
+constexpr float forsyth_valence_boost_power = 0.5f;
+// valences past this all score the same
+constexpr std::size_t forsyth_max_valence = 32;
+
+struct ForsythTables {
+    std::array<float, forsyth_cache_size> cache;
+    std::array<float, forsyth_max_valence + 1> valence;
+};
+
+static const ForsythTables& forsyth_tables() {
+    static const ForsythTables tables = [] {
+        ForsythTables tables;
+        for (std::size_t i = 0; i < forsyth_cache_size; i++) {
+            // the three vertices of the last triangle score the same, a
+            // little lower than the next ones so the strips don't turn back
+            // on themselves
+            if (i < 3) {
+                tables.cache[i] = forsyth_last_triangle_score;
+            } else {
+                const float scale = 1.0f / (forsyth_cache_size - 3);
+                tables.cache[i] = std::pow(
+                    1.0f - (i - 3) * scale, forsyth_cache_decay_power
+                );
+            }
+        }
+        tables.valence[0] = 0.0f;
+        for (std::size_t i = 1; i <= forsyth_max_valence; i++) {
+            // vertices with few triangles left go first, so they don't
+            // end up as lone triangles at the end
+            tables.valence[i] =
+                forsyth_valence_boost_scale *
+                std::pow(float(i), -forsyth_valence_boost_power);
+        }
+        return tables;
+    }();
+    return tables;
+}
+
+// -1 for no longer in the cache
+static float forsyth_score(
+    int cache_position,
+    std::size_t remaining
+) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    const auto& tables = forsyth_tables();
+    const float cache =
+        cache_position < 0 ? 0.0f : tables.cache[cache_position];
+    return cache + tables.valence[std::min(remaining, forsyth_max_valence)];
+}
+
+void optimize_vertex_cache(
+    std::span<std::uint32_t> indices,
+    std::size_t vertex_count
+) {
+    check_indices(indices, vertex_count);
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // The triangles of each vertex, as ranges of one array. The first
+    // `remaining[v]` of a vertex's range are the ones not emitted yet.
+    std::vector<std::uint32_t> remaining(vertex_count, 0);
+    for (const auto index : indices) {
+        remaining[index]++;
+    }
+    std::vector<std::size_t> first_triangle(vertex_count + 1, 0);
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        first_triangle[v + 1] = first_triangle[v] + remaining[v];
+    }
+    std::vector<std::uint32_t> vertex_triangles(indices.size());
+    {
+        std::vector<std::size_t> fill(
+            first_triangle.begin(), first_triangle.end() - 1
+        );
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            vertex_triangles[fill[indices[i]]++] =
+                static_cast<std::uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<float> vertex_score(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        vertex_score[v] = forsyth_score(-1, remaining[v]);
+    }
+
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    std::size_t best = 0;
+    for (std::size_t t = 0; t < triangle_count; t++) {
+        triangle_score[t] = vertex_score[indices[t * 3]] +
+                            vertex_score[indices[t * 3 + 1]] +
+                            vertex_score[indices[t * 3 + 2]];
+        if (triangle_score[t] > triangle_score[best]) {
+            best = t;
+        }
+    }
+
+    // the simulated LRU cache, plus room for the three vertices pushed in
+    // by each triangle
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> next_cache;
+    cache.reserve(forsyth_cache_size + 3);
+    next_cache.reserve(forsyth_cache_size + 3);
+
+    std::vector<std::uint32_t> output(indices.size());
+    // where to look for a triangle when nothing in the cache has any left
+    std::size_t scan = 0;
+    for (std::size_t emitted_count = 0; emitted_count < triangle_count;
+         emitted_count++) {
+        if (best == triangle_count) {
+            while (emitted[scan]) {
+                scan++;
+            }
+            best = scan;
+        }
+
+        const std::array<std::uint32_t, 3> corners = {
+            indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]
+        };
+        std::copy(corners.begin(), corners.end(), &output[emitted_count * 3]);
+        emitted[best] = true;
+
+        // take the triangle out of its vertices' lists
+        for (const auto v : corners) {
+            auto* begin = &vertex_triangles[first_triangle[v]];
+            auto* end = begin + remaining[v];
+            auto* found =
+                std::find(begin, end, static_cast<std::uint32_t>(best));
+            std::swap(*found, *(end - 1));
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front
+        next_cache.assign(corners.begin(), corners.end());
+        for (const auto v : cache) {
+            if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                next_cache.push_back(v);
+            }
+        }
+        std::swap(cache, next_cache);
+
+        // Rescore everything that was touched, including the vertices that
+        // just fell out, and pass the change on to their triangles.
+        best = triangle_count;
+        float best_score = -1.0f;
+        for (std::size_t i = 0; i < cache.size(); i++) {
+            const auto v = cache[i];
+            const int position =
+                i < forsyth_cache_size ? static_cast<int>(i) : -1;
+            const float score = forsyth_score(position, remaining[v]);
+            const float change = score - vertex_score[v];
+            vertex_score[v] = score;
+
+            for (std::size_t j = 0; j < remaining[v]; j++) {
+                const auto t = vertex_triangles[first_triangle[v] + j];
+                triangle_score[t] += change;
+            }
+        }
+        cache.resize(std::min(cache.size(), forsyth_cache_size));
+
+        // the next triangle is the best one with a vertex in the cache
+        for (const auto v : cache) {
+            for (std::size_t j = 0; j < remaining[v]; j++) {
+                const auto t = vertex_triangles[first_triangle[v] + j];
+                if (triangle_score[t] > best_score) {
+                    best = t;
+                    best_score = triangle_score[t];
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimize_vertex_fetch(
+    MeshData& mesh
+) {
+    const std::size_t vertex_count = mesh.vertexCount();
+    check_indices(mesh.indices, vertex_count);
+
+    constexpr auto unused = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> remap(vertex_count, unused);
+    std::vector<std::byte> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    std::uint32_t next = 0;
+    for (auto& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = next++;
+            const auto* vertex = &mesh.vertices[index * mesh.stride];
+            vertices.insert(vertices.end(), vertex, vertex + mesh.stride);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+}  // namespace omgl
@@ -0,0 +1,392 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <omgl/mesh_pool.hpp>
+#include <omgl/state_cache.hpp>
+
+namespace omgl {
+
+// Makes a buffer of `bytes` and copies `copy_bytes` of `old_id` into it.
+// Goes through the copy targets so no VAO state is touched.
+static gl::GLuint make_buffer(
+    std::size_t bytes,
+    gl::GLuint old_id = 0,
+    std::size_t copy_bytes = 0
+) {
+    auto& state = StateCache::current();
+
+    gl::GLuint buffer_id;
+    gl::glGenBuffers(1, &buffer_id);
+    state.bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+    gl::glBufferData(
+        gl::GL_COPY_WRITE_BUFFER, bytes, nullptr, gl::GL_STATIC_DRAW
+    );
+
+    if (old_id != 0 && copy_bytes > 0) {
+        state.bindBuffer(gl::GL_COPY_READ_BUFFER, old_id);
+        gl::glCopyBufferSubData(
+            gl::GL_COPY_READ_BUFFER, gl::GL_COPY_WRITE_BUFFER, 0, 0, copy_bytes
+        );
+    }
+
+    // the copy targets don't affect anything else, so they stay bound
+    return buffer_id;
+}
+
+// pools can be made on more than one context's thread
+static std::atomic<std::uint64_t> next_pool_serial = 1;
+
+static void upload(
+    gl::GLuint buffer_id,
+    std::size_t offset,
+    std::span<const std::byte> data
+) {
+    StateCache::current().bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+    gl::glBufferSubData(
+        gl::GL_COPY_WRITE_BUFFER, offset, data.size(), data.data()
+    );
+}
+
+MeshPool::MeshPool(
+    std::span<const VertexAttribute> attributes,
+    std::size_t vertex_stride,
+    std::size_t initial_vertices,
+    std::size_t initial_indices
+)
+    : attributes(attributes.begin(), attributes.end()),
+      vertex_stride(vertex_stride),
+      vertex_allocator(initial_vertices),
+      index_allocator(initial_indices),
+      pool_serial(next_pool_serial++) {
+    gl::glGenVertexArrays(1, &vao_id);
+    vertex_buffer_id = make_buffer(initial_vertices * vertex_stride);
+    index_buffer_id = make_buffer(initial_indices * sizeof(std::uint32_t));
+    setupVao();
+
+    spdlog::info(
+        "MeshPool: vao={} {} vertices of {} bytes, {} indices",
+        vao_id,
+        initial_vertices,
+        vertex_stride,
+        initial_indices
+    );
+}
+
+MeshPool::~MeshPool() {
+    auto& state = StateCache::current();
+    state.forgetVertexArray(vao_id);
+    state.forgetBuffer(vertex_buffer_id);
+    state.forgetBuffer(index_buffer_id);
+
+    gl::glDeleteVertexArrays(1, &vao_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    gl::glDeleteBuffers(1, &index_buffer_id);
+}
+
+void MeshPool::setupVao() {
+    auto& state = StateCache::current();
+    state.bindVertexArray(vao_id);
+
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, vertex_buffer_id);
+    apply_vertex_attributes(attributes, vertex_stride);
+    // the element buffer binding is part of the VAO
+    state.bindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, index_buffer_id);
+
+    // so nobody else's element buffer binds end up in it
+    state.bindVertexArray(0);
+}
+
+void MeshPool::growVertexBuffer(
+    std::size_t new_capacity
+) {
+    const std::size_t old_capacity = vertex_allocator.capacity();
+    gl::GLuint new_buffer = make_buffer(
+        new_capacity * vertex_stride,
+        vertex_buffer_id,
+        old_capacity * vertex_stride
+    );
+    StateCache::current().forgetBuffer(vertex_buffer_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    vertex_buffer_id = new_buffer;
+
+    vertex_allocator.grow(new_capacity);
+    setupVao();
+
+    spdlog::debug(
+        "MeshPool vertex buffer grown {} -> {}", old_capacity, new_capacity
+    );
+}
+
+void MeshPool::growIndexBuffer(
+    std::size_t new_capacity
+) {
+    const std::size_t old_capacity = index_allocator.capacity();
+    gl::GLuint new_buffer = make_buffer(
+        new_capacity * sizeof(std::uint32_t),
+        index_buffer_id,
+        old_capacity * sizeof(std::uint32_t)
+    );
+    StateCache::current().forgetBuffer(index_buffer_id);
+    gl::glDeleteBuffers(1, &index_buffer_id);
+    index_buffer_id = new_buffer;
+
+    index_allocator.grow(new_capacity);
+    setupVao();
+
+    spdlog::debug(
+        "MeshPool index buffer grown {} -> {}", old_capacity, new_capacity
+    );
+}
+
+std::size_t MeshPool::allocateVertices(
+    std::size_t count
+) {
+    if (auto offset = vertex_allocator.allocate(count)) {
+        return *offset;
+    }
+    // doubling keeps the number of copies logarithmic
+    const std::size_t capacity = vertex_allocator.capacity();
+    growVertexBuffer(std::max(capacity * 2, capacity + count));
+    return vertex_allocator.allocate(count).value();
+}
+
+std::size_t MeshPool::allocateIndices(
+    std::size_t count
+) {
+    if (auto offset = index_allocator.allocate(count)) {
+        return *offset;
+    }
+    const std::size_t capacity = index_allocator.capacity();
+    growIndexBuffer(std::max(capacity * 2, capacity + count));
+    return index_allocator.allocate(count).value();
+}
+
+MeshHandle MeshPool::add(
+    std::span<const std::byte> vertices,
+    std::span<const std::uint32_t> indices
+) {
+    return add(vertices, indices, {});
+}
+
+MeshHandle MeshPool::add(
+    std::span<const std::byte> vertices,
+    std::span<const std::uint32_t> indices,
+    std::span<const MeshLod> lods
+) {
+    for (const auto& lod : lods) {
+        if (lod.first_index > indices.size() ||
+            indices.size() - lod.first_index < lod.index_count) {
+            throw std::runtime_error(std::format(
+                "Level of detail with indices {} to {} is past the {} indices "
+                "of the mesh",
+                lod.first_index,
+                std::size_t{lod.first_index} + lod.index_count,
+                indices.size()
+            ));
+        }
+        // drawn as GL_TRIANGLES, which drops the leftover indices silently
+        if (lod.index_count % 3 != 0) {
+            throw std::runtime_error(std::format(
+                "Level of detail with indices {} to {} isn't whole triangles",
+                lod.first_index,
+                std::size_t{lod.first_index} + lod.index_count
+            ));
+        }
+    }
+    if (vertices.size() % vertex_stride != 0) {
+        throw std::runtime_error(std::format(
+            "Vertex data of {} bytes isn't a multiple of the stride {}",
+            vertices.size(),
+            vertex_stride
+        ));
+    }
+
+    const std::size_t vertex_count = vertices.size() / vertex_stride;
+    const std::size_t first_vertex = allocateVertices(vertex_count);
+    const std::size_t first_index = allocateIndices(indices.size());
+
+    upload(vertex_buffer_id, first_vertex * vertex_stride, vertices);
+    upload(
+        index_buffer_id,
+        first_index * sizeof(std::uint32_t),
+        std::as_bytes(indices)
+    );
+
+    std::uint32_t index;
+    if (free_entries.empty()) {
+        index = static_cast<std::uint32_t>(entries.size());
+        entries.emplace_back();
+    } else {
+        index = free_entries.back();
+        free_entries.pop_back();
+    }
+
+    auto& new_entry = entries[index];
+    new_entry.first_vertex = first_vertex;
+    new_entry.vertex_count = vertex_count;
+    new_entry.first_index = first_index;
+    new_entry.index_count = indices.size();
+    new_entry.lods.assign(lods.begin(), lods.end());
+    new_entry.alive = true;
+    mesh_count++;
+
+    return MeshHandle{index, new_entry.generation};
+}
+
+const MeshPool::Entry& MeshPool::entry(
+    MeshHandle handle
+) const {
+    if (handle.index >= entries.size() || !entries[handle.index].alive ||
+        entries[handle.index].generation != handle.generation) {
+        throw std::runtime_error("Stale or invalid MeshHandle");
+    }
+    return entries[handle.index];
+}
+
+void MeshPool::remove(
+    MeshHandle handle
+) {
+    entry(handle);
+    auto& removed = entries[handle.index];
+
+    vertex_allocator.free(removed.first_vertex, removed.vertex_count);
+    index_allocator.free(removed.first_index, removed.index_count);
+
+    removed.lods.clear();
+    removed.alive = false;
+    removed.generation++;
+    free_entries.push_back(handle.index);
+    mesh_count--;
+}
+
+DrawRange MeshPool::range(
+    MeshHandle handle,
+    std::size_t lod
+) const {
+    const auto& mesh = entry(handle);
+    DrawRange draw_range{
+        .base_vertex = static_cast<gl::GLint>(mesh.first_vertex),
+        .first_index = static_cast<std::uint32_t>(mesh.first_index),
+        .index_count = static_cast<std::uint32_t>(mesh.index_count),
+    };
+    if (!mesh.lods.empty()) {
+        const auto& level = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+        draw_range.first_index += level.first_index;
+        draw_range.index_count = level.index_count;
+    }
+    return draw_range;
+}
+
+std::span<const MeshLod> MeshPool::lods(
+    MeshHandle handle
+) const {
+    return entry(handle).lods;
+}
+
+void MeshPool::bind() {
+    StateCache::current().bindVertexArray(vao_id);
+}
+
+void MeshPool::draw(
+    MeshHandle handle,
+    std::size_t lod
+) const {
+    const auto draw_range = range(handle, lod);
+    // growing unbinds the VAO, see setupVao()
+    StateCache::current().bindVertexArray(vao_id);
+    gl::glDrawElementsBaseVertex(
+        gl::GL_TRIANGLES,
+        draw_range.index_count,
+        gl::GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(
+            draw_range.first_index * sizeof(std::uint32_t)
+        ),
+        draw_range.base_vertex
+    );
+}
+
+void MeshPool::compact() {
+    const auto before = stats();
+
+    std::vector<std::uint32_t> live;
+    for (std::uint32_t i = 0; i < entries.size(); i++) {
+        if (entries[i].alive) {
+            live.push_back(i);
+        }
+    }
+
+    // keep the current order, neighbours in memory stay neighbours
+    std::sort(live.begin(), live.end(), [this](auto a, auto b) {
+        return entries[a].first_vertex < entries[b].first_vertex;
+    });
+
+    // copying into fresh buffers sidesteps overlapping copies within one
+    gl::GLuint new_vertex_buffer =
+        make_buffer(vertex_allocator.capacity() * vertex_stride);
+    gl::GLuint new_index_buffer =
+        make_buffer(index_allocator.capacity() * sizeof(std::uint32_t));
+
+    std::size_t next_vertex = 0;
+    std::size_t next_index = 0;
+
+    auto& state = StateCache::current();
+    state.bindBuffer(gl::GL_COPY_READ_BUFFER, vertex_buffer_id);
+    state.bindBuffer(gl::GL_COPY_WRITE_BUFFER, new_vertex_buffer);
+    for (auto i : live) {
+        auto& mesh = entries[i];
+        gl::glCopyBufferSubData(
+            gl::GL_COPY_READ_BUFFER,
+            gl::GL_COPY_WRITE_BUFFER,
+            mesh.first_vertex * vertex_stride,
+            next_vertex * vertex_stride,
+            mesh.vertex_count * vertex_stride
+        );
+        mesh.first_vertex = next_vertex;
+        next_vertex += mesh.vertex_count;
+    }
+
+    // index values are relative to the base vertex, so they copy as they are
+    state.bindBuffer(gl::GL_COPY_READ_BUFFER, index_buffer_id);
+    state.bindBuffer(gl::GL_COPY_WRITE_BUFFER, new_index_buffer);
+    for (auto i : live) {
+        auto& mesh = entries[i];
+        gl::glCopyBufferSubData(
+            gl::GL_COPY_READ_BUFFER,
+            gl::GL_COPY_WRITE_BUFFER,
+            mesh.first_index * sizeof(std::uint32_t),
+            next_index * sizeof(std::uint32_t),
+            mesh.index_count * sizeof(std::uint32_t)
+        );
+        mesh.first_index = next_index;
+        next_index += mesh.index_count;
+    }
+
+    state.forgetBuffer(vertex_buffer_id);
+    state.forgetBuffer(index_buffer_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    gl::glDeleteBuffers(1, &index_buffer_id);
+    vertex_buffer_id = new_vertex_buffer;
+    index_buffer_id = new_index_buffer;
+
+    vertex_allocator.reset(next_vertex);
+    index_allocator.reset(next_index);
+    setupVao();
+
+    spdlog::debug(
+        "MeshPool compacted: vertex fragmentation {:.2f} -> 0, index "
+        "fragmentation {:.2f} -> 0",
+        before.vertices.fragmentation,
+        before.indices.fragmentation
+    );
+}
+
+MeshPool::Stats MeshPool::stats() const {
+    return Stats{
+        .meshes = mesh_count,
+        .vertices = vertex_allocator.stats(),
+        .indices = index_allocator.stats(),
+    };
+}
+
+}  // namespace omgl
@@ -0,0 +1,320 @@
+#include <spdlog/spdlog.h>
+#include <format>
+#include <fstream>
+#include <omgl/context_info.hpp>
+#include <omgl/program_cache.hpp>
+#include <omgl/shaders.hpp>
+#include <vector>
+
+namespace omgl {
+
+// bump this whenever the file layout changes
+const std::uint32_t cache_file_version = 3;
+const std::uint32_t cache_file_magic = 0x42504d4f;  // "OMPB"
+
+// Followed by the driver identity and the vertex and fragment sources the
+// binary was built from, then the binary. The key is only a hash, so
+// everything it was made of is compared on load.
+struct CacheFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t binary_format;
+    std::uint32_t binary_length;
+    std::uint32_t driver_length;
+    std::uint32_t vertex_length;
+    std::uint32_t fragment_length;
+};
+
+// The cache is only an optimization, so failing to clean up is logged and
+// otherwise ignored.
+static void remove_entry(
+    const fs::path& path
+) {
+    std::error_code error;
+    fs::remove(path, error);
+    if (error) {
+        spdlog::warn("Couldn't remove {}: {}", path.string(), error.message());
+    }
+}
+
+// reads `length` bytes and compares them to `expected`
+static bool read_matches(
+    std::ifstream& file,
+    std::uint32_t length,
+    std::string_view expected
+) {
+    if (length != expected.size()) {
+        return false;
+    }
+    std::string stored(length, '\0');
+    file.read(stored.data(), length);
+    return file && stored == expected;
+}
+
+// FNV-1a, plenty for telling shader sources apart
+static std::uint64_t hash_combine(
+    std::uint64_t hash,
+    std::string_view data
+) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    // separator so ("ab", "c") and ("a", "bc") don't collide
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+ProgramCache::ProgramCache(
+    fs::path directory
+)
+    : directory(directory) {
+    this->driver = driver_identity();
+
+    gl::GLint format_count = 0;
+    gl::glGetIntegerv(gl::GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    this->binaries_supported = format_count > 0;
+
+    if (!this->binaries_supported) {
+        spdlog::warn(
+            "Driver exposes no program binary formats, program cache disabled"
+        );
+        return;
+    }
+
+    std::error_code error;
+    fs::create_directories(this->directory, error);
+    if (error) {
+        spdlog::warn(
+            "Couldn't create {}: {}", this->directory.string(), error.message()
+        );
+    }
+    spdlog::info(
+        "Program cache at {} for {}", this->directory.string(), this->driver
+    );
+}
+
+std::uint64_t ProgramCache::makeKey(
+    std::string_view vertex_source,
+    std::string_view fragment_source
+) const {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hash_combine(hash, vertex_source);
+    hash = hash_combine(hash, fragment_source);
+    hash = hash_combine(hash, driver);
+    return hash;
+}
+
+fs::path ProgramCache::entryPath(
+    std::uint64_t key
+) const {
+    return directory / std::format("{:016x}.bin", key);
+}
+
+gl::GLuint ProgramCache::tryLoad(
+    std::uint64_t key,
+    std::string_view vertex_source,
+    std::string_view fragment_source
+) {
+    const fs::path path = entryPath(key);
+    std::error_code error;
+    const auto file_size = fs::file_size(path, error);
+    if (error) {
+        return 0;
+    }
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+        return 0;
+    }
+
+    CacheFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    // the lengths come from disk, so they have to add up to the file before
+    // anything is allocated from them
+    if (!file || header.magic != cache_file_magic ||
+        header.version != cache_file_version || header.key != key ||
+        file_size != sizeof(header) + std::uint64_t{header.driver_length} +
+                         header.vertex_length + header.fragment_length +
+                         header.binary_length) {
+        spdlog::warn("Ignoring malformed program cache entry {}", path.string());
+        remove_entry(path);
+        return 0;
+    }
+
+    if (!read_matches(file, header.driver_length, driver) ||
+        !read_matches(file, header.vertex_length, vertex_source) ||
+        !read_matches(file, header.fragment_length, fragment_source)) {
+        // a hash collision, or a driver that changed under the same key;
+        // the entry gets overwritten by the build that follows
+        spdlog::warn(
+            "Program cache entry {} was built from something else",
+            path.string()
+        );
+        return 0;
+    }
+
+    std::vector<char> binary(header.binary_length);
+    file.read(binary.data(), binary.size());
+
+    if (!file) {
+        spdlog::warn("Truncated program cache entry {}", path.string());
+        remove_entry(path);
+        return 0;
+    }
+
+    gl::GLuint program_id = gl::glCreateProgram();
+    gl::glProgramBinary(
+        program_id,
+        static_cast<gl::GLenum>(header.binary_format),
+        binary.data(),
+        static_cast<gl::GLsizei>(binary.size())
+    );
+
+    int success;
+    gl::glGetProgramiv(program_id, gl::GL_LINK_STATUS, &success);
+
+    if (!success) {
+        // the driver can reject binaries at any time, eg. after an update
+        // that didn't change the version string
+        spdlog::warn("Driver rejected cached program {}", path.string());
+        gl::glDeleteProgram(program_id);
+        remove_entry(path);
+        cache_stats.rejected++;
+        return 0;
+    }
+
+    return program_id;
+}
+
+void ProgramCache::store(
+    std::uint64_t key,
+    std::string_view vertex_source,
+    std::string_view fragment_source,
+    gl::GLuint program_id
+) {
+    gl::GLint binary_length = 0;
+    gl::glGetProgramiv(program_id, gl::GL_PROGRAM_BINARY_LENGTH, &binary_length);
+
+    if (binary_length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(binary_length);
+    gl::GLenum binary_format;
+    gl::glGetProgramBinary(
+        program_id, binary_length, nullptr, &binary_format, binary.data()
+    );
+
+    CacheFileHeader header{
+        .magic = cache_file_magic,
+        .version = cache_file_version,
+        .key = key,
+        .binary_format = static_cast<std::uint32_t>(binary_format),
+        .binary_length = static_cast<std::uint32_t>(binary_length),
+        .driver_length = static_cast<std::uint32_t>(driver.size()),
+        .vertex_length = static_cast<std::uint32_t>(vertex_source.size()),
+        .fragment_length = static_cast<std::uint32_t>(fragment_source.size()),
+    };
+
+    // write next to the entry and rename, so a crash never leaves a half
+    // written binary behind
+    const fs::path path = entryPath(key);
+    fs::path tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            spdlog::warn("Couldn't write {}", tmp_path.string());
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto part :
+             {std::string_view(driver), vertex_source, fragment_source}) {
+            file.write(part.data(), part.size());
+        }
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            spdlog::warn("Couldn't write {}", tmp_path.string());
+            file.close();
+            remove_entry(tmp_path);
+            return;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tmp_path, path, error);
+    if (error) {
+        spdlog::warn("Couldn't write {}: {}", path.string(), error.message());
+        remove_entry(tmp_path);
+    }
+}
+
+gl::GLuint ProgramCache::getOrBuild(
+    std::string_view vertex_source,
+    std::string_view fragment_source
+) {
+    const std::uint64_t key = makeKey(vertex_source, fragment_source);
+
+    if (binaries_supported) {
+        gl::GLuint program_id =
+            tryLoad(key, vertex_source, fragment_source);
+        if (program_id != 0) {
+            cache_stats.hits++;
+            spdlog::debug("Program cache hit {:016x}: id={}", key, program_id);
+            return program_id;
+        }
+    }
+
+    cache_stats.misses++;
+
+    auto vertex_shader_id = compile_vertex_shader(vertex_source);
+    auto fragment_shader_id = compile_fragment_shader(fragment_source);
+
+    gl::GLuint program_id = gl::glCreateProgram();
+
+    // has to be set before linking for the binary to be retrievable
+    if (binaries_supported) {
+        gl::glProgramParameteri(
+            program_id, gl::GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1
+        );
+    }
+
+    gl::glAttachShader(program_id, vertex_shader_id);
+    gl::glAttachShader(program_id, fragment_shader_id);
+    gl::glLinkProgram(program_id);
+
+    gl::glDetachShader(program_id, vertex_shader_id);
+    gl::glDetachShader(program_id, fragment_shader_id);
+    gl::glDeleteShader(vertex_shader_id);
+    gl::glDeleteShader(fragment_shader_id);
+
+    try {
+        ensure_shader_program_linked(program_id);
+    } catch (const std::exception&) {
+        gl::glDeleteProgram(program_id);
+        throw;
+    }
+
+    if (binaries_supported) {
+        store(key, vertex_source, fragment_source, program_id);
+    }
+
+    spdlog::debug("Program cache miss {:016x}: id={}", key, program_id);
+    return program_id;
+}
+
+void ProgramCache::clear() {
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (entry.path().extension() == ".bin") {
+            remove_entry(entry.path());
+        }
+    }
+}
+
+}  // namespace omgl
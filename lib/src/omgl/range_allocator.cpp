@@ -0,0 +1,145 @@
+#include <format>
+#include <omgl/range_allocator.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+RangeAllocator::RangeAllocator(
+    std::size_t capacity
+)
+    : total(capacity) {
+    if (capacity > 0) {
+        insertFree(0, capacity);
+    }
+}
+
+void RangeAllocator::insertFree(
+    std::size_t offset,
+    std::size_t size
+) {
+    free_by_offset.emplace(offset, size);
+    free_by_size.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(
+    std::map<std::size_t, std::size_t>::iterator block
+) {
+    auto [first, last] = free_by_size.equal_range(block->second);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == block->first) {
+            free_by_size.erase(it);
+            break;
+        }
+    }
+    free_by_offset.erase(block);
+}
+
+std::optional<std::size_t> RangeAllocator::allocate(
+    std::size_t size
+) {
+    if (size == 0) {
+        return 0;
+    }
+
+    // smallest block that fits
+    auto fit = free_by_size.lower_bound(size);
+    if (fit == free_by_size.end()) {
+        return std::nullopt;
+    }
+
+    const std::size_t offset = fit->second;
+    const std::size_t block_size = fit->first;
+
+    eraseFree(free_by_offset.find(offset));
+    if (block_size > size) {
+        insertFree(offset + size, block_size - size);
+    }
+
+    used += size;
+    return offset;
+}
+
+void RangeAllocator::free(
+    std::size_t offset,
+    std::size_t size
+) {
+    if (size == 0) {
+        return;
+    }
+    if (offset + size > total) {
+        throw std::runtime_error(std::format(
+            "Freeing [{}, {}) outside of capacity {}", offset, offset + size, total
+        ));
+    }
+
+    used -= size;
+
+    // merge with the block right after
+    auto next = free_by_offset.lower_bound(offset);
+    if (next != free_by_offset.end() && next->first == offset + size) {
+        size += next->second;
+        eraseFree(next);
+    }
+
+    // and the one right before
+    auto after = free_by_offset.lower_bound(offset);
+    if (after != free_by_offset.begin()) {
+        auto previous = std::prev(after);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            eraseFree(previous);
+        }
+    }
+
+    insertFree(offset, size);
+}
+
+void RangeAllocator::grow(
+    std::size_t new_capacity
+) {
+    if (new_capacity <= total) {
+        return;
+    }
+
+    const std::size_t old_capacity = total;
+    total = new_capacity;
+
+    // pretend the new space was allocated and free it, that merges it with a
+    // free block at the end if there is one
+    used += new_capacity - old_capacity;
+    free(old_capacity, new_capacity - old_capacity);
+}
+
+void RangeAllocator::reset(
+    std::size_t used
+) {
+    free_by_offset.clear();
+    free_by_size.clear();
+    this->used = used;
+    if (used < total) {
+        insertFree(used, total - used);
+    }
+}
+
+FragmentationStats RangeAllocator::stats() const {
+    FragmentationStats stats{
+        .capacity = total,
+        .used = used,
+        .free_blocks = free_by_offset.size(),
+    };
+
+    if (!free_by_size.empty()) {
+        stats.largest_free_block = std::prev(free_by_size.end())->first;
+    }
+
+    const std::size_t free_space = total - used;
+    if (free_space > 0) {
+        stats.fragmentation =
+            1.0 - static_cast<double>(stats.largest_free_block) / free_space;
+    }
+
+    return stats;
+}
+
+}  // namespace omgl
@@ -0,0 +1,271 @@
+#include <spdlog/spdlog.h>
+#include <format>
+#include <omgl/context_info.hpp>
+#include <omgl/io.hpp>
+#include <omgl/shader_batch.hpp>
+#include <omgl/shaders.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+// which flavour of the extension we have, the enums have the same value but
+// glbinding wants the right name
+enum class ParallelCompile {
+    none,
+    khr,
+    arb,
+};
+
+// Asked of the current context every time, has_extension() keeps the list
+// per context so that's cheap.
+static ParallelCompile parallel_compile_support() {
+    if (has_extension("GL_KHR_parallel_shader_compile")) {
+        return ParallelCompile::khr;
+    }
+    if (has_extension("GL_ARB_parallel_shader_compile")) {
+        return ParallelCompile::arb;
+    }
+    return ParallelCompile::none;
+}
+
+static gl::GLenum completion_status_enum() {
+    return parallel_compile_support() == ParallelCompile::khr
+               ? gl::GL_COMPLETION_STATUS_KHR
+               : gl::GL_COMPLETION_STATUS_ARB;
+}
+
+bool program_link_done(
+    gl::GLuint program_id
+) {
+    if (parallel_compile_support() == ParallelCompile::none) {
+        return true;
+    }
+    int done;
+    gl::glGetProgramiv(program_id, completion_status_enum(), &done);
+    return done;
+}
+
+bool ShaderBatch::parallelCompileSupported() {
+    return parallel_compile_support() != ParallelCompile::none;
+}
+
+ShaderBatch::~ShaderBatch() {
+    for (const auto& stage : stages) {
+        if (stage.id != 0) {
+            gl::glDeleteShader(stage.id);
+        }
+    }
+
+    if (!finished) {
+        for (const auto& program : programs) {
+            if (program.id != 0) {
+                gl::glDeleteProgram(program.id);
+            }
+        }
+    }
+}
+
+ShaderBatch::StageHandle ShaderBatch::addStage(
+    gl::GLenum type,
+    std::string source,
+    std::optional<MappedFile> file,
+    std::string label
+) {
+    if (submitted) {
+        throw std::runtime_error("Can't add shaders to a submitted batch");
+    }
+
+    stages.push_back(Stage{
+        .type = type,
+        .source = std::move(source),
+        .file = std::move(file),
+        .label = std::move(label),
+    });
+    return StageHandle{stages.size() - 1};
+}
+
+ShaderBatch::StageHandle ShaderBatch::addVertexShader(
+    std::string source
+) {
+    return addStage(
+        gl::GL_VERTEX_SHADER, std::move(source), std::nullopt, "<source>"
+    );
+}
+
+ShaderBatch::StageHandle ShaderBatch::addVertexShader(
+    fs::path path
+) {
+    // mapped, not read, the compile in submit() reads straight from it
+    return addStage(
+        gl::GL_VERTEX_SHADER, std::string(), MappedFile(path), path.string()
+    );
+}
+
+ShaderBatch::StageHandle ShaderBatch::addFragmentShader(
+    std::string source
+) {
+    return addStage(
+        gl::GL_FRAGMENT_SHADER, std::move(source), std::nullopt, "<source>"
+    );
+}
+
+ShaderBatch::StageHandle ShaderBatch::addFragmentShader(
+    fs::path path
+) {
+    return addStage(
+        gl::GL_FRAGMENT_SHADER, std::string(), MappedFile(path), path.string()
+    );
+}
+
+void ShaderBatch::checkStage(
+    StageHandle handle,
+    gl::GLenum type
+) const {
+    const char* expected =
+        type == gl::GL_VERTEX_SHADER ? "vertex" : "fragment";
+    if (handle.index >= stages.size()) {
+        throw std::runtime_error(std::format(
+            "Stage {} isn't in the batch, it has {} stages",
+            handle.index,
+            stages.size()
+        ));
+    }
+    if (stages[handle.index].type != type) {
+        throw std::runtime_error(std::format(
+            "Stage {} ({}) isn't a {} shader",
+            handle.index,
+            stages[handle.index].label,
+            expected
+        ));
+    }
+}
+
+ShaderBatch::ProgramHandle ShaderBatch::addProgram(
+    StageHandle vertex,
+    StageHandle fragment
+) {
+    if (submitted) {
+        throw std::runtime_error("Can't add programs to a submitted batch");
+    }
+    checkStage(vertex, gl::GL_VERTEX_SHADER);
+    checkStage(fragment, gl::GL_FRAGMENT_SHADER);
+
+    programs.push_back(Program{
+        .vertex = vertex.index,
+        .fragment = fragment.index,
+    });
+    return ProgramHandle{programs.size() - 1};
+}
+
+void ShaderBatch::submit() {
+    if (submitted) {
+        return;
+    }
+    submitted = true;
+
+    // make sure the compiler threads are set up before the first compile,
+    // 0xFFFFFFFF lets the driver pick how many; it's per context, so this
+    // happens on every submit
+    const auto support = parallel_compile_support();
+    if (support == ParallelCompile::khr) {
+        gl::glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (support == ParallelCompile::arb) {
+        gl::glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+
+    for (auto& stage : stages) {
+        stage.id = start_shader_compile(
+            stage.type, stage.file ? stage.file->text() : stage.source
+        );
+        // the driver has its own copy now
+        stage.source = std::string();
+        stage.file.reset();
+    }
+
+    // linking doesn't need the compiles to be done, the driver waits for them
+    // itself (again off-thread with parallel compile)
+    for (auto& program : programs) {
+        program.id = start_program_link(
+            stages[program.vertex].id, stages[program.fragment].id
+        );
+    }
+
+    spdlog::debug(
+        "Submitted {} shaders and {} programs, parallel compile {}",
+        stages.size(),
+        programs.size(),
+        support == ParallelCompile::none ? "not supported" : "supported"
+    );
+}
+
+bool ShaderBatch::ready() const {
+    if (!submitted) {
+        return false;
+    }
+    if (!parallelCompileSupported()) {
+        return true;
+    }
+
+    const gl::GLenum status = completion_status_enum();
+
+    // programs can't complete before their stages, so checking them first
+    // rules most batches out quickly; stages that aren't in any program
+    // still need a look of their own
+    for (const auto& program : programs) {
+        int done;
+        gl::glGetProgramiv(program.id, status, &done);
+        if (!done) {
+            return false;
+        }
+    }
+
+    for (const auto& stage : stages) {
+        int done;
+        gl::glGetShaderiv(stage.id, status, &done);
+        if (!done) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ShaderBatch::finish() {
+    if (finished) {
+        return;
+    }
+    submit();
+
+    // compile errors first, they say a lot more than the link error would
+    for (const auto& stage : stages) {
+        try {
+            ensure_shader_compiled(stage.id);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(
+                std::format("{}: {}", stage.label, e.what())
+            );
+        }
+    }
+
+    for (const auto& program : programs) {
+        ensure_shader_program_linked(program.id);
+    }
+
+    for (auto& stage : stages) {
+        gl::glDeleteShader(stage.id);
+        stage.id = 0;
+    }
+
+    finished = true;
+}
+
+gl::GLuint ShaderBatch::program(
+    ProgramHandle handle
+) const {
+    if (!finished) {
+        throw std::runtime_error("ShaderBatch::finish() hasn't been called");
+    }
+    return programs[handle.index].id;
+}
+
+}  // namespace omgl
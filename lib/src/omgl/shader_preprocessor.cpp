@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <omgl/io.hpp>
+#include <omgl/shader_preprocessor.hpp>
+#include <regex>
+#include <set>
+#include <stdexcept>
+
+namespace omgl {
+
+static std::string_view trim_left(
+    std::string_view text
+) {
+    const auto start = text.find_first_not_of(" \t");
+    return start == std::string_view::npos ? std::string_view()
+                                           : text.substr(start);
+}
+
+// Calls `line_callback(line, number)` for each line, numbered from 1,
+// without the line ending.
+template <typename Callback>
+static void for_each_line(
+    std::string_view text,
+    Callback&& line_callback
+) {
+    std::size_t number = 1;
+    while (!text.empty()) {
+        const auto end = text.find('\n');
+        auto line = text.substr(0, end);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        line_callback(line, number++);
+
+        if (end == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(end + 1);
+    }
+}
+
+// "#directive rest" -> "rest" if the line is that directive
+static bool match_directive(
+    std::string_view line,
+    std::string_view directive,
+    std::string_view& rest
+) {
+    line = trim_left(line);
+    if (!line.starts_with('#')) {
+        return false;
+    }
+    line = trim_left(line.substr(1));
+    if (!line.starts_with(directive)) {
+        return false;
+    }
+    rest = line.substr(directive.size());
+    // "#includes" isn't "#include"
+    if (!rest.empty() && rest.front() != ' ' && rest.front() != '\t' &&
+        rest.front() != '"' && rest.front() != '<') {
+        return false;
+    }
+    rest = trim_left(rest);
+    return true;
+}
+
+// Whether `name` shows up in `text` as a whole identifier.
+static bool mentions(
+    std::string_view text,
+    std::string_view name
+) {
+    auto is_identifier = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    for (auto at = text.find(name); at != std::string_view::npos;
+         at = text.find(name, at + 1)) {
+        const auto end = at + name.size();
+        if ((at == 0 || !is_identifier(text[at - 1])) &&
+            (end == text.size() || !is_identifier(text[end]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string PreprocessedShader::remapLog(
+    std::string_view log
+) const {
+    // Mesa "0:12(5): error", AMD "ERROR: 0:12: error", NVIDIA "0(12) : error"
+    static const std::regex location(
+        R"(^(\s*(?:ERROR: |WARNING: )?)(\d+)([:(])(\d+)(\)?))"
+    );
+
+    std::string remapped;
+    for_each_line(log, [&](std::string_view line, std::size_t) {
+        std::match_results<std::string_view::const_iterator> match;
+        std::size_t file_index = files.size();
+
+        if (std::regex_search(line.begin(), line.end(), match, location)) {
+            const auto number = match[2].str();
+            std::from_chars(
+                number.data(), number.data() + number.size(), file_index
+            );
+        }
+
+        if (file_index >= files.size()) {
+            remapped.append(line);
+        } else {
+            remapped += std::format(
+                "{}{}:{}",
+                match[1].str(),
+                files[file_index].string(),
+                match[4].str()
+            );
+            remapped.append(match.suffix().first, match.suffix().second);
+        }
+        remapped += '\n';
+    });
+    return remapped;
+}
+
+ShaderPreprocessor::ShaderPreprocessor(
+    std::vector<fs::path> include_dirs
+)
+    : include_dirs(std::move(include_dirs)) {}
+
+void ShaderPreprocessor::clear() {
+    file_cache.clear();
+}
+
+const std::string& ShaderPreprocessor::load(
+    const fs::path& path
+) {
+    auto it = file_cache.find(path.string());
+    if (it == file_cache.end()) {
+        it = file_cache.emplace(path.string(), read_file_text(path)).first;
+    }
+    return it->second;
+}
+
+fs::path ShaderPreprocessor::resolve(
+    std::string_view name,
+    bool quoted,
+    const fs::path& including_file
+) const {
+    if (quoted) {
+        auto candidate = including_file.parent_path() / name;
+        if (fs::exists(candidate)) {
+            return fs::weakly_canonical(candidate);
+        }
+    }
+    for (const auto& directory : include_dirs) {
+        auto candidate = directory / name;
+        if (fs::exists(candidate)) {
+            return fs::weakly_canonical(candidate);
+        }
+    }
+    throw std::runtime_error(std::format(
+        "{}: can't find include \"{}\"", including_file.string(), name
+    ));
+}
+
+std::size_t ShaderPreprocessor::fileIndex(
+    Context& context,
+    const fs::path& path
+) const {
+    auto& files = context.result.files;
+    auto it = std::find(files.begin(), files.end(), path);
+    if (it != files.end()) {
+        return it - files.begin();
+    }
+    files.push_back(path);
+    return files.size() - 1;
+}
+
+void ShaderPreprocessor::lineDirective(
+    Context& context,
+    std::size_t next_line,
+    std::size_t file_index
+) {
+    context.result.source += std::format(
+        "#line {} {}\n", next_line - context.line_offset, file_index
+    );
+}
+
+void ShaderPreprocessor::processFile(
+    Context& context,
+    const fs::path& path,
+    std::size_t first_line
+) {
+    context.include_stack.push_back(path);
+    auto& source = context.result.source;
+
+    for_each_line(load(path), [&](std::string_view line, std::size_t number) {
+        if (number < first_line) {
+            return;
+        }
+
+        std::string_view rest;
+        if (match_directive(line, "pragma", rest) && rest.starts_with("once")) {
+            if (std::find(
+                    context.included_once.begin(),
+                    context.included_once.end(),
+                    path
+                ) == context.included_once.end()) {
+                context.included_once.push_back(path);
+            }
+            // an empty line keeps the numbering in step
+            source += '\n';
+            return;
+        }
+
+        if (!match_directive(line, "include", rest)) {
+            source.append(line);
+            source += '\n';
+            return;
+        }
+
+        const bool quoted = rest.starts_with('"');
+        const char terminator = quoted ? '"' : '>';
+        const auto end = rest.find(terminator, 1);
+        if ((!quoted && !rest.starts_with('<')) ||
+            end == std::string_view::npos) {
+            throw std::runtime_error(std::format(
+                "{}:{}: malformed #include", path.string(), number
+            ));
+        }
+
+        const auto included = resolve(rest.substr(1, end - 1), quoted, path);
+
+        if (std::find(
+                context.included_once.begin(),
+                context.included_once.end(),
+                included
+            ) != context.included_once.end()) {
+            source += '\n';
+            return;
+        }
+        if (std::find(
+                context.include_stack.begin(),
+                context.include_stack.end(),
+                included
+            ) != context.include_stack.end()) {
+            throw std::runtime_error(std::format(
+                "{}:{}: include cycle through {}",
+                path.string(),
+                number,
+                included.string()
+            ));
+        }
+
+        lineDirective(context, 1, fileIndex(context, included));
+        processFile(context, included, 1);
+        lineDirective(context, number + 1, fileIndex(context, path));
+    });
+
+    context.include_stack.pop_back();
+}
+
+PreprocessedShader ShaderPreprocessor::process(
+    const fs::path& path,
+    const ShaderDefines& defines
+) {
+    const auto root = fs::weakly_canonical(path);
+    const auto& text = load(root);
+
+    Context context;
+    fileIndex(context, root);
+
+    // #version has to stay on top, so find it first. Anything before it can
+    // only be comments and blank lines.
+    std::size_t version_line = 0;
+    int version = 110;
+    for_each_line(text, [&](std::string_view line, std::size_t number) {
+        std::string_view rest;
+        if (version_line == 0 && match_directive(line, "version", rest)) {
+            version_line = number;
+            std::from_chars(rest.data(), rest.data() + rest.size(), version);
+        }
+    });
+
+    // before GLSL 3.30, #line N meant the *next* line is N + 1
+    context.line_offset = version < 330 ? 1 : 0;
+
+    lineDirective(context, version_line + 1, 0);
+    processFile(context, root, version_line + 1);
+    const std::string body = std::move(context.result.source);
+
+    auto& source = context.result.source;
+    source.clear();
+    for_each_line(text, [&](std::string_view line, std::size_t number) {
+        if (number <= version_line) {
+            source.append(line);
+            source += '\n';
+        }
+    });
+
+    // the defines the shader mentions, then the ones their values mention,
+    // however deep that goes
+    std::set<std::string_view> used;
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (const auto& [name, value] : defines) {
+            if (used.contains(name)) {
+                continue;
+            }
+            bool needed = mentions(body, name);
+            for (const auto& [other, other_value] : defines) {
+                needed = needed ||
+                         (used.contains(other) && mentions(other_value, name));
+            }
+            if (needed) {
+                used.insert(name);
+                grew = true;
+            }
+        }
+    }
+    for (const auto& [name, value] : defines) {
+        if (used.contains(name)) {
+            source += std::format("#define {} {}\n", name, value);
+        }
+    }
+    source += body;
+
+    return std::move(context.result);
+}
+
+}  // namespace omgl
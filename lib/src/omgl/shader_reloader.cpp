@@ -0,0 +1,229 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <exception>
+#include <omgl/shader_batch.hpp>
+#include <omgl/shader_reloader.hpp>
+#include <set>
+
+namespace omgl {
+
+ShaderReloader::ShaderReloader(
+    std::vector<fs::path> include_dirs
+)
+    : preprocessor(std::move(include_dirs)) {}
+
+ShaderReloader::~ShaderReloader() {
+    for (auto& entry : entries) {
+        discardRebuild(*entry);
+    }
+}
+
+void ShaderReloader::watch(
+    ShaderProgram& program,
+    const fs::path& vertex_path,
+    const fs::path& fragment_path,
+    ShaderDefines defines
+) {
+    auto entry = std::make_unique<Entry>();
+    entry->program = &program;
+    entry->vertex_path = vertex_path;
+    entry->fragment_path = fragment_path;
+    entry->defines = std::move(defines);
+
+    // only for the list of files, the program is already built
+    auto vertex = preprocessor.process(vertex_path, entry->defines);
+    auto fragment = preprocessor.process(fragment_path, entry->defines);
+
+    entry->dependencies = vertex.files;
+    entry->dependencies.insert(
+        entry->dependencies.end(), fragment.files.begin(), fragment.files.end()
+    );
+    for (const auto& file : entry->dependencies) {
+        watcher.watch(file);
+    }
+
+    entries.push_back(std::move(entry));
+}
+
+bool ShaderReloader::dependsOn(
+    const Entry& entry,
+    const fs::path& file
+) {
+    return std::find(
+               entry.dependencies.begin(), entry.dependencies.end(), file
+           ) != entry.dependencies.end();
+}
+
+void ShaderReloader::discardRebuild(
+    Entry& entry
+) {
+    // deleting 0 is a no-op
+    gl::glDeleteShader(entry.vertex_id);
+    gl::glDeleteShader(entry.fragment_id);
+    gl::glDeleteProgram(entry.program_id);
+    entry.vertex_id = 0;
+    entry.fragment_id = 0;
+    entry.program_id = 0;
+}
+
+void ShaderReloader::startRebuild(
+    Entry& entry
+) {
+    // a newer save beats whatever is still compiling
+    discardRebuild(entry);
+    entry.started = Clock::now();
+
+    try {
+        entry.vertex_source =
+            preprocessor.process(entry.vertex_path, entry.defines);
+        entry.fragment_source =
+            preprocessor.process(entry.fragment_path, entry.defines);
+    } catch (const std::exception& error) {
+        // half-written files, missing includes and the like
+        spdlog::error("Shader reload failed: {}", error.what());
+        reload_stats.failures++;
+        return;
+    }
+
+    // includes may have come or gone. Watch them even if the compile
+    // fails, so fixing a broken new include reloads
+    entry.dependencies = entry.vertex_source.files;
+    entry.dependencies.insert(
+        entry.dependencies.end(),
+        entry.fragment_source.files.begin(),
+        entry.fragment_source.files.end()
+    );
+    updateWatches();
+
+    entry.vertex_id =
+        start_shader_compile(gl::GL_VERTEX_SHADER, entry.vertex_source.source);
+    entry.fragment_id = start_shader_compile(
+        gl::GL_FRAGMENT_SHADER, entry.fragment_source.source
+    );
+    // the link waits for the compiles on its own
+    entry.program_id = start_program_link(entry.vertex_id, entry.fragment_id);
+
+    spdlog::debug(
+        "Rebuilding {} + {}",
+        entry.vertex_path.string(),
+        entry.fragment_path.string()
+    );
+}
+
+bool ShaderReloader::finishRebuild(
+    Entry& entry
+) {
+    if (!program_link_done(entry.program_id)) {
+        return false;
+    }
+
+    auto compiled = [](gl::GLuint shader_id) {
+        int success;
+        gl::glGetShaderiv(shader_id, gl::GL_COMPILE_STATUS, &success);
+        return success != 0;
+    };
+
+    std::string error;
+    if (!compiled(entry.vertex_id)) {
+        error = entry.vertex_source.remapLog(shader_info_log(entry.vertex_id));
+    } else if (!compiled(entry.fragment_id)) {
+        error =
+            entry.fragment_source.remapLog(shader_info_log(entry.fragment_id));
+    } else {
+        int linked;
+        gl::glGetProgramiv(entry.program_id, gl::GL_LINK_STATUS, &linked);
+        if (!linked) {
+            error = program_info_log(entry.program_id);
+        }
+    }
+
+    if (!error.empty()) {
+        spdlog::error(
+            "Shader reload failed, keeping the old program:\n{}", error
+        );
+        reload_stats.failures++;
+        discardRebuild(entry);
+        return true;
+    }
+
+    // the program keeps what it needs from the stages
+    gl::glDeleteShader(entry.vertex_id);
+    gl::glDeleteShader(entry.fragment_id);
+    entry.vertex_id = 0;
+    entry.fragment_id = 0;
+
+    // the new program is in place even if its uniform blocks don't match
+    // the C++ side, so keep going and only report it
+    try {
+        entry.program->replace(entry.program_id);
+    } catch (const std::exception& error) {
+        spdlog::error("Shader reload: {}", error.what());
+        reload_stats.failures++;
+    }
+    entry.program_id = 0;
+    entry.vertex_source = {};
+    entry.fragment_source = {};
+
+    reload_stats.reloads++;
+    reload_stats.last_reload_ms = std::chrono::duration<double, std::milli>(
+                                      Clock::now() - entry.started
+    )
+                                      .count();
+
+    spdlog::info(
+        "Reloaded {} + {} in {:.1f} ms",
+        entry.vertex_path.string(),
+        entry.fragment_path.string(),
+        reload_stats.last_reload_ms
+    );
+    return true;
+}
+
+void ShaderReloader::updateWatches() {
+    std::set<fs::path> needed;
+    for (const auto& entry : entries) {
+        for (const auto& file : entry->dependencies) {
+            needed.insert(fs::weakly_canonical(file));
+        }
+    }
+
+    // a copy, unwatch() changes the set
+    const auto watched = watcher.watched();
+    for (const auto& file : watched) {
+        if (!needed.contains(file)) {
+            watcher.unwatch(file);
+        }
+    }
+    for (const auto& file : needed) {
+        watcher.watch(file);
+    }
+}
+
+std::size_t ShaderReloader::update() {
+    const auto changed = watcher.changes();
+    if (!changed.empty()) {
+        // the preprocessor's copies are stale now
+        preprocessor.clear();
+
+        for (auto& entry : entries) {
+            const bool affected = std::any_of(
+                changed.begin(),
+                changed.end(),
+                [&](const fs::path& file) { return dependsOn(*entry, file); }
+            );
+            if (affected) {
+                startRebuild(*entry);
+            }
+        }
+    }
+
+    const auto reloads_before = reload_stats.reloads;
+    for (auto& entry : entries) {
+        if (entry->program_id != 0) {
+            finishRebuild(*entry);
+        }
+    }
+    return reload_stats.reloads - reloads_before;
+}
+
+}  // namespace omgl
@@ -0,0 +1,127 @@
+#include <spdlog/spdlog.h>
+#include <format>
+#include <omgl/shader_variants.hpp>
+#include <omgl/state_cache.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+ShaderVariantCache::ShaderVariantCache(
+    std::vector<fs::path> include_dirs
+)
+    : preprocessor(std::move(include_dirs)) {}
+
+ShaderVariantCache::~ShaderVariantCache() {
+    // ShaderProgram leaves its GL program alone when it goes
+    auto& state = StateCache::current();
+    for (auto& [key, program] : programs) {
+        state.forgetProgram(program->id);
+        gl::glDeleteProgram(program->id);
+    }
+    for (auto& [key, stage] : stages) {
+        gl::glDeleteShader(stage.id);
+    }
+}
+
+ShaderVariantCache::Stage& ShaderVariantCache::startStage(
+    gl::GLenum type,
+    const fs::path& path,
+    const ShaderDefines& defines
+) {
+    auto request = std::tuple{type, path.string(), defines};
+
+    auto known = requests.find(request);
+    if (known != requests.end()) {
+        return stages.at(known->second);
+    }
+
+    auto shader = preprocessor.process(path, defines);
+    cache_stats.preprocessed++;
+
+    // the type is part of the key, the same text as a vertex and a fragment
+    // shader is two different stages
+    std::string key =
+        std::format("{}\n", static_cast<unsigned>(type)) + shader.source;
+
+    auto existing = stages.find(key);
+    if (existing != stages.end()) {
+        cache_stats.stages_shared++;
+        requests.emplace(std::move(request), std::move(key));
+        return existing->second;
+    }
+
+    const gl::GLuint id = start_shader_compile(type, shader.source);
+    cache_stats.stages_compiled++;
+
+    shader.source = std::string();
+    auto [inserted, _] = stages.emplace(
+        key, Stage{.id = id, .shader = std::move(shader)}
+    );
+    requests.emplace(std::move(request), std::move(key));
+
+    return inserted->second;
+}
+
+void ShaderVariantCache::checkStage(
+    Stage& stage
+) {
+    if (stage.checked) {
+        return;
+    }
+
+    int success;
+    gl::glGetShaderiv(stage.id, gl::GL_COMPILE_STATUS, &success);
+    if (!success) {
+        throw std::runtime_error(std::format(
+            "Couldn't compile {}:\n{}",
+            stage.shader.files.front().string(),
+            stage.shader.remapLog(shader_info_log(stage.id))
+        ));
+    }
+    stage.checked = true;
+}
+
+gl::GLuint ShaderVariantCache::stage(
+    gl::GLenum type,
+    const fs::path& path,
+    const ShaderDefines& defines
+) {
+    auto& compiled = startStage(type, path, defines);
+    checkStage(compiled);
+    return compiled.id;
+}
+
+ShaderProgram& ShaderVariantCache::program(
+    const fs::path& vertex_path,
+    const fs::path& fragment_path,
+    const ShaderDefines& defines
+) {
+    // start both before waiting on either, so they can compile side by side
+    auto& vertex = startStage(gl::GL_VERTEX_SHADER, vertex_path, defines);
+    auto& fragment =
+        startStage(gl::GL_FRAGMENT_SHADER, fragment_path, defines);
+
+    const auto key = std::pair{vertex.id, fragment.id};
+    auto existing = programs.find(key);
+    if (existing != programs.end()) {
+        return *existing->second;
+    }
+
+    checkStage(vertex);
+    checkStage(fragment);
+
+    auto program = std::make_unique<ShaderProgram>(vertex.id, fragment.id);
+    cache_stats.programs_linked++;
+
+    spdlog::debug(
+        "Shader variant {} + {} ({} defines): program id={}",
+        vertex_path.string(),
+        fragment_path.string(),
+        defines.size(),
+        program->id
+    );
+
+    return *programs.emplace(key, std::move(program)).first->second;
+}
+
+}  // namespace omgl
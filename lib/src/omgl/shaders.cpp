@@ -1,29 +1,58 @@
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
 #include <format>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <omgl/io.hpp>
+#include <omgl/program_cache.hpp>
 #include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/uniform_block.hpp>
 #include <stdexcept>
 
 namespace omgl {
 
-const std::size_t info_buffer_size = 512;
+std::string shader_info_log(
+    gl::GLuint shader_id
+) {
+    gl::GLint length = 0;
+    gl::glGetShaderiv(shader_id, gl::GL_INFO_LOG_LENGTH, &length);
+    if (length <= 1) {
+        return "";
+    }
+
+    std::string log(length, '\0');
+    gl::glGetShaderInfoLog(shader_id, length, nullptr, log.data());
+    // drop the terminator GL counts in
+    log.resize(length - 1);
+    return log;
+}
+
+std::string program_info_log(
+    gl::GLuint program_id
+) {
+    gl::GLint length = 0;
+    gl::glGetProgramiv(program_id, gl::GL_INFO_LOG_LENGTH, &length);
+    if (length <= 1) {
+        return "";
+    }
+
+    std::string log(length, '\0');
+    gl::glGetProgramInfoLog(program_id, length, nullptr, log.data());
+    log.resize(length - 1);
+    return log;
+}
 
 void ensure_shader_compiled(
     gl::GLuint shader_id
 ) {
     int success;
-    char info_log_buf[info_buffer_size];
-
     gl::glGetShaderiv(shader_id, gl::GL_COMPILE_STATUS, &success);
 
     if (!success) {
-        gl::glGetShaderInfoLog(
-            shader_id, info_buffer_size, nullptr, info_log_buf
-        );
         throw std::runtime_error(std::format(
-            "Couldn't compile shader: {}", std::string(info_log_buf)
+            "Couldn't compile shader: {}", shader_info_log(shader_id)
         ));
     }
 }
@@ -32,28 +61,26 @@ void ensure_shader_program_linked(
     gl::GLuint program_id
 ) {
     int success;
-    char info_log_buf[info_buffer_size];
-
     gl::glGetProgramiv(program_id, gl::GL_LINK_STATUS, &success);
 
     if (!success) {
-        gl::glGetProgramInfoLog(
-            program_id, info_buffer_size, nullptr, info_log_buf
-        );
-        throw std::runtime_error(
-            std::format("Couldn't link program: {}", std::string(info_log_buf))
-        );
+        throw std::runtime_error(std::format(
+            "Couldn't link program: {}", program_info_log(program_id)
+        ));
     }
 }
 
-gl::GLuint compile_vertex_shader(
-    std::string source
+gl::GLuint start_shader_compile(
+    gl::GLenum type,
+    std::string_view source
 ) {
-    // now we create the vertex shader
-    const gl::GLuint shader_id = gl::glCreateShader(gl::GL_VERTEX_SHADER);
+    // now we create the shader
+    const gl::GLuint shader_id = gl::glCreateShader(type);
 
     // read the shader source
-    const char* shader_source_cstr = source.c_str();
+    const char* shader_source_ptr = source.data();
+    const gl::GLint shader_source_length =
+        static_cast<gl::GLint>(source.size());
 
     // set the shader's source
     gl::glShaderSource(
@@ -63,13 +90,25 @@ gl::GLuint compile_vertex_shader(
         1,
         // the actual pointer to the source
         // probably a pointer pointer because we might specify multiple files
-        &shader_source_cstr,
-        // we don't need to specify the length, as they are null-terminated
-        nullptr
+        &shader_source_ptr,
+        // views (of mapped files, say) aren't null terminated, so the
+        // length has to be spelled out
+        &shader_source_length
     );
 
+    // this only kicks the compile off, the driver is free to finish it later
+    // (on another thread even) until someone asks for the status
     gl::glCompileShader(shader_id);
 
+    return shader_id;
+}
+
+gl::GLuint compile_vertex_shader(
+    std::string_view source
+) {
+    const gl::GLuint shader_id =
+        start_shader_compile(gl::GL_VERTEX_SHADER, source);
+
     ensure_shader_compiled(shader_id);
 
     spdlog::info("Vertex shader compiled: id={}", shader_id);
@@ -77,22 +116,25 @@ gl::GLuint compile_vertex_shader(
     return shader_id;
 }
 
+gl::GLuint compile_vertex_shader(
+    const std::string& source
+) {
+    return compile_vertex_shader(std::string_view(source));
+}
+
 gl::GLuint compile_vertex_shader(
     fs::path path
 ) {
-    const std::string shader_source = read_file_text(path);
-    return compile_vertex_shader(shader_source);
+    // the driver copies the source anyway, straight out of the mapping
+    const MappedFile file(path);
+    return compile_vertex_shader(file.text());
 }
 
 gl::GLuint compile_fragment_shader(
-    std::string source
+    std::string_view source
 ) {
-    const gl::GLuint shader_id = gl::glCreateShader(gl::GL_FRAGMENT_SHADER);
-
-    const char* shader_source_cstr = source.c_str();
-
-    gl::glShaderSource(shader_id, 1, &shader_source_cstr, nullptr);
-    gl::glCompileShader(shader_id);
+    const gl::GLuint shader_id =
+        start_shader_compile(gl::GL_FRAGMENT_SHADER, source);
 
     ensure_shader_compiled(shader_id);
     spdlog::info("Fragment shader compiled: id={}", shader_id);
@@ -100,14 +142,20 @@ gl::GLuint compile_fragment_shader(
     return shader_id;
 }
 
+gl::GLuint compile_fragment_shader(
+    const std::string& source
+) {
+    return compile_fragment_shader(std::string_view(source));
+}
+
 gl::GLuint compile_fragment_shader(
     fs::path path
 ) {
-    const std::string shader_source = read_file_text(path);
-    return compile_fragment_shader(shader_source);
+    const MappedFile file(path);
+    return compile_fragment_shader(file.text());
 }
 
-gl::GLuint make_shader_program(
+gl::GLuint start_program_link(
     gl::GLuint vertex_shader_id,
     gl::GLuint fragment_shader_id
 ) {
@@ -116,6 +164,16 @@ gl::GLuint make_shader_program(
     gl::glAttachShader(shader_program_id, fragment_shader_id);
     gl::glLinkProgram(shader_program_id);
 
+    return shader_program_id;
+}
+
+gl::GLuint make_shader_program(
+    gl::GLuint vertex_shader_id,
+    gl::GLuint fragment_shader_id
+) {
+    gl::GLuint shader_program_id =
+        start_program_link(vertex_shader_id, fragment_shader_id);
+
     omgl::ensure_shader_program_linked(shader_program_id);
 
     return shader_program_id;
@@ -138,11 +196,57 @@ gl::GLuint make_shader_program(
     return shader_program_id;
 }
 
+std::size_t uniform_type_size(
+    gl::GLenum type
+) {
+    switch (type) {
+        case gl::GL_FLOAT:
+        case gl::GL_INT:
+        case gl::GL_UNSIGNED_INT:
+        case gl::GL_BOOL:
+            return 4;
+        case gl::GL_FLOAT_VEC2:
+        case gl::GL_INT_VEC2:
+        case gl::GL_UNSIGNED_INT_VEC2:
+        case gl::GL_BOOL_VEC2:
+            return 2 * 4;
+        case gl::GL_FLOAT_VEC3:
+        case gl::GL_INT_VEC3:
+        case gl::GL_UNSIGNED_INT_VEC3:
+        case gl::GL_BOOL_VEC3:
+            return 3 * 4;
+        case gl::GL_FLOAT_VEC4:
+        case gl::GL_INT_VEC4:
+        case gl::GL_UNSIGNED_INT_VEC4:
+        case gl::GL_BOOL_VEC4:
+            return 4 * 4;
+        case gl::GL_FLOAT_MAT2:
+            return 2 * 2 * 4;
+        case gl::GL_FLOAT_MAT3:
+            return 3 * 3 * 4;
+        case gl::GL_FLOAT_MAT4:
+            return 4 * 4 * 4;
+        case gl::GL_FLOAT_MAT2x3:
+        case gl::GL_FLOAT_MAT3x2:
+            return 2 * 3 * 4;
+        case gl::GL_FLOAT_MAT2x4:
+        case gl::GL_FLOAT_MAT4x2:
+            return 2 * 4 * 4;
+        case gl::GL_FLOAT_MAT3x4:
+        case gl::GL_FLOAT_MAT4x3:
+            return 3 * 4 * 4;
+        default:
+            // samplers and images are set through glUniform1i
+            return 4;
+    }
+}
+
 ShaderProgram::ShaderProgram(
     fs::path vertex_shader_path,
     fs::path fragment_shader_path
 ) {
     this->id = make_shader_program(vertex_shader_path, fragment_shader_path);
+    reflectUniforms();
 }
 
 ShaderProgram::ShaderProgram(
@@ -150,73 +254,683 @@ ShaderProgram::ShaderProgram(
     gl::GLuint fragment_shader_id
 ) {
     this->id = make_shader_program(vertex_shader_id, fragment_shader_id);
+    reflectUniforms();
+}
+
+ShaderProgram::ShaderProgram(
+    fs::path vertex_shader_path,
+    fs::path fragment_shader_path,
+    ProgramCache& cache
+) {
+    const MappedFile vertex_file(vertex_shader_path);
+    const MappedFile fragment_file(fragment_shader_path);
+    this->id = cache.getOrBuild(vertex_file.text(), fragment_file.text());
+    reflectUniforms();
 }
 
 void ShaderProgram::use() {
-    gl::glUseProgram(this->id);
+    StateCache::current().useProgram(this->id);
 }
 
-template <>
-void ShaderProgram::setUniform<bool>(
-    const std::string& name,
-    const bool value
-) const {
-    gl::glUniform1i(getUniformLocation(name), static_cast<int>(value));
+void ShaderProgram::replace(
+    gl::GLuint program_id
+) {
+    auto& state = StateCache::current();
+    const bool was_current = state.forgetProgram(this->id);
+
+    gl::glDeleteProgram(this->id);
+    this->id = program_id;
+    if (was_current) {
+        use();
+    }
+
+    // last, it throws when the uniform blocks don't match
+    reflectUniforms();
 }
 
-template<>
-void ShaderProgram::setUniform<int>(
-    const std::string& name,
-    const int value
-) const {
-    int variable_location = gl::glGetUniformLocation(this->id, name.c_str());
+void ShaderProgram::reflectUniforms() {
+    // handles are indices into the slots, so after a reload every name
+    // that was there before keeps its index
+    auto previous_names = std::move(uniform_names);
+    auto previous_slots = std::move(uniform_slots);
+
+    uniform_names.clear();
+    uniform_lookup.clear();
+    uniform_slots.clear();
+    uniform_shadow.clear();
+
+    gl::GLint uniform_count = 0;
+    gl::GLint max_name_length = 0;
+    gl::glGetProgramiv(this->id, gl::GL_ACTIVE_UNIFORMS, &uniform_count);
+    gl::glGetProgramiv(
+        this->id, gl::GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length
+    );
+
+    std::string name_buf(std::max(max_name_length, 1), '\0');
+
+    for (gl::GLint i = 0; i < uniform_count; i++) {
+        gl::GLsizei name_length = 0;
+        gl::GLint size = 0;
+        gl::GLenum type;
+
+        gl::glGetActiveUniform(
+            this->id,
+            i,
+            static_cast<gl::GLsizei>(name_buf.size()),
+            &name_length,
+            &size,
+            &type,
+            name_buf.data()
+        );
+
+        std::string name(name_buf.data(), name_length);
+        gl::GLint location = gl::glGetUniformLocation(this->id, name.c_str());
+
+        // members of uniform blocks don't have a location
+        if (location < 0) {
+            continue;
+        }
+
+        // arrays are reported as "name[0]", we want to look them up as "name"
+        if (name.ends_with("[0]")) {
+            name.resize(name.size() - 3);
+        }
+
+        uniform_slots.push_back(UniformSlot{
+            .location = location,
+            .type = type,
+            .size = size,
+            .uploaded_bytes = 0,
+        });
+        uniform_names.push_back(std::move(name));
+    }
+
+    if (!previous_names.empty()) {
+        std::vector<std::string> names = std::move(previous_names);
+        std::vector<UniformSlot> slots(names.size());
+
+        for (std::size_t i = 0; i < names.size(); i++) {
+            // gone from the new program, keep the slot but make it a no-op
+            slots[i] = previous_slots[i];
+            slots[i].location = -1;
+            slots[i].size = 0;
+        }
+        for (std::size_t i = 0; i < uniform_names.size(); i++) {
+            auto it = std::find(names.begin(), names.end(), uniform_names[i]);
+            if (it != names.end()) {
+                slots[it - names.begin()] = uniform_slots[i];
+            } else {
+                names.push_back(std::move(uniform_names[i]));
+                slots.push_back(uniform_slots[i]);
+            }
+        }
+
+        uniform_names = std::move(names);
+        uniform_slots = std::move(slots);
+    }
+
+    for (auto& slot : uniform_slots) {
+        const std::size_t bytes = uniform_type_size(slot.type) * slot.size;
+        slot.shadow_offset = static_cast<std::uint32_t>(uniform_shadow.size());
+        slot.shadow_bytes = static_cast<std::uint32_t>(bytes);
+        uniform_shadow.resize(uniform_shadow.size() + bytes);
+    }
+
+    uniform_lookup.resize(uniform_names.size());
+    for (std::uint32_t i = 0; i < uniform_lookup.size(); i++) {
+        uniform_lookup[i] = i;
+    }
+    std::sort(
+        uniform_lookup.begin(),
+        uniform_lookup.end(),
+        [this](std::uint32_t a, std::uint32_t b) {
+            return uniform_names[a] < uniform_names[b];
+        }
+    );
+
+    spdlog::debug(
+        "Program {} has {} active uniforms", this->id, uniform_slots.size()
+    );
 
-    gl::glUniform1i(variable_location, value);
+    bindUniformBlocks();
 }
 
-template<>
-void ShaderProgram::setUniform<float>(
-    const std::string& name,
-    const float value
+void ShaderProgram::bindUniformBlocks() {
+    auto& registry = UniformBlockRegistry::current();
+
+    gl::GLint block_count = 0;
+    gl::GLint max_name_length = 0;
+    gl::glGetProgramiv(this->id, gl::GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+    gl::glGetProgramiv(
+        this->id,
+        gl::GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+        &max_name_length
+    );
+
+    std::string name_buf(std::max(max_name_length, 1), '\0');
+
+    for (gl::GLint i = 0; i < block_count; i++) {
+        const auto index = static_cast<gl::GLuint>(i);
+        gl::GLsizei name_length = 0;
+        gl::glGetActiveUniformBlockName(
+            this->id,
+            index,
+            static_cast<gl::GLsizei>(name_buf.size()),
+            &name_length,
+            name_buf.data()
+        );
+        const std::string_view name(name_buf.data(), name_length);
+
+        gl::glUniformBlockBinding(this->id, index, registry.binding(name));
+
+        gl::GLint data_size = 0;
+        gl::glGetActiveUniformBlockiv(
+            this->id, index, gl::GL_UNIFORM_BLOCK_DATA_SIZE, &data_size
+        );
+        registry.checkLinkedSize(
+            name, static_cast<std::size_t>(data_size), this->id
+        );
+    }
+}
+
+UniformHandle ShaderProgram::uniformHandle(
+    std::string_view name
 ) const {
-    int variable_location = gl::glGetUniformLocation(this->id, name.c_str());
+    auto it = std::lower_bound(
+        uniform_lookup.begin(),
+        uniform_lookup.end(),
+        name,
+        [this](std::uint32_t index, std::string_view value) {
+            return uniform_names[index] < value;
+        }
+    );
 
-    gl::glUniform1f(variable_location, value);
+    if (it == uniform_lookup.end() || uniform_names[*it] != name) {
+        return UniformHandle{};
+    }
+    return UniformHandle{*it};
 }
 
-template <>
-void ShaderProgram::setUniform<glm::vec2>(
-    const std::string& name,
-    const glm::vec2 value
+bool ShaderProgram::updateShadow(
+    UniformSlot& slot,
+    const void* data,
+    std::size_t bytes
 ) const {
-    gl::glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(value));
+    // a value that doesn't fit the reflected type can't be compared, let GL
+    // deal with it
+    if (bytes > slot.shadow_bytes) {
+        return true;
+    }
+
+    std::byte* shadow = uniform_shadow.data() + slot.shadow_offset;
+
+    if (bytes <= slot.uploaded_bytes &&
+        std::memcmp(shadow, data, bytes) == 0) {
+        elided_uploads++;
+        return false;
+    }
+
+    std::memcpy(shadow, data, bytes);
+    slot.uploaded_bytes =
+        std::max(slot.uploaded_bytes, static_cast<std::uint32_t>(bytes));
+    return true;
 }
 
+// How each C++ type maps to GLSL and which glUniform* call uploads it.
+template <typename T>
+struct UniformTraits;
+
+template <>
+struct UniformTraits<float> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const float* values
+    ) {
+        gl::glUniform1fv(location, count, values);
+    }
+};
+
+template <>
+struct UniformTraits<int> {
+    static constexpr gl::GLenum type = gl::GL_INT;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const int* values
+    ) {
+        gl::glUniform1iv(location, count, values);
+    }
+};
+
+template <>
+struct UniformTraits<unsigned> {
+    static constexpr gl::GLenum type = gl::GL_UNSIGNED_INT;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const unsigned* values
+    ) {
+        gl::glUniform1uiv(location, count, values);
+    }
+};
+
+// vectors and matrices are tightly packed, so a span of them is one array
+// of components
+template <>
+struct UniformTraits<glm::vec2> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_VEC2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::vec2* values
+    ) {
+        gl::glUniform2fv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::vec3> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_VEC3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::vec3* values
+    ) {
+        gl::glUniform3fv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::vec4> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_VEC4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::vec4* values
+    ) {
+        gl::glUniform4fv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::ivec2> {
+    static constexpr gl::GLenum type = gl::GL_INT_VEC2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::ivec2* values
+    ) {
+        gl::glUniform2iv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::ivec3> {
+    static constexpr gl::GLenum type = gl::GL_INT_VEC3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::ivec3* values
+    ) {
+        gl::glUniform3iv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::ivec4> {
+    static constexpr gl::GLenum type = gl::GL_INT_VEC4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::ivec4* values
+    ) {
+        gl::glUniform4iv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::uvec2> {
+    static constexpr gl::GLenum type = gl::GL_UNSIGNED_INT_VEC2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::uvec2* values
+    ) {
+        gl::glUniform2uiv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::uvec3> {
+    static constexpr gl::GLenum type = gl::GL_UNSIGNED_INT_VEC3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::uvec3* values
+    ) {
+        gl::glUniform3uiv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::uvec4> {
+    static constexpr gl::GLenum type = gl::GL_UNSIGNED_INT_VEC4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::uvec4* values
+    ) {
+        gl::glUniform4uiv(location, count, glm::value_ptr(*values));
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat2> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat2* values
+    ) {
+        gl::glUniformMatrix2fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat3> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat3* values
+    ) {
+        gl::glUniformMatrix3fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat4> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat4* values
+    ) {
+        gl::glUniformMatrix4fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat2x3> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT2x3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat2x3* values
+    ) {
+        gl::glUniformMatrix2x3fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat2x4> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT2x4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat2x4* values
+    ) {
+        gl::glUniformMatrix2x4fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
 template <>
-void ShaderProgram::setUniform<glm::vec3>(
-    const std::string& name,
-    const glm::vec3 value
+struct UniformTraits<glm::mat3x2> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT3x2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat3x2* values
+    ) {
+        gl::glUniformMatrix3x2fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat3x4> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT3x4;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat3x4* values
+    ) {
+        gl::glUniformMatrix3x4fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat4x2> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT4x2;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat4x2* values
+    ) {
+        gl::glUniformMatrix4x2fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat4x3> {
+    static constexpr gl::GLenum type = gl::GL_FLOAT_MAT4x3;
+    static void upload(
+        gl::GLint location,
+        gl::GLsizei count,
+        const glm::mat4x3* values
+    ) {
+        gl::glUniformMatrix4x3fv(
+            location, count, gl::GL_FALSE, glm::value_ptr(*values)
+        );
+    }
+};
+
+// bools are uploaded as ints, GL allows that for bool uniforms
+template <>
+struct UniformTraits<bool> {
+    static constexpr gl::GLenum type = gl::GL_BOOL;
+};
+
+static bool is_bool_type(
+    gl::GLenum type
+) {
+    return type == gl::GL_BOOL || type == gl::GL_BOOL_VEC2 ||
+           type == gl::GL_BOOL_VEC3 || type == gl::GL_BOOL_VEC4;
+}
+
+// components per element of the vector types, 0 for anything else
+static int vector_components(
+    gl::GLenum type
+) {
+    switch (type) {
+        case gl::GL_FLOAT:
+        case gl::GL_INT:
+        case gl::GL_UNSIGNED_INT:
+        case gl::GL_BOOL:
+            return 1;
+        case gl::GL_FLOAT_VEC2:
+        case gl::GL_INT_VEC2:
+        case gl::GL_UNSIGNED_INT_VEC2:
+        case gl::GL_BOOL_VEC2:
+            return 2;
+        case gl::GL_FLOAT_VEC3:
+        case gl::GL_INT_VEC3:
+        case gl::GL_UNSIGNED_INT_VEC3:
+        case gl::GL_BOOL_VEC3:
+            return 3;
+        case gl::GL_FLOAT_VEC4:
+        case gl::GL_INT_VEC4:
+        case gl::GL_UNSIGNED_INT_VEC4:
+        case gl::GL_BOOL_VEC4:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+// samplers, images and the like: everything uniform_type_size doesn't
+// know
+static bool is_opaque_type(
+    gl::GLenum type
+) {
+    return vector_components(type) == 0 && type != gl::GL_FLOAT_MAT2 &&
+           type != gl::GL_FLOAT_MAT3 && type != gl::GL_FLOAT_MAT4 &&
+           type != gl::GL_FLOAT_MAT2x3 && type != gl::GL_FLOAT_MAT2x4 &&
+           type != gl::GL_FLOAT_MAT3x2 && type != gl::GL_FLOAT_MAT3x4 &&
+           type != gl::GL_FLOAT_MAT4x2 && type != gl::GL_FLOAT_MAT4x3;
+}
+
+static bool uniform_accepts(
+    gl::GLenum uniform_type,
+    gl::GLenum value_type
+) {
+    if (uniform_type == value_type) {
+        return true;
+    }
+    // a bool vector takes float, int or unsigned vectors of its size
+    if (is_bool_type(uniform_type)) {
+        return vector_components(uniform_type) ==
+               vector_components(value_type);
+    }
+    // a bool goes up as glUniform1i, which an int takes as 0 or 1
+    if (uniform_type == gl::GL_INT) {
+        return value_type == gl::GL_BOOL;
+    }
+    return value_type == gl::GL_INT && is_opaque_type(uniform_type);
+}
+
+UniformSlot* ShaderProgram::checkedSlot(
+    UniformHandle handle,
+    gl::GLenum value_type,
+    std::size_t count
 ) const {
-    gl::glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(value));
+    if (!handle.valid()) {
+        return nullptr;
+    }
+    auto& slot = uniform_slots[handle.index];
+    // gone since a reload
+    if (slot.location < 0) {
+        return nullptr;
+    }
+
+    if (!uniform_accepts(slot.type, value_type)) {
+        throw std::runtime_error(std::format(
+            "Uniform {} of program {} is 0x{:x}, can't set it from 0x{:x}",
+            uniform_names[handle.index],
+            this->id,
+            static_cast<unsigned>(slot.type),
+            static_cast<unsigned>(value_type)
+        ));
+    }
+    if (count > static_cast<std::size_t>(slot.size)) {
+        throw std::runtime_error(std::format(
+            "Uniform {} of program {} has {} elements, got {}",
+            uniform_names[handle.index],
+            this->id,
+            slot.size,
+            count
+        ));
+    }
+    return &slot;
 }
 
-template <>
-void ShaderProgram::setUniform<glm::vec4>(
-    const std::string& name,
-    const glm::vec4 value
+template <typename T>
+void ShaderProgram::setUniform(
+    UniformHandle handle,
+    std::span<const T> values
 ) const {
-    gl::glUniform4fv(getUniformLocation(name), 1, glm::value_ptr(value));
+    using Traits = UniformTraits<T>;
+
+    auto* slot = checkedSlot(handle, Traits::type, values.size());
+    if (slot == nullptr || values.empty()) {
+        return;
+    }
+
+    if constexpr (std::is_same_v<T, bool>) {
+        // bools aren't 4 bytes on this side
+        std::vector<int> as_ints(values.begin(), values.end());
+        if (updateShadow(*slot, as_ints.data(), as_ints.size() * sizeof(int))) {
+            gl::glUniform1iv(
+                slot->location,
+                static_cast<gl::GLsizei>(as_ints.size()),
+                as_ints.data()
+            );
+        }
+    } else {
+        if (updateShadow(*slot, values.data(), values.size_bytes())) {
+            Traits::upload(
+                slot->location,
+                static_cast<gl::GLsizei>(values.size()),
+                values.data()
+            );
+        }
+    }
 }
 
-// Matrices? Why not!
-template <>
-void ShaderProgram::setUniform<glm::mat4>(
-    const std::string& name,
-    const glm::mat4 value
+template <typename T>
+void ShaderProgram::setUniform(
+    UniformHandle handle,
+    const T& value
 ) const {
-    gl::glUniformMatrix4fv(
-        getUniformLocation(name), 1, gl::GL_FALSE, glm::value_ptr(value)
-    );
+    setUniform<T>(handle, std::span<const T>(&value, 1));
 }
 
+#define OMGL_UNIFORM_TYPE(T)                                                   \
+    template void ShaderProgram::setUniform<T>(UniformHandle, const T&) const; \
+    template void ShaderProgram::setUniform<T>(                                \
+        UniformHandle, std::span<const T>                                      \
+    ) const;
+
+OMGL_UNIFORM_TYPE(bool)
+OMGL_UNIFORM_TYPE(int)
+OMGL_UNIFORM_TYPE(unsigned)
+OMGL_UNIFORM_TYPE(float)
+OMGL_UNIFORM_TYPE(glm::vec2)
+OMGL_UNIFORM_TYPE(glm::vec3)
+OMGL_UNIFORM_TYPE(glm::vec4)
+OMGL_UNIFORM_TYPE(glm::ivec2)
+OMGL_UNIFORM_TYPE(glm::ivec3)
+OMGL_UNIFORM_TYPE(glm::ivec4)
+OMGL_UNIFORM_TYPE(glm::uvec2)
+OMGL_UNIFORM_TYPE(glm::uvec3)
+OMGL_UNIFORM_TYPE(glm::uvec4)
+OMGL_UNIFORM_TYPE(glm::mat2)
+OMGL_UNIFORM_TYPE(glm::mat3)
+OMGL_UNIFORM_TYPE(glm::mat4)
+OMGL_UNIFORM_TYPE(glm::mat2x3)
+OMGL_UNIFORM_TYPE(glm::mat2x4)
+OMGL_UNIFORM_TYPE(glm::mat3x2)
+OMGL_UNIFORM_TYPE(glm::mat3x4)
+OMGL_UNIFORM_TYPE(glm::mat4x2)
+OMGL_UNIFORM_TYPE(glm::mat4x3)
+
+#undef OMGL_UNIFORM_TYPE
+
 }  // namespace omgl
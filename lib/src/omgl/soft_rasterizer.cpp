@@ -0,0 +1,602 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <omgl/soft_rasterizer.hpp>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace omgl {
+
+// the guard band is this many times the viewport, wide enough that clipping
+// against it is rare and narrow enough that the fixed point math fits
+const float guard_band = 2.0f;
+// triangles per assembly chunk
+const std::size_t assembly_chunk = 2048;
+
+static std::int64_t floor_div(
+    std::int64_t a,
+    std::int64_t b
+) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static std::int64_t ceil_div(
+    std::int64_t a,
+    std::int64_t b
+) {
+    return -floor_div(-a, b);
+}
+
+// RGBA8, r in the first byte on the little endian machines this runs on
+static std::uint32_t pack_color(
+    const glm::vec4& color
+) {
+    auto channel = [](float value) {
+        return static_cast<std::uint32_t>(
+            std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f
+        );
+    };
+    return channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 |
+           channel(color.w) << 24;
+}
+
+SoftRasterizer::SoftRasterizer(
+    std::size_t width,
+    std::size_t height,
+    JobSystem* jobs
+)
+    : target_width(width), target_height(height), jobs(jobs) {
+    if (width == 0 || height == 0 || width > 4096 || height > 4096) {
+        throw std::runtime_error(std::format(
+            "SoftRasterizer can't draw into {}x{}, 4096x4096 at most",
+            width,
+            height
+        ));
+    }
+
+    color_buffer.resize(width * height);
+    depth_buffer.resize(width * height);
+    tiles_x = static_cast<int>((width + tile_size - 1) / tile_size);
+    tiles_y = static_cast<int>((height + tile_size - 1) / tile_size);
+    fragment_buffers.resize(jobs != nullptr ? jobs->workerCount() + 1 : 1);
+
+    clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    spdlog::debug(
+        "SoftRasterizer: {}x{} in {}x{} tiles", width, height, tiles_x, tiles_y
+    );
+}
+
+void SoftRasterizer::clear(
+    const glm::vec4& color,
+    float depth
+) {
+    std::fill(color_buffer.begin(), color_buffer.end(), pack_color(color));
+    std::fill(depth_buffer.begin(), depth_buffer.end(), depth);
+    draw_stats = Stats{};
+}
+
+std::span<const std::uint8_t> SoftRasterizer::pixels() const {
+    return std::span(
+        reinterpret_cast<const std::uint8_t*>(color_buffer.data()),
+        color_buffer.size() * 4
+    );
+}
+
+template <typename T>
+static glm::vec4 read_attribute(
+    const std::byte* data,
+    const VertexAttribute& attribute
+) {
+    glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+    for (int i = 0; i < attribute.components; i++) {
+        T component;
+        std::memcpy(&component, data + i * sizeof(T), sizeof(T));
+        float converted = static_cast<float>(component);
+        if constexpr (std::is_integral_v<T>) {
+            if (attribute.normalized) {
+                // GL 4.2's rule for signed values, max maps to 1
+                const float max =
+                    static_cast<float>(std::numeric_limits<T>::max());
+                converted = std::max(converted / max, -1.0f);
+            }
+        }
+        value[i] = converted;
+    }
+    return value;
+}
+
+void SoftRasterizer::fetchVertex(
+    const SoftMesh& mesh,
+    std::size_t index,
+    SoftVertexInput& in
+) const {
+    in.attributes.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    const std::byte* vertex = mesh.vertices.data() + index * mesh.stride;
+    for (const auto& attribute : mesh.attributes) {
+        if (attribute.location >= soft_max_attributes ||
+            attribute.components < 1 || attribute.components > 4) {
+            throw std::runtime_error(std::format(
+                "SoftRasterizer can't read attribute {}", attribute.location
+            ));
+        }
+        if (attribute.divisor != 0) {
+            throw std::runtime_error(
+                "SoftRasterizer doesn't do instanced attributes"
+            );
+        }
+
+        const std::byte* data = vertex + attribute.offset;
+        auto& value = in.attributes[attribute.location];
+        switch (attribute.type) {
+            case gl::GL_FLOAT:
+                value = read_attribute<float>(data, attribute);
+                break;
+            case gl::GL_UNSIGNED_BYTE:
+                value = read_attribute<std::uint8_t>(data, attribute);
+                break;
+            case gl::GL_BYTE:
+                value = read_attribute<std::int8_t>(data, attribute);
+                break;
+            case gl::GL_UNSIGNED_SHORT:
+                value = read_attribute<std::uint16_t>(data, attribute);
+                break;
+            case gl::GL_SHORT:
+                value = read_attribute<std::int16_t>(data, attribute);
+                break;
+            case gl::GL_UNSIGNED_INT:
+                value = read_attribute<std::uint32_t>(data, attribute);
+                break;
+            case gl::GL_INT:
+                value = read_attribute<std::int32_t>(data, attribute);
+                break;
+            default:
+                throw std::runtime_error(std::format(
+                    "SoftRasterizer can't read the type of attribute {}",
+                    attribute.location
+                ));
+        }
+    }
+}
+
+// Signed distance of a clip space position to plane `plane`: w > 0, near,
+// far and the four sides of the guard band. Inside is >= 0.
+static float clip_distance(
+    const glm::vec4& p,
+    int plane
+) {
+    switch (plane) {
+        case 0:
+            return p.w - 1e-5f;
+        case 1:
+            return p.w + p.z;
+        case 2:
+            return p.w - p.z;
+        case 3:
+            return guard_band * p.w - p.x;
+        case 4:
+            return guard_band * p.w + p.x;
+        case 5:
+            return guard_band * p.w - p.y;
+        default:
+            return guard_band * p.w + p.y;
+    }
+}
+
+const int clip_plane_count = 7;
+
+static SoftVertex lerp_vertex(
+    const SoftVertex& a,
+    const SoftVertex& b,
+    float t,
+    std::size_t varying_count
+) {
+    SoftVertex out;
+    out.position = a.position + (b.position - a.position) * t;
+    for (std::size_t i = 0; i < varying_count; i++) {
+        out.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+    }
+    return out;
+}
+
+void SoftRasterizer::assemble(
+    std::span<const std::uint32_t> indices,
+    std::size_t varying_count
+) {
+    const std::size_t vertex_count = shaded.size();
+    const std::size_t triangle_count =
+        indices.empty() ? vertex_count / 3 : indices.size() / 3;
+    const std::size_t chunk_count =
+        (triangle_count + assembly_chunk - 1) / assembly_chunk;
+    const std::size_t tile_count = static_cast<std::size_t>(tiles_x) * tiles_y;
+
+    chunk_triangles.resize(chunk_count);
+    bins.resize(chunk_count);
+
+    std::atomic<std::size_t> culled = 0;
+    std::atomic<std::size_t> clipped = 0;
+
+    forEach(chunk_count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end; chunk++) {
+            auto& triangles = chunk_triangles[chunk];
+            auto& chunk_bins = bins[chunk];
+            triangles.clear();
+            chunk_bins.resize(tile_count);
+            for (auto& bin : chunk_bins) {
+                bin.clear();
+            }
+
+            const std::size_t first = chunk * assembly_chunk;
+            const std::size_t last =
+                std::min(first + assembly_chunk, triangle_count);
+            for (std::size_t i = first; i < last; i++) {
+                std::array<std::size_t, 3> corners = {
+                    i * 3, i * 3 + 1, i * 3 + 2
+                };
+                if (!indices.empty()) {
+                    for (auto& corner : corners) {
+                        corner = indices[corner];
+                        if (corner >= vertex_count) {
+                            throw std::runtime_error(std::format(
+                                "Index {} is past the {} vertices",
+                                corner,
+                                vertex_count
+                            ));
+                        }
+                    }
+                }
+                const SoftVertex& a = shaded[corners[0]];
+                const SoftVertex& b = shaded[corners[1]];
+                const SoftVertex& c = shaded[corners[2]];
+
+                // outside or across which planes
+                int any_outside = 0;
+                bool rejected = false;
+                for (int plane = 0; plane < clip_plane_count; plane++) {
+                    const bool out_a = clip_distance(a.position, plane) < 0;
+                    const bool out_b = clip_distance(b.position, plane) < 0;
+                    const bool out_c = clip_distance(c.position, plane) < 0;
+                    if (out_a && out_b && out_c) {
+                        rejected = true;
+                        break;
+                    }
+                    if (out_a || out_b || out_c) {
+                        any_outside |= 1 << plane;
+                    }
+                }
+
+                const std::size_t before = triangles.size();
+                if (rejected) {
+                    culled++;
+                } else if (any_outside == 0) {
+                    setupTriangle(a, b, c, varying_count, triangles);
+                } else {
+                    clipped++;
+
+                    // Sutherland-Hodgman, one plane at a time
+                    std::vector<SoftVertex> polygon = {a, b, c};
+                    std::vector<SoftVertex> next;
+                    for (int plane = 0; plane < clip_plane_count; plane++) {
+                        if ((any_outside & (1 << plane)) == 0) {
+                            continue;
+                        }
+                        next.clear();
+                        for (std::size_t v = 0; v < polygon.size(); v++) {
+                            const auto& from = polygon[v];
+                            const auto& to = polygon[(v + 1) % polygon.size()];
+                            const float d_from =
+                                clip_distance(from.position, plane);
+                            const float d_to =
+                                clip_distance(to.position, plane);
+                            if (d_from >= 0) {
+                                next.push_back(from);
+                            }
+                            if ((d_from >= 0) != (d_to >= 0)) {
+                                next.push_back(lerp_vertex(
+                                    from,
+                                    to,
+                                    d_from / (d_from - d_to),
+                                    varying_count
+                                ));
+                            }
+                        }
+                        std::swap(polygon, next);
+                        if (polygon.size() < 3) {
+                            break;
+                        }
+                    }
+                    for (std::size_t v = 2; v < polygon.size(); v++) {
+                        setupTriangle(
+                            polygon[0],
+                            polygon[v - 1],
+                            polygon[v],
+                            varying_count,
+                            triangles
+                        );
+                    }
+                }
+                if (!rejected && triangles.size() == before) {
+                    // no area or between pixel centers
+                    culled++;
+                }
+
+                for (std::size_t t = before; t < triangles.size(); t++) {
+                    const auto& triangle = triangles[t];
+                    for (int ty = triangle.min_y / tile_size;
+                         ty <= triangle.max_y / tile_size;
+                         ty++) {
+                        for (int tx = triangle.min_x / tile_size;
+                             tx <= triangle.max_x / tile_size;
+                             tx++) {
+                            chunk_bins[ty * tiles_x + tx].push_back(
+                                static_cast<std::uint32_t>(t)
+                            );
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    draw_stats.triangles += triangle_count;
+    draw_stats.culled += culled;
+    draw_stats.clipped += clipped;
+}
+
+void SoftRasterizer::setupTriangle(
+    const SoftVertex& a,
+    const SoftVertex& b,
+    const SoftVertex& c,
+    std::size_t varying_count,
+    std::vector<Triangle>& out
+) {
+    const float subpixels = static_cast<float>(1 << subpixel_bits);
+
+    Triangle triangle;
+    const SoftVertex* vertices[3] = {&a, &b, &c};
+    for (int i = 0; i < 3; i++) {
+        const auto& position = vertices[i]->position;
+        const float inverse_w = 1.0f / position.w;
+        const glm::vec3 ndc = glm::vec3(position) * inverse_w;
+
+        triangle.x[i] = static_cast<std::int32_t>(std::lround(
+            (ndc.x * 0.5f + 0.5f) * target_width * subpixels
+        ));
+        triangle.y[i] = static_cast<std::int32_t>(std::lround(
+            (ndc.y * 0.5f + 0.5f) * target_height * subpixels
+        ));
+        triangle.z[i] = std::clamp(ndc.z * 0.5f + 0.5f, 0.0f, 1.0f);
+        triangle.inverse_w[i] = inverse_w;
+        for (std::size_t v = 0; v < varying_count; v++) {
+            triangle.varyings[i][v] = vertices[i]->varyings[v] * inverse_w;
+        }
+    }
+
+    auto area = [&] {
+        return std::int64_t{triangle.x[1] - triangle.x[0]} *
+                   (triangle.y[2] - triangle.y[0]) -
+               std::int64_t{triangle.x[2] - triangle.x[0]} *
+                   (triangle.y[1] - triangle.y[0]);
+    };
+    triangle.area = area();
+    if (triangle.area == 0) {
+        return;
+    }
+    if (triangle.area < 0) {
+        // everything below wants counter-clockwise
+        std::swap(triangle.x[1], triangle.x[2]);
+        std::swap(triangle.y[1], triangle.y[2]);
+        std::swap(triangle.z[1], triangle.z[2]);
+        std::swap(triangle.inverse_w[1], triangle.inverse_w[2]);
+        std::swap(triangle.varyings[1], triangle.varyings[2]);
+        triangle.area = -triangle.area;
+    }
+
+    // the pixels whose centers can be inside
+    const std::int64_t half = 1 << (subpixel_bits - 1);
+    const std::int64_t one = 1 << subpixel_bits;
+    const auto [min_x, max_x] =
+        std::minmax({triangle.x[0], triangle.x[1], triangle.x[2]});
+    const auto [min_y, max_y] =
+        std::minmax({triangle.y[0], triangle.y[1], triangle.y[2]});
+    triangle.min_x = static_cast<int>(std::max<std::int64_t>(
+        ceil_div(min_x - half, one), 0
+    ));
+    triangle.min_y = static_cast<int>(std::max<std::int64_t>(
+        ceil_div(min_y - half, one), 0
+    ));
+    triangle.max_x = static_cast<int>(std::min<std::int64_t>(
+        floor_div(max_x - half, one), target_width - 1
+    ));
+    triangle.max_y = static_cast<int>(std::min<std::int64_t>(
+        floor_div(max_y - half, one), target_height - 1
+    ));
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+        return;
+    }
+
+    out.push_back(triangle);
+}
+
+void SoftRasterizer::rasterizeTile(
+    std::size_t tile,
+    std::vector<Fragment>& fragments
+) {
+    const int tile_x0 = static_cast<int>(tile % tiles_x) * tile_size;
+    const int tile_y0 = static_cast<int>(tile / tiles_x) * tile_size;
+    const int tile_x1 = std::min<int>(tile_x0 + tile_size, target_width) - 1;
+    const int tile_y1 = std::min<int>(tile_y0 + tile_size, target_height) - 1;
+
+    const std::int64_t one = 1 << subpixel_bits;
+    const std::int64_t half = one / 2;
+
+    for (std::size_t chunk = 0; chunk < bins.size(); chunk++) {
+        for (const std::uint32_t index : bins[chunk][tile]) {
+            const auto& triangle = chunk_triangles[chunk][index];
+
+            const int x0 = std::max(triangle.min_x, tile_x0);
+            const int x1 = std::min(triangle.max_x, tile_x1);
+            const int y0 = std::max(triangle.min_y, tile_y0);
+            const int y1 = std::min(triangle.max_y, tile_y1);
+            if (x0 > x1 || y0 > y1) {
+                continue;
+            }
+            const int span = x1 - x0 + 1;
+
+            // edge k is opposite vertex k:
+            //   E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+            // positive inside a counter-clockwise triangle
+            std::int64_t step_x[3], step_y[3], row_start[3], bias[3];
+            for (int k = 0; k < 3; k++) {
+                const int from = (k + 1) % 3;
+                const int to = (k + 2) % 3;
+                const std::int64_t dx = triangle.x[to] - triangle.x[from];
+                const std::int64_t dy = triangle.y[to] - triangle.y[from];
+                // GL's top-left rule: pixels exactly on an edge belong to
+                // the triangle on its left or top side only
+                const bool top_left = dy < 0 || (dy == 0 && dx < 0);
+                bias[k] = top_left ? 0 : -1;
+                step_x[k] = -dy * one;
+                step_y[k] = dx * one;
+                row_start[k] = dx * (y0 * one + half - triangle.y[from]) -
+                               dy * (x0 * one + half - triangle.x[from]);
+            }
+
+            const float inverse_area = 1.0f / static_cast<float>(triangle.area);
+            const float dz1 = triangle.z[1] - triangle.z[0];
+            const float dz2 = triangle.z[2] - triangle.z[0];
+
+            auto shade = [&](int x, int y, const std::int64_t* edges) {
+                const float b1 = static_cast<float>(edges[1]) * inverse_area;
+                const float b2 = static_cast<float>(edges[2]) * inverse_area;
+                const float z = triangle.z[0] + b1 * dz1 + b2 * dz2;
+                const std::uint32_t pixel =
+                    static_cast<std::uint32_t>(y * target_width + x);
+                if (z < depth_buffer[pixel]) {
+                    depth_buffer[pixel] = z;
+                    fragments.push_back(Fragment{
+                        .pixel = pixel,
+                        .chunk = static_cast<std::uint32_t>(chunk),
+                        .triangle = index,
+                        .b1 = b1,
+                        .b2 = b2,
+                    });
+                }
+            };
+
+            for (int y = y0; y <= y1; y++) {
+                const std::int64_t* start = row_start;
+                // which edges vary across the row; the others pass for
+                // every pixel of it, or fail for every one
+                bool empty = false;
+                int partial = 0;
+                for (int k = 0; k < 3; k++) {
+                    const std::int64_t first = start[k] + bias[k];
+                    const std::int64_t last = first + step_x[k] * (span - 1);
+                    if (first < 0 && last < 0) {
+                        empty = true;
+                    } else if (first < 0 || last < 0) {
+                        partial |= 1 << k;
+                    }
+                }
+
+                if (!empty) {
+                    std::int64_t edges[3];
+                    int x = 0;
+#if defined(__SSE2__)
+                    // Partial edges change sign within the row, so they
+                    // stay within the row's range of values and fit 32
+                    // bits. Full edges are zero here, which always passes.
+                    __m128i value[3], step4[3];
+                    for (int k = 0; k < 3; k++) {
+                        const bool varies = (partial & (1 << k)) != 0;
+                        const auto base = static_cast<std::int32_t>(
+                            varies ? start[k] + bias[k] : 0
+                        );
+                        const auto step = static_cast<std::int32_t>(
+                            varies ? step_x[k] : 0
+                        );
+                        value[k] = _mm_add_epi32(
+                            _mm_set1_epi32(base),
+                            _mm_set_epi32(3 * step, 2 * step, step, 0)
+                        );
+                        step4[k] = _mm_set1_epi32(4 * step);
+                    }
+                    for (; x + 4 <= span; x += 4) {
+                        const __m128i any_negative = _mm_or_si128(
+                            _mm_or_si128(value[0], value[1]), value[2]
+                        );
+                        int covered =
+                            ~_mm_movemask_ps(_mm_castsi128_ps(any_negative)) &
+                            0xf;
+                        for (; covered != 0; covered &= covered - 1) {
+                            const int lane = __builtin_ctz(covered);
+                            for (int k = 0; k < 3; k++) {
+                                edges[k] = start[k] + step_x[k] * (x + lane);
+                            }
+                            shade(x0 + x + lane, y, edges);
+                        }
+                        for (int k = 0; k < 3; k++) {
+                            value[k] = _mm_add_epi32(value[k], step4[k]);
+                        }
+                    }
+#endif
+                    for (; x < span; x++) {
+                        bool inside = true;
+                        for (int k = 0; k < 3; k++) {
+                            edges[k] = start[k] + step_x[k] * x;
+                            inside = inside && edges[k] + bias[k] >= 0;
+                        }
+                        if (inside) {
+                            shade(x0 + x, y, edges);
+                        }
+                    }
+                }
+
+                for (int k = 0; k < 3; k++) {
+                    row_start[k] += step_y[k];
+                }
+            }
+        }
+    }
+}
+
+void SoftRasterizer::interpolate(
+    const Fragment& fragment,
+    std::size_t varying_count,
+    SoftVaryings& out
+) const {
+    const auto& triangle =
+        chunk_triangles[fragment.chunk][fragment.triangle];
+
+    // screen space weights times 1/w, normalized: perspective correct
+    const float b0 = 1.0f - fragment.b1 - fragment.b2;
+    const float w0 = b0 * triangle.inverse_w[0];
+    const float w1 = fragment.b1 * triangle.inverse_w[1];
+    const float w2 = fragment.b2 * triangle.inverse_w[2];
+    const float scale = 1.0f / (w0 + w1 + w2);
+
+    for (std::size_t i = 0; i < varying_count; i++) {
+        out[i] = (b0 * triangle.varyings[0][i] +
+                  fragment.b1 * triangle.varyings[1][i] +
+                  fragment.b2 * triangle.varyings[2][i]) *
+                 scale;
+    }
+}
+
+void SoftRasterizer::writeColor(
+    std::uint32_t pixel,
+    const glm::vec4& color
+) {
+    color_buffer[pixel] = pack_color(color);
+}
+
+}  // namespace omgl
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <omgl/state_cache.hpp>
+
+namespace omgl {
+
+StateCache& StateCache::current() {
+    thread_local StateCache cache;
+    return cache;
+}
+
+bool StateCache::change(
+    bool differs
+) {
+    if (differs) {
+        frame.issued++;
+    } else {
+        frame.elided++;
+    }
+    return differs;
+}
+
+void StateCache::useProgram(
+    gl::GLuint new_program
+) {
+    if (change(program != new_program)) {
+        gl::glUseProgram(new_program);
+        program = new_program;
+    }
+}
+
+void StateCache::bindVertexArray(
+    gl::GLuint vao
+) {
+    if (!change(vertex_array != vao)) {
+        return;
+    }
+    gl::glBindVertexArray(vao);
+    vertex_array = vao;
+
+    // the new VAO brings its own element buffer
+    std::erase_if(buffers, [](const BufferBinding& binding) {
+        return binding.target == gl::GL_ELEMENT_ARRAY_BUFFER;
+    });
+}
+
+void StateCache::bindBuffer(
+    gl::GLenum target,
+    gl::GLuint buffer
+) {
+    auto it = std::find_if(
+        buffers.begin(),
+        buffers.end(),
+        [target](const BufferBinding& binding) {
+            return binding.target == target;
+        }
+    );
+
+    if (!change(it == buffers.end() || it->buffer != buffer)) {
+        return;
+    }
+    gl::glBindBuffer(target, buffer);
+
+    if (it == buffers.end()) {
+        buffers.push_back(BufferBinding{target, buffer});
+    } else {
+        it->buffer = buffer;
+    }
+}
+
+void StateCache::bindBufferRange(
+    gl::GLenum target,
+    gl::GLuint index,
+    gl::GLuint buffer,
+    gl::GLintptr offset,
+    gl::GLsizeiptr size
+) {
+    change(true);
+    gl::glBindBufferRange(target, index, buffer, offset, size);
+
+    auto it = std::find_if(
+        buffers.begin(),
+        buffers.end(),
+        [target](const BufferBinding& binding) {
+            return binding.target == target;
+        }
+    );
+    if (it == buffers.end()) {
+        buffers.push_back(BufferBinding{target, buffer});
+    } else {
+        it->buffer = buffer;
+    }
+}
+
+void StateCache::activeTexture(
+    gl::GLuint unit
+) {
+    if (change(active_unit != unit)) {
+        gl::glActiveTexture(static_cast<gl::GLenum>(
+            static_cast<gl::GLuint>(gl::GL_TEXTURE0) + unit
+        ));
+        active_unit = unit;
+    }
+}
+
+void StateCache::bindTexture(
+    gl::GLuint unit,
+    gl::GLenum target,
+    gl::GLuint texture
+) {
+    // callers editing the texture rely on the unit being active
+    activeTexture(unit);
+
+    auto it = std::find_if(
+        textures.begin(),
+        textures.end(),
+        [unit, target](const TextureBinding& binding) {
+            return binding.unit == unit && binding.target == target;
+        }
+    );
+
+    if (!change(it == textures.end() || it->texture != texture)) {
+        return;
+    }
+    gl::glBindTexture(target, texture);
+
+    if (it == textures.end()) {
+        textures.push_back(TextureBinding{unit, target, texture});
+    } else {
+        it->texture = texture;
+    }
+}
+
+void StateCache::setEnabled(
+    gl::GLenum capability,
+    bool enabled
+) {
+    auto it = std::find_if(
+        capabilities.begin(),
+        capabilities.end(),
+        [capability](const Capability& entry) {
+            return entry.capability == capability;
+        }
+    );
+
+    if (!change(it == capabilities.end() || it->enabled != enabled)) {
+        return;
+    }
+
+    if (enabled) {
+        gl::glEnable(capability);
+    } else {
+        gl::glDisable(capability);
+    }
+
+    if (it == capabilities.end()) {
+        capabilities.push_back(Capability{capability, enabled});
+    } else {
+        it->enabled = enabled;
+    }
+}
+
+void StateCache::blendFunc(
+    gl::GLenum source,
+    gl::GLenum destination
+) {
+    const auto value = std::pair{source, destination};
+    if (change(blend != value)) {
+        gl::glBlendFunc(source, destination);
+        blend = value;
+    }
+}
+
+void StateCache::depthFunc(
+    gl::GLenum function
+) {
+    if (change(depth_function != function)) {
+        gl::glDepthFunc(function);
+        depth_function = function;
+    }
+}
+
+void StateCache::depthMask(
+    bool write
+) {
+    if (change(depth_write != write)) {
+        gl::glDepthMask(write ? gl::GL_TRUE : gl::GL_FALSE);
+        depth_write = write;
+    }
+}
+
+void StateCache::viewport(
+    gl::GLint x,
+    gl::GLint y,
+    gl::GLsizei width,
+    gl::GLsizei height
+) {
+    const std::array<gl::GLint, 4> rect = {x, y, width, height};
+    if (change(viewport_rect != rect)) {
+        gl::glViewport(x, y, width, height);
+        viewport_rect = rect;
+    }
+}
+
+void StateCache::unpackAlignment(
+    gl::GLint alignment
+) {
+    if (change(unpack_alignment != alignment)) {
+        gl::glPixelStorei(gl::GL_UNPACK_ALIGNMENT, alignment);
+        unpack_alignment = alignment;
+    }
+}
+
+void StateCache::forgetBuffer(
+    gl::GLuint buffer
+) {
+    std::erase_if(buffers, [buffer](const BufferBinding& binding) {
+        return binding.buffer == buffer;
+    });
+}
+
+void StateCache::forgetVertexArray(
+    gl::GLuint vao
+) {
+    if (vertex_array == vao) {
+        vertex_array = unknown;
+        std::erase_if(buffers, [](const BufferBinding& binding) {
+            return binding.target == gl::GL_ELEMENT_ARRAY_BUFFER;
+        });
+    }
+}
+
+void StateCache::forgetTexture(
+    gl::GLuint texture
+) {
+    std::erase_if(textures, [texture](const TextureBinding& binding) {
+        return binding.texture == texture;
+    });
+}
+
+bool StateCache::forgetProgram(
+    gl::GLuint deleted
+) {
+    if (program != deleted) {
+        return false;
+    }
+    program = unknown;
+    return true;
+}
+
+void StateCache::invalidate() {
+    program = unknown;
+    vertex_array = unknown;
+    active_unit = unknown;
+    buffers.clear();
+    textures.clear();
+    capabilities.clear();
+    blend.reset();
+    depth_function.reset();
+    depth_write.reset();
+    viewport_rect.reset();
+    unpack_alignment.reset();
+    extension_names.reset();
+}
+
+const std::vector<std::string>& StateCache::extensions() {
+    if (extension_names) {
+        return *extension_names;
+    }
+
+    gl::GLint count = 0;
+    gl::glGetIntegerv(gl::GL_NUM_EXTENSIONS, &count);
+
+    std::vector<std::string> names;
+    for (gl::GLint i = 0; i < count; i++) {
+        // null without a context, or on errors
+        const auto name = gl::glGetStringi(gl::GL_EXTENSIONS, i);
+        if (name != nullptr) {
+            names.emplace_back(reinterpret_cast<const char*>(name));
+        }
+    }
+    std::sort(names.begin(), names.end());
+    extension_names = std::move(names);
+    return *extension_names;
+}
+
+void StateCache::endFrame() {
+    previous_frames.issued += frame.issued;
+    previous_frames.elided += frame.elided;
+    last_frame = frame;
+    frame = Stats{};
+}
+
+StateCache::Stats StateCache::totalStats() const {
+    return Stats{
+        .issued = previous_frames.issued + frame.issued,
+        .elided = previous_frames.elided + frame.elided,
+    };
+}
+
+}  // namespace omgl
@@ -0,0 +1,225 @@
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <format>
+#include <omgl/context_info.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <omgl/sync.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+static std::size_t align_up(
+    std::size_t value,
+    std::size_t alignment
+) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+StreamBuffer::StreamBuffer(
+    gl::GLenum target,
+    std::size_t region_size,
+    std::size_t region_count,
+    std::size_t region_alignment
+)
+    : buffer_target(target), region_count(region_count) {
+    if (region_count == 0 || region_size == 0 || region_alignment == 0) {
+        throw std::runtime_error("StreamBuffer needs a non-empty ring");
+    }
+    this->region_size = align_up(region_size, region_alignment);
+    region_fences.assign(region_count, nullptr);
+    // start on the last region so the first beginFrame() lands on 0
+    region = region_count - 1;
+
+    const std::size_t total_size = this->region_size * region_count;
+
+    auto& state = StateCache::current();
+
+    // everything goes through GL_COPY_WRITE_BUFFER rather than the target,
+    // binding a GL_ELEMENT_ARRAY_BUFFER would change the bound VAO
+    gl::glGenBuffers(1, &buffer_id);
+    state.bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+
+    persistent_mapping = gl_version_at_least(4, 4) ||
+                         has_extension("GL_ARB_buffer_storage");
+
+    if (persistent_mapping) {
+        // coherent, so writes show up without explicit flushes
+        gl::glBufferStorage(
+            gl::GL_COPY_WRITE_BUFFER,
+            total_size,
+            nullptr,
+            gl::GL_MAP_WRITE_BIT | gl::GL_MAP_PERSISTENT_BIT |
+                gl::GL_MAP_COHERENT_BIT
+        );
+        mapped = static_cast<std::byte*>(gl::glMapBufferRange(
+            gl::GL_COPY_WRITE_BUFFER,
+            0,
+            total_size,
+            gl::GL_MAP_WRITE_BIT | gl::GL_MAP_PERSISTENT_BIT |
+                gl::GL_MAP_COHERENT_BIT
+        ));
+        if (mapped == nullptr) {
+            throw std::runtime_error("Couldn't map the stream buffer");
+        }
+    } else {
+        gl::glBufferData(
+            gl::GL_COPY_WRITE_BUFFER, total_size, nullptr, gl::GL_STREAM_DRAW
+        );
+    }
+
+    spdlog::info(
+        "StreamBuffer: id={} {} x {} bytes, {}",
+        buffer_id,
+        region_count,
+        this->region_size,
+        persistent_mapping ? "persistent" : "orphaning"
+    );
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (auto& fence : region_fences) {
+        delete_fence(fence);
+    }
+
+    auto& state = StateCache::current();
+    if (mapped != nullptr) {
+        state.bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+        gl::glUnmapBuffer(gl::GL_COPY_WRITE_BUFFER);
+    }
+    state.forgetBuffer(buffer_id);
+    gl::glDeleteBuffers(1, &buffer_id);
+}
+
+void StreamBuffer::beginFrame() {
+    if (in_frame) {
+        throw std::runtime_error("StreamBuffer::beginFrame() called twice");
+    }
+    in_frame = true;
+
+    region = (region + 1) % region_count;
+    region_used = 0;
+    stream_stats.frames++;
+
+    if (persistent_mapping) {
+        auto& fence = region_fences[region];
+        if (!fence_signaled(fence)) {
+            auto start = std::chrono::steady_clock::now();
+            wait_fence(fence);
+            auto waited = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start
+            );
+            stream_stats.waits++;
+            stream_stats.wait_ms += waited.count();
+        }
+        delete_fence(fence);
+        return;
+    }
+
+    StateCache::current().bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+
+    if (region == 0) {
+        // hand the old storage to the driver, it keeps it alive until the GPU
+        // is done with it and gives us fresh memory
+        gl::glBufferData(
+            gl::GL_COPY_WRITE_BUFFER,
+            region_size * region_count,
+            nullptr,
+            gl::GL_STREAM_DRAW
+        );
+    }
+
+    mapRest();
+}
+
+void StreamBuffer::mapRest() {
+    mapped_from = region_used;
+    // a 0 byte map is an error, and there is nothing left to write anyway
+    if (region_used == region_size) {
+        return;
+    }
+
+    // nothing has been drawn from the unused part of this region of the new
+    // storage yet, so there is nothing to synchronize with
+    mapped = static_cast<std::byte*>(gl::glMapBufferRange(
+        gl::GL_COPY_WRITE_BUFFER,
+        region * region_size + mapped_from,
+        region_size - mapped_from,
+        gl::GL_MAP_WRITE_BIT | gl::GL_MAP_INVALIDATE_RANGE_BIT |
+            gl::GL_MAP_UNSYNCHRONIZED_BIT
+    ));
+
+    if (mapped == nullptr) {
+        throw std::runtime_error("Couldn't map the stream buffer region");
+    }
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(
+    std::size_t bytes,
+    std::size_t alignment
+) {
+    if (!in_frame) {
+        throw std::runtime_error(
+            "StreamBuffer::allocate() outside beginFrame()/endFrame()"
+        );
+    }
+
+    if (alignment == 0) {
+        throw std::runtime_error("StreamBuffer::allocate() with alignment 0");
+    }
+
+    // aligned as an offset into the whole buffer, which is what GL checks
+    const std::size_t region_start = region * region_size;
+    const std::size_t aligned =
+        align_up(region_start + region_used, alignment) - region_start;
+
+    if (aligned + bytes > region_size) {
+        throw std::runtime_error(std::format(
+            "StreamBuffer region overflow: {} + {} > {}",
+            aligned,
+            bytes,
+            region_size
+        ));
+    }
+
+    if (persistent_mapping) {
+        region_used = aligned + bytes;
+        return Allocation{
+            .offset = region_start + aligned,
+            .data = mapped + region_start + aligned,
+        };
+    }
+
+    // the fallback maps what's left of the region, again after a commit()
+    if (mapped == nullptr) {
+        StateCache::current().bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+        mapRest();
+    }
+    region_used = aligned + bytes;
+    return Allocation{
+        .offset = region_start + aligned,
+        // unmapped when a 0 byte allocation lands on a full region
+        .data = mapped != nullptr ? mapped + (aligned - mapped_from) : nullptr,
+    };
+}
+
+void StreamBuffer::commit() {
+    if (persistent_mapping || mapped == nullptr) {
+        return;
+    }
+
+    StateCache::current().bindBuffer(gl::GL_COPY_WRITE_BUFFER, buffer_id);
+    gl::glUnmapBuffer(gl::GL_COPY_WRITE_BUFFER);
+    mapped = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    commit();
+
+    if (persistent_mapping) {
+        region_fences[region] = insert_fence();
+    }
+    in_frame = false;
+}
+
+}  // namespace omgl
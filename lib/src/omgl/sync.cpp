@@ -0,0 +1,58 @@
+#include <omgl/sync.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+// a second is a long time for a fence, but llvmpipe can take a while on big
+// frames and we just loop anyway
+const gl::GLuint64 fence_wait_timeout_ns = 1'000'000'000;
+
+gl::GLsync insert_fence() {
+    return gl::glFenceSync(gl::GL_SYNC_GPU_COMMANDS_COMPLETE, gl::GL_NONE_BIT);
+}
+
+bool fence_signaled(
+    gl::GLsync fence
+) {
+    if (fence == nullptr) {
+        return true;
+    }
+
+    auto result =
+        gl::glClientWaitSync(fence, gl::GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return result == gl::GL_ALREADY_SIGNALED ||
+           result == gl::GL_CONDITION_SATISFIED;
+}
+
+void wait_fence(
+    gl::GLsync fence
+) {
+    if (fence == nullptr) {
+        return;
+    }
+
+    while (true) {
+        auto result = gl::glClientWaitSync(
+            fence, gl::GL_SYNC_FLUSH_COMMANDS_BIT, fence_wait_timeout_ns
+        );
+
+        if (result == gl::GL_ALREADY_SIGNALED ||
+            result == gl::GL_CONDITION_SATISFIED) {
+            return;
+        }
+        if (result == gl::GL_WAIT_FAILED) {
+            throw std::runtime_error("glClientWaitSync failed");
+        }
+    }
+}
+
+void delete_fence(
+    gl::GLsync& fence
+) {
+    if (fence != nullptr) {
+        gl::glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+}  // namespace omgl
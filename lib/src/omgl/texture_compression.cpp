@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <omgl/texture_compression.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+using Color = std::array<int, 3>;
+
+static std::uint16_t to_565(
+    const Color& color
+) {
+    const int r = (color[0] * 31 + 127) / 255;
+    const int g = (color[1] * 63 + 127) / 255;
+    const int b = (color[2] * 31 + 127) / 255;
+    return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+}
+
+// what the GPU expands it back to
+static Color from_565(
+    std::uint16_t packed
+) {
+    const int r = packed >> 11 & 31;
+    const int g = packed >> 5 & 63;
+    const int b = packed & 31;
+    return {r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2};
+}
+
+// One 4x4 block, texels row by row, rows in memory order.
+static void compress_block(
+    const std::array<Color, 16>& texels,
+    std::byte* out
+) {
+    Color low = texels[0];
+    Color high = texels[0];
+    Color mean = {0, 0, 0};
+    for (const auto& texel : texels) {
+        for (int c = 0; c < 3; c++) {
+            low[c] = std::min(low[c], texel[c]);
+            high[c] = std::max(high[c], texel[c]);
+            mean[c] += texel[c];
+        }
+    }
+
+    // The box's main diagonal runs from low to high in every channel. When
+    // red or blue fall while green rises the colors lie along another one.
+    int red_green = 0;
+    int blue_green = 0;
+    for (const auto& texel : texels) {
+        const int green = texel[1] * 16 - mean[1];
+        red_green += (texel[0] * 16 - mean[0]) * green;
+        blue_green += (texel[2] * 16 - mean[2]) * green;
+    }
+    if (red_green < 0) {
+        std::swap(low[0], high[0]);
+    }
+    if (blue_green < 0) {
+        std::swap(low[2], high[2]);
+    }
+
+    // the extremes are outliers more often than not, pull them in by a
+    // sixteenth of the range
+    for (int c = 0; c < 3; c++) {
+        const int inset = (high[c] - low[c]) / 16;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+
+    std::uint16_t color0 = to_565(high);
+    std::uint16_t color1 = to_565(low);
+    // color0 > color1 picks the four color mode, equal ones are one color
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    std::uint32_t indices = 0;
+    if (color0 != color1) {
+        const Color end0 = from_565(color0);
+        const Color end1 = from_565(color1);
+        std::array<Color, 4> palette = {end0, end1, Color{}, Color{}};
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * end0[c] + end1[c]) / 3;
+            palette[3][c] = (end0[c] + 2 * end1[c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int best_distance = 0;
+            for (int p = 0; p < 4; p++) {
+                int distance = 0;
+                for (int c = 0; c < 3; c++) {
+                    const int d = texels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (p == 0 || distance < best_distance) {
+                    best = p;
+                    best_distance = distance;
+                }
+            }
+            indices |= static_cast<std::uint32_t>(best) << (i * 2);
+        }
+    }
+
+    std::memcpy(out, &color0, 2);
+    std::memcpy(out + 2, &color1, 2);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+TextureImage compress_bc1(
+    const TextureImage& image
+) {
+    if (image.compressed() || image.format != gl::GL_RGBA ||
+        image.type != gl::GL_UNSIGNED_BYTE) {
+        throw std::runtime_error("compress_bc1 needs an RGBA8 image");
+    }
+
+    TextureImage compressed;
+    compressed.internal_format = gl::GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    compressed.block_size = 4;
+    compressed.bytes_per_block = 8;
+
+    for (const auto& level : image.levels) {
+        const auto pixels = level.data();
+        const std::size_t blocks_x = (level.width + 3) / 4;
+        const std::size_t blocks_y = (level.height + 3) / 4;
+
+        auto& out = compressed.levels.emplace_back();
+        out.width = level.width;
+        out.height = level.height;
+        out.pixels.resize(blocks_x * blocks_y * 8);
+
+        std::array<Color, 16> texels;
+        for (std::size_t by = 0; by < blocks_y; by++) {
+            for (std::size_t bx = 0; bx < blocks_x; bx++) {
+                for (std::size_t i = 0; i < 16; i++) {
+                    // blocks hanging over the edge repeat the last texel
+                    const std::size_t x =
+                        std::min(bx * 4 + i % 4, level.width - 1);
+                    const std::size_t y =
+                        std::min(by * 4 + i / 4, level.height - 1);
+                    const auto* texel = &pixels[(y * level.width + x) * 4];
+                    for (int c = 0; c < 3; c++) {
+                        texels[i][c] = std::to_integer<int>(texel[c]);
+                    }
+                }
+                compress_block(texels, &out.pixels[(by * blocks_x + bx) * 8]);
+            }
+        }
+    }
+    return compressed;
+}
+
+}  // namespace omgl
@@ -0,0 +1,239 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <omgl/texture_file.hpp>
+#include <stdexcept>
+#include "container_file.hpp"
+
+namespace omgl {
+
+// bytes one level takes in the layout GL uploads it in
+static std::size_t level_size(
+    std::size_t width,
+    std::size_t height,
+    std::size_t block_size,
+    std::size_t bytes_per_block
+) {
+    const std::size_t blocks_x = (width + block_size - 1) / block_size;
+    const std::size_t blocks_y = (height + block_size - 1) / block_size;
+    return blocks_x * blocks_y * bytes_per_block;
+}
+
+TextureFile::TextureFile(
+    const fs::path& path
+)
+    : file(path) {
+    const auto bytes = file.bytes();
+    const InvalidFile fail{path, "texture"};
+
+    if (bytes.size() < sizeof(TextureFileHeader)) {
+        throw fail("too short for the header");
+    }
+    std::memcpy(&file_header, bytes.data(), sizeof(TextureFileHeader));
+    if (file_header.magic != texture_file_magic) {
+        throw fail("wrong magic");
+    }
+    if (file_header.version != texture_file_version) {
+        throw fail(std::format("version {}", file_header.version));
+    }
+    if (file_header.level_count == 0 || file_header.layer_count == 0 ||
+        file_header.block_size == 0 || file_header.bytes_per_block == 0) {
+        throw fail("empty");
+    }
+
+    const std::size_t count =
+        std::size_t{file_header.level_count} * file_header.layer_count;
+    if ((bytes.size() - sizeof(TextureFileHeader)) / sizeof(TextureFileLevel) <
+        count) {
+        throw fail("too short for the index");
+    }
+    index.resize(count);
+    std::memcpy(
+        index.data(),
+        bytes.data() + sizeof(TextureFileHeader),
+        count * sizeof(TextureFileLevel)
+    );
+
+    for (std::size_t i = 0; i < count; i++) {
+        const auto& entry = index[i];
+        const std::size_t level = i / file_header.layer_count;
+        const std::size_t width =
+            std::max<std::size_t>(file_header.width >> level, 1);
+        const std::size_t height =
+            std::max<std::size_t>(file_header.height >> level, 1);
+        if (entry.level != level ||
+            entry.layer != i % file_header.layer_count ||
+            entry.width != width || entry.height != height ||
+            entry.size != level_size(
+                              width,
+                              height,
+                              file_header.block_size,
+                              file_header.bytes_per_block
+                          )) {
+            throw fail(std::format("index entry {} doesn't add up", i));
+        }
+        if (entry.offset > bytes.size() ||
+            bytes.size() - entry.offset < entry.size) {
+            throw fail(std::format("level {} is past the end", level));
+        }
+    }
+
+    file.adviseSequential();
+}
+
+std::span<const std::byte> TextureFile::data(
+    std::size_t level,
+    std::size_t layer
+) const {
+    if (level >= file_header.level_count || layer >= file_header.layer_count) {
+        throw std::runtime_error(std::format(
+            "No level {} of layer {} in a texture file with {} levels of {} "
+            "layers",
+            level,
+            layer,
+            file_header.level_count,
+            file_header.layer_count
+        ));
+    }
+    const auto& entry = index[level * file_header.layer_count + layer];
+    return file.bytes().subspan(entry.offset, entry.size);
+}
+
+TextureImage read_texture_file(
+    const fs::path& path,
+    std::size_t layer
+) {
+    auto file = std::make_shared<TextureFile>(path);
+    const auto& header = file->header();
+
+    TextureImage image;
+    image.internal_format = static_cast<gl::GLenum>(header.internal_format);
+    image.format = static_cast<gl::GLenum>(header.format);
+    image.type = static_cast<gl::GLenum>(header.type);
+    image.block_size = header.block_size;
+    image.bytes_per_block = header.bytes_per_block;
+
+    for (std::size_t level = 0; level < header.level_count; level++) {
+        auto& mip = image.levels.emplace_back();
+        mip.width = std::max<std::size_t>(header.width >> level, 1);
+        mip.height = std::max<std::size_t>(header.height >> level, 1);
+        mip.mapped = file->data(level, layer);
+    }
+    image.source = std::move(file);
+    return image;
+}
+
+void write_texture_file(
+    const fs::path& path,
+    std::span<const TextureImage> layers
+) {
+    if (layers.empty() || layers.front().levels.empty()) {
+        throw std::runtime_error("Nothing to write to a texture file");
+    }
+    const auto& first = layers.front();
+
+    TextureFileHeader header{
+        .magic = texture_file_magic,
+        .version = texture_file_version,
+        .internal_format = static_cast<std::uint32_t>(first.internal_format),
+        .format = static_cast<std::uint32_t>(
+            first.compressed() ? gl::GLenum{} : first.format
+        ),
+        .type = static_cast<std::uint32_t>(
+            first.compressed() ? gl::GLenum{} : first.type
+        ),
+        .block_size = static_cast<std::uint32_t>(first.block_size),
+        .bytes_per_block = static_cast<std::uint32_t>(first.bytes_per_block),
+        .width = static_cast<std::uint32_t>(first.levels.front().width),
+        .height = static_cast<std::uint32_t>(first.levels.front().height),
+        .level_count = static_cast<std::uint32_t>(first.levels.size()),
+        .layer_count = static_cast<std::uint32_t>(layers.size()),
+        .reserved = 0,
+    };
+
+    // level-major
+    std::vector<TextureFileLevel> index;
+    std::vector<std::span<const std::byte>> data;
+    std::size_t offset = align_16(
+        sizeof(TextureFileHeader) +
+        header.level_count * header.layer_count * sizeof(TextureFileLevel)
+    );
+    for (std::size_t level = 0; level < header.level_count; level++) {
+        const std::size_t width =
+            std::max<std::size_t>(header.width >> level, 1);
+        const std::size_t height =
+            std::max<std::size_t>(header.height >> level, 1);
+        const std::size_t size = level_size(
+            width, height, header.block_size, header.bytes_per_block
+        );
+
+        for (std::size_t layer = 0; layer < layers.size(); layer++) {
+            const auto& image = layers[layer];
+            if (image.internal_format != first.internal_format ||
+                image.block_size != first.block_size ||
+                image.bytes_per_block != first.bytes_per_block ||
+                image.levels.size() != first.levels.size()) {
+                throw std::runtime_error(std::format(
+                    "Layer {} doesn't match the first one", layer
+                ));
+            }
+            const auto& mip = image.levels[level];
+            if (mip.width != width || mip.height != height ||
+                mip.data().size() != size) {
+                throw std::runtime_error(std::format(
+                    "Level {} of layer {} is {}x{} in {} bytes, expected "
+                    "{}x{} in {}",
+                    level,
+                    layer,
+                    mip.width,
+                    mip.height,
+                    mip.data().size(),
+                    width,
+                    height,
+                    size
+                ));
+            }
+
+            index.push_back(TextureFileLevel{
+                .offset = 0,
+                .size = size,
+                .width = static_cast<std::uint32_t>(width),
+                .height = static_cast<std::uint32_t>(height),
+                .level = static_cast<std::uint32_t>(level),
+                .layer = static_cast<std::uint32_t>(layer),
+            });
+            data.push_back(mip.data());
+        }
+    }
+    // the data goes smallest level first, the order TextureManager uploads
+    // in, so streaming a file reads it front to back
+    for (std::size_t i = index.size(); i-- > 0;) {
+        index[i].offset = offset;
+        offset = align_16(offset + index[i].size);
+    }
+
+    ContainerWriter file(path);
+
+    file.write(&header, sizeof(header));
+    file.write(index.data(), index.size() * sizeof(TextureFileLevel));
+    for (std::size_t i = index.size(); i-- > 0;) {
+        file.padTo(index[i].offset);
+        file.write(data[i].data(), data[i].size());
+    }
+    file.padTo(align_16(file.position()));
+
+    file.finish();
+    spdlog::debug(
+        "Wrote {}: {}x{}, {} levels, {} layers, {} bytes",
+        path.string(),
+        header.width,
+        header.height,
+        header.level_count,
+        header.layer_count,
+        offset
+    );
+}
+
+}  // namespace omgl
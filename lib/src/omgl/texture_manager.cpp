@@ -0,0 +1,665 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <omgl/context_info.hpp>
+#include <omgl/io.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/texture_file.hpp>
+#include <omgl/texture_manager.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace omgl {
+
+void generate_mipmaps(
+    TextureImage& image
+) {
+    if (image.levels.size() != 1 || image.format != gl::GL_RGBA ||
+        image.type != gl::GL_UNSIGNED_BYTE) {
+        throw std::runtime_error(
+            "generate_mipmaps needs a single RGBA8 level to start from"
+        );
+    }
+
+    while (image.levels.back().width > 1 || image.levels.back().height > 1) {
+        const auto& source = image.levels.back();
+        TextureImage::Level level;
+        level.width = std::max<std::size_t>(source.width / 2, 1);
+        level.height = std::max<std::size_t>(source.height / 2, 1);
+        level.pixels.resize(level.width * level.height * 4);
+
+        auto texel = [&source](std::size_t x, std::size_t y) {
+            x = std::min(x, source.width - 1);
+            y = std::min(y, source.height - 1);
+            return &source.pixels[(y * source.width + x) * 4];
+        };
+        for (std::size_t y = 0; y < level.height; y++) {
+            for (std::size_t x = 0; x < level.width; x++) {
+                const std::array<const std::byte*, 4> corners = {
+                    texel(x * 2, y * 2),
+                    texel(x * 2 + 1, y * 2),
+                    texel(x * 2, y * 2 + 1),
+                    texel(x * 2 + 1, y * 2 + 1),
+                };
+                auto* out = &level.pixels[(y * level.width + x) * 4];
+                for (int channel = 0; channel < 4; channel++) {
+                    unsigned sum = 2;
+                    for (const auto* corner : corners) {
+                        sum += std::to_integer<unsigned>(corner[channel]);
+                    }
+                    out[channel] = static_cast<std::byte>(sum / 4);
+                }
+            }
+        }
+        // push_back may move `source`
+        image.levels.push_back(std::move(level));
+    }
+}
+
+TextureImage decode_ppm(
+    const fs::path& path
+) {
+    MappedFile file(path);
+    const std::string_view text = file.text();
+    std::size_t position = 0;
+
+    // header fields are separated by whitespace and comments
+    auto next_field = [&]() {
+        while (position < text.size()) {
+            if (text[position] == '#') {
+                while (position < text.size() && text[position] != '\n') {
+                    position++;
+                }
+            } else if (std::isspace(
+                           static_cast<unsigned char>(text[position])
+                       )) {
+                position++;
+            } else {
+                break;
+            }
+        }
+        const std::size_t start = position;
+        while (position < text.size() &&
+               !std::isspace(static_cast<unsigned char>(text[position]))) {
+            position++;
+        }
+        return text.substr(start, position - start);
+    };
+    auto next_number = [&]() {
+        const auto field = next_field();
+        std::size_t value = 0;
+        if (field.empty() ||
+            !std::all_of(field.begin(), field.end(), [](char c) {
+                return std::isdigit(static_cast<unsigned char>(c));
+            })) {
+            throw std::runtime_error(std::format(
+                "{} has a broken PPM header", path.string()
+            ));
+        }
+        for (char c : field) {
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    };
+
+    if (next_field() != "P6") {
+        throw std::runtime_error(
+            std::format("{} isn't a binary PPM", path.string())
+        );
+    }
+    const std::size_t width = next_number();
+    const std::size_t height = next_number();
+    const std::size_t max_value = next_number();
+    // exactly one whitespace character before the pixels
+    position++;
+
+    if (width == 0 || height == 0 || max_value != 255) {
+        throw std::runtime_error(std::format(
+            "{} is {}x{} with a maximum of {}, only 8 bit PPMs are supported",
+            path.string(),
+            width,
+            height,
+            max_value
+        ));
+    }
+    if (position > text.size() ||
+        text.size() - position < width * height * 3) {
+        throw std::runtime_error(
+            std::format("{} is cut short", path.string())
+        );
+    }
+
+    TextureImage image;
+    auto& level = image.levels.emplace_back();
+    level.width = width;
+    level.height = height;
+    level.pixels.resize(width * height * 4);
+
+    const auto* source =
+        reinterpret_cast<const std::byte*>(text.data() + position);
+    for (std::size_t row = 0; row < height; row++) {
+        // PPM rows are top first
+        const auto* in = source + (height - 1 - row) * width * 3;
+        auto* out = &level.pixels[row * width * 4];
+        for (std::size_t x = 0; x < width; x++) {
+            out[x * 4 + 0] = in[x * 3 + 0];
+            out[x * 4 + 1] = in[x * 3 + 1];
+            out[x * 4 + 2] = in[x * 3 + 2];
+            out[x * 4 + 3] = std::byte{255};
+        }
+    }
+
+    generate_mipmaps(image);
+    return image;
+}
+
+TextureManager::TextureManager(
+    JobSystem& jobs,
+    Config config
+)
+    : jobs(jobs), config(config) {
+    if (config.upload_budget == 0) {
+        throw std::runtime_error("TextureManager needs an upload budget");
+    }
+
+    texture_storage = gl_version_at_least(4, 2) ||
+                      has_extension("GL_ARB_texture_storage");
+    s3tc_support = has_extension("GL_EXT_texture_compression_s3tc");
+
+    auto& state = StateCache::current();
+
+    // before the staging buffer, which stays bound to the unpack target
+    const std::array<std::uint8_t, 4> grey = {128, 128, 128, 255};
+    gl::glGenTextures(1, &placeholder);
+    state.bindTexture(0, gl::GL_TEXTURE_2D, placeholder);
+    gl::glTexImage2D(
+        gl::GL_TEXTURE_2D,
+        0,
+        gl::GL_RGBA8,
+        1,
+        1,
+        0,
+        gl::GL_RGBA,
+        gl::GL_UNSIGNED_BYTE,
+        grey.data()
+    );
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_NEAREST
+    );
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_NEAREST
+    );
+
+    staging = std::make_unique<StreamBuffer>(
+        gl::GL_PIXEL_UNPACK_BUFFER, config.upload_budget, config.staging_regions
+    );
+    // client memory uploads elsewhere would read from it otherwise
+    state.bindBuffer(gl::GL_PIXEL_UNPACK_BUFFER, 0);
+
+    decoders[".ppm"] = decode_ppm;
+    decoders[".omtx"] = [](const fs::path& path) {
+        return read_texture_file(path);
+    };
+
+    spdlog::info(
+        "TextureManager: {} KiB a frame through {} staging regions, {}",
+        config.upload_budget / 1024,
+        config.staging_regions,
+        texture_storage ? "immutable storage" : "glTexImage2D storage"
+    );
+}
+
+TextureManager::~TextureManager() {
+    // the jobs hold on to `this`
+    jobs.wait(decodes);
+
+    auto& state = StateCache::current();
+    for (auto& entry : entries) {
+        if (entry.texture != 0) {
+            state.forgetTexture(entry.texture);
+            gl::glDeleteTextures(1, &entry.texture);
+        }
+    }
+    state.forgetTexture(placeholder);
+    gl::glDeleteTextures(1, &placeholder);
+}
+
+void TextureManager::addDecoder(
+    const std::string& extension,
+    TextureDecoder decoder
+) {
+    decoders[extension] = std::move(decoder);
+}
+
+TextureHandle TextureManager::load(
+    const fs::path& path
+) {
+    std::string extension = path.extension().string();
+    std::transform(
+        extension.begin(), extension.end(), extension.begin(), [](char c) {
+            return static_cast<char>(
+                std::tolower(static_cast<unsigned char>(c))
+            );
+        }
+    );
+    const auto decoder = decoders.find(extension);
+    if (decoder == decoders.end()) {
+        throw std::runtime_error(
+            std::format("No texture decoder for {}", path.string())
+        );
+    }
+
+    std::uint32_t index;
+    if (!free_entries.empty()) {
+        index = free_entries.back();
+        free_entries.pop_back();
+    } else {
+        index = static_cast<std::uint32_t>(entries.size());
+        entries.emplace_back();
+    }
+    auto& entry = entries[index];
+    entry.path = path;
+    entry.used = true;
+    entry.status = Status::decoding;
+
+    const std::uint32_t generation = entry.generation;
+    jobs.run(
+        [this, index, generation, path, decode = decoder->second] {
+            std::unique_ptr<TextureImage> image;
+            try {
+                image = std::make_unique<TextureImage>(decode(path));
+                if (image->levels.empty()) {
+                    throw std::runtime_error("No levels");
+                }
+            } catch (const std::exception& error) {
+                spdlog::error(
+                    "Couldn't decode {}: {}", path.string(), error.what()
+                );
+                image.reset();
+            }
+
+            std::lock_guard lock(decoded_mutex);
+            decoded.push_back(Decoded{
+                .index = index,
+                .generation = generation,
+                .image = std::move(image),
+            });
+        },
+        &decodes
+    );
+
+    return TextureHandle{index, generation};
+}
+
+void TextureManager::release(
+    TextureHandle handle
+) {
+    auto& released = entry(handle);
+    if (released.texture != 0) {
+        StateCache::current().forgetTexture(released.texture);
+        gl::glDeleteTextures(1, &released.texture);
+    }
+    std::erase(upload_queue, handle.index);
+
+    // a decode still running finds the generation changed and is dropped
+    const std::uint32_t generation = released.generation + 1;
+    released = Entry{};
+    released.generation = generation;
+    free_entries.push_back(handle.index);
+}
+
+const TextureManager::Entry& TextureManager::entry(
+    TextureHandle handle
+) const {
+    if (handle.index >= entries.size() || !entries[handle.index].used ||
+        entries[handle.index].generation != handle.generation) {
+        throw std::runtime_error("Stale or invalid TextureHandle");
+    }
+    return entries[handle.index];
+}
+
+TextureManager::Entry& TextureManager::entry(
+    TextureHandle handle
+) {
+    return const_cast<Entry&>(std::as_const(*this).entry(handle));
+}
+
+void TextureManager::createTexture(
+    Entry& entry
+) {
+    const auto& image = *entry.image;
+    const auto& base = image.levels.front();
+
+    gl::glGenTextures(1, &entry.texture);
+    StateCache::current().bindTexture(0, gl::GL_TEXTURE_2D, entry.texture);
+
+    const auto level_count = static_cast<gl::GLsizei>(image.levels.size());
+    if (texture_storage) {
+        gl::glTexStorage2D(
+            gl::GL_TEXTURE_2D,
+            level_count,
+            image.internal_format,
+            static_cast<gl::GLsizei>(base.width),
+            static_cast<gl::GLsizei>(base.height)
+        );
+    } else {
+        for (gl::GLint level = 0; level < level_count; level++) {
+            const auto& mip = image.levels[level];
+            if (image.compressed()) {
+                gl::glCompressedTexImage2D(
+                    gl::GL_TEXTURE_2D,
+                    level,
+                    image.internal_format,
+                    static_cast<gl::GLsizei>(mip.width),
+                    static_cast<gl::GLsizei>(mip.height),
+                    0,
+                    static_cast<gl::GLsizei>(mip.data().size()),
+                    nullptr
+                );
+            } else {
+                gl::glTexImage2D(
+                    gl::GL_TEXTURE_2D,
+                    level,
+                    image.internal_format,
+                    static_cast<gl::GLsizei>(mip.width),
+                    static_cast<gl::GLsizei>(mip.height),
+                    0,
+                    image.format,
+                    image.type,
+                    nullptr
+                );
+            }
+        }
+    }
+
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D,
+        gl::GL_TEXTURE_MIN_FILTER,
+        level_count > 1 ? gl::GL_LINEAR_MIPMAP_LINEAR : gl::GL_LINEAR
+    );
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR
+    );
+    // nothing is sampled before the first level is in, and then only the
+    // levels that are
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D, gl::GL_TEXTURE_BASE_LEVEL, level_count - 1
+    );
+    gl::glTexParameteri(
+        gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAX_LEVEL, level_count - 1
+    );
+}
+
+std::size_t TextureManager::stageLevel(
+    Entry& entry,
+    std::size_t budget,
+    std::vector<Upload>& uploads
+) {
+    const auto& image = *entry.image;
+    const auto& level = image.levels[entry.next_level];
+    const auto data = level.data();
+    const std::size_t row_bytes = image.rowBytes(level.width);
+    const std::size_t block_rows =
+        (level.height + image.block_size - 1) / image.block_size;
+
+    // whatever alignment left of the region counts against the budget too
+    const std::size_t used = (staging->used() + 15) / 16 * 16;
+    const std::size_t space =
+        staging->regionSize() > used ? staging->regionSize() - used : 0;
+    const std::size_t rows = std::min(
+        block_rows - entry.next_row, std::min(budget, space) / row_bytes
+    );
+    if (rows == 0) {
+        return 0;
+    }
+
+    const std::size_t bytes = rows * row_bytes;
+    const auto allocation = staging->allocate(bytes);
+    // for mapped levels this is where the pages get read in
+    std::memcpy(allocation.data, &data[entry.next_row * row_bytes], bytes);
+
+    const bool completes = entry.next_row + rows == block_rows;
+    const std::size_t first_row = entry.next_row * image.block_size;
+    uploads.push_back(Upload{
+        .texture = entry.texture,
+        .internal_format = image.internal_format,
+        .format = image.format,
+        .type = image.type,
+        .compressed = image.compressed(),
+        .level = entry.next_level,
+        .width = level.width,
+        .first_row = first_row,
+        .rows = std::min(rows * image.block_size, level.height - first_row),
+        .offset = allocation.offset,
+        .bytes = bytes,
+        .completes_level = completes,
+    });
+
+    entry.next_row += rows;
+    if (completes) {
+        if (entry.next_level == 0) {
+            entry.status = Status::resident;
+            // the pixels are in the staging buffer, nothing needs them now
+            entry.image.reset();
+        } else {
+            entry.status = Status::partial;
+            entry.next_level--;
+            entry.next_row = 0;
+        }
+    }
+    return bytes;
+}
+
+void TextureManager::update() {
+    if (jobs.workerCount() == 0) {
+        jobs.wait(decodes);
+    }
+
+    std::vector<Decoded> finished;
+    {
+        std::lock_guard lock(decoded_mutex);
+        std::swap(finished, decoded);
+    }
+
+    for (auto& result : finished) {
+        auto& entry = entries[result.index];
+        if (!entry.used || entry.generation != result.generation) {
+            // released while it was decoding
+            continue;
+        }
+        if (!result.image) {
+            entry.status = Status::failed;
+            continue;
+        }
+
+        const auto& base = result.image->levels.front();
+        if (result.image->rowBytes(base.width) > config.upload_budget) {
+            spdlog::error(
+                "{}: a row is more than the upload budget", entry.path.string()
+            );
+            entry.status = Status::failed;
+            continue;
+        }
+        // not core GL, and uploading it anyway only raises GL errors
+        if (result.image->internal_format ==
+                gl::GL_COMPRESSED_RGB_S3TC_DXT1_EXT &&
+            !s3tc_support) {
+            spdlog::error(
+                "{}: BC1 needs GL_EXT_texture_compression_s3tc, which the "
+                "driver doesn't have",
+                entry.path.string()
+            );
+            entry.status = Status::failed;
+            continue;
+        }
+
+        entry.image = std::move(result.image);
+        entry.level_count = entry.image->levels.size();
+        // smallest first
+        entry.next_level = entry.level_count - 1;
+        entry.next_row = 0;
+        createTexture(entry);
+        upload_queue.push_back(result.index);
+    }
+
+    last_uploaded_bytes = 0;
+    if (upload_queue.empty()) {
+        return;
+    }
+
+    staging->beginFrame();
+    std::vector<Upload> uploads;
+    std::size_t budget = config.upload_budget;
+    for (const auto index : upload_queue) {
+        auto& entry = entries[index];
+        while (entry.image && budget > 0) {
+            const std::size_t staged = stageLevel(entry, budget, uploads);
+            if (staged == 0) {
+                break;
+            }
+            budget -= staged;
+        }
+        if (entry.image) {
+            // out of budget, textures go in the order they were decoded
+            break;
+        }
+    }
+    staging->commit();
+
+    auto& state = StateCache::current();
+    state.bindBuffer(gl::GL_PIXEL_UNPACK_BUFFER, staging->id());
+    // stageLevel() packs the rows tightly, whatever their size
+    state.unpackAlignment(1);
+    for (const auto& upload : uploads) {
+        state.bindTexture(0, gl::GL_TEXTURE_2D, upload.texture);
+        if (upload.compressed) {
+            gl::glCompressedTexSubImage2D(
+                gl::GL_TEXTURE_2D,
+                static_cast<gl::GLint>(upload.level),
+                0,
+                static_cast<gl::GLint>(upload.first_row),
+                static_cast<gl::GLsizei>(upload.width),
+                static_cast<gl::GLsizei>(upload.rows),
+                upload.internal_format,
+                static_cast<gl::GLsizei>(upload.bytes),
+                reinterpret_cast<const void*>(upload.offset)
+            );
+        } else {
+            gl::glTexSubImage2D(
+                gl::GL_TEXTURE_2D,
+                static_cast<gl::GLint>(upload.level),
+                0,
+                static_cast<gl::GLint>(upload.first_row),
+                static_cast<gl::GLsizei>(upload.width),
+                static_cast<gl::GLsizei>(upload.rows),
+                upload.format,
+                upload.type,
+                reinterpret_cast<const void*>(upload.offset)
+            );
+        }
+        if (upload.completes_level) {
+            gl::glTexParameteri(
+                gl::GL_TEXTURE_2D,
+                gl::GL_TEXTURE_BASE_LEVEL,
+                static_cast<gl::GLint>(upload.level)
+            );
+        }
+    }
+    state.bindBuffer(gl::GL_PIXEL_UNPACK_BUFFER, 0);
+    // back to GL's default, for whoever uploads next
+    state.unpackAlignment(4);
+    staging->endFrame();
+
+    last_uploaded_bytes = config.upload_budget - budget;
+    total_uploaded_bytes += last_uploaded_bytes;
+
+    std::erase_if(upload_queue, [this](std::uint32_t index) {
+        return !entries[index].image;
+    });
+}
+
+gl::GLuint TextureManager::id(
+    TextureHandle handle
+) const {
+    const auto& found = entry(handle);
+    return found.status == Status::partial || found.status == Status::resident
+               ? found.texture
+               : placeholder;
+}
+
+TextureManager::Status TextureManager::status(
+    TextureHandle handle
+) const {
+    return entry(handle).status;
+}
+
+std::size_t TextureManager::residentLevel(
+    TextureHandle handle
+) const {
+    const auto& found = entry(handle);
+    switch (found.status) {
+        case Status::resident:
+            return 0;
+        case Status::partial:
+            return found.next_level + 1;
+        default:
+            return found.level_count;
+    }
+}
+
+TextureManager::Stats TextureManager::stats() const {
+    Stats stats;
+    for (const auto& entry : entries) {
+        if (!entry.used) {
+            continue;
+        }
+        stats.loaded++;
+        if (entry.status == Status::decoding && !entry.image) {
+            stats.decoding++;
+        } else if (entry.status == Status::resident) {
+            stats.resident++;
+        } else if (entry.status == Status::failed) {
+            stats.failed++;
+        } else {
+            stats.uploading++;
+        }
+
+        if (entry.image) {
+            const auto& image = *entry.image;
+            for (std::size_t level = 0; level <= entry.next_level; level++) {
+                stats.queued_bytes += image.levels[level].data().size();
+            }
+            stats.queued_bytes -=
+                entry.next_row *
+                image.rowBytes(image.levels[entry.next_level].width);
+        }
+    }
+    stats.uploaded_bytes = last_uploaded_bytes;
+    stats.total_uploaded_bytes = total_uploaded_bytes;
+    return stats;
+}
+
+void TextureManager::logStats() const {
+    const auto stats = this->stats();
+    spdlog::info(
+        "TextureManager: {} textures, {} decoding, {} uploading, {} "
+        "resident, {} failed",
+        stats.loaded,
+        stats.decoding,
+        stats.uploading,
+        stats.resident,
+        stats.failed
+    );
+    spdlog::info(
+        "TextureManager: {:.2f} MiB uploaded last update, {:.2f} MiB in "
+        "total, {:.2f} MiB queued",
+        stats.uploaded_bytes / (1024.0 * 1024.0),
+        stats.total_uploaded_bytes / (1024.0 * 1024.0),
+        stats.queued_bytes / (1024.0 * 1024.0)
+    );
+}
+
+}  // namespace omgl
@@ -0,0 +1,184 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <format>
+#include <omgl/state_cache.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <omgl/uniform_block.hpp>
+#include <stdexcept>
+
+namespace omgl {
+
+UniformBlockRegistry& UniformBlockRegistry::current() {
+    thread_local UniformBlockRegistry registry;
+    return registry;
+}
+
+gl::GLuint UniformBlockRegistry::binding(
+    std::string_view block_name
+) {
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) {
+        return b.name == block_name;
+    });
+    if (it != blocks.end()) {
+        return it->binding;
+    }
+
+    gl::GLint max_bindings = 0;
+    gl::glGetIntegerv(gl::GL_MAX_UNIFORM_BUFFER_BINDINGS, &max_bindings);
+
+    const auto next = static_cast<gl::GLuint>(blocks.size());
+    if (next >= static_cast<gl::GLuint>(max_bindings)) {
+        throw std::runtime_error(std::format(
+            "No uniform buffer binding left for block {} ({} in use)",
+            block_name,
+            max_bindings
+        ));
+    }
+
+    blocks.push_back(Block{
+        .name = std::string(block_name),
+        .binding = next,
+        .size = 0,
+    });
+    spdlog::debug("Uniform block {} uses binding {}", block_name, next);
+    return next;
+}
+
+UniformBlockRegistry::Block& UniformBlockRegistry::block(
+    std::string_view block_name
+) {
+    binding(block_name);
+    return *std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) {
+        return b.name == block_name;
+    });
+}
+
+// a std140 block has the same size everywhere, so a mismatch means the C++
+// and GLSL sides disagree on the members
+static std::runtime_error size_mismatch(
+    std::string_view block_name,
+    gl::GLuint program,
+    std::size_t linked_size,
+    std::size_t declared_size
+) {
+    return std::runtime_error(std::format(
+        "Program {}: uniform block {} is {} bytes, the C++ side has {}",
+        program,
+        block_name,
+        linked_size,
+        declared_size
+    ));
+}
+
+void UniformBlockRegistry::declareSize(
+    std::string_view block_name,
+    std::size_t size
+) {
+    auto& entry = block(block_name);
+    if (entry.linked_size != 0 && entry.linked_size != size) {
+        throw size_mismatch(
+            block_name, entry.linked_program, entry.linked_size, size
+        );
+    }
+    entry.size = size;
+}
+
+void UniformBlockRegistry::checkLinkedSize(
+    std::string_view block_name,
+    std::size_t size,
+    gl::GLuint program
+) {
+    auto& entry = block(block_name);
+    if (entry.size != 0 && entry.size != size) {
+        throw size_mismatch(block_name, program, size, entry.size);
+    }
+    if (entry.linked_size == 0) {
+        entry.linked_size = size;
+        entry.linked_program = program;
+    }
+}
+
+std::size_t UniformBlockRegistry::declaredSize(
+    std::string_view block_name
+) const {
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) {
+        return b.name == block_name;
+    });
+    return it == blocks.end() ? 0 : it->size;
+}
+
+UniformBuffer::UniformBuffer(
+    std::string_view block_name,
+    std::size_t size
+)
+    : block_size(size), uploaded(size) {
+    auto& registry = UniformBlockRegistry::current();
+    binding_point = registry.binding(block_name);
+    registry.declareSize(block_name, size);
+
+    // per buffer rather than once per process, contexts can disagree
+    gl::GLint alignment = 256;
+    gl::glGetIntegerv(gl::GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    offset_alignment = static_cast<std::size_t>(alignment);
+
+    auto& state = StateCache::current();
+    gl::glGenBuffers(1, &buffer_id);
+    state.bindBuffer(gl::GL_UNIFORM_BUFFER, buffer_id);
+    gl::glBufferData(
+        gl::GL_UNIFORM_BUFFER, block_size, nullptr, gl::GL_DYNAMIC_DRAW
+    );
+    bind();
+}
+
+UniformBuffer::~UniformBuffer() {
+    StateCache::current().forgetBuffer(buffer_id);
+    gl::glDeleteBuffers(1, &buffer_id);
+}
+
+void UniformBuffer::bind() {
+    StateCache::current().bindBufferRange(
+        gl::GL_UNIFORM_BUFFER, binding_point, buffer_id, 0, block_size
+    );
+    stream_bound = false;
+}
+
+void UniformBuffer::upload(
+    std::span<const std::byte> data
+) {
+    if (stream_bound) {
+        bind();
+    }
+
+    if (has_upload &&
+        std::equal(data.begin(), data.end(), uploaded.begin())) {
+        upload_stats.elided++;
+        return;
+    }
+
+    std::copy(data.begin(), data.end(), uploaded.begin());
+    has_upload = true;
+    upload_stats.uploads++;
+
+    StateCache::current().bindBuffer(gl::GL_UNIFORM_BUFFER, buffer_id);
+    gl::glBufferSubData(gl::GL_UNIFORM_BUFFER, 0, data.size(), data.data());
+}
+
+std::byte* UniformBuffer::allocate(
+    StreamBuffer& stream
+) {
+    // the stream aligns the offset into the whole buffer, whatever its
+    // regions are aligned to
+    const auto allocation = stream.allocate(block_size, offset_alignment);
+    StateCache::current().bindBufferRange(
+        gl::GL_UNIFORM_BUFFER,
+        binding_point,
+        stream.id(),
+        allocation.offset,
+        block_size
+    );
+    stream_bound = true;
+    upload_stats.uploads++;
+    return static_cast<std::byte*>(allocation.data);
+}
+
+}  // namespace omgl
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <format>
+#include <omgl/vertex_format.hpp>
+#include <string>
+
+namespace omgl {
+
+void apply_vertex_attributes(
+    std::span<const VertexAttribute> attributes,
+    std::size_t stride,
+    std::size_t base_offset
+) {
+    for (const auto& attribute : attributes) {
+        // the "pointer" is an offset into the bound buffer
+        const void* offset =
+            reinterpret_cast<const void*>(base_offset + attribute.offset);
+
+        if (attribute.integer) {
+            gl::glVertexAttribIPointer(
+                attribute.location,
+                attribute.components,
+                attribute.type,
+                stride,
+                offset
+            );
+        } else {
+            gl::glVertexAttribPointer(
+                attribute.location,
+                attribute.components,
+                attribute.type,
+                attribute.normalized ? gl::GL_TRUE : gl::GL_FALSE,
+                stride,
+                offset
+            );
+        }
+        gl::glEnableVertexAttribArray(attribute.location);
+        gl::glVertexAttribDivisor(attribute.location, attribute.divisor);
+    }
+}
+
+// how many locations an input of this type takes, and whether it's read
+// as integers
+struct VertexInputType {
+    gl::GLint locations;
+    bool integer;
+};
+
+static VertexInputType vertex_input_type(
+    gl::GLenum type
+) {
+    switch (type) {
+        case gl::GL_INT:
+        case gl::GL_INT_VEC2:
+        case gl::GL_INT_VEC3:
+        case gl::GL_INT_VEC4:
+        case gl::GL_UNSIGNED_INT:
+        case gl::GL_UNSIGNED_INT_VEC2:
+        case gl::GL_UNSIGNED_INT_VEC3:
+        case gl::GL_UNSIGNED_INT_VEC4:
+            return {1, true};
+        // a column per location
+        case gl::GL_FLOAT_MAT2:
+        case gl::GL_FLOAT_MAT2x3:
+        case gl::GL_FLOAT_MAT2x4:
+            return {2, false};
+        case gl::GL_FLOAT_MAT3:
+        case gl::GL_FLOAT_MAT3x2:
+        case gl::GL_FLOAT_MAT3x4:
+            return {3, false};
+        case gl::GL_FLOAT_MAT4:
+        case gl::GL_FLOAT_MAT4x2:
+        case gl::GL_FLOAT_MAT4x3:
+            return {4, false};
+        default:
+            return {1, false};
+    }
+}
+
+void check_vertex_inputs(
+    gl::GLuint program_id,
+    std::span<const VertexAttribute> attributes
+) {
+    gl::GLint input_count = 0;
+    gl::GLint max_name_length = 0;
+    gl::glGetProgramiv(program_id, gl::GL_ACTIVE_ATTRIBUTES, &input_count);
+    gl::glGetProgramiv(
+        program_id, gl::GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_name_length
+    );
+
+    std::string name_buf(std::max(max_name_length, 1), '\0');
+
+    for (gl::GLint i = 0; i < input_count; i++) {
+        gl::GLsizei name_length = 0;
+        gl::GLint size = 0;
+        gl::GLenum type;
+        gl::glGetActiveAttrib(
+            program_id,
+            i,
+            static_cast<gl::GLsizei>(name_buf.size()),
+            &name_length,
+            &size,
+            &type,
+            name_buf.data()
+        );
+        const std::string name(name_buf.data(), name_length);
+        const gl::GLint location =
+            gl::glGetAttribLocation(program_id, name.c_str());
+
+        // gl_VertexID and friends
+        if (location < 0) {
+            continue;
+        }
+
+        const auto input_type = vertex_input_type(type);
+        const gl::GLint locations = input_type.locations * size;
+        for (gl::GLint l = location; l < location + locations; l++) {
+            const auto attribute = std::find_if(
+                attributes.begin(),
+                attributes.end(),
+                [l](const VertexAttribute& attribute) {
+                    return attribute.location == static_cast<gl::GLuint>(l);
+                }
+            );
+            if (attribute == attributes.end()) {
+                throw std::runtime_error(std::format(
+                    "Vertex input {} at location {} has no attribute",
+                    name,
+                    l
+                ));
+            }
+            if (attribute->integer != input_type.integer) {
+                throw std::runtime_error(std::format(
+                    "Vertex input {} at location {} is {} but its attribute "
+                    "is fed as {}",
+                    name,
+                    l,
+                    input_type.integer ? "an integer" : "a float",
+                    attribute->integer ? "integers" : "floats"
+                ));
+            }
+        }
+    }
+}
+
+}  // namespace omgl
@@ -7,6 +7,7 @@
 #include <glbinding/glbinding.h>
 #include <spdlog/spdlog.h>
 #include <iostream>
+#include <omgl/state_cache.hpp>
 
 void framebuffer_size_callback(
     GLFWwindow* window,
@@ -14,7 +15,7 @@ void framebuffer_size_callback(
     int height
 ) {
     spdlog::debug("Window resized");
-    gl::glViewport(0, 0, width, height);
+    omgl::StateCache::current().viewport(0, 0, width, height);
 }
 
 void process_input(
@@ -45,7 +46,7 @@ int main() {
 
     glbinding::initialize(glfwGetProcAddress);
 
-    gl::glViewport(0, 0, 800, 600);
+    omgl::StateCache::current().viewport(0, 0, 800, 600);
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
@@ -0,0 +1,207 @@
+// Renders the moving triangle from hello_shaders without a window and writes
+// the last frame out as a PPM.
+//
+//   headless_render [frames] [output.ppm] [none|sync|async]
+//
+// The last argument picks how every frame is read back: not at all, with a
+// plain glReadPixels, or through omgl::FrameReader.
+#include <glbinding/gl/gl.h>
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <omgl/frame_reader.hpp>
+#include <omgl/headless.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/uniform_block.hpp>
+#include <omgl/vertex_format.hpp>
+#include <string>
+
+namespace fs = std::filesystem;
+
+const fs::path base = fs::path(__FILE__).parent_path();
+const fs::path shaders_dir = base.parent_path() / "hello_shaders" / "shaders";
+
+// the Frame block in moving_triangle.vert
+struct FrameUniforms {
+    glm::vec2 shift;
+};
+
+template <>
+struct omgl::UniformBlockLayout<FrameUniforms> {
+    static constexpr std::string_view name = "Frame";
+    static constexpr auto fields = std::tuple{
+        uniform_field(&FrameUniforms::shift),
+    };
+};
+
+// the inputs of moving_triangle.vert
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+template <>
+struct omgl::VertexLayout<Vertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &Vertex::position),
+        vertex_field(1, &Vertex::color),
+    };
+};
+
+void write_ppm(
+    const fs::path& path,
+    const std::vector<std::uint8_t>& rgba,
+    std::size_t width,
+    std::size_t height
+) {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    // GL hands rows over bottom first, PPM wants them top first
+    for (std::size_t row = height; row-- > 0;) {
+        for (std::size_t col = 0; col < width; col++) {
+            file.write(
+                reinterpret_cast<const char*>(&rgba[(row * width + col) * 4]), 3
+            );
+        }
+    }
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    spdlog::set_level(spdlog::level::debug);
+
+    const int frame_count = argc > 1 ? std::stoi(argv[1]) : 100;
+    const fs::path output_path = argc > 2 ? argv[2] : "headless_render.ppm";
+    const std::string readback = argc > 3 ? argv[3] : "none";
+
+    if (readback != "none" && readback != "sync" && readback != "async") {
+        spdlog::error("Readback has to be one of none, sync or async");
+        return 1;
+    }
+
+    const std::size_t width = 800, height = 600;
+    omgl::HeadlessContext context(width, height);
+
+    auto shader_program = omgl::ShaderProgram(
+        shaders_dir / "moving_triangle.vert", shaders_dir / "triangle_basic.frag"
+    );
+
+    const std::array<Vertex, 3> triangle_vertices = {{
+        {.position = {0.0f, 0.5f, 0.0f}, .color = {1.0f, 0.0f, 0.0f}},
+        {.position = {0.5f, -0.5f, 0.0f}, .color = {0.0f, 1.0f, 0.0f}},
+        {.position = {-0.5f, -0.5f, 0.0f}, .color = {0.0f, 0.0f, 1.0f}},
+    }};
+
+    gl::GLuint vao_id;
+    gl::glGenVertexArrays(1, &vao_id);
+    auto& state = omgl::StateCache::current();
+    state.bindVertexArray(vao_id);
+
+    gl::GLuint vertex_buffer_id;
+    gl::glGenBuffers(1, &vertex_buffer_id);
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, vertex_buffer_id);
+    gl::glBufferData(
+        gl::GL_ARRAY_BUFFER,
+        triangle_vertices.size() * sizeof(Vertex),
+        triangle_vertices.data(),
+        gl::GL_STATIC_DRAW
+    );
+
+    omgl::apply_vertex_layout<Vertex>();
+    omgl::check_vertex_inputs(
+        shader_program.id, omgl::vertex_attributes_of<Vertex>
+    );
+
+    omgl::UniformBlock<FrameUniforms> frame_uniforms;
+
+    // stand-in for real work on the frames: keep a running checksum
+    std::mutex checksum_mutex;
+    std::uint64_t checksum = 0;
+    auto consume = [&](const omgl::CapturedFrame& frame) {
+        std::uint64_t sum = 0;
+        for (auto value : frame.pixels) {
+            sum += value;
+        }
+        std::lock_guard lock(checksum_mutex);
+        checksum += sum;
+    };
+
+    omgl::FrameReader frame_reader(width, height, 3, consume);
+    std::vector<std::uint8_t> sync_pixels(context.target().byteSize());
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frame_count; frame++) {
+        // fixed time step instead of the clock, so the output is repeatable
+        const float time_value = frame / 60.0f;
+
+        gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+        frame_uniforms.set(
+            {.shift = glm::vec2(sin(time_value) / 2.0f, cos(time_value) / 2.0f)}
+        );
+        shader_program.use();
+        gl::glDrawArrays(gl::GL_TRIANGLES, 0, 3);
+
+        if (readback == "sync") {
+            context.target().readPixels(sync_pixels);
+            consume(omgl::CapturedFrame{
+                .index = static_cast<std::uint64_t>(frame),
+                .width = width,
+                .height = height,
+                .pixels = sync_pixels,
+            });
+        } else if (readback == "async") {
+            frame_reader.capture();
+            frame_reader.poll();
+        }
+    }
+    frame_reader.flush();
+    gl::glFinish();
+
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    );
+    spdlog::info(
+        "Rendered {} frames in {:.3f} s ({:.1f} fps)",
+        frame_count,
+        elapsed.count(),
+        frame_count / elapsed.count()
+    );
+
+    if (readback == "async") {
+        auto stats = frame_reader.stats();
+        spdlog::info(
+            "FrameReader: delivered={} stalls={} (consumer {}) readback "
+            "avg={:.2f} ms max={:.2f} ms",
+            stats.delivered,
+            stats.stalls,
+            stats.consumer_stalls,
+            stats.avg_readback_ms,
+            stats.max_readback_ms
+        );
+    }
+    if (readback != "none") {
+        spdlog::info("Checksum: {}", checksum);
+    }
+
+    write_ppm(output_path, context.target().readPixels(), width, height);
+    spdlog::info("Wrote {}", output_path.string());
+
+    state.forgetBuffer(vertex_buffer_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    state.forgetVertexArray(vao_id);
+    gl::glDeleteVertexArrays(1, &vao_id);
+    return 0;
+}
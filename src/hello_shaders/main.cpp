@@ -1,3 +1,10 @@
+// A triangle going round in circles, with shaders that reload on save.
+//
+//   hello_shaders [trace.json]
+//
+// With a path, the frame profiler records every zone and writes them there
+// as a Chrome trace on exit.
+//
 // glfw is including some opengl helper functions
 // but glbinding does that as well, so we don't want that
 // This constant tells glfw not to include those
@@ -6,24 +13,69 @@
 #include <glbinding/gl/gl.h>
 #include <glbinding/glbinding.h>
 #include <spdlog/spdlog.h>
+#include <array>
+#include <cmath>
 #include <filesystem>
 #include <glm/glm.hpp>
 #include <iostream>
+#include <omgl/frame_loop.hpp>
+#include <omgl/frame_profiler.hpp>
 #include <omgl/glfw.hpp>
+#include <omgl/job_system.hpp>
+#include <omgl/shader_reloader.hpp>
 #include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/uniform_block.hpp>
+#include <omgl/vertex_format.hpp>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 const fs::path base = fs::path(__FILE__).parent_path();
 const fs::path shaders_dir = base / "shaders";
 
+// the Frame block in moving_triangle.vert
+struct FrameUniforms {
+    glm::vec2 shift;
+};
+
+template <>
+struct omgl::UniformBlockLayout<FrameUniforms> {
+    static constexpr std::string_view name = "Frame";
+    static constexpr auto fields = std::tuple{
+        uniform_field(&FrameUniforms::shift),
+    };
+};
+
+static_assert(omgl::std140_size<FrameUniforms> == 16);
+
+// the inputs of moving_triangle.vert
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+template <>
+struct omgl::VertexLayout<Vertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &Vertex::position),
+        vertex_field(1, &Vertex::color),
+    };
+};
+
+// what update() advances, at a fixed rate
+struct Simulation {
+    double angle = 0;
+    double previous_angle = 0;
+};
+
 void framebuffer_size_callback(
     GLFWwindow* window,
     int width,
     int height
 ) {
     spdlog::debug("Window resized");
-    gl::glViewport(0, 0, width, height);
+    omgl::StateCache::current().viewport(0, 0, width, height);
 }
 
 void process_input(
@@ -34,7 +86,12 @@ void process_input(
     }
 }
 
-int main() {
+int main(
+    int argc,
+    char** argv
+) {
+    const fs::path trace_path = argc > 1 ? argv[1] : "";
+
     spdlog::set_level(spdlog::level::debug);
     const uint window_height = 1000, window_width = 1000;
     auto window =
@@ -49,89 +106,134 @@ int main() {
         triangle_vertex_shader_path, triangle_frag_shader_path
     );
 
-    // clang-format off
-    std::array<float, (3 + 3) * 3> triangle_vertices = {
-
-        // v1 pos
-        0.0f, 0.5f, 0.0f,
-        // v1 color
-        1.0f, 0.0f, 0.0f,
-
-        // v2 pos
-        0.5f, -0.5f, 0.0f,
-        /// v2 color
-        0.0f, 1.0f, 0.0f,
-
-        // v3 pos
-        -0.5f, -0.5f, 0.0f,
-        // v3 color
-        0.0f, 0.0f, 1.0f
-    };
-    // clang-format on
+    const std::array<Vertex, 3> triangle_vertices = {{
+        {.position = {0.0f, 0.5f, 0.0f}, .color = {1.0f, 0.0f, 0.0f}},
+        {.position = {0.5f, -0.5f, 0.0f}, .color = {0.0f, 1.0f, 0.0f}},
+        {.position = {-0.5f, -0.5f, 0.0f}, .color = {0.0f, 0.0f, 1.0f}},
+    }};
 
     // create the triangel vertex array object
     gl::GLuint triangle_vao_id;
     gl::glGenVertexArrays(1, &triangle_vao_id);
 
     // activate it
-    gl::glBindVertexArray(triangle_vao_id);
+    auto& state = omgl::StateCache::current();
+    state.bindVertexArray(triangle_vao_id);
 
     // create the triangle vertex buffer
     gl::GLuint triangle_vertex_buffer_id;
     gl::glGenBuffers(1, &triangle_vertex_buffer_id);
 
     // bind the triangle vertex buffer to the array buffer target
-    gl::glBindBuffer(gl::GL_ARRAY_BUFFER, triangle_vertex_buffer_id);
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, triangle_vertex_buffer_id);
     // copy the data
     gl::glBufferData(
         gl::GL_ARRAY_BUFFER,
-        triangle_vertices.size() * sizeof(float),
+        triangle_vertices.size() * sizeof(Vertex),
         triangle_vertices.data(),
         gl::GL_STATIC_DRAW
     );
 
-    // assign the vertex buffer to the shader vertex attribute
-    gl::glVertexAttribPointer(
-        0, 3, gl::GL_FLOAT, gl::GL_FALSE, 6 * sizeof(float), (void*)(0)
+    // assign the vertex buffer to the shader vertex attributes
+    omgl::apply_vertex_layout<Vertex>();
+    omgl::check_vertex_inputs(
+        shader_program.id, omgl::vertex_attributes_of<Vertex>
     );
-    gl::glEnableVertexAttribArray(0);
-
-    gl::glVertexAttribPointer(
-        1,
-        3,
-        gl::GL_FLOAT,
-        gl::GL_FALSE,
-        6 * sizeof(float),
-        (void*)(3 * sizeof(float))
-    );
-    gl::glEnableVertexAttribArray(1);
-
-    gl::glBindVertexArray(0);
 
-    while (!glfwWindowShouldClose(window)) {
-        process_input(window);
+    state.bindVertexArray(0);
 
-        float time_value = glfwGetTime();
-        ;
-        float shiftx = sin(time_value) / 2.0f;
-        float shifty = cos(time_value) / 2.0f;
+    // one upload a frame, whichever programs read it
+    omgl::UniformBlock<FrameUniforms> frame_uniforms;
 
-        // state-setting
-        gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-
-        // state-using
-        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
-
-        shader_program.use();
-        shader_program.setUniform("shift", glm::vec2(shiftx, shifty));
-        gl::glBindVertexArray(triangle_vao_id);
-
-        gl::glDrawArrays(gl::GL_TRIANGLES, 0, 3);
-
-        gl::glBindVertexArray(0);
+    // edit the shaders while this runs and they get swapped in
+    omgl::ShaderReloader reloader;
+    reloader.watch(
+        shader_program, triangle_vertex_shader_path, triangle_frag_shader_path
+    );
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // the profiler owns GL queries, so it has to go before the context does
+    {
+        omgl::FrameProfiler profiler;
+        profiler.setLogInterval(std::chrono::seconds(2));
+        if (!trace_path.empty()) {
+            profiler.startTrace();
+        }
+
+        omgl::JobSystem jobs(1);
+
+        // the triangle goes round once every 2 pi seconds, updated at 30 Hz
+        // and interpolated in between
+        Simulation simulation;
+        const omgl::FrameLoop::Config loop_config{
+            .update_step = std::chrono::duration<double>(1.0 / 30.0),
+            .frames_in_flight = 2,
+        };
+        // one per slot, written by prepare() and read by submit()
+        std::vector<FrameUniforms> slot_uniforms(loop_config.frames_in_flight);
+
+        omgl::FrameLoop loop(
+            loop_config,
+            {
+                .poll =
+                    [&] {
+                        glfwPollEvents();
+                        process_input(window);
+                        reloader.update();
+                        return !glfwWindowShouldClose(window);
+                    },
+                .update =
+                    [&](double step) {
+                        simulation.previous_angle = simulation.angle;
+                        simulation.angle += step;
+                    },
+                .prepare =
+                    [&](const omgl::FrameLoop::Frame& frame) {
+                        auto zone = profiler.cpuZone("prepare");
+                        const double angle = std::lerp(
+                            simulation.previous_angle,
+                            simulation.angle,
+                            frame.alpha
+                        );
+                        slot_uniforms[frame.slot].shift = glm::vec2(
+                            std::sin(angle) / 2.0, std::cos(angle) / 2.0
+                        );
+                    },
+                .submit =
+                    [&](const omgl::FrameLoop::Frame& frame) {
+                        profiler.beginFrame();
+
+                        // state-setting
+                        gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+
+                        // state-using
+                        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+                        auto zone = profiler.gpuZone("triangle");
+
+                        frame_uniforms.set(slot_uniforms[frame.slot]);
+                        shader_program.use();
+                        state.bindVertexArray(triangle_vao_id);
+
+                        gl::glDrawArrays(gl::GL_TRIANGLES, 0, 3);
+                    },
+                .present =
+                    [&] {
+                        {
+                            auto zone = profiler.cpuZone("swap");
+                            glfwSwapBuffers(window);
+                        }
+                        profiler.endFrame();
+                        state.endFrame();
+                    },
+            },
+            &jobs
+        );
+        loop.run();
+        loop.logStats();
+
+        if (!trace_path.empty()) {
+            profiler.writeChromeTrace(trace_path);
+        }
     }
 
     glfwTerminate();
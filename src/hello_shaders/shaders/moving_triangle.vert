@@ -3,7 +3,9 @@
 layout(location = 0) in vec3 a_pos;
 layout(location = 1) in vec3 a_color;
 
-uniform vec2 shift;
+layout(std140) uniform Frame {
+    vec2 shift;
+};
 
 out vec4 vertex_color;
 
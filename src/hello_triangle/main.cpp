@@ -6,12 +6,16 @@
 #include <glbinding/gl/gl.h>
 #include <glbinding/glbinding.h>
 #include <spdlog/spdlog.h>
+#include <array>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <glm/glm.hpp>
 #include <iostream>
 #include <omgl/glfw.hpp>
 #include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/vertex_format.hpp>
 
 namespace fs = std::filesystem;
 
@@ -19,13 +23,25 @@ const fs::path base = fs::path(__FILE__).parent_path();
 const fs::path vertex_shader_path = base / "shaders" / "vertex_shader.vert";
 const fs::path fragment_shader_path = base / "shaders" / "fragment_shader.frag";
 
+// the input of vertex_shader.vert, a vec3 at location 0
+struct Vertex {
+    glm::vec3 position;
+};
+
+template <>
+struct omgl::VertexLayout<Vertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &Vertex::position),
+    };
+};
+
 void framebuffer_size_callback(
     GLFWwindow* window,
     int width,
     int height
 ) {
     spdlog::debug("Window resized");
-    gl::glViewport(0, 0, width, height);
+    omgl::StateCache::current().viewport(0, 0, width, height);
 }
 
 void process_input(
@@ -47,18 +63,10 @@ int main() {
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    std::array<float, 3 * 3> arr = {
-        -0.5f,
-        -0.5f,
-        0.0f,
-        //
-        0.5f,
-        -0.5f,
-        0.0f,
-        //
-        0.0f,
-        0.5f,
-        0.0f
+    std::array<Vertex, 3> arr = {
+        Vertex{.position = glm::vec3(-0.5f, -0.5f, 0.0f)},
+        Vertex{.position = glm::vec3(0.5f, -0.5f, 0.0f)},
+        Vertex{.position = glm::vec3(0.0f, 0.5f, 0.0f)},
     };
 
     // create a vertex buffer object
@@ -72,8 +80,10 @@ int main() {
     // bind the buffer to the gl::GL_ARRAY_BUFFER target
     // state-setting
     // the GL_ARRAY_BUFFER is probably some slot that OpenGL has
-    // and we want to bind the buffer to it
-    gl::glBindBuffer(
+    // and we want to bind the buffer to it. The StateCache remembers what
+    // is bound, so binding the same thing again never reaches the driver
+    auto& state = omgl::StateCache::current();
+    state.bindBuffer(
         // we are binding to the gl array buffer target
         gl::GL_ARRAY_BUFFER,
         // the object we are binding to the target
@@ -124,36 +134,19 @@ int main() {
     gl::glGenVertexArrays(1, &vertex_array_obj_id);
 
     // We enable the vertex array object before we start fiddling with state
-    gl::glBindVertexArray(vertex_array_obj_id);
-
-    // now we specify how our vertices are laid out in memory
-    // and which variables they should be linked to in our shaders
-    // Since vbo is still bound to GL_ARRAY_BUFFER, opengl will attach
-    // vbo to attribute 0.
-    glVertexAttribPointer(
-        // This is for attribute 0 (location=0 in our vertex shader)
-        0,
-        // This is the size of the vertex attribute - it is a vec3, so
-        // it is composed of 3 values
-        3,
-        // The type is floating point (float*)
-        gl::GL_FLOAT,
-        // This argument specifies whether we want to squish our inputs
-        // to a normalized range, usually not needed for floats
-        gl::GL_FALSE,
-        // This is the stride of the data - what is the distance between
-        // pointers to the first values of the vectors
-        // We can also pass 0, which tells OpenGL that we have tightly
-        // packed values
-        3 * sizeof(float),
-        // This is a weird argument - it represents the offset to the first
-        // value given the pointer to the beginning of the vectors. Our values
-        // have 0 offset, so we specify 0 (so what is the void* cast for?)
-        static_cast<void*>(0)
+    state.bindVertexArray(vertex_array_obj_id);
+
+    // now we specify how our vertices are laid out in memory and which
+    // variables they should be linked to in our shaders. VertexLayout<Vertex>
+    // describes the struct once, and the stride and the offsets follow from
+    // its members. Since vbo is still bound to GL_ARRAY_BUFFER, OpenGL
+    // attaches vbo to attribute 0 (location=0 in our vertex shader), and
+    // the attribute is enabled, as vertex attributes are disabled by default
+    omgl::apply_vertex_layout<Vertex>();
+    // a mismatch with the shader inputs would read garbage without a word
+    omgl::check_vertex_inputs(
+        shader_program_id, omgl::vertex_attributes_of<Vertex>
     );
-    // vertex attributes are disabled by default, so we tell OpenGL to
-    // enable the vertex attribute at location=0
-    gl::glEnableVertexAttribArray(0);
 
     while (!glfwWindowShouldClose(window)) {
         process_input(window);
@@ -166,8 +159,8 @@ int main() {
         gl::glClear(gl::GL_COLOR_BUFFER_BIT);
 
         //
-        gl::glUseProgram(shader_program_id);
-        gl::glBindVertexArray(vertex_array_obj_id);
+        state.useProgram(shader_program_id);
+        state.bindVertexArray(vertex_array_obj_id);
         gl::glDrawArrays(gl::GL_TRIANGLES, 0, 3);
 
         glfwSwapBuffers(window);
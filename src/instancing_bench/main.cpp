@@ -0,0 +1,222 @@
+// Draws a lot of moving quads with one instanced draw call a frame and
+// reports how many instances per second that comes to, counting only the
+// drawn ones.
+//
+//   instancing_bench [instances] [frames] [auto|scalar|sse2|avx2|off]
+//
+// The quads move over twice the screen in each direction, so about a quarter
+// are visible. The last argument picks the culling kernels, off draws all of
+// them.
+//
+// Meant for llvmpipe as much as for real GPUs:
+//   LIBGL_ALWAYS_SOFTWARE=1 EGL_PLATFORM=surfaceless ./instancing_bench
+#include <glbinding/gl/gl.h>
+#include <spdlog/spdlog.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <omgl/culling.hpp>
+#include <omgl/headless.hpp>
+#include <omgl/instanced_mesh.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const fs::path base = fs::path(__FILE__).parent_path();
+const fs::path shaders_dir = base / "shaders";
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(
+    Clock::time_point since
+) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since)
+        .count();
+}
+
+// nullopt for no culling at all
+std::optional<omgl::SimdLevel> parse_culling(
+    const std::string& name
+) {
+    if (name == "off") {
+        return std::nullopt;
+    }
+    if (name == "auto") {
+        return omgl::supported_simd_level();
+    }
+    for (auto level :
+         {omgl::SimdLevel::scalar,
+          omgl::SimdLevel::sse2,
+          omgl::SimdLevel::avx2}) {
+        if (name == omgl::to_string(level)) {
+            return level;
+        }
+    }
+    throw std::runtime_error(
+        "Culling has to be auto, scalar, sse2, avx2 or off"
+    );
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    const std::size_t instance_count =
+        argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    const int frame_count = argc > 2 ? std::stoi(argv[2]) : 100;
+    const auto culling = parse_culling(argc > 3 ? argv[3] : "auto");
+    if (culling) {
+        spdlog::info(
+            "Culling with {} kernels",
+            omgl::to_string(omgl::force_simd_level(*culling))
+        );
+    }
+
+    const std::size_t width = 1024, height = 1024;
+    omgl::HeadlessContext context(width, height);
+
+    auto program = omgl::ShaderProgram(
+        shaders_dir / "quad.vert", shaders_dir / "quad.frag"
+    );
+
+    // clang-format off
+    const std::array<glm::vec2, 4> quad_vertices = {
+        glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f),
+        glm::vec2(1.0f, -1.0f), glm::vec2(-1.0f, -1.0f),
+    };
+    const std::array<std::uint32_t, 6> quad_indices = {0, 1, 2, 0, 2, 3};
+    // clang-format on
+    const std::array<omgl::VertexAttribute, 1> quad_attributes = {
+        omgl::VertexAttribute{
+            .location = 0,
+            .components = 2,
+            .type = gl::GL_FLOAT,
+        },
+    };
+
+    omgl::InstancedMesh quads(
+        quad_attributes,
+        std::span<const glm::vec2>(quad_vertices),
+        quad_indices,
+        instance_count
+    );
+
+    // a fixed seed so runs are comparable
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    // the clip space box, culled against as-is
+    const float extent = 2.0f;
+    const auto frustum = omgl::Frustum::fromMatrix(glm::mat4(1.0f));
+
+    omgl::InstanceStore instances;
+    instances.reserve(instance_count);
+    // the velocities are the benchmark's business, not the store's
+    std::vector<float> velocity_x(instance_count);
+    std::vector<float> velocity_y(instance_count);
+
+    for (std::size_t i = 0; i < instance_count; i++) {
+        const glm::vec4 color(
+            unit(random) * 0.5f + 0.5f, unit(random) * 0.5f + 0.5f, 1.0f, 1.0f
+        );
+        instances.add(
+            glm::vec3(unit(random) * extent, unit(random) * extent, 0.0f),
+            0.002f,
+            omgl::pack_rgba8(color)
+        );
+        velocity_x[i] = unit(random) * 0.5f;
+        velocity_y[i] = unit(random) * 0.5f;
+    }
+
+    spdlog::info(
+        "{} instances, {} frames, {} KiB of instance data per frame",
+        instance_count,
+        frame_count,
+        instance_count * sizeof(omgl::InstanceData) / 1024
+    );
+
+    double update_ms = 0;
+    double pack_ms = 0;
+    std::size_t drawn = 0;
+    auto& state = omgl::StateCache::current();
+    const auto start = Clock::now();
+
+    for (int frame = 0; frame < frame_count; frame++) {
+        // fixed time step, so the output doesn't depend on the speed
+        const float dt = 1.0f / 60.0f;
+
+        // plain loops over the arrays, which the compiler vectorizes
+        const auto update_start = Clock::now();
+        auto xs = instances.x();
+        auto ys = instances.y();
+        for (std::size_t i = 0; i < xs.size(); i++) {
+            xs[i] += velocity_x[i] * dt;
+            ys[i] += velocity_y[i] * dt;
+            // wrap around instead of bouncing, no branches
+            xs[i] -= 2.0f * extent * static_cast<float>(xs[i] > extent);
+            xs[i] += 2.0f * extent * static_cast<float>(xs[i] < -extent);
+            ys[i] -= 2.0f * extent * static_cast<float>(ys[i] > extent);
+            ys[i] += 2.0f * extent * static_cast<float>(ys[i] < -extent);
+        }
+        update_ms += elapsed_ms(update_start);
+
+        gl::glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+        program.use();
+        quads.beginFrame();
+        if (culling) {
+            // the quads are 2x2 before scaling
+            quads.drawVisible(instances, frustum, std::sqrt(2.0f));
+        } else {
+            quads.draw(instances);
+        }
+        quads.endFrame();
+        pack_ms += quads.stats().pack_ms;
+        drawn += quads.stats().instances;
+
+        state.endFrame();
+    }
+    gl::glFinish();
+
+    const double total_ms = elapsed_ms(start);
+    const double seconds = total_ms / 1000.0;
+
+    spdlog::info(
+        "{} frames in {:.3f} s ({:.1f} fps)",
+        frame_count,
+        seconds,
+        frame_count / seconds
+    );
+    // what reached the GPU, comparable between culling modes
+    spdlog::info(
+        "{:.2f} M instances/s drawn, one draw call per frame",
+        drawn / seconds / 1e6
+    );
+    if (culling) {
+        spdlog::info(
+            "{:.2f} M instances/s culled",
+            instance_count * frame_count / seconds / 1e6
+        );
+    }
+    spdlog::info(
+        "{:.1f}% drawn, {} per frame on average",
+        100.0 * drawn / (instance_count * frame_count),
+        drawn / frame_count
+    );
+    spdlog::info(
+        "per frame: update {:.2f} ms, {} {:.2f} ms, the rest {:.2f} ms",
+        update_ms / frame_count,
+        culling ? "cull" : "pack",
+        pack_ms / frame_count,
+        (total_ms - update_ms - pack_ms) / frame_count
+    );
+    return 0;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+in vec4 vertex_color;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vertex_color;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec2 a_pos;
+
+// per instance, see omgl::InstancedMesh
+layout(location = 2) in vec4 a_transform;
+layout(location = 3) in vec4 a_color;
+
+out vec4 vertex_color;
+
+void main() {
+    vec2 position = a_pos * a_transform.w + a_transform.xy;
+    gl_Position = vec4(position, a_transform.z, 1.);
+    vertex_color = a_color;
+}
@@ -0,0 +1,278 @@
+// Draws a field of bumpy spheres stretching away from the camera, once with
+// every sphere at full detail and once with a level of detail picked per
+// sphere, and compares the triangle counts and frame times.
+//
+//   lod_bench [frames] [pixel threshold]
+//
+// The levels come from build_lod_chain() and live in one MeshPool next to
+// the full detail indices, so picking a level only changes the index range
+// that gets drawn.
+//
+// Meant for llvmpipe as much as for real GPUs:
+//   LIBGL_ALWAYS_SOFTWARE=1 EGL_PLATFORM=surfaceless ./lod_bench
+#include <glbinding/gl/gl.h>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <numbers>
+#include <omgl/headless.hpp>
+#include <omgl/mesh_import.hpp>
+#include <omgl/mesh_lod.hpp>
+#include <omgl/mesh_optimizer.hpp>
+#include <omgl/mesh_pool.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const fs::path base = fs::path(__FILE__).parent_path();
+const fs::path shaders_dir = base / "shaders";
+
+using Clock = std::chrono::steady_clock;
+
+// A latitude-longitude sphere with bumps. The first and last column are at
+// the same place with different texture coordinates, a seam like the ones
+// real models have.
+void make_sphere(
+    int rows,
+    int columns,
+    std::vector<omgl::ObjVertex>& vertices,
+    std::vector<std::uint32_t>& indices
+) {
+    const float pi = std::numbers::pi_v<float>;
+    auto radius = [](float theta, float phi) {
+        return 1.0f + 0.05f * std::sin(8.0f * theta) * std::cos(6.0f * phi);
+    };
+    auto point = [&](float theta, float phi) {
+        return radius(theta, phi) * glm::vec3(
+                                        std::sin(theta) * std::cos(phi),
+                                        std::cos(theta),
+                                        std::sin(theta) * std::sin(phi)
+                                    );
+    };
+
+    for (int row = 0; row <= rows; row++) {
+        for (int column = 0; column <= columns; column++) {
+            const float theta = pi * row / rows;
+            const float phi = 2.0f * pi * column / columns;
+            // normals from the neighbourhood, the bumps need them
+            const float step = 0.5f * pi / rows;
+            const glm::vec3 along_theta =
+                point(theta + step, phi) - point(theta - step, phi);
+            const glm::vec3 along_phi = point(theta, phi + step) -
+                                        point(theta, phi - step);
+            glm::vec3 normal = glm::cross(along_phi, along_theta);
+            if (row == 0 || row == rows) {
+                normal = glm::vec3(0.0f, row == 0 ? 1.0f : -1.0f, 0.0f);
+            }
+            vertices.push_back(omgl::ObjVertex{
+                .position = point(theta, phi),
+                .normal = glm::normalize(normal),
+                .uv = glm::vec2(float(column) / columns, float(row) / rows),
+            });
+        }
+    }
+
+    auto at = [columns](int row, int column) {
+        return static_cast<std::uint32_t>(row * (columns + 1) + column);
+    };
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            // the pole rows have one triangle per column
+            if (row != 0) {
+                indices.insert(
+                    indices.end(),
+                    {at(row, column),
+                     at(row, column + 1),
+                     at(row + 1, column + 1)}
+                );
+            }
+            if (row != rows - 1) {
+                indices.insert(
+                    indices.end(),
+                    {at(row, column),
+                     at(row + 1, column + 1),
+                     at(row + 1, column)}
+                );
+            }
+        }
+    }
+
+    // the pole rows are a vertex per column, all at the same position, so
+    // weld them into one
+    for (auto& index : indices) {
+        if (index <= at(0, columns)) {
+            index = at(0, 0);
+        } else if (index >= at(rows, 0)) {
+            index = at(rows, 0);
+        }
+    }
+}
+
+struct RunStats {
+    double ms_per_frame = 0.0;
+    std::size_t triangles = 0;
+    // how many spheres were drawn at each level
+    std::vector<std::size_t> per_level;
+};
+
+int main(
+    int argc,
+    char** argv
+) {
+    const int frame_count = argc > 1 ? std::stoi(argv[1]) : 100;
+    const float pixel_threshold = argc > 2 ? std::stof(argv[2]) : 1.0f;
+
+    const std::size_t width = 1280, height = 720;
+    omgl::HeadlessContext context(width, height);
+
+    auto program = omgl::ShaderProgram(
+        shaders_dir / "lit.vert", shaders_dir / "lit.frag"
+    );
+    omgl::check_vertex_inputs(
+        program.id, omgl::vertex_attributes_of<omgl::ObjVertex>
+    );
+    const auto view_projection_handle =
+        program.uniformHandle("view_projection");
+    const auto model_handle = program.uniformHandle("model");
+
+    std::vector<omgl::ObjVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    make_sphere(192, 384, vertices, indices);
+    omgl::optimize_vertex_cache(indices, vertices.size());
+
+    std::vector<glm::vec3> positions;
+    for (const auto& vertex : vertices) {
+        positions.push_back(vertex.position);
+    }
+    const auto chain_start = Clock::now();
+    const auto chain = omgl::build_lod_chain(indices, positions);
+    spdlog::info(
+        "{} levels of detail in {:.1f} ms",
+        chain.levels.size(),
+        std::chrono::duration<double, std::milli>(Clock::now() - chain_start)
+            .count()
+    );
+    for (std::size_t i = 0; i < chain.levels.size(); i++) {
+        spdlog::info(
+            "  level {}: {} triangles, error {:.5f}",
+            i,
+            chain.levels[i].index_count / 3,
+            chain.levels[i].error
+        );
+    }
+
+    omgl::MeshPool pool(
+        omgl::vertex_attributes_of<omgl::ObjVertex>,
+        sizeof(omgl::ObjVertex),
+        vertices.size(),
+        chain.indices.size()
+    );
+    const auto sphere = pool.add(
+        std::as_bytes(std::span<const omgl::ObjVertex>(vertices)),
+        chain.indices,
+        chain.levels
+    );
+
+    // a field of spheres from right in front of the camera to far away
+    const float fov_y = glm::radians(60.0f);
+    const glm::mat4 projection = glm::perspective(
+        fov_y, float(width) / float(height), 0.1f, 500.0f
+    );
+    std::vector<glm::vec3> centers;
+    for (int z = 0; z < 40; z++) {
+        for (int x = -10; x <= 10; x++) {
+            centers.emplace_back(x * 3.0f, -2.0f, -4.0f - z * 6.0f);
+        }
+    }
+
+    const omgl::LodSelector selector{
+        .projection_scale = omgl::perspective_lod_scale(fov_y, float(height)),
+        .pixel_threshold = pixel_threshold,
+    };
+
+    auto& state = omgl::StateCache::current();
+    state.setEnabled(gl::GL_DEPTH_TEST, true);
+
+    auto run = [&](bool use_lods) {
+        RunStats stats;
+        stats.per_level.resize(chain.levels.size());
+        const auto start = Clock::now();
+        for (int frame = 0; frame < frame_count; frame++) {
+            // the camera drifts sideways, so distances change a little
+            const glm::vec3 eye(std::sin(frame * 0.02f) * 4.0f, 0.0f, 0.0f);
+            const glm::mat4 view = glm::lookAt(
+                eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0, 1, 0)
+            );
+
+            gl::glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            gl::glClear(gl::GL_COLOR_BUFFER_BIT | gl::GL_DEPTH_BUFFER_BIT);
+
+            program.use();
+            program.setUniform(view_projection_handle, projection * view);
+            pool.bind();
+            for (const auto& center : centers) {
+                std::size_t lod = 0;
+                if (use_lods) {
+                    lod = omgl::select_lod(
+                        chain.levels,
+                        1.0f,
+                        glm::length(center - eye),
+                        selector
+                    );
+                }
+                program.setUniform(
+                    model_handle, glm::translate(glm::mat4(1.0f), center)
+                );
+                pool.draw(sphere, lod);
+                if (frame == 0) {
+                    stats.triangles += chain.levels[lod].index_count / 3;
+                    stats.per_level[lod]++;
+                }
+            }
+            state.endFrame();
+        }
+        gl::glFinish();
+        stats.ms_per_frame =
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count() /
+            frame_count;
+        return stats;
+    };
+
+    // warm up the driver before measuring anything
+    run(false);
+    const auto full = run(false);
+    const auto lod = run(true);
+
+    spdlog::info(
+        "{} spheres, {} frames, {} px threshold",
+        centers.size(),
+        frame_count,
+        pixel_threshold
+    );
+    spdlog::info(
+        "full detail: {} triangles per frame, {:.2f} ms per frame",
+        full.triangles,
+        full.ms_per_frame
+    );
+    spdlog::info(
+        "with LODs:   {} triangles per frame, {:.2f} ms per frame",
+        lod.triangles,
+        lod.ms_per_frame
+    );
+    for (std::size_t i = 0; i < lod.per_level.size(); i++) {
+        spdlog::info("  level {}: {} spheres", i, lod.per_level[i]);
+    }
+    spdlog::info(
+        "{:.1f}x fewer triangles, {:.2f}x the frame rate",
+        double(full.triangles) / double(lod.triangles),
+        full.ms_per_frame / lod.ms_per_frame
+    );
+    return 0;
+}
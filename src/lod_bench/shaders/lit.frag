@@ -0,0 +1,9 @@
+#version 330 core
+
+in vec3 normal;
+out vec4 FragColor;
+
+void main() {
+    float light = max(dot(normalize(normal), normalize(vec3(1., 2., 1.))), 0.);
+    FragColor = vec4(vec3(0.1 + 0.9 * light), 1.);
+}
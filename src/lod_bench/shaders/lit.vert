@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_uv;
+
+uniform mat4 view_projection;
+uniform mat4 model;
+
+out vec3 normal;
+
+void main() {
+    gl_Position = view_projection * model * vec4(a_pos, 1.);
+    normal = mat3(model) * a_normal;
+}
@@ -0,0 +1,105 @@
+// Converts OBJ files to .ommesh, the layout MeshPool takes without any
+// processing.
+//
+//   meshconv [--quantize] [--no-optimize] input.obj output.ommesh
+//
+// Merges duplicate vertices, reorders the triangles for the vertex cache
+// and the vertices for fetch locality, and reports what that did to the
+// ACMR and ATVR. --quantize halves the vertices to QuantizedVertex,
+// --no-optimize keeps the order of the file.
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <omgl/mesh_file.hpp>
+#include <omgl/mesh_import.hpp>
+#include <omgl/mesh_optimizer.hpp>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+void log_cache_stats(
+    std::string_view label,
+    const omgl::MeshData& mesh
+) {
+    // the usual FIFO sizes of older and newer GPUs
+    for (const std::size_t cache_size : {16, 32}) {
+        const auto stats = omgl::analyze_vertex_cache(
+            mesh.indices, mesh.vertexCount(), cache_size
+        );
+        spdlog::info(
+            "{:<6} cache {:>2}: ACMR {:.3f}, ATVR {:.3f}",
+            label,
+            cache_size,
+            stats.acmr,
+            stats.atvr
+        );
+    }
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    bool quantize = false;
+    bool optimize = true;
+    std::vector<fs::path> paths;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--quantize") {
+            quantize = true;
+        } else if (arg == "--no-optimize") {
+            optimize = false;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        spdlog::error(
+            "Usage: meshconv [--quantize] [--no-optimize] input.obj "
+            "output.ommesh"
+        );
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    omgl::MeshData mesh;
+    std::size_t corners = 0;
+    try {
+        mesh = omgl::load_obj(paths[0]);
+        corners = mesh.vertexCount();
+        omgl::remove_duplicate_vertices(mesh);
+        log_cache_stats("before", mesh);
+
+        if (optimize) {
+            omgl::optimize_vertex_cache(mesh.indices, mesh.vertexCount());
+            omgl::optimize_vertex_fetch(mesh);
+            log_cache_stats("after", mesh);
+        }
+        if (quantize) {
+            mesh = omgl::quantize_mesh(mesh);
+        }
+        omgl::write_mesh_file(paths[1], mesh);
+    } catch (const std::exception& error) {
+        spdlog::error("{}", error.what());
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    );
+    spdlog::info(
+        "{}: {} triangles, {} vertices from {} corners, {} byte vertices, "
+        "{} KiB from {} KiB in {:.2f} s",
+        paths[1].string(),
+        mesh.indices.size() / 3,
+        mesh.vertexCount(),
+        corners,
+        mesh.stride,
+        fs::file_size(paths[1]) / 1024,
+        fs::file_size(paths[0]) / 1024,
+        elapsed.count()
+    );
+    return 0;
+}
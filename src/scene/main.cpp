@@ -0,0 +1,365 @@
+// A grid of many small squares and triangles, all living in one MeshPool.
+//
+//   scene [--headless] [--frames N] [--objects N] [--direct] [--jobs N]
+//
+// Without --headless it opens a window and runs until closed, with it it
+// renders N frames offscreen and reports the frame rate. Objects go through
+// the BatchRenderer unless --direct asks for one draw call each. The batched
+// grid pans from side to side and whatever leaves the screen is culled;
+// --jobs N does the culling, sorting and buffer filling on N worker threads
+// while the main thread only talks to GL.
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glbinding/gl/gl.h>
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <omgl/batch_renderer.hpp>
+#include <omgl/culling.hpp>
+#include <omgl/glfw.hpp>
+#include <omgl/headless.hpp>
+#include <omgl/job_system.hpp>
+#include <omgl/mesh_pool.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/vertex_format.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const fs::path base = fs::path(__FILE__).parent_path();
+const fs::path shaders_dir = base / "shaders";
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+template <>
+struct omgl::VertexLayout<Vertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &Vertex::position),
+        vertex_field(1, &Vertex::color),
+    };
+};
+
+struct Options {
+    bool headless = false;
+    int frames = 300;
+    int objects = 10000;
+    bool direct = false;
+    // no job system when negative
+    int jobs = -1;
+};
+
+Options parse_options(
+    int argc,
+    char** argv
+) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = std::stoi(argv[++i]);
+        } else if (arg == "--objects" && i + 1 < argc) {
+            options.objects = std::stoi(argv[++i]);
+        } else if (arg == "--direct") {
+            options.direct = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = std::stoi(argv[++i]);
+        } else {
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+void process_input(
+    GLFWwindow* window
+) {
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, true);
+    }
+}
+
+// Square or triangle `i` of the grid, in normalized device coordinates.
+// Returns a sphere around it, center in xyz and radius in w.
+glm::vec4 make_object(
+    int i,
+    int grid_size,
+    std::vector<Vertex>& vertices,
+    std::vector<std::uint32_t>& indices
+) {
+    const float cell = 2.0f / grid_size;
+    const float x = -1.0f + (i % grid_size) * cell;
+    const float y = -1.0f + (i / grid_size) * cell;
+    const float size = cell * 0.8f;
+
+    const glm::vec3 color(
+        0.3f + 0.7f * (i % 7) / 6.0f, 0.3f + 0.7f * (i % 5) / 4.0f, 0.8f
+    );
+
+    vertices.clear();
+    indices.clear();
+
+    if (i % 2 == 0) {
+        vertices = {
+            {{x, y + size, 0.0f}, color},
+            {{x + size, y + size, 0.0f}, color},
+            {{x + size, y, 0.0f}, color},
+            {{x, y, 0.0f}, color},
+        };
+        indices = {0, 1, 2, 0, 2, 3};
+    } else {
+        vertices = {
+            {{x, y + size, 0.0f}, color},
+            {{x + size, y, 0.0f}, color},
+            {{x, y, 0.0f}, color},
+        };
+        indices = {0, 1, 2};
+    }
+    return glm::vec4(
+        x + size * 0.5f, y + size * 0.5f, 0.0f, size * 0.5f * std::sqrt(2.0f)
+    );
+}
+
+// 4.3 gets the multi-draw-indirect path, anything older the fallback.
+void make_context(
+    const Options& options,
+    std::size_t width,
+    std::size_t height,
+    GLFWwindow*& window,
+    std::unique_ptr<omgl::HeadlessContext>& headless
+) {
+    for (auto [major, minor] : {std::pair{4, 3}, std::pair{3, 3}}) {
+        try {
+            if (options.headless) {
+                headless = std::make_unique<omgl::HeadlessContext>(
+                    width, height, major, minor
+                );
+            } else {
+                window = omgl::make_window("scene", width, height, major, minor);
+            }
+            return;
+        } catch (const std::runtime_error& error) {
+            if (major == 3) {
+                throw;
+            }
+            spdlog::warn("No GL {}.{} context: {}", major, minor, error.what());
+        }
+    }
+}
+
+void log_pool_stats(
+    const char* label,
+    const omgl::MeshPool& pool
+) {
+    auto stats = pool.stats();
+    spdlog::info(
+        "{}: {} meshes, vertices {}/{} in {} free blocks (fragmentation "
+        "{:.2f}), indices {}/{} in {} free blocks (fragmentation {:.2f})",
+        label,
+        stats.meshes,
+        stats.vertices.used,
+        stats.vertices.capacity,
+        stats.vertices.free_blocks,
+        stats.vertices.fragmentation,
+        stats.indices.used,
+        stats.indices.capacity,
+        stats.indices.free_blocks,
+        stats.indices.fragmentation
+    );
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    spdlog::set_level(spdlog::level::debug);
+    const auto options = parse_options(argc, argv);
+
+    const std::size_t window_width = 1000, window_height = 1000;
+
+    GLFWwindow* window = nullptr;
+    std::unique_ptr<omgl::HeadlessContext> headless;
+    make_context(options, window_width, window_height, window, headless);
+
+    auto shader_program = omgl::ShaderProgram(
+        shaders_dir / "pooled.vert", shaders_dir / "pooled.frag"
+    );
+
+    {
+        std::unique_ptr<omgl::JobSystem> jobs;
+        if (options.jobs >= 0) {
+            jobs = std::make_unique<omgl::JobSystem>(options.jobs);
+        }
+
+        omgl::BatchRenderer batch(options.objects);
+        batch.setJobSystem(jobs.get());
+
+        auto batched_program = omgl::ShaderProgram(
+            shaders_dir /
+                (batch.usesIndirect() ? "batched.vert" : "batched_330.vert"),
+            shaders_dir / "pooled.frag"
+        );
+
+        const std::array<glm::vec4, 3> material_tints = {{
+            {1.0f, 1.0f, 1.0f, 1.0f},
+            {1.0f, 0.6f, 0.6f, 1.0f},
+            {0.6f, 1.0f, 0.6f, 1.0f},
+        }};
+        const auto tint_handle = batched_program.uniformHandle("material_tint");
+        batch.setMaterialBinder(
+            [&](omgl::ShaderProgram& program, std::uint32_t material) {
+                program.setUniform(tint_handle, material_tints[material]);
+            }
+        );
+
+        // deliberately small so it has to grow a few times
+        omgl::MeshPool pool(
+            omgl::vertex_attributes_of<Vertex>, sizeof(Vertex), 1024, 2048
+        );
+        omgl::check_vertex_inputs(
+            shader_program.id, omgl::vertex_attributes_of<Vertex>
+        );
+
+        const int grid_size =
+            static_cast<int>(std::ceil(std::sqrt(options.objects)));
+
+        std::vector<omgl::MeshHandle> meshes;
+        std::vector<glm::vec4> bounds;
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+        for (int i = 0; i < options.objects; i++) {
+            bounds.push_back(make_object(i, grid_size, vertices, indices));
+            meshes.push_back(pool.add(
+                std::span<const Vertex>(vertices),
+                std::span<const std::uint32_t>(indices)
+            ));
+        }
+        log_pool_stats("after adding", pool);
+
+        // punch holes in the pool, then pack it back together
+        std::vector<omgl::MeshHandle> kept;
+        std::vector<glm::vec4> kept_bounds;
+        for (std::size_t i = 0; i < meshes.size(); i++) {
+            if (i % 3 == 1) {
+                pool.remove(meshes[i]);
+            } else {
+                kept.push_back(meshes[i]);
+                kept_bounds.push_back(bounds[i]);
+            }
+        }
+        meshes = std::move(kept);
+        bounds = std::move(kept_bounds);
+        log_pool_stats("after removing", pool);
+
+        pool.compact();
+        log_pool_stats("after compacting", pool);
+
+        auto start = std::chrono::steady_clock::now();
+        int frame = 0;
+
+        while (options.headless ? frame < options.frames
+                                : !glfwWindowShouldClose(window)) {
+            if (window != nullptr) {
+                process_input(window);
+            }
+
+            gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+            if (options.direct) {
+                shader_program.use();
+
+                // one bind for every object
+                pool.bind();
+                for (const auto& mesh : meshes) {
+                    pool.draw(mesh);
+                }
+            } else {
+                // positions are baked into the meshes, the model matrix only
+                // pans the whole grid
+                const glm::mat4 model = glm::translate(
+                    glm::mat4(1.0f),
+                    glm::vec3(0.75f * std::sin(frame * 0.01f), 0.0f, 0.0f)
+                );
+                // no camera, so clip space is world space
+                const auto frustum = omgl::Frustum::fromMatrix(model);
+
+                batch.submitMany(
+                    meshes.size(),
+                    [&](std::size_t i, omgl::BatchRenderer::Draw& draw) {
+                        const auto& sphere = bounds[i];
+                        if (!frustum.containsSphere(
+                                glm::vec3(sphere), sphere.w
+                            )) {
+                            return false;
+                        }
+                        draw.program = &batched_program;
+                        draw.pool = &pool;
+                        draw.mesh = meshes[i];
+                        draw.material = i % material_tints.size();
+                        draw.data = omgl::ObjectData{
+                            .model = model,
+                            .color = glm::vec4(1.0f),
+                        };
+                        return true;
+                    }
+                );
+                batch.flush();
+            }
+
+            if (window != nullptr) {
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            omgl::StateCache::current().endFrame();
+            frame++;
+        }
+        gl::glFinish();
+
+        auto elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start
+        );
+        spdlog::info(
+            "{} frames of {} objects in {:.2f} s ({:.1f} fps)",
+            frame,
+            meshes.size(),
+            elapsed.count(),
+            frame / elapsed.count()
+        );
+        const auto& state_stats = omgl::StateCache::current().frameStats();
+        spdlog::info(
+            "last frame: {} state changes issued, {} elided",
+            state_stats.issued,
+            state_stats.elided
+        );
+        if (!options.direct) {
+            const auto& stats = batch.stats();
+            spdlog::info(
+                "last frame: {} objects ({} culled) in {} buckets, {} draw "
+                "calls",
+                stats.objects,
+                stats.culled,
+                stats.buckets,
+                stats.draw_calls
+            );
+        }
+    }
+
+    if (window != nullptr) {
+        glfwTerminate();
+    }
+    return 0;
+}
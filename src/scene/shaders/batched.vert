@@ -0,0 +1,24 @@
+#version 430 core
+
+struct ObjectData {
+    mat4 model;
+    vec4 color;
+};
+
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec3 a_color;
+layout(location = 15) in uint a_object_id;
+
+layout(std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+uniform vec4 material_tint;
+
+out vec4 vertex_color;
+
+void main() {
+    ObjectData object = objects[a_object_id];
+    gl_Position = object.model * vec4(a_pos, 1.);
+    vertex_color = vec4(a_color, 1.) * object.color * material_tint;
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec3 a_color;
+layout(location = 15) in uint a_object_id;
+
+// five texels per object: four model matrix columns, then the color
+uniform samplerBuffer objects;
+uniform int object_texel_offset;
+
+uniform vec4 material_tint;
+
+out vec4 vertex_color;
+
+void main() {
+    int base = object_texel_offset + int(a_object_id) * 5;
+    mat4 model = mat4(
+        texelFetch(objects, base),
+        texelFetch(objects, base + 1),
+        texelFetch(objects, base + 2),
+        texelFetch(objects, base + 3)
+    );
+    vec4 color = texelFetch(objects, base + 4);
+
+    gl_Position = model * vec4(a_pos, 1.);
+    vertex_color = vec4(a_color, 1.) * color * material_tint;
+}
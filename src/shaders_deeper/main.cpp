@@ -5,6 +5,7 @@
 #include <spdlog/spdlog.h>
 #include <filesystem>
 #include <omgl/glfw.hpp>
+#include <omgl/state_cache.hpp>
 
 namespace fs = std::filesystem;
 
@@ -14,7 +15,7 @@ void framebuffer_size_callback(
     int height
 ) {
     spdlog::debug("Window resized");
-    gl::glViewport(0, 0, width, height);
+    omgl::StateCache::current().viewport(0, 0, width, height);
 }
 
 int main() {
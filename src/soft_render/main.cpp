@@ -0,0 +1,240 @@
+// Renders the moving triangle from headless_render on the CPU, no GL context
+// needed, over a field of small triangles to give the rasterizer some work,
+// and writes the last frame out as a PPM.
+//
+//   soft_render [frames] [output.ppm] [jobs] [triangles]
+//
+// With 0 jobs everything runs on the main thread. The output is the same
+// for any number of jobs.
+#include <spdlog/spdlog.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <memory>
+#include <omgl/job_system.hpp>
+#include <omgl/soft_rasterizer.hpp>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// moving_triangle.vert and triangle_basic.frag from hello_shaders
+struct MovingTriangle {
+    static constexpr std::size_t varying_count = 4;
+
+    glm::vec2 shift;
+
+    void vertex(
+        const omgl::SoftVertexInput& in,
+        omgl::SoftVertex& out
+    ) const {
+        const glm::vec4& pos = in.attributes[0];
+        const glm::vec4& color = in.attributes[1];
+        out.position =
+            glm::vec4(pos.x + shift.x, pos.y + shift.y, pos.z, 1.0f);
+
+        const glm::vec2 tint =
+            (glm::vec2(color.x, color.y) + shift) / 2.0f + 0.5f;
+        out.varyings = {tint.x, tint.y, color.z, 1.0f};
+    }
+
+    glm::vec4 fragment(
+        const omgl::SoftVaryings& varyings
+    ) const {
+        return glm::vec4(varyings[0], varyings[1], varyings[2], varyings[3]);
+    }
+};
+
+// the background field, positions and colors passed straight through
+struct Unlit {
+    static constexpr std::size_t varying_count = 3;
+
+    void vertex(
+        const omgl::SoftVertexInput& in,
+        omgl::SoftVertex& out
+    ) const {
+        const glm::vec4& color = in.attributes[1];
+        out.position = in.attributes[0];
+        out.varyings = {color.x, color.y, color.z};
+    }
+
+    glm::vec4 fragment(
+        const omgl::SoftVaryings& varyings
+    ) const {
+        return glm::vec4(varyings[0], varyings[1], varyings[2], 1.0f);
+    }
+};
+
+const std::array<omgl::VertexAttribute, 2> vertex_attributes = {{
+    {
+        .location = 0,
+        .components = 3,
+        .type = gl::GL_FLOAT,
+        .offset = 0,
+    },
+    {
+        .location = 1,
+        .components = 3,
+        .type = gl::GL_FLOAT,
+        .offset = 3 * sizeof(float),
+    },
+}};
+
+// `count` small triangles scattered behind the moving one, as an indexed
+// mesh
+void make_field(
+    std::size_t count,
+    std::vector<float>& vertices,
+    std::vector<std::uint32_t>& indices
+) {
+    // a fixed linear congruential generator, so every run draws the same
+    std::uint32_t state = 12345;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1 << 24);
+    };
+
+    for (std::size_t i = 0; i < count; i++) {
+        const float x = random() * 2.0f - 1.0f;
+        const float y = random() * 2.0f - 1.0f;
+        // behind the moving triangle at z = 0
+        const float z = 0.1f + random() * 0.8f;
+        const float size = 0.01f + random() * 0.04f;
+        const glm::vec3 color(random(), random(), random());
+
+        const auto first = static_cast<std::uint32_t>(vertices.size() / 6);
+        for (auto [dx, dy] : {std::pair{0.0f, size},
+                              std::pair{size, -size},
+                              std::pair{-size, -size}}) {
+            vertices.insert(
+                vertices.end(),
+                {x + dx, y + dy, z, color.x, color.y, color.z}
+            );
+        }
+        indices.insert(indices.end(), {first, first + 1, first + 2});
+    }
+}
+
+void write_ppm(
+    const fs::path& path,
+    std::span<const std::uint8_t> rgba,
+    std::size_t width,
+    std::size_t height
+) {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    // rows come bottom first like from GL, PPM wants them top first
+    for (std::size_t row = height; row-- > 0;) {
+        for (std::size_t col = 0; col < width; col++) {
+            file.write(
+                reinterpret_cast<const char*>(&rgba[(row * width + col) * 4]), 3
+            );
+        }
+    }
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    spdlog::set_level(spdlog::level::debug);
+
+    const int frame_count = argc > 1 ? std::stoi(argv[1]) : 100;
+    const fs::path output_path = argc > 2 ? argv[2] : "soft_render.ppm";
+    const int job_count = argc > 3 ? std::stoi(argv[3]) : -1;
+    const std::size_t field_size = argc > 4 ? std::stoul(argv[4]) : 10000;
+
+    std::unique_ptr<omgl::JobSystem> jobs;
+    if (job_count != 0) {
+        jobs = std::make_unique<omgl::JobSystem>(
+            job_count > 0 ? job_count : omgl::default_worker_count()
+        );
+    }
+
+    const std::size_t width = 800, height = 600;
+    omgl::SoftRasterizer rasterizer(width, height, jobs.get());
+
+    // clang-format off
+    const std::array<float, (3 + 3) * 3> triangle_vertices = {
+        // v1 pos, color
+        0.0f, 0.5f, 0.0f,     1.0f, 0.0f, 0.0f,
+        // v2 pos, color
+        0.5f, -0.5f, 0.0f,    0.0f, 1.0f, 0.0f,
+        // v3 pos, color
+        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f
+    };
+    // clang-format on
+    const omgl::SoftMesh triangle{
+        .attributes = vertex_attributes,
+        .stride = 6 * sizeof(float),
+        .vertices = std::as_bytes(std::span(triangle_vertices)),
+        .indices = {},
+    };
+
+    std::vector<float> field_vertices;
+    std::vector<std::uint32_t> field_indices;
+    make_field(field_size, field_vertices, field_indices);
+    const omgl::SoftMesh field{
+        .attributes = vertex_attributes,
+        .stride = 6 * sizeof(float),
+        .vertices = std::as_bytes(std::span(field_vertices)),
+        .indices = field_indices,
+    };
+
+    std::size_t triangles = 0;
+    std::size_t fragments = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frame_count; frame++) {
+        // fixed time step instead of the clock, so the output is repeatable
+        const float time_value = frame / 60.0f;
+
+        rasterizer.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+        rasterizer.draw(field, Unlit{});
+        rasterizer.draw(
+            triangle,
+            MovingTriangle{
+                .shift = glm::vec2(
+                    std::sin(time_value) / 2.0f, std::cos(time_value) / 2.0f
+                ),
+            }
+        );
+
+        triangles += rasterizer.stats().triangles;
+        fragments += rasterizer.stats().fragments;
+    }
+
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    );
+    spdlog::info(
+        "Rendered {} frames in {:.3f} s ({:.1f} fps) on {}",
+        frame_count,
+        elapsed.count(),
+        frame_count / elapsed.count(),
+        jobs ? std::format("{} workers", jobs->workerCount())
+             : std::string("the main thread")
+    );
+    spdlog::info(
+        "{:.2f} M triangles/s, {:.2f} M fragments/s",
+        triangles / elapsed.count() / 1e6,
+        fragments / elapsed.count() / 1e6
+    );
+    const auto& stats = rasterizer.stats();
+    spdlog::info(
+        "last frame: {} triangles ({} culled, {} clipped), {} fragments",
+        stats.triangles,
+        stats.culled,
+        stats.clipped,
+        stats.fragments
+    );
+
+    write_ppm(output_path, rasterizer.pixels(), width, height);
+    spdlog::info("Wrote {}", output_path.string());
+    return 0;
+}
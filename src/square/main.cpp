@@ -7,19 +7,27 @@
 #include <glbinding/glbinding.h>
 #include <spdlog/spdlog.h>
 
+#include <array>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <glm/glm.hpp>
 #include <iostream>
 #include <omgl/glfw.hpp>
+#include <omgl/instanced_mesh.hpp>
+#include <omgl/shader_variants.hpp>
 #include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/vertex_format.hpp>
+#include <span>
 
 namespace fs = std::filesystem;
 
 const fs::path base = fs::path(__FILE__).parent_path();
 const fs::path vertex_shader_path = base / "shaders" / "vertex_shader.vert";
-const fs::path orange_frag_path = base / "shaders" / "just_orange.frag";
-const fs::path blue_frag_path = base / "shaders" / "just_blue.frag";
+const fs::path color_frag_path = base / "shaders" / "solid_color.frag";
+const fs::path instanced_vertex_path = base / "shaders" / "instanced.vert";
+const fs::path vertex_color_frag_path = base / "shaders" / "vertex_color.frag";
 
 void framebuffer_size_callback(
     GLFWwindow* window,
@@ -27,7 +35,7 @@ void framebuffer_size_callback(
     int height
 ) {
     spdlog::debug("Window resized");
-    gl::glViewport(0, 0, width, height);
+    omgl::StateCache::current().viewport(0, 0, width, height);
 }
 
 void process_input(
@@ -38,19 +46,33 @@ void process_input(
     }
 }
 
+// the input of vertex_shader.vert
+struct Vertex {
+    glm::vec3 position;
+};
+
+template <>
+struct omgl::VertexLayout<Vertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &Vertex::position),
+    };
+};
+
 gl::GLuint set_array_buffer(
-    const std::vector<float>& data
+    const std::vector<Vertex>& data
 ) {
     gl::GLuint vertex_buffer_id;
     gl::glGenBuffers(1, &vertex_buffer_id);
 
     spdlog::info("vbo id: {}", vertex_buffer_id);
 
-    gl::glBindBuffer(gl::GL_ARRAY_BUFFER, vertex_buffer_id);
+    omgl::StateCache::current().bindBuffer(
+        gl::GL_ARRAY_BUFFER, vertex_buffer_id
+    );
 
     gl::glBufferData(
         gl::GL_ARRAY_BUFFER,
-        data.size() * sizeof(float),
+        data.size() * sizeof(Vertex),
         data.data(),
         gl::GL_STATIC_DRAW
     );
@@ -58,111 +80,34 @@ gl::GLuint set_array_buffer(
     return vertex_buffer_id;
 }
 
-gl::GLuint set_element_buffer(
-    const std::vector<gl::GLuint>& indices
-) {
-    gl::GLuint element_array_buffer_id;
-    gl::glGenBuffers(1, &element_array_buffer_id);
-
-    gl::glBindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_id);
-    gl::glBufferData(
-        gl::GL_ELEMENT_ARRAY_BUFFER,
-        indices.size() * sizeof(gl::GLuint),
-        indices.data(),
-        gl::GL_STATIC_DRAW
-    );
-
-    return element_array_buffer_id;
-}
-
-class Square {
-   public:
-    Square(
-        std::vector<float> vertices
-    )
-        : vertices(vertices) {
-        this->indices = {
-
-            // top right triangle
-            0,
-            1,
-            2,
-            // bottom left triangle
-            0,
-            2,
-            3
-        };
-    }
-
-    void init() {
-        gl::glGenVertexArrays(1, &this->vao_id);
-
-        gl::glBindVertexArray(this->vao_id);
-
-        auto vertex_buffer_id = set_array_buffer(this->vertices);
-        auto element_buffer_id = set_element_buffer(this->indices);
-
-        gl::glVertexAttribPointer(
-            0,
-            3,
-            gl::GL_FLOAT,
-            gl::GL_FALSE,
-            3 * sizeof(float),
-            static_cast<void*>(0)
-        );
-        gl::glEnableVertexAttribArray(0);
-
-        gl::glBindVertexArray(0);
-    }
-
-    void draw() {
-        gl::glBindVertexArray(this->vao_id);
-        gl::glDrawElements(gl::GL_TRIANGLES, 6, gl::GL_UNSIGNED_INT, 0);
-        gl::glBindVertexArray(0);
-    }
-
-   private:
-    gl::GLuint vao_id;
-    std::vector<float> vertices;
-    std::vector<gl::GLuint> indices;
-};
-
 class Triangle {
    public:
     Triangle(
-        std::vector<float> vertices
+        std::vector<Vertex> vertices
     )
         : vertices(vertices) {}
 
     void init() {
+        auto& state = omgl::StateCache::current();
         gl::glGenVertexArrays(1, &this->vao_id);
 
-        gl::glBindVertexArray(this->vao_id);
+        state.bindVertexArray(this->vao_id);
 
         auto vertex_buffer_id = set_array_buffer(this->vertices);
 
-        gl::glVertexAttribPointer(
-            0,
-            3,
-            gl::GL_FLOAT,
-            gl::GL_FALSE,
-            3 * sizeof(float),
-            static_cast<void*>(0)
-        );
-        gl::glEnableVertexAttribArray(0);
+        omgl::apply_vertex_layout<Vertex>();
 
-        gl::glBindVertexArray(0);
+        state.bindVertexArray(0);
     }
 
     void draw() {
-        gl::glBindVertexArray(this->vao_id);
+        omgl::StateCache::current().bindVertexArray(this->vao_id);
         gl::glDrawArrays(gl::GL_TRIANGLES, 0, 3);
-        gl::glBindVertexArray(0);
     }
 
    private:
     gl::GLuint vao_id;
-    std::vector<float> vertices;
+    std::vector<Vertex> vertices;
 };
 
 int main() {
@@ -175,91 +120,96 @@ int main() {
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    auto vertex_shader_id = omgl::compile_vertex_shader(vertex_shader_path);
-    auto blue_frag_id = omgl::compile_fragment_shader(blue_frag_path);
-    auto orange_frag_id = omgl::compile_fragment_shader(orange_frag_path);
-
-    auto orange_shader_program_id =
-        omgl::make_shader_program(vertex_shader_id, orange_frag_id);
-
-    auto blue_shader_program_id =
-        omgl::make_shader_program(vertex_shader_id, blue_frag_id);
-
-    Square square1({
-
-        // top left
-        -0.5f,
-        0.5f,
-        0.0f,
-        // top right
-        0.0f,
-        0.5f,
-        0.0f,
-        // bottom right
-        0.0f,
-        0.0f,
-        0.0f,
-        // bottom left
-        -0.5f,
-        0.0f,
-        0.0f
-    });
-    square1.init();
-
-    Square square2({
-
-        // top left
-        0.0f,
-        0.0f,
-        0.0f,
-        // top right
-        0.5f,
-        0.0f,
-        0.0f,
-        // bottom right
-        0.5f,
-        -0.5f,
-        0.0f,
-        // bottom left
-        0.0f,
-        -0.5f,
-        0.0f
-    });
-    square2.init();
-
-    Triangle triangle({
-
-        // v1
-        0.0f,
-        0.5f,
-        0.0f,
-        // v2
-        0.5f,
-        0.5f,
-        0.0f,
-        // v3
-        0.5f,
-        0.0f,
-        0.0f
-    });
-    triangle.init();
-
-    while (!glfwWindowShouldClose(window)) {
-        process_input(window);
-
-        gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
-
-        gl::glUseProgram(blue_shader_program_id);
-
-        square1.draw();
-        square2.draw();
-
-        gl::glUseProgram(orange_shader_program_id);
-        triangle.draw();
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // the mesh and the programs own GL objects, so they have to go before
+    // the context does
+    {
+        // both squares are the same quad, moved and scaled per instance
+        // clang-format off
+        const std::array<float, 4 * 3> quad_vertices = {
+            // top left
+            -1.0f, 1.0f, 0.0f,
+            // top right
+            1.0f, 1.0f, 0.0f,
+            // bottom right
+            1.0f, -1.0f, 0.0f,
+            // bottom left
+            -1.0f, -1.0f, 0.0f,
+        };
+        const std::array<std::uint32_t, 6> quad_indices = {
+            // top right triangle
+            0, 1, 2,
+            // bottom left triangle
+            0, 2, 3
+        };
+        // clang-format on
+        const std::array<omgl::VertexAttribute, 1> quad_attributes = {
+            omgl::VertexAttribute{
+                .location = 0,
+                .components = 3,
+                .type = gl::GL_FLOAT,
+            },
+        };
+
+        omgl::InstancedMesh squares(
+            quad_attributes,
+            3 * sizeof(float),
+            std::as_bytes(std::span(quad_vertices)),
+            quad_indices,
+            2
+        );
+
+        omgl::InstanceStore square_instances;
+        const auto blue = omgl::pack_rgba8(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+        square_instances.add(glm::vec3(-0.25f, 0.25f, 0.0f), 0.25f, blue);
+        square_instances.add(glm::vec3(0.25f, -0.25f, 0.0f), 0.25f, blue);
+
+        Triangle triangle({
+            {.position = glm::vec3(0.0f, 0.5f, 0.0f)},
+            {.position = glm::vec3(0.5f, 0.5f, 0.0f)},
+            {.position = glm::vec3(0.5f, 0.0f, 0.0f)},
+        });
+        triangle.init();
+
+        // the color is baked into the fragment shader through a define
+        omgl::ShaderVariantCache variants;
+        auto& orange_program = variants.program(
+            vertex_shader_path,
+            color_frag_path,
+            {{"COLOR", "vec4(1.0f, 0.5f, 0.2f, 1.0f)"}}
+        );
+        auto& square_program =
+            variants.program(instanced_vertex_path, vertex_color_frag_path);
+        omgl::check_vertex_inputs(
+            orange_program.id, omgl::vertex_attributes_of<Vertex>
+        );
+
+        auto& state = omgl::StateCache::current();
+
+        while (!glfwWindowShouldClose(window)) {
+            process_input(window);
+
+            gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+            // both squares in one draw call
+            square_program.use();
+            squares.beginFrame();
+            squares.draw(square_instances);
+            squares.endFrame();
+
+            orange_program.use();
+            triangle.draw();
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            state.endFrame();
+        }
+
+        spdlog::info(
+            "state changes per frame: {} issued, {} elided",
+            state.frameStats().issued,
+            state.frameStats().elided
+        );
     }
 
     glfwTerminate();
@@ -0,0 +1,14 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+
+// one per square, see omgl::InstancedMesh
+layout(location = 2) in vec4 aTransform;
+layout(location = 3) in vec4 aColor;
+
+out vec4 vertexColor;
+
+void main() {
+    gl_Position = vec4(aPos * aTransform.w + aTransform.xyz, 1.);
+    vertexColor = aColor;
+}
@@ -1,6 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-void main() {
-    FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);
-}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 330 core
+// COLOR is defined per variant, see main.cpp
+#ifndef COLOR
+#define COLOR vec4(1.0f, 0.0f, 1.0f, 1.0f)
+#endif
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = COLOR;
+}
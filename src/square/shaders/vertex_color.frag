@@ -1,6 +1,8 @@
 #version 330 core
+
+in vec4 vertexColor;
 out vec4 FragColor;
 
 void main() {
-    FragColor = vec4(0.0f, 0.0f, 1.0f, 1.0f);
-}
\ No newline at end of file
+    FragColor = vertexColor;
+}
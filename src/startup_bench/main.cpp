@@ -0,0 +1,161 @@
+// Measures how long it takes to get a set of shader programs ready.
+//
+//   startup_bench cold [count]    clears the program cache first
+//   startup_bench warm [count]    reuses whatever the last run left behind
+//   startup_bench serial [count]  no cache, compiles and checks one by one
+//   startup_bench batch [count]   no cache, compiles through omgl::ShaderBatch
+//
+// To run it under llvmpipe and keep mesa's own shader cache out of the way:
+//   LIBGL_ALWAYS_SOFTWARE=1 MESA_SHADER_CACHE_DISABLE=true ./startup_bench cold
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glbinding/gl/gl.h>
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <omgl/glfw.hpp>
+#include <omgl/program_cache.hpp>
+#include <omgl/shader_batch.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const fs::path cache_dir = fs::temp_directory_path() / "omgl_startup_bench";
+
+constexpr std::string_view vertex_template = R"(#version 330 core
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec3 a_color;
+
+uniform mat4 transform;
+
+out vec3 vertex_color;
+
+void main() {{
+    gl_Position = transform * vec4(a_pos, 1.);
+    vertex_color = a_color * {};
+}}
+)";
+
+// something with a bit of work in it so compilation isn't trivially cheap
+constexpr std::string_view fragment_template = R"(#version 330 core
+in vec3 vertex_color;
+out vec4 FragColor;
+
+uniform float time;
+
+void main() {{
+    vec3 color = vertex_color;
+    for (int i = 0; i < {}; i++) {{
+        color = abs(sin(color * 1.7 + time)) * 0.9 + cos(color.zxy) * 0.1;
+    }}
+    FragColor = vec4(color, 1.);
+}}
+)";
+
+int main(
+    int argc,
+    char** argv
+) {
+    spdlog::set_level(spdlog::level::warn);
+
+    const std::string mode = argc > 1 ? argv[1] : "warm";
+    const int program_count = argc > 2 ? std::stoi(argv[2]) : 64;
+
+    if (mode != "cold" && mode != "warm" && mode != "serial" &&
+        mode != "batch") {
+        spdlog::error("Usage: startup_bench [cold|warm|serial|batch] [count]");
+        return 1;
+    }
+
+    auto window = omgl::make_window("startup_bench", 64, 64);
+
+    omgl::ProgramCache cache(cache_dir);
+    if (mode == "cold") {
+        cache.clear();
+    }
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info(
+        "parallel shader compile: {}",
+        omgl::ShaderBatch::parallelCompileSupported()
+    );
+    spdlog::set_level(spdlog::level::warn);
+
+    // every variant differs so the driver can't dedupe them
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (int i = 0; i < program_count; i++) {
+        sources.emplace_back(
+            std::format(vertex_template, 1.0f + i * 0.001f),
+            std::format(fragment_template, 4 + i % 8)
+        );
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<gl::GLuint> programs;
+    if (mode == "batch") {
+        omgl::ShaderBatch batch;
+        std::vector<omgl::ShaderBatch::ProgramHandle> handles;
+        for (const auto& [vertex_source, fragment_source] : sources) {
+            handles.push_back(batch.addProgram(
+                batch.addVertexShader(vertex_source),
+                batch.addFragmentShader(fragment_source)
+            ));
+        }
+        batch.submit();
+        batch.finish();
+        for (auto handle : handles) {
+            programs.push_back(batch.program(handle));
+        }
+    } else if (mode == "serial") {
+        for (const auto& [vertex_source, fragment_source] : sources) {
+            auto vertex_shader_id = omgl::compile_vertex_shader(vertex_source);
+            auto fragment_shader_id =
+                omgl::compile_fragment_shader(fragment_source);
+            programs.push_back(
+                omgl::make_shader_program(vertex_shader_id, fragment_shader_id)
+            );
+            gl::glDeleteShader(vertex_shader_id);
+            gl::glDeleteShader(fragment_shader_id);
+        }
+    } else {
+        for (const auto& [vertex_source, fragment_source] : sources) {
+            programs.push_back(cache.getOrBuild(vertex_source, fragment_source)
+            );
+        }
+    }
+    // make sure nothing is still being compiled in the background
+    gl::glFinish();
+
+    auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start
+    );
+
+    const auto& stats = cache.stats();
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info(
+        "{}: {} programs in {:.1f} ms ({:.2f} ms/program), hits={} misses={} "
+        "rejected={}",
+        mode,
+        program_count,
+        elapsed.count(),
+        elapsed.count() / program_count,
+        stats.hits,
+        stats.misses,
+        stats.rejected
+    );
+
+    auto& state = omgl::StateCache::current();
+    for (auto program : programs) {
+        state.forgetProgram(program);
+        gl::glDeleteProgram(program);
+    }
+
+    glfwTerminate();
+    return 0;
+}
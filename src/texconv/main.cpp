@@ -0,0 +1,86 @@
+// Converts images to .omtx, the layout TextureManager streams without
+// decoding anything.
+//
+//   texconv [--bc1] [--no-mips] input.ppm... output.omtx
+//
+// Several inputs become the layers of one file and have to be the same
+// size. --bc1 block compresses to BC1, an eighth of the size of RGBA8;
+// --no-mips keeps only the full size level.
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <omgl/texture_compression.hpp>
+#include <omgl/texture_file.hpp>
+#include <omgl/texture_manager.hpp>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(
+    int argc,
+    char** argv
+) {
+    bool bc1 = false;
+    bool mips = true;
+    std::vector<fs::path> paths;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--bc1") {
+            bc1 = true;
+        } else if (arg == "--no-mips") {
+            mips = false;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.size() < 2) {
+        spdlog::error(
+            "Usage: texconv [--bc1] [--no-mips] input.ppm... output.omtx"
+        );
+        return 1;
+    }
+    const fs::path output = paths.back();
+    paths.pop_back();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<omgl::TextureImage> layers;
+    std::size_t input_bytes = 0;
+    try {
+        for (const auto& path : paths) {
+            auto image = omgl::decode_ppm(path);
+            if (!mips) {
+                image.levels.resize(1);
+            }
+            if (bc1) {
+                image = omgl::compress_bc1(image);
+            }
+            input_bytes += fs::file_size(path);
+            layers.push_back(std::move(image));
+        }
+        omgl::write_texture_file(output, layers);
+    } catch (const std::exception& error) {
+        spdlog::error("{}", error.what());
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    );
+    const auto& level = layers.front().levels.front();
+    spdlog::info(
+        "{}: {} layer(s) of {}x{}, {} levels, {}, {} KiB from {} KiB in "
+        "{:.2f} s",
+        output.string(),
+        layers.size(),
+        level.width,
+        level.height,
+        layers.front().levels.size(),
+        bc1 ? "BC1" : "RGBA8",
+        fs::file_size(output) / 1024,
+        input_bytes / 1024,
+        elapsed.count()
+    );
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Streams a grid of textures in while drawing it, to show how the frames
+// keep coming while the textures load.
+//
+//   texture_streaming [textures] [size] [budget KiB] [jobs] [ppm|omtx|bc1]
+//
+// Writes `textures` checkerboards of size x size pixels to a temporary
+// directory, then renders offscreen until every one of them is resident and
+// reports when the first usable version and the full version of all of them
+// were there, and the slowest frame on the way. PPMs have to be decoded and
+// mipmapped while loading, .omtx files (converted up front, raw RGBA8 or
+// BC1) are only mapped.
+#include <glbinding/gl/gl.h>
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <omgl/context_info.hpp>
+#include <omgl/headless.hpp>
+#include <omgl/job_system.hpp>
+#include <omgl/shaders.hpp>
+#include <omgl/state_cache.hpp>
+#include <omgl/texture_compression.hpp>
+#include <omgl/texture_file.hpp>
+#include <omgl/texture_manager.hpp>
+#include <omgl/vertex_format.hpp>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const fs::path base = fs::path(__FILE__).parent_path();
+const fs::path shaders_dir = base / "shaders";
+
+// the inputs of textured_quad.vert
+struct QuadVertex {
+    glm::vec2 position;
+    glm::vec2 uv;
+};
+
+template <>
+struct omgl::VertexLayout<QuadVertex> {
+    static constexpr auto fields = std::tuple{
+        vertex_field(0, &QuadVertex::position),
+        vertex_field(1, &QuadVertex::uv),
+    };
+};
+
+// a checkerboard in a color of its own, so a missing texture stands out
+void write_checkerboard(
+    const fs::path& path,
+    std::size_t size,
+    int seed
+) {
+    const std::array<std::uint8_t, 3> color = {
+        static_cast<std::uint8_t>(64 + (seed * 53) % 192),
+        static_cast<std::uint8_t>(64 + (seed * 97) % 192),
+        static_cast<std::uint8_t>(64 + (seed * 31) % 192),
+    };
+    const std::size_t square = std::max<std::size_t>(size / 8, 1);
+
+    std::vector<std::uint8_t> row(size * 3);
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << size << " " << size << "\n255\n";
+    for (std::size_t y = 0; y < size; y++) {
+        for (std::size_t x = 0; x < size; x++) {
+            const bool dark = (x / square + y / square) % 2 == 0;
+            for (int channel = 0; channel < 3; channel++) {
+                row[x * 3 + channel] =
+                    dark ? color[channel] / 3 : color[channel];
+            }
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+}
+
+int main(
+    int argc,
+    char** argv
+) {
+    spdlog::set_level(spdlog::level::debug);
+
+    const int texture_count = argc > 1 ? std::stoi(argv[1]) : 64;
+    const std::size_t texture_size = argc > 2 ? std::stoul(argv[2]) : 1024;
+    const std::size_t budget_kib = argc > 3 ? std::stoul(argv[3]) : 8 * 1024;
+    const std::size_t job_count =
+        argc > 4 ? std::stoul(argv[4]) : omgl::default_worker_count();
+    const std::string file_format = argc > 5 ? argv[5] : "ppm";
+    if (file_format != "ppm" && file_format != "omtx" && file_format != "bc1") {
+        spdlog::error("The format has to be one of ppm, omtx or bc1");
+        return 1;
+    }
+
+    const fs::path texture_dir =
+        fs::temp_directory_path() / "omgl_texture_streaming";
+    fs::create_directories(texture_dir);
+    std::vector<fs::path> texture_paths;
+    for (int i = 0; i < texture_count; i++) {
+        const fs::path ppm_path = texture_dir / std::format("{}.ppm", i);
+        write_checkerboard(ppm_path, texture_size, i);
+        if (file_format == "ppm") {
+            texture_paths.push_back(ppm_path);
+            continue;
+        }
+
+        // what texconv does
+        auto image = omgl::decode_ppm(ppm_path);
+        if (file_format == "bc1") {
+            image = omgl::compress_bc1(image);
+        }
+        texture_paths.push_back(texture_dir / std::format("{}.omtx", i));
+        omgl::write_texture_file(texture_paths.back(), {&image, 1});
+    }
+    spdlog::info(
+        "Wrote {} {}x{} textures as {} to {}",
+        texture_count,
+        texture_size,
+        texture_size,
+        file_format,
+        texture_dir.string()
+    );
+
+    const std::size_t width = 800, height = 800;
+    omgl::HeadlessContext context(width, height);
+    if (file_format == "bc1" &&
+        !omgl::has_extension("GL_EXT_texture_compression_s3tc")) {
+        spdlog::error(
+            "bc1 needs GL_EXT_texture_compression_s3tc, try ppm or omtx"
+        );
+        fs::remove_all(texture_dir);
+        return 1;
+    }
+
+    auto shader_program = omgl::ShaderProgram(
+        shaders_dir / "textured_quad.vert", shaders_dir / "textured_quad.frag"
+    );
+    const auto rect_handle = shader_program.uniformHandle("rect");
+
+    const std::array<QuadVertex, 4> quad_vertices = {{
+        {.position = {0.0f, 0.0f}, .uv = {0.0f, 0.0f}},
+        {.position = {1.0f, 0.0f}, .uv = {1.0f, 0.0f}},
+        {.position = {0.0f, 1.0f}, .uv = {0.0f, 1.0f}},
+        {.position = {1.0f, 1.0f}, .uv = {1.0f, 1.0f}},
+    }};
+
+    auto& state = omgl::StateCache::current();
+
+    gl::GLuint vao_id;
+    gl::glGenVertexArrays(1, &vao_id);
+    state.bindVertexArray(vao_id);
+
+    gl::GLuint vertex_buffer_id;
+    gl::glGenBuffers(1, &vertex_buffer_id);
+    state.bindBuffer(gl::GL_ARRAY_BUFFER, vertex_buffer_id);
+    gl::glBufferData(
+        gl::GL_ARRAY_BUFFER,
+        quad_vertices.size() * sizeof(QuadVertex),
+        quad_vertices.data(),
+        gl::GL_STATIC_DRAW
+    );
+    omgl::apply_vertex_layout<QuadVertex>();
+    omgl::check_vertex_inputs(
+        shader_program.id, omgl::vertex_attributes_of<QuadVertex>
+    );
+
+    omgl::JobSystem jobs(job_count);
+    omgl::TextureManager textures(
+        jobs, {.upload_budget = budget_kib * 1024, .staging_regions = 3}
+    );
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto since_start = [&start] {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    };
+
+    std::vector<omgl::TextureHandle> handles;
+    for (const auto& path : texture_paths) {
+        handles.push_back(textures.load(path));
+    }
+
+    const int grid_size =
+        static_cast<int>(std::ceil(std::sqrt(texture_count)));
+    const float cell = 2.0f / grid_size;
+
+    double all_usable_ms = -1;
+    double max_frame_ms = 0;
+    int frame = 0;
+    while (true) {
+        const auto frame_start = Clock::now();
+
+        textures.update();
+
+        gl::glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        gl::glClear(gl::GL_COLOR_BUFFER_BIT);
+
+        shader_program.use();
+        state.bindVertexArray(vao_id);
+        for (int i = 0; i < texture_count; i++) {
+            state.bindTexture(0, gl::GL_TEXTURE_2D, textures.id(handles[i]));
+            shader_program.setUniform(
+                rect_handle,
+                glm::vec4(
+                    -1.0f + (i % grid_size) * cell,
+                    -1.0f + (i / grid_size) * cell,
+                    cell * 0.9f,
+                    cell * 0.9f
+                )
+            );
+            gl::glDrawArrays(gl::GL_TRIANGLE_STRIP, 0, 4);
+        }
+        // what a swap would do, the frame is done before the next one
+        gl::glFinish();
+        state.endFrame();
+        frame++;
+
+        max_frame_ms = std::max(
+            max_frame_ms,
+            std::chrono::duration<double, std::milli>(
+                Clock::now() - frame_start
+            )
+                .count()
+        );
+
+        const bool all_usable =
+            std::none_of(handles.begin(), handles.end(), [&](auto handle) {
+                return textures.status(handle) ==
+                       omgl::TextureManager::Status::decoding;
+            });
+        if (all_usable_ms < 0 && all_usable) {
+            all_usable_ms = since_start();
+            spdlog::info(
+                "Frame {}: every texture usable after {:.1f} ms",
+                frame,
+                all_usable_ms
+            );
+        }
+        const auto stats = textures.stats();
+        if (stats.resident + stats.failed == stats.loaded) {
+            spdlog::info(
+                "Frame {}: every texture resident after {:.1f} ms",
+                frame,
+                since_start()
+            );
+            break;
+        }
+    }
+
+    spdlog::info("Slowest frame {:.2f} ms", max_frame_ms);
+    textures.logStats();
+
+    state.forgetBuffer(vertex_buffer_id);
+    gl::glDeleteBuffers(1, &vertex_buffer_id);
+    state.forgetVertexArray(vao_id);
+    gl::glDeleteVertexArrays(1, &vao_id);
+    fs::remove_all(texture_dir);
+    return 0;
+}
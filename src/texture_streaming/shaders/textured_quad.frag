@@ -0,0 +1,10 @@
+#version 330 core
+
+uniform sampler2D image;
+
+in vec2 uv;
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(image, uv);
+}
\ No newline at end of file
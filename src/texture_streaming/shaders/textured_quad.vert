@@ -0,0 +1,14 @@
+#version 330 core
+
+layout(location = 0) in vec2 a_pos;
+layout(location = 1) in vec2 a_uv;
+
+// xy is the lower left corner, zw the size
+uniform vec4 rect;
+
+out vec2 uv;
+
+void main() {
+    gl_Position = vec4(rect.xy + a_pos * rect.zw, 0., 1.);
+    uv = a_uv;
+}
\ No newline at end of file
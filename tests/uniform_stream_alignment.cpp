@@ -0,0 +1,96 @@
+// Streams a uniform block through a StreamBuffer for more frames than the
+// ring has regions, several times a frame, and checks that every range
+// bound lands on GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and that GL raised no
+// errors.
+//
+// The regions are deliberately not a multiple of the alignment, so every
+// region after the first starts off it and UniformBuffer::allocate() has to
+// pad. Exits with 1 on the first misaligned range.
+#include <glbinding/gl/gl.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+#include <omgl/headless.hpp>
+#include <omgl/stream_buffer.hpp>
+#include <omgl/uniform_block.hpp>
+
+struct TestUniforms {
+    glm::vec4 color;
+    float scale;
+};
+
+template <>
+struct omgl::UniformBlockLayout<TestUniforms> {
+    static constexpr std::string_view name = "Test";
+    static constexpr auto fields = std::tuple{
+        uniform_field(&TestUniforms::color),
+        uniform_field(&TestUniforms::scale),
+    };
+};
+
+int main() {
+    omgl::HeadlessContext context(64, 64);
+
+    gl::GLint offset_alignment = 256;
+    gl::glGetIntegerv(
+        gl::GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment
+    );
+
+    omgl::UniformBlock<TestUniforms> uniforms;
+
+    const int frame_count = 10;
+    const int sets_per_frame = 3;
+    const std::size_t block_size = omgl::UniformBlock<TestUniforms>::size;
+    // room for every set and the padding in front of it, plus 4 bytes that
+    // push every region after the first off the alignment
+    omgl::StreamBuffer stream(
+        gl::GL_UNIFORM_BUFFER,
+        sets_per_frame * (block_size + offset_alignment) + 4,
+        3,
+        4
+    );
+
+    for (int frame = 0; frame < frame_count; frame++) {
+        stream.beginFrame();
+        for (int set = 0; set < sets_per_frame; set++) {
+            uniforms.set(
+                {.color = glm::vec4(1.0f), .scale = float(set)}, stream
+            );
+
+            gl::GLint64 offset = 0;
+            gl::glGetInteger64i_v(
+                gl::GL_UNIFORM_BUFFER_START,
+                uniforms.gpu().binding(),
+                &offset
+            );
+            if (offset % offset_alignment != 0) {
+                spdlog::error(
+                    "Frame {}, set {}: uniform range at {} isn't aligned to {}",
+                    frame,
+                    set,
+                    offset,
+                    offset_alignment
+                );
+                return 1;
+            }
+        }
+        stream.endFrame();
+    }
+    gl::glFinish();
+
+    if (const auto error = gl::glGetError(); error != gl::GL_NO_ERROR) {
+        spdlog::error(
+            "GL error {:#x} after {} frames",
+            static_cast<unsigned>(error),
+            frame_count
+        );
+        return 1;
+    }
+
+    spdlog::info(
+        "{} frames of {} uniform ranges, all aligned to {}",
+        frame_count,
+        sets_per_frame,
+        offset_alignment
+    );
+    return 0;
+}